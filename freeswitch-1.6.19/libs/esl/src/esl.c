@@ -622,6 +622,8 @@ ESL_DECLARE(esl_status_t) esl_events(esl_handle_t *handle, esl_event_type_t etyp
 		type = "xml";
 	} else if (etype == ESL_EVENT_TYPE_JSON) {
 		type = "json";
+	} else if (etype == ESL_EVENT_TYPE_BINARY) {
+		type = "binary";
 	}
 
 	snprintf(send_buf, sizeof(send_buf), "event %s %s\n\n", type, value);
@@ -1475,6 +1477,10 @@ ESL_DECLARE(esl_status_t) esl_recv_event(esl_handle_t *handle, int check_q, esl_
 				}
 			} else if (!esl_safe_strcasecmp(hval, "text/event-json")) {
 				esl_event_create_json(&handle->last_ievent, revent->body);
+			} else if (!esl_safe_strcasecmp(hval, "text/event-binary")) {
+				if ((cl = esl_event_get_header(revent, "content-length"))) {
+					esl_event_create_compact(&handle->last_ievent, revent->body, atol(cl));
+				}
 			}
 		}
 
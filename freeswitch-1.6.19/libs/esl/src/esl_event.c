@@ -887,6 +887,257 @@ ESL_DECLARE(esl_status_t) esl_event_serialize(esl_event_t *event, char **str, es
 	return ESL_SUCCESS;
 }
 
+/*
+ * Compact wire format sent by mod_event_socket for "event binary":
+ *
+ * version byte, varint header count, then for each header a varint name id
+ * (0 means the name follows inline as a string) and the value as a string,
+ * then the body as a string or a single 0 when there is none.
+ *
+ * A string is a varint length followed by that many bytes and a NUL, so the
+ * receiving side can point straight into the buffer.  Varints are LEB128.
+ *
+ * Ids index the sorted table below, starting from 1.  The table is part of
+ * the protocol: new names mean a new ESL_EVENT_COMPACT_VERSION, and it
+ * must match the table in the FreeSWITCH core (src/switch_event.c).
+ */
+#define ESL_EVENT_COMPACT_VERSION 1
+
+static const char *COMPACT_HEADER_NAMES[] = {
+	"Answer-State", "Application", "Application-Data", "Application-Response", "Application-UUID", "Bridge-A-Unique-ID",
+	"Bridge-B-Unique-ID", "Call-Direction", "Caller-ANI", "Caller-ANI-II", "Caller-Callee-ID-Name",
+	"Caller-Callee-ID-Number", "Caller-Caller-ID-Name", "Caller-Caller-ID-Number", "Caller-Channel-Answered-Time",
+	"Caller-Channel-Bridged-Time", "Caller-Channel-Created-Time", "Caller-Channel-Hangup-Time",
+	"Caller-Channel-Hold-Accum", "Caller-Channel-Last-Hold", "Caller-Channel-Name", "Caller-Channel-Progress-Media-Time",
+	"Caller-Channel-Progress-Time", "Caller-Channel-Resurrect-Time", "Caller-Channel-Transfer-Time", "Caller-Context",
+	"Caller-Destination-Number", "Caller-Dialplan", "Caller-Direction", "Caller-Logical-Direction", "Caller-Network-Addr",
+	"Caller-Orig-Caller-ID-Name", "Caller-Orig-Caller-ID-Number", "Caller-Privacy-Hide-Name",
+	"Caller-Privacy-Hide-Number", "Caller-Profile-Created-Time", "Caller-Profile-Index", "Caller-RDNIS",
+	"Caller-Screen-Bit", "Caller-Source", "Caller-Transfer-Source", "Caller-Unique-ID", "Caller-Username",
+	"Channel-Call-State", "Channel-Call-UUID", "Channel-HIT-Dialplan", "Channel-Name", "Channel-Presence-Data",
+	"Channel-Presence-ID", "Channel-Read-Codec-Bit-Rate", "Channel-Read-Codec-Name", "Channel-Read-Codec-Rate",
+	"Channel-State", "Channel-State-Number", "Channel-Write-Codec-Bit-Rate", "Channel-Write-Codec-Name",
+	"Channel-Write-Codec-Rate", "Content-Length", "Content-Type", "Core-UUID", "DTMF-Digit", "DTMF-Duration",
+	"DTMF-Source", "Event-Calling-File", "Event-Calling-Function", "Event-Calling-Line-Number", "Event-Date-GMT",
+	"Event-Date-Local", "Event-Date-Timestamp", "Event-Info", "Event-Name", "Event-Sequence", "Event-Subclass",
+	"Event-UUID", "FreeSWITCH-Hostname", "FreeSWITCH-IPv4", "FreeSWITCH-IPv6", "FreeSWITCH-Switchname", "Hangup-Cause",
+	"Job-Command", "Job-Command-Arg", "Job-UUID", "Other-Leg-ANI", "Other-Leg-ANI-II", "Other-Leg-Callee-ID-Name",
+	"Other-Leg-Callee-ID-Number", "Other-Leg-Caller-ID-Name", "Other-Leg-Caller-ID-Number",
+	"Other-Leg-Channel-Answered-Time", "Other-Leg-Channel-Bridged-Time", "Other-Leg-Channel-Created-Time",
+	"Other-Leg-Channel-Hangup-Time", "Other-Leg-Channel-Hold-Accum", "Other-Leg-Channel-Last-Hold",
+	"Other-Leg-Channel-Name", "Other-Leg-Channel-Progress-Media-Time", "Other-Leg-Channel-Progress-Time",
+	"Other-Leg-Channel-Resurrect-Time", "Other-Leg-Channel-Transfer-Time", "Other-Leg-Context",
+	"Other-Leg-Destination-Number", "Other-Leg-Dialplan", "Other-Leg-Direction", "Other-Leg-Logical-Direction",
+	"Other-Leg-Network-Addr", "Other-Leg-Orig-Caller-ID-Name", "Other-Leg-Orig-Caller-ID-Number",
+	"Other-Leg-Privacy-Hide-Name", "Other-Leg-Privacy-Hide-Number", "Other-Leg-Profile-Created-Time",
+	"Other-Leg-Profile-Index", "Other-Leg-RDNIS", "Other-Leg-Screen-Bit", "Other-Leg-Source", "Other-Leg-Transfer-Source",
+	"Other-Leg-Unique-ID", "Other-Leg-Username", "Other-Type", "Presence-Call-Direction", "Presence-Data-Cols",
+	"Reply-Text", "Unique-ID"
+};
+
+#define COMPACT_HEADER_COUNT (sizeof(COMPACT_HEADER_NAMES) / sizeof(COMPACT_HEADER_NAMES[0]))
+
+static uint32_t compact_header_id(const char *name)
+{
+	int lo = 0, hi = (int) COMPACT_HEADER_COUNT - 1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		int cmp = strcmp(name, COMPACT_HEADER_NAMES[mid]);
+
+		if (!cmp) {
+			return mid + 1;
+		}
+
+		if (cmp < 0) {
+			hi = mid - 1;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return 0;
+}
+
+typedef struct {
+	uint8_t *buf;
+	esl_size_t len;
+	esl_size_t size;
+} compact_buf_t;
+
+static void compact_reserve(compact_buf_t *cb, esl_size_t need)
+{
+	if (cb->len + need > cb->size) {
+		while (cb->len + need > cb->size) {
+			cb->size *= 2;
+		}
+
+		if (!(cb->buf = realloc(cb->buf, cb->size))) {
+			abort();
+		}
+	}
+}
+
+static void compact_put_varint(compact_buf_t *cb, esl_size_t val)
+{
+	compact_reserve(cb, 10);
+
+	while (val >= 0x80) {
+		cb->buf[cb->len++] = (uint8_t) (val | 0x80);
+		val >>= 7;
+	}
+
+	cb->buf[cb->len++] = (uint8_t) val;
+}
+
+static void compact_put_string(compact_buf_t *cb, const char *str)
+{
+	esl_size_t slen = strlen(str);
+
+	compact_put_varint(cb, slen);
+	compact_reserve(cb, slen + 1);
+	memcpy(cb->buf + cb->len, str, slen + 1);
+	cb->len += slen + 1;
+}
+
+static int compact_get_varint(const uint8_t **p, const uint8_t *end, esl_size_t *val)
+{
+	esl_size_t v = 0;
+	int shift = 0;
+
+	while (*p < end && shift < (int) (sizeof(v) * 8)) {
+		uint8_t c = *(*p)++;
+
+		v |= (esl_size_t) (c & 0x7f) << shift;
+
+		if (!(c & 0x80)) {
+			*val = v;
+			return 1;
+		}
+
+		shift += 7;
+	}
+
+	return 0;
+}
+
+static const char *compact_get_string(const uint8_t **p, const uint8_t *end)
+{
+	esl_size_t slen;
+	const char *str;
+
+	if (!compact_get_varint(p, end, &slen) || slen >= (esl_size_t) (end - *p) || (*p)[slen] != '\0') {
+		return NULL;
+	}
+
+	str = (const char *) *p;
+	*p += slen + 1;
+
+	return str;
+}
+
+ESL_DECLARE(esl_status_t) esl_event_serialize_compact(esl_event_t *event, char **data, esl_size_t *len)
+{
+	compact_buf_t cb = { 0 };
+	esl_event_header_t *hp;
+	esl_size_t count = 0;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		count++;
+	}
+
+	cb.size = 1024;
+	cb.buf = malloc(cb.size);
+	esl_assert(cb.buf);
+
+	cb.buf[cb.len++] = ESL_EVENT_COMPACT_VERSION;
+	compact_put_varint(&cb, count);
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		uint32_t id = compact_header_id(hp->name);
+
+		compact_put_varint(&cb, id);
+
+		if (!id) {
+			compact_put_string(&cb, hp->name);
+		}
+
+		compact_put_string(&cb, hp->value);
+	}
+
+	if (event->body) {
+		compact_put_string(&cb, event->body);
+	} else {
+		compact_put_varint(&cb, 0);
+	}
+
+	*data = (char *) cb.buf;
+	*len = cb.len;
+
+	return ESL_SUCCESS;
+}
+
+ESL_DECLARE(esl_status_t) esl_event_create_compact(esl_event_t **event, const char *data, esl_size_t len)
+{
+	const uint8_t *p = (const uint8_t *) data, *end = p + len;
+	esl_event_t *new_event;
+	esl_size_t count, x;
+
+	if (len < 2 || *p++ != ESL_EVENT_COMPACT_VERSION || !compact_get_varint(&p, end, &count)) {
+		return ESL_FAIL;
+	}
+
+	if (esl_event_create(&new_event, ESL_EVENT_CLONE) != ESL_SUCCESS) {
+		return ESL_FAIL;
+	}
+
+	for (x = 0; x < count; x++) {
+		const char *name = NULL, *value;
+		esl_size_t id;
+
+		if (!compact_get_varint(&p, end, &id) || id > COMPACT_HEADER_COUNT) {
+			goto fail;
+		}
+
+		if (id) {
+			name = COMPACT_HEADER_NAMES[id - 1];
+		} else if (!(name = compact_get_string(&p, end))) {
+			goto fail;
+		}
+
+		if (!(value = compact_get_string(&p, end))) {
+			goto fail;
+		}
+
+		if (!strcasecmp(name, "event-name")) {
+			esl_event_del_header(new_event, "event-name");
+			esl_name_event(value, &new_event->event_id);
+		}
+
+		esl_event_add_header_string(new_event, ESL_STACK_BOTTOM, name, value);
+	}
+
+	if (p < end && *p) {
+		const char *body;
+
+		if (!(body = compact_get_string(&p, end))) {
+			goto fail;
+		}
+
+		new_event->body = strdup(body);
+	}
+
+	*event = new_event;
+
+	return ESL_SUCCESS;
+
+ fail:
+
+	esl_event_destroy(&new_event);
+
+	return ESL_FAIL;
+}
+
 ESL_DECLARE(esl_status_t) esl_event_create_json(esl_event_t **event, const char *json)
 {
 	esl_event_t *new_event;
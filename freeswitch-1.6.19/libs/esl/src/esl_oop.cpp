@@ -280,6 +280,8 @@ int ESLconnection::events(const char *etype, const char *value)
 		type_id = ESL_EVENT_TYPE_XML;
 	} else if (!strcmp(etype, "json")) {
         type_id = ESL_EVENT_TYPE_JSON;
+	} else if (!strcmp(etype, "binary")) {
+		type_id = ESL_EVENT_TYPE_BINARY;
 	}
 
 	return esl_events(&handle, type_id, value);
@@ -56,7 +56,8 @@ typedef enum {
 typedef enum {
 	ESL_EVENT_TYPE_PLAIN,
 	ESL_EVENT_TYPE_XML,
-	ESL_EVENT_TYPE_JSON
+	ESL_EVENT_TYPE_JSON,
+	ESL_EVENT_TYPE_BINARY
 } esl_event_type_t;
 
 #ifdef WIN32
@@ -300,6 +300,22 @@ struct switch_runtime {
 	char *core_db_inner_post_trans_execute;
 	int events_use_dispatch;
 	uint32_t port_alloc_flags;
+	/*! decoded prompts kept in memory, 0 disables the prompt cache */
+	switch_size_t prompt_cache_size;
+	/*! prompts decoding to more than this are played from the file */
+	switch_size_t prompt_cache_max_file_size;
+	/*! files of a phrase, menu or playlist opened ahead of the one playing, 0 disables prefetch */
+	uint32_t prompt_prefetch_depth;
+	/*! threads opening files for sessions, 0 opens them on the session threads */
+	uint32_t file_open_threads;
+	/*! ms a session waits for a file to open before giving up on it, 0 waits as long as it takes */
+	uint32_t file_open_timeout;
+	/*! let format modules read files through a memory mapping */
+	switch_bool_t map_audio_files;
+	/*! threads writing recordings, 0 writes them on the media threads */
+	uint32_t record_writer_threads;
+	/*! bytes of audio each recording may queue for the writers, a power of two */
+	uint32_t record_ring_size;
 };
 
 extern struct switch_runtime runtime;
@@ -327,5 +343,11 @@ void switch_core_sqldb_stop(void);
 void switch_core_session_init(switch_memory_pool_t *pool);
 void switch_core_session_uninit(void);
 void switch_core_state_machine_init(switch_memory_pool_t *pool);
+void switch_core_file_cache_init(switch_memory_pool_t *pool);
+void switch_core_file_cache_uninit(void);
+void switch_core_file_io_init(switch_memory_pool_t *pool);
+void switch_core_file_io_shutdown(void);
+void switch_ivr_record_writer_init(switch_memory_pool_t *pool);
+void switch_ivr_record_writer_shutdown(void);
 switch_memory_pool_t *switch_core_memory_init(void);
 void switch_core_memory_stop(void);
@@ -424,6 +424,26 @@ SWITCH_DECLARE(void) switch_atomic_inc(volatile switch_atomic_t *mem);
  */
 SWITCH_DECLARE(int)  switch_atomic_dec(volatile switch_atomic_t *mem);
 
+/**
+ * Compare the value at the specified memory location with cmp and, if
+ * they are the same, store with there.
+ * @param mem The location of the value.
+ * @param with The value to store if the current value equals cmp.
+ * @param cmp The value to compare it to.
+ * @return the old value of *mem
+ */
+SWITCH_DECLARE(uint32_t) switch_atomic_cas(volatile switch_atomic_t *mem, uint32_t with, uint32_t cmp);
+
+/**
+ * Compare the pointer at the specified memory location with cmp and, if
+ * they are the same, store with there.
+ * @param mem The location of the pointer.
+ * @param with The pointer to store if the current pointer equals cmp.
+ * @param cmp The pointer to compare it to.
+ * @return the old pointer at *mem
+ */
+SWITCH_DECLARE(void *) switch_atomic_casptr(volatile void **mem, void *with, const void *cmp);
+
 /** @} */
 
 /**
@@ -880,8 +900,39 @@ SWITCH_DECLARE(switch_size_t) switch_file_get_size(switch_file_t *thefile);
 
 SWITCH_DECLARE(switch_status_t) switch_file_exists(const char *filename, switch_memory_pool_t *pool);
 
+/**
+ * Get the modification time and size of a file without opening it
+ * @param filename The file to look at
+ * @param mtime Set to the last modification time
+ * @param size Set to the size in bytes
+ * @param pool The pool to use
+ */
+SWITCH_DECLARE(switch_status_t) switch_file_stat(const char *filename, switch_time_t *mtime, switch_size_t *size, switch_memory_pool_t *pool);
+
 SWITCH_DECLARE(switch_status_t) switch_directory_exists(const char *dirname, switch_memory_pool_t *pool);
 
+/** Structure for referencing a read only memory mapped file. */
+	 typedef struct apr_mmap_t switch_mmap_t;
+
+/**
+ * Map part of an open file read only into memory
+ * @param newmmap The newly created mapping
+ * @param data Set to the first mapped byte
+ * @param file The file to map, it may be closed once mapped
+ * @param offset The offset into the file to start mapping at
+ * @param size The number of bytes to map
+ * @param pool The pool to use
+ * @remark Returns SWITCH_STATUS_NOTIMPL where the platform cannot map files
+ */
+SWITCH_DECLARE(switch_status_t) switch_mmap_create(switch_mmap_t **newmmap, const void **data, switch_file_t *file, int64_t offset, switch_size_t size,
+												   switch_memory_pool_t *pool);
+
+/**
+ * Remove a mapping made with switch_mmap_create
+ * @param mm The mapping to remove
+ */
+SWITCH_DECLARE(switch_status_t) switch_mmap_delete(switch_mmap_t *mm);
+
 /**
 * Create a new directory on the file system.
 * @param path the path for the directory to be created. (use / on all systems)
@@ -1164,6 +1215,22 @@ SWITCH_DECLARE(switch_status_t) switch_sockaddr_create(switch_sockaddr_t **sa, s
  */
 SWITCH_DECLARE(switch_status_t) switch_socket_send(switch_socket_t *sock, const char *buf, switch_size_t *len);
 
+/** A region of memory to be gathered into a single write by switch_socket_sendv */
+typedef struct switch_io_vec_s {
+	const char *base;
+	switch_size_t len;
+} switch_io_vec_t;
+
+/**
+ * Send multiple buffers over a network with as few system calls as possible.
+ * @param sock The socket to send the data over.
+ * @param vec The array of buffers to send, in order.
+ * @param nvec The number of buffers in vec.
+ * @param len On exit, the number of bytes sent.
+ * @remark Like switch_socket_send this retries until everything is written or the socket fails.
+ */
+SWITCH_DECLARE(switch_status_t) switch_socket_sendv(switch_socket_t *sock, const switch_io_vec_t *vec, int32_t nvec, switch_size_t *len);
+
 /**
  * @param sock The socket to send from
  * @param where The apr_sockaddr_t describing where to send the data
@@ -1622,6 +1622,14 @@ SWITCH_DECLARE(switch_status_t) switch_core_codec_init_with_bitrate(switch_codec
 SWITCH_DECLARE(switch_status_t) switch_core_codec_copy(switch_codec_t *codec, switch_codec_t *new_codec, 
 													   const switch_codec_settings_t *codec_settings, switch_memory_pool_t *pool);
 SWITCH_DECLARE(switch_status_t) switch_core_codec_parse_fmtp(const char *codec_name, const char *fmtp, uint32_t rate, switch_codec_fmtp_t *codec_fmtp);
+
+/*!
+  \brief Parse a video encoder profile into codec settings
+  \param params semicolon separated list, e.g. "threads=4;cpu-used=-8;token-partitions=4;deadline=realtime;row-mt=true;tile-columns=2"
+  \param codec_settings the settings to update, keys not in the list are left alone
+  \return SWITCH_STATUS_SUCCESS if every key was understood, otherwise codec_settings is not changed
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_codec_parse_video_encoder_params(const char *params, switch_codec_settings_t *codec_settings);
 SWITCH_DECLARE(switch_status_t) switch_core_codec_reset(switch_codec_t *codec);
 
 /*! 
@@ -1940,6 +1948,103 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_command(switch_file_handle_t *f
 SWITCH_DECLARE(switch_status_t) switch_core_file_truncate(switch_file_handle_t *fh, int64_t offset);
 SWITCH_DECLARE(switch_bool_t) switch_core_file_has_video(switch_file_handle_t *fh, switch_bool_t CHECK_OPEN);
 
+/*!
+  \brief Map a file being opened for reading so the format module can serve reads from memory
+  \param fh the file handle being opened
+  \param path the file to map
+  \param offset where the audio starts in the file
+  \return SWITCH_STATUS_SUCCESS if fh->map_data now holds the audio
+  \note the mapping is removed when the handle is closed
+  \note fails unless map-audio-files is enabled in switch.conf
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_file_map(switch_file_handle_t *fh, const char *path, int64_t offset);
+
+/*!
+  \brief Get the next bytes of a mapped native file without copying them
+  \param fh the file handle to read from
+  \param data set to the bytes, valid until the handle is closed and never to be written to
+  \param len the number of bytes wanted
+  \return SWITCH_STATUS_SUCCESS if len bytes were left in the mapping, otherwise read the file as usual
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_file_read_ref(switch_file_handle_t *fh, const void **data, switch_size_t len);
+
+/*!
+  \brief Write the prompt cache usage and hit counters to a stream
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_core_file_cache_status(switch_stream_handle_t *stream);
+
+/*!
+  \brief Drop every prompt from the cache, handles still playing one keep it until closed
+*/
+SWITCH_DECLARE(void) switch_core_file_cache_flush(void);
+
+/*!
+  \brief Open a file on a pool thread ahead of playing it so the real open does not wait on the disk or network
+  \param file the full path or url, as it will be opened for playback
+  \param channels the channels it will be played with
+  \param rate the rate it will be played at
+  \return SWITCH_STATUS_SUCCESS if queued, SWITCH_STATUS_FALSE if already being fetched or too many fetches are running
+
+  Plain files land in the prompt cache when it is enabled and are read through otherwise,
+  http and http_cache urls are opened and closed so mod_http_cache downloads them.
+  Other streams are generated as they play and are skipped.
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_file_prefetch(const char *file, uint32_t channels, uint32_t rate);
+
+/*!
+  \brief Get the number of files to open ahead of the one playing, from prompt-prefetch-depth in switch.conf
+*/
+SWITCH_DECLARE(uint32_t) switch_core_file_prefetch_depth(void);
+
+/*!
+  \brief Create a job to open a file on the file I/O threads
+  \param jobp the new job
+  \param settings a handle that was never opened to take options such as prefix or prebuf from, NULL for none
+  \return SWITCH_STATUS_SUCCESS if the job was created
+
+  The job owns its handle, get it with switch_core_file_open_job_handle.  A caller that stops
+  waiting destroys the job and the I/O thread closes the handle whenever the open returns.
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_file_open_job_create(switch_file_open_job_t **jobp, const switch_file_handle_t *settings);
+
+/*!
+  \brief Get the handle a job opens, valid until the job is destroyed
+*/
+SWITCH_DECLARE(switch_file_handle_t *) switch_core_file_open_job_handle(switch_file_open_job_t *job);
+
+/*!
+  \brief Start opening the job's handle, takes the same arguments as switch_core_file_open
+  \return SWITCH_STATUS_SUCCESS once started, the file is opened inline when no I/O thread can take it
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_file_open_job_start(switch_file_open_job_t *job, const char *file_path, uint32_t channels, uint32_t rate,
+																unsigned int flags);
+
+/*!
+  \brief Wait for a job's open to return
+  \param job the job
+  \param ms the most to wait, 0 to only check
+  \return SWITCH_STATUS_TIMEOUT while still opening, otherwise the status of switch_core_file_open
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_file_open_job_wait(switch_file_open_job_t *job, uint32_t ms);
+
+/*!
+  \brief Close the job's handle if open and free the job, or leave both to the I/O thread if it is still opening
+*/
+SWITCH_DECLARE(void) switch_core_file_open_job_destroy(switch_file_open_job_t **jobp);
+
+/*!
+  \brief Get how long sessions wait for a file to open, from file-open-timeout in switch.conf
+  \return the timeout in ms, 0 for no limit
+*/
+SWITCH_DECLARE(uint32_t) switch_core_file_open_timeout(void);
+
+/*!
+  \brief Write the file I/O thread usage to a stream
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_core_file_io_status(switch_stream_handle_t *stream);
+
 
 ///\}
 
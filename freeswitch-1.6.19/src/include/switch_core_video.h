@@ -255,7 +255,7 @@ SWITCH_DECLARE(void) switch_img_patch_rect(switch_image_t *IMG, int X, int Y, sw
 /*!\brief Copy image to a new image
 *
 * if new_img is NULL, a new image is allocated
-* if new_img is not NULL but not the same size as img,
+* if new_img is not NULL but not the same size as img, or shared,
 *    new_img is destroyed and a new new_img is allocated
 * else, copy the img data to the new_img
 *
@@ -285,6 +285,46 @@ SWITCH_DECLARE(void) switch_img_rotate(switch_image_t **img, switch_image_rotati
 */
 SWITCH_DECLARE(void) switch_img_free(switch_image_t **img);
 
+/*!\brief Take another reference to an image
+*
+* Images from switch_img_alloc() are refcounted, each reference is dropped
+* with switch_img_free() and the storage goes back to the image pool with
+* the last one. A shared image must be treated as read only, use
+* switch_img_copy() to get a private one before drawing on it.
+* Images that did not come from the pool are copied instead.
+*
+* \param[in]    img       Image descriptor
+*
+* \return the new reference, NULL if img could not be copied
+*/
+SWITCH_DECLARE(switch_image_t *) switch_img_ref(switch_image_t *img);
+
+/*!\brief Check if an image has more than one reference
+*
+* \param[in]    img       Image descriptor
+*/
+SWITCH_DECLARE(switch_bool_t) switch_img_shared(switch_image_t *img);
+
+typedef struct switch_img_pool_stats_s {
+	uint64_t allocs;
+	uint64_t hits;
+	uint64_t refs;
+	uint64_t releases;
+	uint32_t in_use;
+	uint32_t cached;
+	switch_size_t cached_bytes;
+	switch_size_t max_bytes;
+} switch_img_pool_stats_t;
+
+SWITCH_DECLARE(void) switch_img_pool_stats(switch_img_pool_stats_t *stats);
+
+/*!\brief Release every image held in the image pool
+*/
+SWITCH_DECLARE(void) switch_img_pool_flush(void);
+
+SWITCH_DECLARE(void) switch_core_video_init(switch_memory_pool_t *pool);
+SWITCH_DECLARE(void) switch_core_video_deinit(void);
+
 SWITCH_DECLARE(void) switch_img_draw_text(switch_image_t *IMG, int x, int y, switch_rgb_color_t color, uint16_t font_size, char *text);
 
 SWITCH_DECLARE(void) switch_img_add_text(void *buffer, int w, int x, int y, char *s);
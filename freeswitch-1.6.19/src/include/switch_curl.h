@@ -53,6 +53,82 @@ SWITCH_DECLARE(void) switch_curl_destroy(void);
 SWITCH_DECLARE(switch_status_t) switch_curl_process_form_post_params(switch_event_t *event, switch_CURL *curl_handle, struct curl_httppost **formpostp);
 #define switch_curl_easy_setopt curl_easy_setopt
 
+typedef struct switch_curl_spool switch_curl_spool_t;
+
+/*! Called on a transfer handle before each POST to set auth, tls and cookie options */
+typedef void (*switch_curl_spool_setup_func_t) (switch_CURL *curl_handle, const char *url, void *user_data);
+/*! Called for every record that could not be delivered or spooled */
+typedef void (*switch_curl_spool_fail_func_t) (const char *id, const char *body, switch_size_t len, void *user_data);
+
+typedef struct {
+	/*! name used in logs and status output */
+	const char *name;
+	const char **urls;
+	int url_count;
+	/*! records are kept here when the queue is full or at shutdown, NULL to disable */
+	const char *spool_dir;
+	/*! most records kept in spool_dir */
+	uint32_t spool_max;
+	/*! records held in memory waiting for a worker */
+	uint32_t queue_size;
+	/*! threads, each driving its own set of keep-alive connections */
+	uint32_t workers;
+	/*! concurrent POSTs per worker */
+	uint32_t connections;
+	/*! most records in one POST, 1 posts each record on its own */
+	uint32_t batch_size;
+	/*! attempts per POST and seconds between them */
+	uint32_t retries;
+	uint32_t delay;
+	/*! transfer and connect timeouts in seconds, 0 for the curl defaults */
+	uint32_t timeout;
+	uint32_t connect_timeout;
+	const char *content_type;
+	const char *user_agent;
+	switch_bool_t disable_expect;
+	/*! put in front of every record, e.g. "cdr=" for form posts */
+	const char *record_prefix;
+	/*! wrapped around and put between the records of a batch */
+	const char *batch_open;
+	const char *batch_separator;
+	const char *batch_close;
+	switch_curl_spool_setup_func_t setup;
+	switch_curl_spool_fail_func_t fail;
+	void *user_data;
+} switch_curl_spool_settings_t;
+
+/*!
+  \brief Start an asynchronous HTTP delivery pipeline
+  \param spool the new spool
+  \param settings delivery settings, strings are copied
+  \param pool pool to allocate from
+
+  Records submitted to the spool are posted by a pool of worker threads
+  using curl multi handles so connections are kept alive between posts.
+  Whatever is waiting in the queue is posted together, up to batch_size
+  records at a time.  Records that do not fit the queue are written to
+  spool_dir and picked up again once the queue drains, including the
+  ones left from a previous run.
+*/
+SWITCH_DECLARE(switch_status_t) switch_curl_spool_create(switch_curl_spool_t **spool, const switch_curl_spool_settings_t *settings, switch_memory_pool_t *pool);
+
+/*!
+  \brief Hand a record to the spool, never blocks on the network
+  \param id record id, sent as uuid= on single record posts and used as the spool file name
+  \param body the record, copied
+  \return SWITCH_STATUS_SUCCESS if queued or spooled, SWITCH_STATUS_FALSE if the fail callback got it
+*/
+SWITCH_DECLARE(switch_status_t) switch_curl_spool_submit(switch_curl_spool_t *spool, const char *id, const char *body);
+
+/*! Write backlog, counters and delivery latency */
+SWITCH_DECLARE(void) switch_curl_spool_status(switch_curl_spool_t *spool, switch_stream_handle_t *stream);
+
+/*! Number of records queued, in flight or spooled to disk */
+SWITCH_DECLARE(uint32_t) switch_curl_spool_backlog(switch_curl_spool_t *spool);
+
+/*! Stop the workers, records still pending are spooled to disk */
+SWITCH_DECLARE(void) switch_curl_spool_destroy(switch_curl_spool_t **spool);
+
 SWITCH_END_EXTERN_C
 																
 #endif
@@ -414,6 +414,21 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_tone_detect_session(switch_core_sessi
 SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *session, switch_file_handle_t *fh, const char *file,
 													 switch_input_args_t *args);
 
+/*!
+  \brief open a file in the background so a later switch_ivr_play_file of it starts without delay
+  \param session the session that will play it, for the sound prefix and codec
+  \param file the file as it would be passed to switch_ivr_play_file, phrases and generated streams are skipped
+  \return SWITCH_STATUS_SUCCESS if the file is being fetched
+*/
+SWITCH_DECLARE(switch_status_t) switch_ivr_prefetch_file(switch_core_session_t *session, const char *file);
+
+/*!
+  \brief get how many files ahead of the playing one should be prefetched
+  \param session the session, its prompt_prefetch_depth variable overrides prompt-prefetch-depth in switch.conf
+  \return the number of files, 0 when prefetch is off
+*/
+SWITCH_DECLARE(uint32_t) switch_ivr_prefetch_depth(switch_core_session_t *session);
+
 SWITCH_DECLARE(switch_status_t) switch_ivr_detect_audio(switch_core_session_t *session, uint32_t thresh, uint32_t audio_hits,
 															uint32_t timeout_ms, const char *file);
 
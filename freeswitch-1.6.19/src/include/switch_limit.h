@@ -109,6 +109,64 @@ SWITCH_DECLARE(void) switch_limit_fire_event(const char *backend, const char *re
 */
 SWITCH_DECLARE(char *) switch_limit_status(const char *backend);
 
+/* Largest max the sliding log behind switch_limit_rate() can enforce */
+#define SWITCH_RATE_LOG_MAX 64
+
+typedef enum {
+	SWITCH_RATE_TOKEN_BUCKET,	/* < Refills max tokens per interval, holds up to burst */
+	SWITCH_RATE_SLIDING_LOG		/* < At most max hits within any interval */
+} switch_rate_algorithm_t;
+
+/*!
+  \brief Create a keyed rate limiter
+  \param limiter the new limiter
+  \param algorithm token bucket or sliding log
+  \param slots number of keys tracked at once, rounded up to a power of 2
+  \param log_size largest max a sliding log can enforce, rounded up to a power of 2, unused for token buckets
+  \param pool the memory pool to allocate from
+  \note Checks never lock or allocate. Keys are tracked by hash, once the
+  table is full idle keys are recycled and busy ones share state.
+*/
+SWITCH_DECLARE(switch_status_t) switch_rate_limiter_create(switch_rate_limiter_t **limiter, switch_rate_algorithm_t algorithm,
+														   uint32_t slots, uint32_t log_size, switch_memory_pool_t *pool);
+
+/*!
+  \brief Count a hit on key
+  \param limiter the limiter
+  \param key the key to count against
+  \param max hits allowed per interval
+  \param interval_ms the interval in milliseconds
+  \param burst token bucket size, 0 means max
+  \return SWITCH_STATUS_SUCCESS if allowed, SWITCH_STATUS_GENERR if over the rate,
+  SWITCH_STATUS_FALSE if max is larger than a sliding log can enforce
+*/
+SWITCH_DECLARE(switch_status_t) switch_rate_limiter_check(switch_rate_limiter_t *limiter, const char *key, uint32_t max, uint32_t interval_ms, uint32_t burst);
+
+/*!
+  \brief Forget the hits counted on key
+*/
+SWITCH_DECLARE(void) switch_rate_limiter_reset(switch_rate_limiter_t *limiter, const char *key);
+
+/*!
+  \brief Parse a rate algorithm name
+  \param name token_bucket or sliding_log
+  \param algorithm the parsed algorithm
+  \return SWITCH_STATUS_SUCCESS if the name is known
+*/
+SWITCH_DECLARE(switch_status_t) switch_rate_str2algorithm(const char *name, switch_rate_algorithm_t *algorithm);
+
+/*!
+  \brief Check a resource against the core rate limiters
+  \param realm
+  \param resource
+  \param algorithm token bucket or sliding log
+  \param max hits allowed per interval
+  \param interval_ms the interval in milliseconds
+  \return SWITCH_STATUS_SUCCESS if allowed, SWITCH_STATUS_GENERR if over the rate,
+  SWITCH_STATUS_FALSE if a sliding log max is above SWITCH_RATE_LOG_MAX
+*/
+SWITCH_DECLARE(switch_status_t) switch_limit_rate(const char *realm, const char *resource, switch_rate_algorithm_t algorithm, uint32_t max, uint32_t interval_ms);
+
 /*! callback to init a backend */
 #define SWITCH_LIMIT_INCR(name) static switch_status_t name (switch_core_session_t *session, const char *realm, const char *resource, const int max, const int interval)
 #define SWITCH_LIMIT_RELEASE(name) static switch_status_t name (switch_core_session_t *session, const char *realm, const char *resource)
@@ -370,6 +370,19 @@ struct switch_file_handle {
 	int64_t duration;
 	/*! current video position, or current page in pdf */
 	int64_t vpos;
+	/*! decoded audio shared from the prompt cache, the file itself is not open when set */
+	void *prompt_cache;
+	/*! read position in the cached audio in samples */
+	switch_size_t prompt_cache_pos;
+	/*! read only mapping of the file made by the format module with switch_core_file_map */
+	switch_mmap_t *map;
+	const uint8_t *map_data;
+	/*! bytes mapped and the read position in them */
+	switch_size_t map_len;
+	switch_size_t map_pos;
+	/*! codec the reader will send, only valid during file_open; a format module that can
+	  produce frames in it may set SWITCH_FILE_NATIVE and return them already encoded */
+	const switch_codec_implementation_t *native_impl;
 };
 
 /*! \brief Abstract interface to an asr module */
@@ -611,6 +624,15 @@ struct switch_video_codec_settings {
 	int32_t width;
 	int32_t height;
 	uint8_t try_hardware_encoder;
+	/* encoder profile, 0 leaves the choice to the codec */
+	int32_t threads;
+	int32_t cpu_used;
+	/* cpu_used was given, 0 is a valid speed */
+	uint8_t cpu_used_set;
+	int32_t token_partitions;
+	int32_t tile_columns;
+	int32_t row_mt;
+	uint32_t deadline;
 };
 
 union switch_codec_settings {
@@ -588,6 +588,12 @@ SWITCH_DECLARE(int) switch_rtp_has_dtls(void);
 
 SWITCH_DECLARE(switch_status_t) switch_rtp_req_bitrate(switch_rtp_t *rtp_session, uint32_t bps);
 SWITCH_DECLARE(switch_status_t) switch_rtp_ack_bitrate(switch_rtp_t *rtp_session, uint32_t bps);
+/*!
+  \brief Get the most recent bitrate the far end asked us to send at (TMMBR or REMB)
+  \param rtp_session the RTP session
+  \return the bitrate in bits per second or 0 if none was received
+*/
+SWITCH_DECLARE(uint32_t) switch_rtp_get_remote_bitrate(switch_rtp_t *rtp_session);
 SWITCH_DECLARE(void) switch_rtp_video_refresh(switch_rtp_t *rtp_session);
 SWITCH_DECLARE(void) switch_rtp_video_loss(switch_rtp_t *rtp_session);
 
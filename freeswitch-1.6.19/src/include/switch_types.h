@@ -227,6 +227,7 @@ SWITCH_BEGIN_EXTERN_C
 #define SWITCH_UUID_BRIDGE "uuid_bridge"
 #define SWITCH_BITS_PER_BYTE 8
 #define SWITCH_DEFAULT_FILE_BUFFER_LEN 65536
+#define SWITCH_DEFAULT_FILE_OPEN_TIMEOUT 5000
 #define SWITCH_DTMF_LOG_LEN 1000
 #define SWITCH_MAX_TRANS 2000
 #define SWITCH_CORE_SESSION_MAX_PRIVATES 2
@@ -1805,6 +1806,7 @@ SWITCH_FILE_PAUSE =             (1 <<  8) - Pause
 SWITCH_FILE_NATIVE =            (1 <<  9) - File is in native format (no transcoding)
 SWITCH_FILE_SEEK = 				(1 << 10) - File has done a seek
 SWITCH_FILE_OPEN =              (1 << 11) - File is open
+SWITCH_FILE_NOCACHE =           (1 << 21) - Always read from the file, never from the prompt cache
 </pre>
  */
 typedef enum {
@@ -1828,7 +1830,8 @@ typedef enum {
 	SWITCH_FILE_NOMUX = (1 << 17),
 	SWITCH_FILE_BREAK_ON_CHANGE = (1 << 18),
 	SWITCH_FILE_FLAG_VIDEO = (1 << 19),
-	SWITCH_FILE_FLAG_VIDEO_EOF = (1 << 20)
+	SWITCH_FILE_FLAG_VIDEO_EOF = (1 << 20),
+	SWITCH_FILE_NOCACHE = (1 << 21)
 } switch_file_flag_enum_t;
 typedef uint32_t switch_file_flag_t;
 
@@ -2188,6 +2191,7 @@ typedef struct switch_rtcp_frame switch_rtcp_frame_t;
 typedef struct switch_channel switch_channel_t;
 typedef struct switch_sql_queue_manager switch_sql_queue_manager_t;
 typedef struct switch_file_handle switch_file_handle_t;
+typedef struct switch_file_open_job switch_file_open_job_t;
 typedef struct switch_core_session switch_core_session_t;
 typedef struct switch_caller_profile switch_caller_profile_t;
 typedef struct switch_caller_extension switch_caller_extension_t;
@@ -2226,6 +2230,7 @@ typedef struct switch_management_interface switch_management_interface_t;
 typedef struct switch_core_port_allocator switch_core_port_allocator_t;
 typedef struct switch_media_bug switch_media_bug_t;
 typedef struct switch_limit_interface switch_limit_interface_t;
+typedef struct switch_rate_limiter switch_rate_limiter_t;
 
 typedef void (*hashtable_destructor_t)(void *ptr);
 
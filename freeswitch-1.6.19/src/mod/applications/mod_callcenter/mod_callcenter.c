@@ -419,12 +419,20 @@ static struct {
 	switch_bool_t reserve_agents;
 	switch_bool_t truncate_tiers;
 	switch_bool_t truncate_agents;
+	switch_bool_t agent_cache;
+	volatile switch_atomic_t agent_cache_generation;
 	int32_t threads;
 	int32_t running;
 	switch_mutex_t *mutex;
 	switch_memory_pool_t *pool;
 } globals;
 
+/* Tell the dispatch thread its copy of the agents and tiers tables is stale */
+static void cc_agent_cache_invalidate(void)
+{
+	switch_atomic_inc(&globals.agent_cache_generation);
+}
+
 #define CC_QUEUE_CONFIGITEM_COUNT 100
 
 struct cc_queue {
@@ -866,6 +874,7 @@ cc_status_t cc_agent_add(const char *agent, const char *type)
 				agent, type, cc_agent_status2str(CC_AGENT_STATUS_LOGGED_OUT), cc_agent_state2str(CC_AGENT_STATE_WAITING));
 		cc_execute_sql(NULL, sql, NULL);
 		switch_safe_free(sql);
+		cc_agent_cache_invalidate();
 
 		if (switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, CALLCENTER_EVENT) == SWITCH_STATUS_SUCCESS) {
 			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "CC-Agent", agent);
@@ -894,6 +903,7 @@ cc_status_t cc_agent_del(const char *agent)
 			agent, agent);
 	cc_execute_sql(NULL, sql, NULL);
 	switch_safe_free(sql);
+	cc_agent_cache_invalidate();
 	return result;
 }
 
@@ -1132,6 +1142,7 @@ cc_status_t cc_agent_update(const char *key, const char *value, const char *agen
 
 done:
 	if (result == CC_STATUS_SUCCESS) {
+		cc_agent_cache_invalidate();
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Updated Agent %s set %s = %s\n", agent, key, value);
 	}
 
@@ -1178,6 +1189,7 @@ cc_status_t cc_tier_add(const char *queue_name, const char *agent, const char *s
 				queue_name, agent, state, level, position);
 		cc_execute_sql(NULL, sql, NULL);
 		switch_safe_free(sql);
+		cc_agent_cache_invalidate();
 
 		result = CC_STATUS_SUCCESS;
 	} else {
@@ -1253,6 +1265,7 @@ cc_status_t cc_tier_update(const char *key, const char *value, const char *queue
 	}
 done:
 	if (result == CC_STATUS_SUCCESS) {
+		cc_agent_cache_invalidate();
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Updated tier: Agent %s in Queue %s set %s = %s\n", agent, queue_name, key, value);
 	}
 	return result;
@@ -1267,6 +1280,7 @@ cc_status_t cc_tier_del(const char *queue_name, const char *agent)
 	sql = switch_mprintf("DELETE FROM tiers WHERE queue = '%q' AND agent = '%q';", queue_name, agent);
 	cc_execute_sql(NULL, sql, NULL);
 	switch_safe_free(sql);
+	cc_agent_cache_invalidate();
 
 	result = CC_STATUS_SUCCESS;
 
@@ -1419,6 +1433,7 @@ static switch_status_t load_config(void)
 	}
 
 	switch_mutex_lock(globals.mutex);
+	globals.agent_cache = SWITCH_TRUE;
 	if ((settings = switch_xml_child(cfg, "settings"))) {
 		for (param = switch_xml_child(settings, "param"); param; param = param->next) {
 			char *var = (char *) switch_xml_attr_soft(param, "name");
@@ -1436,6 +1451,8 @@ static switch_status_t load_config(void)
 				globals.truncate_tiers = switch_true(val);
 			} else if (!strcasecmp(var, "truncate-agents-on-load")) {
 				globals.truncate_agents = switch_true(val);
+			} else if (!strcasecmp(var, "agent-dispatch-cache")) {
+				globals.agent_cache = switch_true(val);
 			}
 		}
 	}
@@ -1447,6 +1464,9 @@ static switch_status_t load_config(void)
 	} else {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Reserving Agents before offering calls.\n");
 	}
+	if (!globals.agent_cache) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Agent dispatch cache disabled, selecting agents from the database for every member.\n");
+	}
 	/* Initialize database */
 	if (!(dbh = cc_get_db_handle())) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Cannot open DB!\n");
@@ -1857,6 +1877,7 @@ static void *SWITCH_THREAD_FUNC outbound_agent_thread_run(switch_thread_t *threa
 								 h->agent_name, h->agent_system);
 			cc_execute_sql(NULL, sql, NULL);
 			switch_safe_free(sql);
+			cc_agent_cache_invalidate();
 			/* Change the agents Status in the tiers */
 			cc_tier_update("state", cc_tier_state2str(CC_TIER_STATE_ACTIVE_INBOUND), h->queue_name, h->agent_name);
 			cc_agent_update("state", cc_agent_state2str(CC_AGENT_STATE_IN_A_QUEUE_CALL), h->agent_name);
@@ -1902,6 +1923,7 @@ static void *SWITCH_THREAD_FUNC outbound_agent_thread_run(switch_thread_t *threa
 					, (strcasecmp(h->agent_type, CC_AGENT_TYPE_UUID_STANDBY)?"uuid = '',":""), local_epoch_time_now(NULL), local_epoch_time_now(NULL), h->agent_name, h->agent_system);
 			cc_execute_sql(NULL, sql, NULL);
 			switch_safe_free(sql);
+			cc_agent_cache_invalidate();
 
 			/* Remove the member entry from the db (Could become optional to support latter processing) */
 			sql = switch_mprintf("DELETE FROM members WHERE system = 'single_box' AND uuid = '%q'", h->member_uuid);
@@ -1979,6 +2001,7 @@ static void *SWITCH_THREAD_FUNC outbound_agent_thread_run(switch_thread_t *threa
 						h->agent_name, h->agent_system);
 				cc_execute_sql(NULL, sql, NULL);
 				switch_safe_free(sql);
+				cc_agent_cache_invalidate();
 
 				/* Put Agent on break because he didn't answer often */
 				if (h->max_no_answer > 0 && (h->no_answer_count + 1) >= h->max_no_answer) {
@@ -2025,6 +2048,7 @@ done:
 			cc_tier_state2str(CC_TIER_STATE_READY), h->agent_name, h->queue_name, cc_tier_state2str(CC_TIER_STATE_STANDBY));
 	cc_execute_sql(NULL, sql, NULL);
 	switch_safe_free(sql);
+	cc_agent_cache_invalidate();
 
 	/* If we are in Status Available On Demand, set state to Idle so we do not receive another call until state manually changed to Waiting */
 	if (!strcasecmp(cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND), h->agent_status)) {
@@ -2245,6 +2269,7 @@ static int agents_callback(void *pArg, int argc, char **argv, char **columnNames
 						cc_tier_state2str(CC_TIER_STATE_STANDBY), h->agent_name, h->queue_name, cc_tier_state2str(CC_TIER_STATE_READY));
 				cc_execute_sql(NULL, sql, NULL);
 				switch_safe_free(sql);
+				cc_agent_cache_invalidate();
 
 				switch_threadattr_create(&thd_attr, h->pool);
 				switch_threadattr_detach_set(thd_attr, 1);
@@ -2262,6 +2287,297 @@ static int agents_callback(void *pArg, int argc, char **argv, char **columnNames
 	}
 }
 
+/* In-memory copy of the agents and tiers tables used by the dispatch thread.
+ * It is reloaded with a single query whenever an agent or tier changes (or
+ * every CC_AGENT_CACHE_REFRESH seconds, to pick up external writers) so each
+ * waiting member is matched without its own agents/tiers join. */
+#define CC_AGENT_CACHE_REFRESH 1
+
+typedef enum {
+	CC_AGENT_CACHE_COL_STATUS = 2,
+	CC_AGENT_CACHE_COL_LAST_BRIDGE_END = 10,
+	CC_AGENT_CACHE_COL_POSITION = 14,
+	CC_AGENT_CACHE_COL_LEVEL,
+	CC_AGENT_CACHE_COL_LAST_OFFERED_CALL = 18,
+	CC_AGENT_CACHE_COL_TALK_TIME,
+	CC_AGENT_CACHE_COL_CALLS_ANSWERED,
+	CC_AGENT_CACHE_COL_QUEUE,
+	CC_AGENT_CACHE_COLS
+} cc_agent_cache_col_t;
+
+typedef enum {
+	CC_AGENT_ORDER_NONE,
+	CC_AGENT_ORDER_POSITION,
+	CC_AGENT_ORDER_POSITION_OFFERED,
+	CC_AGENT_ORDER_IDLE,
+	CC_AGENT_ORDER_TALK_TIME,
+	CC_AGENT_ORDER_CALLS
+} cc_agent_order_t;
+
+typedef struct cc_agent_cache_row_s {
+	char *argv[CC_AGENT_CACHE_COLS];
+	switch_bool_t dispatchable;
+	int level;
+	int position;
+	long last_bridge_end;
+	long last_offered_call;
+	long talk_time;
+	long calls_answered;
+} cc_agent_cache_row_t;
+
+typedef struct cc_agent_cache_queue_s {
+	cc_agent_cache_row_t **rows;
+	int count;
+	int size;
+	cc_agent_order_t order;
+	struct cc_agent_cache_queue_s *next;
+} cc_agent_cache_queue_t;
+
+static struct {
+	switch_memory_pool_t *pool;
+	switch_hash_t *queue_hash;
+	cc_agent_cache_queue_t *queues;
+	uint32_t generation;
+	switch_time_t loaded;
+	uint32_t rand_state;
+} agent_cache;
+
+static cc_agent_order_t cc_agent_cache_sort_order = CC_AGENT_ORDER_NONE;
+
+static void cc_agent_cache_destroy(void)
+{
+	cc_agent_cache_queue_t *q;
+
+	for (q = agent_cache.queues; q; q = q->next) {
+		switch_safe_free(q->rows);
+	}
+	agent_cache.queues = NULL;
+
+	if (agent_cache.queue_hash) {
+		switch_core_hash_destroy(&agent_cache.queue_hash);
+	}
+	if (agent_cache.pool) {
+		switch_core_destroy_memory_pool(&agent_cache.pool);
+	}
+}
+
+static int agent_cache_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	cc_agent_cache_queue_t *q;
+	cc_agent_cache_row_t *row;
+	const char *status;
+	int i;
+
+	if (argc < CC_AGENT_CACHE_COLS || zstr(argv[CC_AGENT_CACHE_COL_QUEUE])) {
+		return 0;
+	}
+
+	if (!(q = switch_core_hash_find(agent_cache.queue_hash, argv[CC_AGENT_CACHE_COL_QUEUE]))) {
+		q = switch_core_alloc(agent_cache.pool, sizeof(*q));
+		switch_core_hash_insert(agent_cache.queue_hash, argv[CC_AGENT_CACHE_COL_QUEUE], q);
+		q->next = agent_cache.queues;
+		agent_cache.queues = q;
+	}
+
+	if (q->count == q->size) {
+		q->size = q->size ? q->size * 2 : 32;
+		q->rows = realloc(q->rows, q->size * sizeof(*q->rows));
+		switch_assert(q->rows);
+	}
+
+	row = switch_core_alloc(agent_cache.pool, sizeof(*row));
+	for (i = 0; i < CC_AGENT_CACHE_COLS; i++) {
+		row->argv[i] = argv[i] ? switch_core_strdup(agent_cache.pool, argv[i]) : NULL;
+	}
+
+	status = switch_str_nil(argv[CC_AGENT_CACHE_COL_STATUS]);
+	row->dispatchable = (!strcasecmp(status, cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE)) ||
+						 !strcasecmp(status, cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK)) ||
+						 !strcasecmp(status, cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND)));
+	row->level = atoi(switch_str_nil(argv[CC_AGENT_CACHE_COL_LEVEL]));
+	row->position = atoi(switch_str_nil(argv[CC_AGENT_CACHE_COL_POSITION]));
+	row->last_bridge_end = atol(switch_str_nil(argv[CC_AGENT_CACHE_COL_LAST_BRIDGE_END]));
+	row->last_offered_call = atol(switch_str_nil(argv[CC_AGENT_CACHE_COL_LAST_OFFERED_CALL]));
+	row->talk_time = atol(switch_str_nil(argv[CC_AGENT_CACHE_COL_TALK_TIME]));
+	row->calls_answered = atol(switch_str_nil(argv[CC_AGENT_CACHE_COL_CALLS_ANSWERED]));
+
+	q->rows[q->count++] = row;
+	q->order = CC_AGENT_ORDER_NONE;
+
+	return 0;
+}
+
+static void cc_agent_cache_refresh(void)
+{
+	uint32_t generation = switch_atomic_read(&globals.agent_cache_generation);
+	switch_time_t now = local_epoch_time_now(NULL);
+	char *sql;
+
+	if (agent_cache.pool && agent_cache.generation == generation && now - agent_cache.loaded < CC_AGENT_CACHE_REFRESH) {
+		return;
+	}
+
+	cc_agent_cache_destroy();
+	switch_core_new_memory_pool(&agent_cache.pool);
+	switch_core_hash_init(&agent_cache.queue_hash);
+
+	/* Taken before the query, so a change racing with it triggers another reload */
+	agent_cache.generation = generation;
+	agent_cache.loaded = now;
+
+	sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position, tiers.level, agents.type, agents.uuid, agents.last_offered_call, agents.talk_time, agents.calls_answered, tiers.queue"
+			" FROM agents JOIN tiers ON (agents.name = tiers.agent)");
+	cc_execute_sql_callback(NULL /* queue */, NULL /* mutex */, sql, agent_cache_callback, NULL /* Call back variables */);
+	switch_safe_free(sql);
+}
+
+#define CC_AGENT_CACHE_CMP(_a, _b) if ((_a) != (_b)) return (_a) < (_b) ? -1 : 1
+
+static int cc_agent_cache_cmp(const void *va, const void *vb)
+{
+	const cc_agent_cache_row_t *a = *(const cc_agent_cache_row_t **) va;
+	const cc_agent_cache_row_t *b = *(const cc_agent_cache_row_t **) vb;
+
+	CC_AGENT_CACHE_CMP(a->level, b->level);
+
+	switch (cc_agent_cache_sort_order) {
+	case CC_AGENT_ORDER_IDLE:
+		CC_AGENT_CACHE_CMP(a->last_bridge_end, b->last_bridge_end);
+		break;
+	case CC_AGENT_ORDER_TALK_TIME:
+		CC_AGENT_CACHE_CMP(a->talk_time, b->talk_time);
+		break;
+	case CC_AGENT_ORDER_CALLS:
+		CC_AGENT_CACHE_CMP(a->calls_answered, b->calls_answered);
+		break;
+	default:
+		break;
+	}
+
+	CC_AGENT_CACHE_CMP(a->position, b->position);
+
+	if (cc_agent_cache_sort_order == CC_AGENT_ORDER_POSITION_OFFERED) {
+		CC_AGENT_CACHE_CMP(a->last_offered_call, b->last_offered_call);
+	}
+
+	return 0;
+}
+
+/* xorshift for the random strategy, seeded on first use rather than relying on anyone calling srand() */
+static uint32_t cc_agent_cache_rand(void)
+{
+	uint32_t x = agent_cache.rand_state;
+
+	if (!x) {
+		switch_rtp_get_random(&x, sizeof(x));
+		x |= 1;
+	}
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return agent_cache.rand_state = x;
+}
+
+/* Same ordering as the ORDER BY members_callback() uses for the strategy */
+static cc_agent_order_t cc_agent_cache_strategy_order(const char *strategy)
+{
+	if (!strcasecmp(strategy, "longest-idle-agent")) {
+		return CC_AGENT_ORDER_IDLE;
+	} else if (!strcasecmp(strategy, "agent-with-least-talk-time")) {
+		return CC_AGENT_ORDER_TALK_TIME;
+	} else if (!strcasecmp(strategy, "agent-with-fewest-calls")) {
+		return CC_AGENT_ORDER_CALLS;
+	} else if (!strcasecmp(strategy, "ring-all") || !strcasecmp(strategy, "ring-progressively") || !strcasecmp(strategy, "random")) {
+		return CC_AGENT_ORDER_POSITION;
+	}
+
+	return CC_AGENT_ORDER_POSITION_OFFERED;
+}
+
+/* Offer the member to the queue's agents in strategy order, the way the per member SQL result would have been walked */
+static void cc_agent_cache_dispatch(agent_callback_t *cbt, switch_bool_t top_down, int top_position, int top_level)
+{
+	cc_agent_cache_queue_t *q;
+	cc_agent_cache_row_t **rows, **shuffled = NULL;
+	cc_agent_order_t order;
+	switch_bool_t dyn = SWITCH_FALSE;
+	int position = top_position, level = top_level;
+	int i;
+
+	cc_agent_cache_refresh();
+
+	if (!(q = switch_core_hash_find(agent_cache.queue_hash, cbt->queue_name)) || !q->count) {
+		return;
+	}
+
+	order = cc_agent_cache_strategy_order(cbt->strategy);
+	if (q->order != order) {
+		cc_agent_cache_sort_order = order;
+		qsort(q->rows, q->count, sizeof(*q->rows), cc_agent_cache_cmp);
+		q->order = order;
+	}
+	rows = q->rows;
+
+	if (top_down) {
+		dyn = SWITCH_TRUE;
+	} else if (!strcasecmp(cbt->strategy, "round-robin")) {
+		long last_offered_call = 0;
+
+		/* Resume after the agent that was offered a call last */
+		for (i = 0; i < q->count; i++) {
+			if (rows[i]->last_offered_call > last_offered_call) {
+				last_offered_call = rows[i]->last_offered_call;
+				position = rows[i]->position;
+				level = rows[i]->level;
+				dyn = SWITCH_TRUE;
+			}
+		}
+	}
+
+	if (dyn) {
+		for (i = 0; i < q->count; i++) {
+			if (rows[i]->dispatchable && rows[i]->level == level && rows[i]->position > position) {
+				if (agents_callback(cbt, CC_AGENT_CACHE_COLS, rows[i]->argv, NULL)) {
+					return;
+				}
+			}
+		}
+	}
+
+	if (!strcasecmp(cbt->strategy, "random")) {
+		int start = 0;
+
+		switch_zmalloc(shuffled, q->count * sizeof(*shuffled));
+		memcpy(shuffled, q->rows, q->count * sizeof(*shuffled));
+
+		/* Shuffle within each tier level */
+		for (i = 1; i <= q->count; i++) {
+			if (i == q->count || shuffled[i]->level != shuffled[start]->level) {
+				int j;
+
+				for (j = i - 1; j > start; j--) {
+					int k = start + cc_agent_cache_rand() % (j - start + 1);
+					cc_agent_cache_row_t *tmp = shuffled[j];
+					shuffled[j] = shuffled[k];
+					shuffled[k] = tmp;
+				}
+				start = i;
+			}
+		}
+		rows = shuffled;
+	}
+
+	for (i = 0; i < q->count; i++) {
+		if (rows[i]->dispatchable && agents_callback(cbt, CC_AGENT_CACHE_COLS, rows[i]->argv, NULL)) {
+			break;
+		}
+	}
+
+	switch_safe_free(shuffled);
+}
+
 static int members_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	cc_queue_t *queue = NULL;
@@ -2281,6 +2597,8 @@ static int members_callback(void *pArg, int argc, char **argv, char **columnName
 	const char *member_abandoned_epoch = NULL;
 	const char *serving_agent = NULL;
 	const char *last_originated_call = NULL;
+	int position = 0, level = 0;
+	switch_bool_t use_cache = globals.agent_cache;
 	memset(&cbt, 0, sizeof(cbt));
 
 	cbt.queue_name = argv[0];
@@ -2402,7 +2720,6 @@ static int members_callback(void *pArg, int argc, char **argv, char **columnName
 	if (!strcasecmp(queue->strategy, "top-down")) {
 		/* WARNING this use channel variable to help dispatch... might need to be reviewed to save it in DB to make this multi server prooft in the future */
 		switch_core_session_t *member_session = switch_core_session_locate(cbt.member_session_uuid);
-		int position = 0, level = 0;
 		const char *last_agent_tier_position, *last_agent_tier_level;
 		if (member_session) {
 			switch_channel_t *member_channel = switch_core_session_get_channel(member_session);
@@ -2416,74 +2733,81 @@ static int members_callback(void *pArg, int argc, char **argv, char **columnName
 			switch_core_session_rwunlock(member_session);
 		}
 
-		sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 1 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
-				" WHERE tiers.queue = '%q'"
-				" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
-				" AND tiers.position > %d"
-				" AND tiers.level = %d"
-				" UNION "
-				"SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 2 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
-				" WHERE tiers.queue = '%q'"
-				" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
-				" ORDER BY dyn_order asc, tiers_level, tiers_position, agents_last_offered_call",
-				queue_name,
-				cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND),
-				position,
-				level,
-				queue_name,
-				cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND)
-				);
+		if (!use_cache) {
+			sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 1 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
+					" WHERE tiers.queue = '%q'"
+					" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
+					" AND tiers.position > %d"
+					" AND tiers.level = %d"
+					" UNION "
+					"SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 2 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
+					" WHERE tiers.queue = '%q'"
+					" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
+					" ORDER BY dyn_order asc, tiers_level, tiers_position, agents_last_offered_call",
+					queue_name,
+					cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND),
+					position,
+					level,
+					queue_name,
+					cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND)
+					);
+		}
 	} else if (!strcasecmp(queue->strategy, "round-robin")) {
-		sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 1 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
-				" WHERE tiers.queue = '%q'"
-				" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
-				" AND tiers.position > (SELECT tiers.position FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent) WHERE tiers.queue = '%q' AND agents.last_offered_call > 0 ORDER BY agents.last_offered_call DESC LIMIT 1)"
-				" AND tiers.level = (SELECT tiers.level FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent) WHERE tiers.queue = '%q' AND agents.last_offered_call > 0 ORDER BY agents.last_offered_call DESC LIMIT 1)"
-				" UNION "
-				"SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 2 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
-				" WHERE tiers.queue = '%q'"
-				" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
-				" ORDER BY dyn_order asc, tiers_level, tiers_position, agents_last_offered_call",
-				queue_name,
-				cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND),
-				queue_name,
-				queue_name,
-				queue_name,
-				cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND)
-				);
-
+		if (!use_cache) {
+			sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 1 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
+					" WHERE tiers.queue = '%q'"
+					" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
+					" AND tiers.position > (SELECT tiers.position FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent) WHERE tiers.queue = '%q' AND agents.last_offered_call > 0 ORDER BY agents.last_offered_call DESC LIMIT 1)"
+					" AND tiers.level = (SELECT tiers.level FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent) WHERE tiers.queue = '%q' AND agents.last_offered_call > 0 ORDER BY agents.last_offered_call DESC LIMIT 1)"
+					" UNION "
+					"SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position as tiers_position, tiers.level as tiers_level, agents.type, agents.uuid, agents.last_offered_call as agents_last_offered_call, 2 as dyn_order FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
+					" WHERE tiers.queue = '%q'"
+					" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
+					" ORDER BY dyn_order asc, tiers_level, tiers_position, agents_last_offered_call",
+					queue_name,
+					cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND),
+					queue_name,
+					queue_name,
+					queue_name,
+					cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND)
+					);
+		}
 	} else {
-
-		if (!strcasecmp(queue->strategy, "longest-idle-agent")) {
-			sql_order_by = switch_mprintf("level, agents.last_bridge_end, position");
-		} else if (!strcasecmp(queue_strategy, "agent-with-least-talk-time")) {
-			sql_order_by = switch_mprintf("level, agents.talk_time, position");
-		} else if (!strcasecmp(queue_strategy, "agent-with-fewest-calls")) {
-			sql_order_by = switch_mprintf("level, agents.calls_answered, position");
-		} else if (!strcasecmp(queue_strategy, "ring-all") || !strcasecmp(queue_strategy, "ring-progressively")) {
+		if (!strcasecmp(queue_strategy, "ring-all") || !strcasecmp(queue_strategy, "ring-progressively")) {
 			sql = switch_mprintf("UPDATE members SET state = '%q' WHERE state = '%q' AND uuid = '%q' AND system = 'single_box'",
 					cc_member_state2str(CC_MEMBER_STATE_TRYING), cc_member_state2str(CC_MEMBER_STATE_WAITING), cbt.member_uuid);
 			cc_execute_sql(NULL, sql, NULL);
 			switch_safe_free(sql);
-			sql_order_by = switch_mprintf("level, position");
-		} else if(!strcasecmp(queue_strategy, "random")) {
-			sql_order_by = switch_mprintf("level, random()");
-		} else if(!strcasecmp(queue_strategy, "sequentially-by-agent-order")) {
-			sql_order_by = switch_mprintf("level, position, agents.last_offered_call"); /* Default to last_offered_call, let add new strategy if needing it differently */
-		} else {
-			/* If the strategy doesn't exist, just fallback to the following */
-			sql_order_by = switch_mprintf("level, position, agents.last_offered_call");
 		}
 
-		sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position, tiers.level, agents.type, agents.uuid FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
-				" WHERE tiers.queue = '%q'"
-				" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
-				" ORDER BY %q",
-				queue_name,
-				cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND),
-				sql_order_by);
-		switch_safe_free(sql_order_by);
+		/* the agent cache sorts its own rows for the strategy */
+		if (!use_cache) {
+			if (!strcasecmp(queue->strategy, "longest-idle-agent")) {
+				sql_order_by = switch_mprintf("level, agents.last_bridge_end, position");
+			} else if (!strcasecmp(queue_strategy, "agent-with-least-talk-time")) {
+				sql_order_by = switch_mprintf("level, agents.talk_time, position");
+			} else if (!strcasecmp(queue_strategy, "agent-with-fewest-calls")) {
+				sql_order_by = switch_mprintf("level, agents.calls_answered, position");
+			} else if (!strcasecmp(queue_strategy, "ring-all") || !strcasecmp(queue_strategy, "ring-progressively")) {
+				sql_order_by = switch_mprintf("level, position");
+			} else if(!strcasecmp(queue_strategy, "random")) {
+				sql_order_by = switch_mprintf("level, random()");
+			} else if(!strcasecmp(queue_strategy, "sequentially-by-agent-order")) {
+				sql_order_by = switch_mprintf("level, position, agents.last_offered_call"); /* Default to last_offered_call, let add new strategy if needing it differently */
+			} else {
+				/* If the strategy doesn't exist, just fallback to the following */
+				sql_order_by = switch_mprintf("level, position, agents.last_offered_call");
+			}
 
+			sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.position, tiers.level, agents.type, agents.uuid FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
+					" WHERE tiers.queue = '%q'"
+					" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
+					" ORDER BY %q",
+					queue_name,
+					cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND),
+					sql_order_by);
+			switch_safe_free(sql_order_by);
+		}
 	}
 
 	if (!strcasecmp(queue->strategy, "ring-progressively")) {
@@ -2504,7 +2828,11 @@ static int members_callback(void *pArg, int argc, char **argv, char **columnName
 		}
 	}
 
-	cc_execute_sql_callback(NULL /* queue */, NULL /* mutex */, sql, agents_callback, &cbt /* Call back variables */);
+	if (use_cache) {
+		cc_agent_cache_dispatch(&cbt, !strcasecmp(queue_strategy, "top-down"), position, level);
+	} else {
+		cc_execute_sql_callback(NULL /* queue */, NULL /* mutex */, sql, agents_callback, &cbt /* Call back variables */);
+	}
 
 	switch_safe_free(sql);
 
@@ -2564,6 +2892,8 @@ void *SWITCH_THREAD_FUNC cc_agent_dispatch_thread_run(switch_thread_t *thread, v
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Agent Dispatch Thread Ended\n");
 
+	cc_agent_cache_destroy();
+
 	switch_mutex_lock(globals.mutex);
 	globals.threads--;
 	AGENT_DISPATCH_THREAD_RUNNING = AGENT_DISPATCH_THREAD_STARTED = 0;
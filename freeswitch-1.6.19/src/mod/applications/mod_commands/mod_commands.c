@@ -685,6 +685,35 @@ end:
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_STANDARD_API(prompt_cache_function)
+{
+	if (zstr(cmd)) {
+		stream->write_function(stream, "%s", "parameter missing\n");
+	} else if (!strcasecmp(cmd, "status")) {
+		switch_core_file_cache_status(stream);
+	} else if (!strcasecmp(cmd, "flush")) {
+		switch_core_file_cache_flush();
+		stream->write_function(stream, "+OK\n");
+	} else {
+		stream->write_function(stream, "-USAGE: status|flush\n");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_STANDARD_API(file_io_function)
+{
+	if (zstr(cmd)) {
+		stream->write_function(stream, "%s", "parameter missing\n");
+	} else if (!strcasecmp(cmd, "status")) {
+		switch_core_file_io_status(stream);
+	} else {
+		stream->write_function(stream, "-USAGE: status\n");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(db_cache_function)
 {
 	int argc;
@@ -716,6 +745,36 @@ SWITCH_STANDARD_API(db_cache_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define IMAGE_POOL_SYNTAX "[status|flush]"
+SWITCH_STANDARD_API(image_pool_function)
+{
+	switch_img_pool_stats_t stats;
+
+	if (!zstr(cmd) && !strcasecmp(cmd, "flush")) {
+		switch_img_pool_flush();
+		stream->write_function(stream, "+OK\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!zstr(cmd) && strcasecmp(cmd, "status")) {
+		stream->write_function(stream, "-USAGE: %s\n", IMAGE_POOL_SYNTAX);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_img_pool_stats(&stats);
+
+	stream->write_function(stream, "allocs: %" SWITCH_UINT64_T_FMT "\n", stats.allocs);
+	stream->write_function(stream, "hits: %" SWITCH_UINT64_T_FMT " (%0.2f%%)\n", stats.hits,
+						   stats.allocs ? (double) stats.hits * 100 / stats.allocs : 0);
+	stream->write_function(stream, "releases: %" SWITCH_UINT64_T_FMT "\n", stats.releases);
+	stream->write_function(stream, "shared refs: %" SWITCH_UINT64_T_FMT "\n", stats.refs);
+	stream->write_function(stream, "in use: %u\n", stats.in_use);
+	stream->write_function(stream, "cached: %u images, %" SWITCH_SIZE_T_FMT "/%" SWITCH_SIZE_T_FMT " bytes\n",
+						   stats.cached, stats.cached_bytes, stats.max_bytes);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(host_lookup_function)
 {
 	char host[256] = "";
@@ -7213,6 +7272,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "group_call", "Generate a dial string to call a group", group_call_function, "<group>[@<domain>]");
 	SWITCH_ADD_API(commands_api_interface, "help", "Show help for all the api commands", help_function, "");
 	SWITCH_ADD_API(commands_api_interface, "host_lookup", "Lookup host", host_lookup_function, "<hostname>");
+	SWITCH_ADD_API(commands_api_interface, "image_pool", "Show or flush the video image pool", image_pool_function, IMAGE_POOL_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "hostname", "Return the system hostname", hostname_api_function, "");
 	SWITCH_ADD_API(commands_api_interface, "interface_ip", "Return the primary IP of an interface", interface_ip_function, INTERFACE_IP_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "switchname", "Return the switch name", switchname_api_function, "");
@@ -7235,6 +7295,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "nat_map", "Manage NAT", nat_map_function, "[status|republish|reinit] | [add|del] <port> [tcp|udp] [static]");
 	SWITCH_ADD_API(commands_api_interface, "originate", "Originate a call", originate_function, ORIGINATE_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "pause", "Pause media on a channel", pause_function, PAUSE_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "prompt_cache", "Manage the decoded prompt cache", prompt_cache_function, "status|flush");
+	SWITCH_ADD_API(commands_api_interface, "file_io", "Show the file open threads", file_io_function, "status");
 	SWITCH_ADD_API(commands_api_interface, "quote_shell_arg", "Quote/escape a string for use on shell command line", quote_shell_arg_function, "<data>");
 	SWITCH_ADD_API(commands_api_interface, "regex", "Evaluate a regex", regex_function, "<data>|<pattern>[|<subst string>][n|b]");
 	SWITCH_ADD_API(commands_api_interface, "reloadacl", "Reload XML", reload_acl_function, "");
@@ -7341,6 +7403,11 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add complete add");
 	switch_console_set_complete("add complete del");
 	switch_console_set_complete("add db_cache status");
+	switch_console_set_complete("add prompt_cache status");
+	switch_console_set_complete("add prompt_cache flush");
+	switch_console_set_complete("add file_io status");
+	switch_console_set_complete("add image_pool status");
+	switch_console_set_complete("add image_pool flush");
 	switch_console_set_complete("add fsctl debug_level");
 	switch_console_set_complete("add fsctl debug_pool");
 	switch_console_set_complete("add fsctl debug_sql");
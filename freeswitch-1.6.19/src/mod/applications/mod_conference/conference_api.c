@@ -1218,7 +1218,9 @@ switch_status_t conference_api_sub_vid_bandwidth(conference_obj_t *conference, s
 		if (conference->canvases[i]) {
 			stream->write_function(stream, "Set Bandwidth for canvas %d to %d\n", i + 1, video_write_bandwidth);
 			x++;
+			switch_mutex_lock(conference->canvases[i]->mutex);
 			conference->canvases[i]->video_write_bandwidth = video_write_bandwidth;
+			switch_mutex_unlock(conference->canvases[i]->mutex);
 		}
 	}
 
@@ -1662,6 +1664,48 @@ switch_status_t conference_api_sub_list(conference_obj_t *conference, switch_str
 
 			stream->write_function(stream, ")\n");
 
+			if (summary && conference_utils_test_flag(conference, CFLAG_VIDEO_MUXING)) {
+				uint32_t j;
+
+				switch_mutex_lock(conference->canvas_mutex);
+				for (j = 0; j < conference->canvas_count; j++) {
+					mcu_canvas_t *canvas = conference->canvases[j];
+
+					if (!canvas) continue;
+
+					stream->write_function(stream, "  canvas %d: %dx%d layers %d/%d patch_threads %d render %0.2fms avg %0.2fms max %0.2fms\n",
+										   canvas->canvas_id + 1, canvas->width, canvas->height,
+										   canvas->layers_used, canvas->total_layers, canvas->patch_thread_count,
+										   (double) canvas->render_time / 1000,
+										   canvas->render_count ? (double) canvas->render_time_total / canvas->render_count / 1000 : 0,
+										   (double) canvas->render_time_max / 1000);
+
+					if (canvas->encode_count) {
+						stream->write_function(stream, "    encode %0.2fms avg %0.2fms max %0.2fms\n",
+											   (double) canvas->encode_time / 1000,
+											   (double) canvas->encode_time_total / canvas->encode_count / 1000,
+											   (double) canvas->encode_time_max / 1000);
+					}
+
+					if (conference->video_ladder_rungs) {
+						int r;
+
+						stream->write_function(stream, "    ladder:");
+
+						for (r = 0; r < conference->video_ladder_rungs; r++) {
+							video_ladder_rung_t *lr = &conference->video_ladder[r];
+
+							stream->write_function(stream, " %dx%d@%dkbps (%d)",
+												   lr->width ? lr->width : canvas->width, lr->height ? lr->height : canvas->height,
+												   lr->bandwidth, canvas->ladder_members[r]);
+						}
+
+						stream->write_function(stream, "\n");
+					}
+				}
+				switch_mutex_unlock(conference->canvas_mutex);
+			}
+
 			count++;
 			if (!summary) {
 				if (pretty) {
@@ -811,7 +811,7 @@ switch_status_t conference_member_add(conference_obj_t *conference, conference_m
 			if ((var = switch_channel_get_variable(member->channel, "rtp_video_max_bandwidth_out"))) {
 				member->max_bw_out = switch_parse_bandwidth_string(var);
 
-				if (member->max_bw_out < conference->video_codec_settings.video.bandwidth) {
+				if (member->max_bw_out < conference->video_codec_settings.video.bandwidth && !conference->video_ladder_rungs) {
 					conference_utils_member_set_flag_locked(member, MFLAG_NO_MINIMIZE_ENCODING);
 					switch_core_media_set_outgoing_bitrate(member->session, SWITCH_MEDIA_TYPE_VIDEO, member->max_bw_out);
 				}
@@ -361,19 +361,17 @@ void conference_video_reset_layer(mcu_layer_t *layer)
 	switch_img_free(&layer->cur_img);
 }
 
-void conference_video_scale_and_patch(mcu_layer_t *layer, switch_image_t *ximg, switch_bool_t freeze)
+/* called with the canvas mutex held, by the canvas owner or by a patch thread working for it */
+static void patch_layer(mcu_layer_t *layer, switch_image_t *ximg, switch_bool_t freeze)
 {
 	switch_image_t *IMG, *img;
 
-	switch_mutex_lock(layer->canvas->mutex);
-
 	IMG = layer->canvas->img;
 	img = ximg ? ximg : layer->cur_img;
 
 	switch_assert(IMG);
 
 	if (!img) {
-		switch_mutex_unlock(layer->canvas->mutex);
 		return;
 	}
 
@@ -520,10 +518,142 @@ void conference_video_scale_and_patch(mcu_layer_t *layer, switch_image_t *ximg,
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG10, "insert at %d,%d\n", 0, 0);
 		switch_img_patch(IMG, img, 0, 0);
 	}
+}
 
+void conference_video_scale_and_patch(mcu_layer_t *layer, switch_image_t *ximg, switch_bool_t freeze)
+{
+	switch_mutex_lock(layer->canvas->mutex);
+	patch_layer(layer, ximg, freeze);
 	switch_mutex_unlock(layer->canvas->mutex);
 }
 
+static void *SWITCH_THREAD_FUNC conference_video_encode_thread_run(switch_thread_t *thread, void *obj);
+
+static void *SWITCH_THREAD_FUNC conference_video_patch_thread_run(switch_thread_t *thread, void *obj)
+{
+	mcu_canvas_t *canvas = (mcu_canvas_t *) obj;
+	void *pop;
+
+	while (switch_queue_pop(canvas->patch_queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		mcu_layer_t *layer = (mcu_layer_t *) pop;
+
+		patch_layer(layer, NULL, SWITCH_FALSE);
+
+		switch_mutex_lock(canvas->patch_mutex);
+		if (!--canvas->patch_pending) {
+			switch_thread_cond_signal(canvas->patch_cond);
+		}
+		switch_mutex_unlock(canvas->patch_mutex);
+	}
+
+	return NULL;
+}
+
+static void conference_video_launch_patch_threads(mcu_canvas_t *canvas)
+{
+	conference_obj_t *conference = canvas->conference;
+	switch_threadattr_t *thd_attr = NULL;
+	int cpus = switch_core_cpu_count();
+	int count = conference->video_mux_threads;
+	int i;
+
+	if (count < 0) {
+		/* auto: leave a core for the canvas thread itself, every canvas of every conference gets its own */
+		count = cpus > 2 ? cpus - 1 : 0;
+
+		if (count > MCU_AUTO_PATCH_THREADS) {
+			count = MCU_AUTO_PATCH_THREADS;
+		}
+	}
+
+	/* more threads than cores only adds switching */
+	if (count > cpus) {
+		count = cpus;
+	}
+
+	if (count > MCU_MAX_PATCH_THREADS) {
+		count = MCU_MAX_PATCH_THREADS;
+	}
+
+	if (!count) {
+		return;
+	}
+
+	if (!canvas->patch_queue) {
+		switch_queue_create(&canvas->patch_queue, MCU_MAX_LAYERS, canvas->pool);
+		switch_mutex_init(&canvas->patch_mutex, SWITCH_MUTEX_NESTED, canvas->pool);
+		switch_thread_cond_create(&canvas->patch_cond, canvas->pool);
+		switch_queue_create(&canvas->encode_queue, 1, canvas->pool);
+	}
+
+	for (i = 0; i < count; i++) {
+		switch_threadattr_create(&thd_attr, canvas->pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		if (switch_thread_create(&canvas->patch_threads[i], thd_attr, conference_video_patch_thread_run, canvas, canvas->pool) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+	}
+
+	canvas->patch_thread_count = i;
+
+	switch_threadattr_create(&thd_attr, canvas->pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	switch_thread_create(&canvas->encode_thread, thd_attr, conference_video_encode_thread_run, canvas, canvas->pool);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Canvas %d compositing with %d threads\n", canvas->canvas_id + 1, canvas->patch_thread_count);
+}
+
+static void conference_video_stop_patch_threads(mcu_canvas_t *canvas)
+{
+	switch_status_t st;
+	int i;
+
+	if (canvas->encode_thread) {
+		switch_queue_push(canvas->encode_queue, NULL);
+		switch_thread_join(&st, canvas->encode_thread);
+		canvas->encode_thread = NULL;
+	}
+
+	for (i = 0; i < canvas->patch_thread_count; i++) {
+		switch_queue_push(canvas->patch_queue, NULL);
+	}
+
+	for (i = 0; i < canvas->patch_thread_count; i++) {
+		switch_thread_join(&st, canvas->patch_threads[i]);
+		canvas->patch_threads[i] = NULL;
+	}
+
+	canvas->patch_thread_count = 0;
+}
+
+/* composite layers that do not overlap in parallel, returning once all of them are on the canvas */
+static void conference_video_patch_layers(mcu_canvas_t *canvas, mcu_layer_t **layers, int count)
+{
+	int i;
+
+	if (!count) {
+		return;
+	}
+
+	switch_mutex_lock(canvas->mutex);
+
+	switch_mutex_lock(canvas->patch_mutex);
+	canvas->patch_pending = count;
+	switch_mutex_unlock(canvas->patch_mutex);
+
+	for (i = 0; i < count; i++) {
+		switch_queue_push(canvas->patch_queue, layers[i]);
+	}
+
+	switch_mutex_lock(canvas->patch_mutex);
+	while (canvas->patch_pending) {
+		switch_thread_cond_wait(canvas->patch_cond, canvas->patch_mutex);
+	}
+	switch_mutex_unlock(canvas->patch_mutex);
+
+	switch_mutex_unlock(canvas->mutex);
+}
+
 void conference_video_set_canvas_bgcolor(mcu_canvas_t *canvas, char *color)
 {
 	switch_color_set_rgb(&canvas->bgcolor, color);
@@ -1277,6 +1407,11 @@ void conference_video_write_canvas_image_to_codec_group(conference_obj_t *confer
 	frame->m = 0;
 	frame->timestamp = timestamp;
 
+	/* the canvas encode thread runs this while the muxing thread sets up codecs */
+	if (need_reset || send_keyframe) {
+		switch_mutex_lock(canvas->mutex);
+	}
+
 	if (need_reset) {
 		int type = 1; // sum flags: 1 encoder; 2; decoder
 		switch_core_codec_control(&codec_set->codec, SCC_VIDEO_RESET, SCCT_INT, (void *)&type, SCCT_NONE, NULL, NULL, NULL);
@@ -1287,6 +1422,10 @@ void conference_video_write_canvas_image_to_codec_group(conference_obj_t *confer
 		switch_core_codec_control(&codec_set->codec, SCC_VIDEO_GEN_KEYFRAME, SCCT_NONE, NULL, SCCT_NONE, NULL, NULL, NULL);
 	}
 
+	if (need_reset || send_keyframe) {
+		switch_mutex_unlock(canvas->mutex);
+	}
+
 	if (scaled_img) {
 		if (!send_keyframe && codec_set->fps_divisor > 1 && (codec_set->frame_count++) % codec_set->fps_divisor) {
 			// switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Skip one frame, total: %d\n", codec_set->frame_count);
@@ -1377,6 +1516,86 @@ void conference_video_write_canvas_image_to_codec_group(conference_obj_t *confer
 	} while(encode_status == SWITCH_STATUS_MORE_DATA);
 }
 
+typedef struct mcu_encode_job_s {
+	switch_image_t *img;
+	codec_set_t *codecs[MAX_MUX_CODECS];
+	uint32_t timestamp;
+	switch_bool_t need_refresh;
+	switch_bool_t send_keyframe;
+	switch_bool_t need_reset;
+} mcu_encode_job_t;
+
+static void conference_video_encode_canvas(mcu_canvas_t *canvas, codec_set_t **codecs, switch_image_t *img, uint32_t timestamp,
+										   switch_bool_t need_refresh, switch_bool_t send_keyframe, switch_bool_t need_reset)
+{
+	switch_time_t encode_start = switch_micro_time_now();
+	int i;
+
+	for (i = 0; i < MAX_MUX_CODECS && codecs[i] && switch_core_codec_ready(&codecs[i]->codec); i++) {
+		codecs[i]->frame.img = img;
+		conference_video_write_canvas_image_to_codec_group(canvas->conference, canvas, codecs[i], i,
+														   timestamp, need_refresh, send_keyframe, need_reset);
+
+		/* set by the api, checked again under the lock so the compositing is only waited for when it changes */
+		if (canvas->video_write_bandwidth && codecs[i]->rung < 0) {
+			switch_mutex_lock(canvas->mutex);
+			if (canvas->video_write_bandwidth) {
+				switch_core_codec_control(&codecs[i]->codec, SCC_VIDEO_BANDWIDTH,
+										  SCCT_INT, &canvas->video_write_bandwidth, SCCT_NONE, NULL, NULL, NULL);
+				canvas->video_write_bandwidth = 0;
+			}
+			switch_mutex_unlock(canvas->mutex);
+		}
+	}
+
+	if (i) {
+		canvas->encode_time = switch_micro_time_now() - encode_start;
+		canvas->encode_time_total += canvas->encode_time;
+		canvas->encode_count++;
+
+		if (canvas->encode_time > canvas->encode_time_max) {
+			canvas->encode_time_max = canvas->encode_time;
+		}
+	}
+}
+
+/* hand a snapshot of the canvas to the encode thread so the next frame can be composited meanwhile */
+static void conference_video_queue_canvas_encode(mcu_canvas_t *canvas, codec_set_t **codecs, switch_image_t *img, uint32_t timestamp,
+												 switch_bool_t need_refresh, switch_bool_t send_keyframe, switch_bool_t need_reset)
+{
+	mcu_encode_job_t *job;
+
+	switch_zmalloc(job, sizeof(*job));
+	job->img = switch_img_ref(img);
+	memcpy(job->codecs, codecs, sizeof(job->codecs));
+	job->timestamp = timestamp;
+	job->need_refresh = need_refresh;
+	job->send_keyframe = send_keyframe;
+	job->need_reset = need_reset;
+
+	if (!job->img || switch_queue_push(canvas->encode_queue, job) != SWITCH_STATUS_SUCCESS) {
+		switch_img_free(&job->img);
+		free(job);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC conference_video_encode_thread_run(switch_thread_t *thread, void *obj)
+{
+	mcu_canvas_t *canvas = (mcu_canvas_t *) obj;
+	void *pop;
+
+	while (switch_queue_pop(canvas->encode_queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		mcu_encode_job_t *job = (mcu_encode_job_t *) pop;
+
+		conference_video_encode_canvas(canvas, job->codecs, job->img, job->timestamp, job->need_refresh, job->send_keyframe, job->need_reset);
+
+		switch_img_free(&job->img);
+		free(job);
+	}
+
+	return NULL;
+}
+
 video_layout_t *conference_video_find_best_layout(conference_obj_t *conference, layout_group_t *lg, uint32_t count, uint32_t file_count)
 {
 	video_layout_node_t *vlnode = NULL, *last = NULL, *least = NULL;
@@ -2343,6 +2562,34 @@ switch_status_t conference_video_change_res(conference_obj_t *conference, int w,
 }
 
 
+/* the highest rung that fits what the far end asked for (TMMBR/REMB), or its configured max bandwidth */
+static int conference_video_pick_ladder_rung(conference_member_t *member)
+{
+	conference_obj_t *conference = member->conference;
+	int32_t kbps = 0;
+	int i;
+
+	if (member->session) {
+		kbps = switch_core_media_get_remote_bitrate(member->session, SWITCH_MEDIA_TYPE_VIDEO) / 1000;
+	}
+
+	if (!kbps || (member->max_bw_out > 0 && member->max_bw_out < kbps)) {
+		kbps = member->max_bw_out;
+	}
+
+	if (kbps <= 0) {
+		return 0;
+	}
+
+	for (i = 0; i < conference->video_ladder_rungs - 1; i++) {
+		if (conference->video_ladder[i].bandwidth <= kbps) {
+			break;
+		}
+	}
+
+	return i;
+}
+
 void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thread, void *obj)
 {
 	mcu_canvas_t *canvas = (mcu_canvas_t *) obj;
@@ -2368,11 +2615,15 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 	int last_personal = conference_utils_test_flag(conference, CFLAG_PERSONAL_CANVAS) ? 1 : 0;
 	int last_video_count = 0;
 	int watchers = 0, last_watchers = 0;
+	switch_time_t render_start = 0, render_time = 0;
+	switch_image_t *frame_img = NULL;
 
 	canvas->video_timer_reset = 1;
 	canvas->video_layout_group = conference->video_layout_group;
 
 	packet = switch_core_alloc(conference->pool, SWITCH_RTP_MAX_BUF_LEN);
+
+	conference_video_launch_patch_threads(canvas);
 	
 	while (conference_globals.running && !conference_utils_test_flag(conference, CFLAG_DESTRUCT) && conference_utils_test_flag(conference, CFLAG_VIDEO_MUXING)) {
 		switch_bool_t need_refresh = SWITCH_FALSE, send_keyframe = SWITCH_FALSE, need_reset = SWITCH_FALSE;
@@ -2384,6 +2635,7 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 		switch_frame_t file_frame = { 0 };
 		int j = 0, personal = conference_utils_test_flag(conference, CFLAG_PERSONAL_CANVAS) ? 1 : 0;
 		int video_count = 0;
+		int ladder_members[MAX_LADDER_RUNGS] = { 0 };
 
 		if (!personal) {
 			if (canvas->new_vlayout && switch_mutex_trylock(conference->canvas_mutex) == SWITCH_STATUS_SUCCESS) {
@@ -2558,9 +2810,47 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 				min_members++;
 
 				if (switch_channel_test_flag(imember->channel, CF_VIDEO_READY)) {
+					if (conference->video_ladder_rungs && imember->video_codec_index > -1) {
+						int rung = conference_video_pick_ladder_rung(imember);
+
+						/* only climb once the estimate has left room for it over the whole delay, to the lowest rung it allowed meanwhile */
+						if (rung < imember->video_ladder_rung) {
+							if (!imember->video_ladder_time) {
+								imember->video_ladder_time = now;
+								imember->video_ladder_up_rung = rung;
+							} else if (rung > imember->video_ladder_up_rung) {
+								imember->video_ladder_up_rung = rung;
+							}
+						} else {
+							imember->video_ladder_time = 0;
+						}
+
+						/* drop a rung right away */
+						if (rung > imember->video_ladder_rung ||
+							(imember->video_ladder_time && now - imember->video_ladder_time >= LADDER_UPGRADE_DELAY)) {
+							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(imember->session), SWITCH_LOG_DEBUG,
+											  "Moving member %d from ladder rung %d to %d\n", imember->id, imember->video_ladder_rung,
+											  imember->video_ladder_time ? imember->video_ladder_up_rung : rung);
+							imember->video_codec_index = -1;
+							conference_utils_member_set_flag_locked(imember, MFLAG_VIDEO_JOIN);
+							send_keyframe = SWITCH_TRUE;
+						}
+					}
+
 					if (imember->video_codec_index < 0 && (check_codec = switch_core_session_get_video_write_codec(imember->session))) {
-						for (i = 0; write_codecs[i] && switch_core_codec_ready(&write_codecs[i]->codec) && i < MAX_MUX_CODECS; i++) {
-							if (check_codec->implementation->codec_id == write_codecs[i]->codec.implementation->codec_id) {
+						int rung = -1;
+
+						if (conference->video_ladder_rungs) {
+							rung = conference_video_pick_ladder_rung(imember);
+							if (imember->video_ladder_time && rung < imember->video_ladder_up_rung) {
+								rung = imember->video_ladder_up_rung;
+							}
+							imember->video_ladder_rung = rung;
+							imember->video_ladder_time = 0;
+						}
+
+						for (i = 0; i < MAX_MUX_CODECS && write_codecs[i] && switch_core_codec_ready(&write_codecs[i]->codec); i++) {
+							if (check_codec->implementation->codec_id == write_codecs[i]->codec.implementation->codec_id && write_codecs[i]->rung == rung) {
 								imember->video_codec_index = i;
 								imember->video_codec_id = check_codec->implementation->codec_id;
 								need_refresh = SWITCH_TRUE;
@@ -2568,13 +2858,14 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 							}
 						}
 
-						if (imember->video_codec_index < 0) {
+						if (imember->video_codec_index < 0 && i < MAX_MUX_CODECS) {
 							write_codecs[i] = switch_core_alloc(conference->pool, sizeof(codec_set_t));
+							write_codecs[i]->rung = rung;
 
 							if (switch_core_codec_copy(check_codec, &write_codecs[i]->codec,
 													   &conference->video_codec_settings, conference->pool) == SWITCH_STATUS_SUCCESS) {
 								switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG,
-												  "Setting up video write codec %s at slot %d\n", write_codecs[i]->codec.implementation->iananame, i);
+												  "Setting up video write codec %s at slot %d rung %d\n", write_codecs[i]->codec.implementation->iananame, i, rung);
 
 								imember->video_codec_index = i;
 								imember->video_codec_id = check_codec->implementation->codec_id;
@@ -2583,7 +2874,17 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 								write_codecs[i]->frame.data = ((uint8_t *)write_codecs[i]->frame.packet) + 12;
 								write_codecs[i]->frame.packetlen = buflen;
 								write_codecs[i]->frame.buflen = buflen - 12;
-								if (conference->scale_h264_canvas_width > 0 && conference->scale_h264_canvas_height > 0 && !strcmp(check_codec->implementation->iananame, "H264")) {
+								if (rung > -1) {
+									video_ladder_rung_t *lr = &conference->video_ladder[rung];
+
+									if (lr->width && lr->height && (lr->width != canvas->width || lr->height != canvas->height)) {
+										write_codecs[i]->scaled_img = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, lr->width, lr->height, 16);
+									}
+
+									switch_mutex_lock(canvas->mutex);
+									switch_core_codec_control(&write_codecs[i]->codec, SCC_VIDEO_BANDWIDTH, SCCT_INT, &lr->bandwidth, SCCT_NONE, NULL, NULL, NULL);
+									switch_mutex_unlock(canvas->mutex);
+								} else if (conference->scale_h264_canvas_width > 0 && conference->scale_h264_canvas_height > 0 && !strcmp(check_codec->implementation->iananame, "H264")) {
 									int32_t bw = -1;
 
 									write_codecs[i]->fps_divisor = conference->scale_h264_canvas_fps_divisor;
@@ -2603,7 +2904,9 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 										bw = switch_calc_bitrate(conference->scale_h264_canvas_width, conference->scale_h264_canvas_height, conference->video_quality, fps);
 									}
 
+									switch_mutex_lock(canvas->mutex);
 									switch_core_codec_control(&write_codecs[i]->codec, SCC_VIDEO_BANDWIDTH, SCCT_INT, &bw, SCCT_NONE, NULL, NULL, NULL);
+									switch_mutex_unlock(canvas->mutex);
 								}
 								switch_set_flag((&write_codecs[i]->frame), SFF_RAW_RTP);
 
@@ -2616,6 +2919,10 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 						switch_core_session_rwunlock(imember->session);
 						continue;
 					}
+
+					if (imember->video_ladder_rung > -1 && imember->video_ladder_rung < MAX_LADDER_RUNGS) {
+						ladder_members[imember->video_ladder_rung]++;
+					}
 				}
 			}
 
@@ -2774,6 +3081,8 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 
 		switch_mutex_unlock(conference->member_mutex);
 
+		memcpy(canvas->ladder_members, ladder_members, sizeof(canvas->ladder_members));
+
 		if (personal) {
 			layout_group_t *lg = NULL;
 			video_layout_t *vlayout = NULL;
@@ -3120,7 +3429,12 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 			}
 			switch_mutex_unlock(conference->file_mutex);
 
+			render_start = switch_time_now();
+
 			if (!conference->playing_video_file) {
+				mcu_layer_t *patch_layers[MCU_MAX_LAYERS];
+				int patch_count = 0;
+
 				for (i = 0; i < canvas->total_layers; i++) {
 					mcu_layer_t *layer = &canvas->layers[i];
 
@@ -3131,7 +3445,9 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 						}
 
 						if (layer->cur_img) {
-							if (layer->member && switch_core_cpu_count() > 2) {
+							if (canvas->patch_thread_count) {
+								patch_layers[patch_count++] = layer;
+							} else if (layer->member && switch_core_cpu_count() > 2) {
 								layer->need_patch = 1;
 							} else {
 								conference_video_scale_and_patch(layer, NULL, SWITCH_FALSE);
@@ -3142,6 +3458,8 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 					}
 				}
 
+				conference_video_patch_layers(canvas, patch_layers, patch_count);
+
 				wait_for_canvas(canvas);
 
 				for (i = 0; i < canvas->total_layers; i++) {
@@ -3216,33 +3534,36 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 			write_frame.img = write_img;
 
 			wait_for_canvas(canvas);
+
+			render_time = switch_time_now() - render_start;
+			canvas->render_time = render_time;
+			canvas->render_time_total += render_time;
+			canvas->render_count++;
+			if (render_time > canvas->render_time_max) {
+				canvas->render_time_max = render_time;
+			}
 			
 			if (canvas->recording) {
 				conference_video_check_recording(conference, canvas, &write_frame);
 			}
 
 			if (conference->canvas_count > 1) {
-				switch_image_t *img_copy = NULL;
+				switch_image_t *img_ref;
 
-				switch_img_copy(write_img, &img_copy);
+				if (!frame_img) switch_img_copy(write_img, &frame_img);
+				img_ref = switch_img_ref(frame_img);
 
-				if (switch_queue_trypush(canvas->video_queue, img_copy) != SWITCH_STATUS_SUCCESS) {
-					switch_img_free(&img_copy);
+				if (switch_queue_trypush(canvas->video_queue, img_ref) != SWITCH_STATUS_SUCCESS) {
+					switch_img_free(&img_ref);
 				}
 			}
 
 			if (min_members && conference_utils_test_flag(conference, CFLAG_MINIMIZE_VIDEO_ENCODING)) {
-				for (i = 0; write_codecs[i] && switch_core_codec_ready(&write_codecs[i]->codec) && i < MAX_MUX_CODECS; i++) {
-					write_codecs[i]->frame.img = write_img;
-					conference_video_write_canvas_image_to_codec_group(conference, canvas, write_codecs[i], i,
-																	   timestamp, need_refresh, send_keyframe, need_reset);
-
-					if (canvas->video_write_bandwidth) {
-						switch_core_codec_control(&write_codecs[i]->codec, SCC_VIDEO_BANDWIDTH, 
-												  SCCT_INT, &canvas->video_write_bandwidth, SCCT_NONE, NULL, NULL, NULL);
-						canvas->video_write_bandwidth = 0;
-					}
-
+				if (canvas->encode_thread) {
+					if (!frame_img) switch_img_copy(write_img, &frame_img);
+					conference_video_queue_canvas_encode(canvas, write_codecs, frame_img, timestamp, need_refresh, send_keyframe, need_reset);
+				} else {
+					conference_video_encode_canvas(canvas, write_codecs, write_img, timestamp, need_refresh, send_keyframe, need_reset);
 				}
 			}
 			
@@ -3279,7 +3600,8 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 				}
 
 				switch_set_flag(&write_frame, SFF_RAW_RTP|SFF_USE_VIDEO_TIMESTAMP|SFF_RAW_RTP_PARSE_FRAME);
-				write_frame.img = write_img;
+				/* every watcher gets a reference to the same snapshot instead of its own copy */
+				write_frame.img = NULL;
 				write_frame.packet = packet;
 				write_frame.data = ((uint8_t *)packet) + 12;
 				write_frame.datalen = 0;
@@ -3290,6 +3612,9 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 				//switch_core_session_write_video_frame(imember->session, &write_frame, SWITCH_IO_FLAG_NONE, 0);
 
 				if (imember->mux_out_queue && switch_frame_buffer_dup(imember->fb, &write_frame, &dupframe) == SWITCH_STATUS_SUCCESS) {
+					if (!frame_img) switch_img_copy(write_img, &frame_img);
+					dupframe->img = switch_img_ref(frame_img);
+
 					if (switch_queue_trypush(imember->mux_out_queue, dupframe) != SWITCH_STATUS_SUCCESS) {
 						switch_frame_buffer_free(imember->fb, &dupframe);
 					}
@@ -3302,9 +3627,13 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 			}
 
 			switch_mutex_unlock(conference->member_mutex);
+
+			switch_img_free(&frame_img);
 		} // NOT PERSONAL
 	}
 
+	conference_video_stop_patch_threads(canvas);
+
 	switch_img_free(&file_img);
 
 	for (i = 0; i < MCU_MAX_LAYERS; i++) {
@@ -3553,6 +3882,14 @@ void *SWITCH_THREAD_FUNC conference_video_super_muxing_thread_run(switch_thread_
 						switch_image_t *tmp;
 						const char *format = "#cccccc:#142e55:FreeSans.ttf:4%:";
 
+						if (switch_img_shared(img)) {
+							switch_image_t *shared = img;
+
+							img = NULL;
+							switch_img_copy(shared, &img);
+							switch_img_free(&shared);
+						}
+
 						switch_snprintf(str, sizeof(str), "%sCanvas %d", format, jcanvas->canvas_id + 1);
 						tmp = switch_img_write_text_img(img->d_w, img->d_h, SWITCH_TRUE, str);
 						switch_img_patch(img, tmp, 0, 0);
@@ -3745,6 +4082,72 @@ void conference_video_find_floor(conference_member_t *member, switch_bool_t ente
 void conference_video_reset_member_codec_index(conference_member_t *member)
 {
 	member->video_codec_index = -1;
+	member->video_ladder_rung = -1;
+	member->video_ladder_time = 0;
+}
+
+/* parse WxH@bandwidth[,WxH@bandwidth...] ("canvas" for the canvas size) into rungs ordered by bandwidth */
+int conference_video_parse_ladder(conference_obj_t *conference, const char *str)
+{
+	char *dup, *argv[MAX_LADDER_RUNGS + 1] = { 0 };
+	int argc, i, j;
+
+	conference->video_ladder_rungs = 0;
+
+	if (zstr(str)) {
+		return 0;
+	}
+
+	dup = strdup(str);
+	argc = switch_separate_string(dup, ',', argv, (sizeof(argv) / sizeof(argv[0])));
+
+	if (argc > MAX_LADDER_RUNGS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "video-bitrate-ladder is limited to %d rungs\n", MAX_LADDER_RUNGS);
+		argc = MAX_LADDER_RUNGS;
+	}
+
+	for (i = 0; i < argc; i++) {
+		video_ladder_rung_t rung = { 0 };
+		char *bw, *p;
+
+		if (!(bw = strchr(argv[i], '@'))) {
+			goto fail;
+		}
+
+		*bw++ = '\0';
+
+		if (strcasecmp(argv[i], "canvas")) {
+			rung.width = atoi(argv[i]) & ~1;
+
+			if ((p = strchr(argv[i], 'x'))) {
+				rung.height = atoi(p + 1) & ~1;
+			}
+
+			if (rung.width < 16 || rung.height < 16) {
+				goto fail;
+			}
+		}
+
+		if ((rung.bandwidth = switch_parse_bandwidth_string(bw)) <= 0) {
+			goto fail;
+		}
+
+		for (j = conference->video_ladder_rungs; j > 0 && conference->video_ladder[j - 1].bandwidth < rung.bandwidth; j--) {
+			conference->video_ladder[j] = conference->video_ladder[j - 1];
+		}
+
+		conference->video_ladder[j] = rung;
+		conference->video_ladder_rungs++;
+	}
+
+	free(dup);
+	return conference->video_ladder_rungs;
+
+ fail:
+
+	conference->video_ladder_rungs = 0;
+	free(dup);
+	return 0;
 }
 
 void conference_video_set_floor_holder(conference_obj_t *conference, conference_member_t *member, switch_bool_t force)
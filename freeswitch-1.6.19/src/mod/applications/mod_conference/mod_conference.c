@@ -2435,11 +2435,13 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	char *video_super_canvas_bgcolor = NULL;
 	char *video_letterbox_bgcolor = NULL;
 	char *video_codec_bandwidth = NULL;
+	char *video_encoder_params = NULL;
 	char *no_video_avatar = NULL;
 	char *video_mute_banner = NULL;
 	conference_video_mode_t conference_video_mode = CONF_VIDEO_MODE_PASSTHROUGH;
 	int conference_video_quality = 1;
 	int auto_kps_debounce = 30000;
+	int video_mux_threads = -1;
 	float fps = 30.0f;
 	uint32_t max_members = 0;
 	uint32_t announce_count = 0;
@@ -2475,6 +2477,7 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	int scale_h264_canvas_height = 0;
 	int scale_h264_canvas_fps_divisor = 0;
 	char *scale_h264_canvas_bandwidth = NULL;
+	char *video_bitrate_ladder = NULL;
 
 	/* Validate the conference name */
 	if (zstr(name)) {
@@ -2629,6 +2632,8 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 				fps = (float)atof(val);
 			} else if (!strcasecmp(var, "video-codec-bandwidth") && !zstr(val)) {
 				video_codec_bandwidth = val;
+			} else if (!strcasecmp(var, "video-encoder-params") && !zstr(val)) {
+				video_encoder_params = val;
 			} else if (!strcasecmp(var, "video-no-video-avatar") && !zstr(val)) {
 				no_video_avatar = val;
 			} else if (!strcasecmp(var, "video-mute-banner") && !zstr(val)) {
@@ -2782,6 +2787,16 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 				} else {
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Video quality must be between 0 and 4\n");
 				}
+			} else if (!strcasecmp(var, "video-mux-threads") && !zstr(val)) {
+				int tmp = atoi(val);
+
+				if (!strcasecmp(val, "auto")) {
+					video_mux_threads = -1;
+				} else if (tmp >= 0 && tmp <= MCU_MAX_PATCH_THREADS) {
+					video_mux_threads = tmp;
+				} else {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "video-mux-threads must be auto or between 0 and %d\n", MCU_MAX_PATCH_THREADS);
+				}
 			} else if (!strcasecmp(var, "video-kps-debounce") && !zstr(val)) {
 				int tmp = atoi(val);
 
@@ -2823,6 +2838,8 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 				if (scale_h264_canvas_fps_divisor < 0) scale_h264_canvas_fps_divisor = 0;
 			} else if (!strcasecmp(var, "scale-h264-canvas-bandwidth") && !zstr(val)) {
 				scale_h264_canvas_bandwidth = val;
+			} else if (!strcasecmp(var, "video-bitrate-ladder") && !zstr(val)) {
+				video_bitrate_ladder = val;
 			}
 		}
 
@@ -2883,6 +2900,7 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	conference->broadcast_chat_messages = broadcast_chat_messages;
 	conference->video_quality = conference_video_quality;
 	conference->auto_kps_debounce = auto_kps_debounce;
+	conference->video_mux_threads = video_mux_threads;
 
 	conference->conference_video_mode = conference_video_mode;
 
@@ -2891,6 +2909,10 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	conference->scale_h264_canvas_fps_divisor = scale_h264_canvas_fps_divisor;
 	conference->scale_h264_canvas_bandwidth = switch_core_strdup(conference->pool, scale_h264_canvas_bandwidth);
 
+	if (video_bitrate_ladder && !conference_video_parse_ladder(conference, video_bitrate_ladder)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Invalid video-bitrate-ladder [%s], expected WxH@bandwidth[,WxH@bandwidth...]\n", video_bitrate_ladder);
+	}
+
 	if (!switch_core_has_video() && (conference->conference_video_mode == CONF_VIDEO_MODE_MUX || conference->conference_video_mode == CONF_VIDEO_MODE_TRANSCODE)) {
 		conference->conference_video_mode = CONF_VIDEO_MODE_PASSTHROUGH;
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "video-mode invalid, only valid setting is 'passthrough' due to no video capabilities\n");
@@ -2974,6 +2996,11 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 
 		conference->video_codec_settings.video.try_hardware_encoder = 1;
 
+		if (video_encoder_params &&
+			switch_core_codec_parse_video_encoder_params(video_encoder_params, &conference->video_codec_settings) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Invalid video-encoder-params [%s]\n", video_encoder_params);
+		}
+
 		if (zstr(video_layout_name)) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "No video-layout-name specified, using " CONFERENCE_MUX_DEFAULT_LAYOUT "\n");
 			video_layout_name = CONFERENCE_MUX_DEFAULT_LAYOUT;
@@ -85,6 +85,10 @@
 #define FPS 30
 /* max supported layers in one mcu */
 #define MCU_MAX_LAYERS 64
+/* max threads compositing layers into one canvas */
+#define MCU_MAX_PATCH_THREADS 16
+/* most threads video-mux-threads auto starts for one canvas */
+#define MCU_AUTO_PATCH_THREADS 4
 
 /* video layout scale factor */
 #define VIDEO_LAYOUT_SCALE 360.0f
@@ -106,6 +110,8 @@
 #define CONFFUNCAPISIZE (sizeof(conference_api_sub_commands)/sizeof(conference_api_sub_commands[0]))
 
 #define MAX_MUX_CODECS 10
+#define MAX_LADDER_RUNGS 4
+#define LADDER_UPGRADE_DELAY 5000000
 
 #define ALC_HRTF_SOFT  0x1992
 
@@ -514,6 +520,23 @@ typedef struct mcu_canvas_s {
 	int recording;
 	switch_image_t *bgimg;
 	switch_thread_rwlock_t *video_rwlock;
+	switch_thread_t *patch_threads[MCU_MAX_PATCH_THREADS];
+	int patch_thread_count;
+	switch_queue_t *patch_queue;
+	switch_mutex_t *patch_mutex;
+	switch_thread_cond_t *patch_cond;
+	int patch_pending;
+	switch_thread_t *encode_thread;
+	switch_queue_t *encode_queue;
+	int ladder_members[MAX_LADDER_RUNGS];
+	switch_time_t encode_time;
+	switch_time_t encode_time_max;
+	switch_time_t encode_time_total;
+	uint64_t encode_count;
+	switch_time_t render_time;
+	switch_time_t render_time_max;
+	switch_time_t render_time_total;
+	uint64_t render_count;
 } mcu_canvas_t;
 
 /* Record Node */
@@ -533,6 +556,13 @@ typedef enum {
 	CONF_VIDEO_MODE_MUX
 } conference_video_mode_t;
 
+/* one rendition of the canvas in a simulcast ladder, width 0 means canvas size */
+typedef struct video_ladder_rung_s {
+	int width;
+	int height;
+	int32_t bandwidth;
+} video_ladder_rung_t;
+
 /* Conference Object */
 typedef struct conference_obj {
 	char *name;
@@ -585,6 +615,7 @@ typedef struct conference_obj {
 	int members_seeing_video;
 	int members_with_avatar;
 	uint32_t auto_kps_debounce;
+	int video_mux_threads;
 	switch_codec_settings_t video_codec_settings;
 	uint32_t canvas_width;
 	uint32_t canvas_height;
@@ -689,6 +720,8 @@ typedef struct conference_obj {
 	int scale_h264_canvas_height;
 	int scale_h264_canvas_fps_divisor;
 	char *scale_h264_canvas_bandwidth;
+	video_ladder_rung_t video_ladder[MAX_LADDER_RUNGS];
+	int video_ladder_rungs;
 	uint32_t moh_wait;
 } conference_obj_t;
 
@@ -773,6 +806,10 @@ struct conference_member {
 	int layer_timeout;
 	int video_codec_index;
 	int video_codec_id;
+	int video_ladder_rung;
+	/* since when a higher rung has fit, and the lowest one that did */
+	switch_time_t video_ladder_time;
+	int video_ladder_up_rung;
 	char *video_banner_text;
 	switch_image_t *video_logo;
 	switch_img_position_t logo_pos;
@@ -828,6 +865,7 @@ typedef struct codec_set_s {
 	switch_image_t *scaled_img;
 	uint8_t fps_divisor;
 	uint32_t frame_count;
+	int rung;
 } codec_set_t;
 
 typedef void (*conference_key_callback_t) (conference_member_t *, struct caller_control_actions *);
@@ -921,6 +959,7 @@ void conference_video_reset_video_bitrate_counters(conference_member_t *member);
 void conference_video_clear_layer(mcu_layer_t *layer);
 int conference_member_get_canvas_id(conference_member_t *member, const char *val, switch_bool_t watching);
 void conference_video_reset_member_codec_index(conference_member_t *member);
+int conference_video_parse_ladder(conference_obj_t *conference, const char *str);
 void conference_video_detach_video_layer(conference_member_t *member);
 void conference_utils_set_flag(conference_obj_t *conference, conference_flag_t flag);
 void conference_utils_set_flag_locked(conference_obj_t *conference, conference_flag_t flag);
@@ -4548,7 +4548,7 @@ SWITCH_STANDARD_APP(session_loglevel_function)
 }
 
 /* LIMIT STUFF */
-#define LIMIT_USAGE "<backend> <realm> <id> [<max>[/interval]] [number [dialplan [context]]]"
+#define LIMIT_USAGE "<backend> <realm> <id> [<max>[/interval[/token_bucket|sliding_log]]] [number [dialplan [context]]]"
 #define LIMIT_DESC "limit access to a resource and transfer to an extension if the limit is exceeded"
 SWITCH_STANDARD_APP(limit_function)
 {
@@ -4561,6 +4561,9 @@ SWITCH_STANDARD_APP(limit_function)
 	char *xfer_exten = NULL;
 	int max = -1;
 	int interval = 0;
+	char *szalgorithm = NULL;
+	switch_rate_algorithm_t algorithm = SWITCH_RATE_TOKEN_BUCKET;
+	switch_status_t status;
 	switch_channel_t *channel = switch_core_session_get_channel(session);
 
 	/* Parse application data  */
@@ -4603,6 +4606,9 @@ SWITCH_STANDARD_APP(limit_function)
 			char *szinterval = NULL;
 			if ((szinterval = strchr(argv[3], '/'))) {
 				*szinterval++ = '\0';
+				if ((szalgorithm = strchr(szinterval, '/'))) {
+					*szalgorithm++ = '\0';
+				}
 				interval = atoi(szinterval);
 			}
 
@@ -4614,13 +4620,34 @@ SWITCH_STANDARD_APP(limit_function)
 		}
 	}
 
+	if (szalgorithm && (switch_rate_str2algorithm(szalgorithm, &algorithm) != SWITCH_STATUS_SUCCESS || interval <= 0)) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Invalid rate algorithm %s, USAGE: limit %s\n", szalgorithm, LIMIT_USAGE);
+		return;
+	}
+
+	if (szalgorithm && algorithm == SWITCH_RATE_SLIDING_LOG && max > SWITCH_RATE_LOG_MAX) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "A sliding_log rate allows at most %d per interval, use token_bucket for %d\n",
+						  SWITCH_RATE_LOG_MAX, max);
+		return;
+	}
+
 	if (argc > 4) {
 		xfer_exten = argv[4];
 	} else {
 		xfer_exten = LIMIT_DEF_XFER_EXTEN;
 	}
 
-	if (switch_limit_incr(backend, session, realm, id, max, interval) != SWITCH_STATUS_SUCCESS) {
+	if (szalgorithm) {
+		/* Burst-free rate limits are enforced by the core on this box only, the backend is not involved */
+		if ((status = switch_limit_rate(realm, id, algorithm, max, interval * 1000)) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Usage for %s_%s exceeds maximum rate of %d/%ds (%s)\n",
+							  realm, id, max, interval, szalgorithm);
+		}
+	} else {
+		status = switch_limit_incr(backend, session, realm, id, max, interval);
+	}
+
+	if (status != SWITCH_STATUS_SUCCESS) {
 		/* Limit exceeded */
 		if (*xfer_exten == '!') {
 			switch_channel_hangup(channel, switch_channel_str2cause(xfer_exten + 1));
@@ -4757,8 +4784,15 @@ struct file_string_context {
 	char *argv[128];
 	int argc;
 	int index;
+	int prefetched;
 	int samples;
-	switch_file_handle_t fh;
+	/* the open file, either lfh or the handle of job */
+	switch_file_handle_t *fh;
+	switch_file_handle_t lfh;
+	switch_file_open_job_t *job;
+	/* the file after this one, opened on the I/O threads while this one plays */
+	switch_file_open_job_t *next_job;
+	int next_index;
 	file_string_audio_col_t *audio_cols;
 };
 
@@ -4768,42 +4802,77 @@ typedef struct file_string_context file_string_context_t;
 #define FILE_STRING_CLOSE "filestring::close"
 #define FILE_STRING_FAIL "filestring::fail"
 
+static char *file_string_path(switch_file_handle_t *handle, int index)
+{
+	file_string_context_t *context = handle->private_info;
+	const char *prefix = handle->prefix;
+
+	if (!prefix) {
+		if (!(prefix = switch_core_get_variable_pdup("sound_prefix", handle->memory_pool))) {
+			prefix = SWITCH_GLOBAL_dirs.sounds_dir;
+		}
+	}
+
+	if (!prefix || switch_is_file_path(context->argv[index])) {
+		return context->argv[index];
+	}
+
+	return switch_core_sprintf(handle->memory_pool, "%s%s%s", prefix, SWITCH_PATH_SEPARATOR, context->argv[index]);
+}
+
 static switch_status_t next_file(switch_file_handle_t *handle)
 {
 	file_string_context_t *context = handle->private_info;
 	char *file;
-	const char *prefix = handle->prefix;
-	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_status_t status = SWITCH_STATUS_SUCCESS, ostatus;
 	switch_event_t *event = NULL;
+	const char *var;
+	uint32_t depth = switch_core_file_prefetch_depth();
+
+	/* file_string has no channel to ask, {prompt_prefetch_depth=N}file_string://... sets it for one list */
+	if (handle->params && (var = switch_event_get_header(handle->params, "prompt_prefetch_depth")) && atoi(var) >= 0) {
+		depth = (uint32_t) atoi(var);
+	}
 
   top:
 
 	context->index++;
 
-	if (switch_test_flag((&context->fh), SWITCH_FILE_OPEN)) {
+	if (switch_test_flag(context->fh, SWITCH_FILE_OPEN)) {
 		if (switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, FILE_STRING_CLOSE) == SWITCH_STATUS_SUCCESS) {
 			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "File", context->argv[(context->index - 1)]);
 			switch_event_fire(&event);
 		}
 
-		switch_core_file_close(&context->fh);
+		switch_core_file_close(context->fh);
 	}
 
+	switch_core_file_open_job_destroy(&context->job);
+	context->fh = &context->lfh;
+
 	if (context->index >= context->argc) {
+		switch_core_file_open_job_destroy(&context->next_job);
 		return SWITCH_STATUS_FALSE;
 	}
 
+	file = file_string_path(handle, context->index);
 
-	if (!prefix) {
-		if (!(prefix = switch_core_get_variable_pdup("sound_prefix", handle->memory_pool))) {
-			prefix = SWITCH_GLOBAL_dirs.sounds_dir;
+	/* say phrases come through here as long lists of short files, open the next few while this one plays */
+	if (switch_test_flag(handle, SWITCH_FILE_FLAG_READ) && depth) {
+		if (context->prefetched <= context->index) {
+			context->prefetched = context->index + 1;
 		}
-	}
 
-	if (!prefix || switch_is_file_path(context->argv[context->index])) {
-		file = context->argv[context->index];
-	} else {
-		file = switch_core_sprintf(handle->memory_pool, "%s%s%s", prefix, SWITCH_PATH_SEPARATOR, context->argv[context->index]);
+		while (context->prefetched < context->argc && context->prefetched <= context->index + (int) depth) {
+			char *path = file_string_path(handle, context->prefetched);
+
+			/* the next plain file is opened ahead below */
+			if (context->prefetched > context->index + 1 || strstr(path, SWITCH_URL_SEPARATOR)) {
+				switch_core_file_prefetch(path, handle->channels, handle->samplerate);
+			}
+
+			context->prefetched++;
+		}
 	}
 
 	if (switch_test_flag(handle, SWITCH_FILE_FLAG_WRITE)) {
@@ -4827,7 +4896,31 @@ static switch_status_t next_file(switch_file_handle_t *handle)
 		}
 	}
 
-	if (switch_core_file_open(&context->fh, file, handle->channels, handle->samplerate, handle->flags, NULL) != SWITCH_STATUS_SUCCESS) {
+	if (context->next_job && context->next_index == context->index) {
+		uint32_t timeout = switch_core_file_open_timeout();
+
+		context->job = context->next_job;
+		context->next_job = NULL;
+
+		/* usually opened long ago, this runs on the media thread so never wait on it without a limit */
+		if (!timeout) {
+			timeout = SWITCH_DEFAULT_FILE_OPEN_TIMEOUT;
+		}
+
+		ostatus = switch_core_file_open_job_wait(context->job, timeout);
+
+		if (ostatus == SWITCH_STATUS_TIMEOUT) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Gave up opening %s after %ums\n", file, timeout);
+			switch_core_file_open_job_destroy(&context->job);
+		} else {
+			context->fh = switch_core_file_open_job_handle(context->job);
+		}
+	} else {
+		switch_core_file_open_job_destroy(&context->next_job);
+		ostatus = switch_core_file_open(context->fh, file, handle->channels, handle->samplerate, handle->flags, NULL);
+	}
+
+	if (ostatus != SWITCH_STATUS_SUCCESS) {
 		if (switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, FILE_STRING_FAIL) == SWITCH_STATUS_SUCCESS) {
 			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "File", context->argv[context->index]);
 			switch_event_fire(&event);
@@ -4855,7 +4948,7 @@ static switch_status_t next_file(switch_file_handle_t *handle)
 		file_string_audio_col_t *col_ptr = context->audio_cols;
 
 		while (col_ptr) {
-			switch_core_file_set_string(&context->fh, col_ptr->col, col_ptr->value);
+			switch_core_file_set_string(context->fh, col_ptr->col, col_ptr->value);
 			col_ptr = col_ptr->next;
 		}
 
@@ -4870,7 +4963,7 @@ static switch_status_t next_file(switch_file_handle_t *handle)
 					do {
 						len = SWITCH_RECOMMENDED_BUFFER_SIZE / handle->channels;
 						if ((stat = switch_core_file_read(&fh, buf, &len)) == SWITCH_STATUS_SUCCESS) {
-							stat = switch_core_file_write(&context->fh, buf, &len);
+							stat = switch_core_file_write(context->fh, buf, &len);
 						}
 					} while (stat == SWITCH_STATUS_SUCCESS);
 
@@ -4884,18 +4977,30 @@ static switch_status_t next_file(switch_file_handle_t *handle)
 	}
 	context->file = file;
 
-	handle->samples = context->fh.samples;
-	handle->cur_samplerate = context->fh.samplerate;
-	handle->cur_channels = context->fh.real_channels;
-	handle->format = context->fh.format;
-	handle->sections = context->fh.sections;
-	handle->seekable = context->fh.seekable;
-	handle->speed = context->fh.speed;
-	handle->interval = context->fh.interval;
+	/* open the next plain file in the background so switching to it does not wait on the disk */
+	if (switch_test_flag(handle, SWITCH_FILE_FLAG_READ) && context->index + 1 < context->argc) {
+		char *next = file_string_path(handle, context->index + 1);
+
+		if (!strstr(next, SWITCH_URL_SEPARATOR) && switch_core_file_open_job_create(&context->next_job, NULL) == SWITCH_STATUS_SUCCESS) {
+			context->next_index = context->index + 1;
+			if (switch_core_file_open_job_start(context->next_job, next, handle->channels, handle->samplerate, handle->flags) != SWITCH_STATUS_SUCCESS) {
+				switch_core_file_open_job_destroy(&context->next_job);
+			}
+		}
+	}
+
+	handle->samples = context->fh->samples;
+	handle->cur_samplerate = context->fh->samplerate;
+	handle->cur_channels = context->fh->real_channels;
+	handle->format = context->fh->format;
+	handle->sections = context->fh->sections;
+	handle->seekable = context->fh->seekable;
+	handle->speed = context->fh->speed;
+	handle->interval = context->fh->interval;
 	handle->max_samples = 0;
 
 
-	if (switch_test_flag((&context->fh), SWITCH_FILE_NATIVE)) {
+	if (switch_test_flag(context->fh, SWITCH_FILE_NATIVE)) {
 		switch_set_flag_locked(handle, SWITCH_FILE_NATIVE);
 	} else {
 		switch_clear_flag_locked(handle, SWITCH_FILE_NATIVE);
@@ -4926,7 +5031,7 @@ static switch_status_t file_string_file_seek(switch_file_handle_t *handle, unsig
 		return SWITCH_STATUS_NOTIMPL;
 	}
 
-	return switch_core_file_seek(&context->fh, cur_sample, samples, whence);
+	return switch_core_file_seek(context->fh, cur_sample, samples, whence);
 }
 
 static switch_status_t file_string_file_open(switch_file_handle_t *handle, const char *path)
@@ -4939,6 +5044,7 @@ static switch_status_t file_string_file_open(switch_file_handle_t *handle, const
 	file_dup = switch_core_strdup(handle->memory_pool, path);
 	context->argc = switch_separate_string(file_dup, '!', context->argv, (sizeof(context->argv) / sizeof(context->argv[0])));
 	context->index = -1;
+	context->fh = &context->lfh;
 
 	handle->private_info = context;
 	handle->pre_buffer_datalen = 0;
@@ -4950,10 +5056,13 @@ static switch_status_t file_string_file_close(switch_file_handle_t *handle)
 {
 	file_string_context_t *context = handle->private_info;
 
-	if (switch_test_flag((&context->fh), SWITCH_FILE_OPEN)) {
-		switch_core_file_close(&context->fh);
+	if (switch_test_flag(context->fh, SWITCH_FILE_OPEN)) {
+		switch_core_file_close(context->fh);
 	}
 
+	switch_core_file_open_job_destroy(&context->job);
+	switch_core_file_open_job_destroy(&context->next_job);
+
 	return SWITCH_STATUS_SUCCESS;
 }
 
@@ -4976,14 +5085,14 @@ static switch_status_t file_string_file_set_string(switch_file_handle_t *handle,
 		context->audio_cols = col_ptr;
 	}
 	
-	return switch_core_file_set_string(&context->fh, col, string);
+	return switch_core_file_set_string(context->fh, col, string);
 }
 
 static switch_status_t file_string_file_get_string(switch_file_handle_t *handle, switch_audio_col_t col, const char **string)
 {
 	file_string_context_t *context = handle->private_info;
 
-	return switch_core_file_get_string(&context->fh, col, string);
+	return switch_core_file_get_string(context->fh, col, string);
 }
 
 
@@ -5002,7 +5111,7 @@ static switch_status_t file_string_file_read(switch_file_handle_t *handle, void
 		memset(data, 255, *len *2);
 		status = SWITCH_STATUS_SUCCESS;
 	} else {
-		status = switch_core_file_read(&context->fh, data, len);
+		status = switch_core_file_read(context->fh, data, len);
 	}
 
 	if (status != SWITCH_STATUS_SUCCESS) {
@@ -5014,7 +5123,7 @@ static switch_status_t file_string_file_read(switch_file_handle_t *handle, void
 			status = SWITCH_STATUS_BREAK;
 		} else {
 			*len = llen;
-			status = switch_core_file_read(&context->fh, data, len);
+			status = switch_core_file_read(context->fh, data, len);
 		}
 	}
 
@@ -5028,14 +5137,14 @@ static switch_status_t file_string_file_write(switch_file_handle_t *handle, void
 	switch_status_t status;
 	size_t llen = *len;
 
-	status = switch_core_file_write(&context->fh, data, len);
+	status = switch_core_file_write(context->fh, data, len);
 
 	if (status != SWITCH_STATUS_SUCCESS) {
 		if ((status = next_file(handle)) != SWITCH_STATUS_SUCCESS) {
 			return status;
 		}
 		*len = llen;
-		status = switch_core_file_write(&context->fh, data, len);
+		status = switch_core_file_write(context->fh, data, len);
 	}
 	return status;
 }
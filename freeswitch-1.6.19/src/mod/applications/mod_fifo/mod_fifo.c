@@ -126,17 +126,29 @@ typedef enum {
 /*!\struct fifo_queue_t
  * \brief Queue of callers
  *
- * Callers are placed into a queue as events in `data` which is an
- * array of such events.  The array size is hard-coded as 1000
- * elements.
+ * Callers are placed into a queue as events in `data`, in arrival
+ * order.  A removed caller leaves an empty slot behind instead of
+ * shifting everyone after it; the slots are compacted (or the array
+ * doubled) when the tail reaches the end of the array.
+ *
+ * `tree` is a Fenwick tree counting the occupied slots so the
+ * position of any caller is found in O(log n), and `uuid_hash` maps
+ * a caller's unique-id to its slot so removal by uuid is O(1).
+ * `removed` counts the callers taken out, waiting callers watch it to
+ * know when their position has changed.
  *
  * Fifo nodes are composed of an array of these queues representing
  * each priority level of the fifo.
  */
 typedef struct {
 	int nelm;
+	int head;
 	int idx;
+	int count;
 	switch_event_t **data;
+	int *tree;
+	switch_hash_t *uuid_hash;
+	volatile uint32_t removed;
 	switch_memory_pool_t *pool;
 	switch_mutex_t *mutex;
 } fifo_queue_t;
@@ -166,8 +178,10 @@ switch_status_t fifo_queue_create(fifo_queue_t **queue, int size, switch_memory_
 
 	q = switch_core_alloc(pool, sizeof(*q));
 	q->pool = pool;
-	q->nelm = size - 1;
-	q->data = switch_core_alloc(pool, size * sizeof(switch_event_t *));
+	q->nelm = size;
+	switch_zmalloc(q->data, size * sizeof(switch_event_t *));
+	switch_zmalloc(q->tree, size * sizeof(int));
+	switch_core_hash_init(&q->uuid_hash);
 	switch_mutex_init(&q->mutex, SWITCH_MUTEX_NESTED, pool);
 
 	*queue = q;
@@ -175,32 +189,108 @@ switch_status_t fifo_queue_create(fifo_queue_t **queue, int size, switch_memory_
 	return SWITCH_STATUS_SUCCESS;
 }
 
-static void change_pos(switch_event_t *event, int pos)
+static void fifo_queue_destroy(fifo_queue_t *queue)
+{
+	switch_core_hash_destroy(&queue->uuid_hash);
+	switch_safe_free(queue->data);
+	switch_safe_free(queue->tree);
+}
+
+static void fifo_queue_tree_add(fifo_queue_t *queue, int slot, int delta)
+{
+	for (slot++; slot <= queue->nelm; slot += slot & -slot) {
+		queue->tree[slot - 1] += delta;
+	}
+}
+
+/* Number of callers in slots 0 through slot, i.e. the 1-based position of the caller in slot */
+static int fifo_queue_tree_sum(fifo_queue_t *queue, int slot)
 {
+	int sum = 0;
+
+	for (slot++; slot > 0; slot -= slot & -slot) {
+		sum += queue->tree[slot - 1];
+	}
+
+	return sum;
+}
+
+static void fifo_queue_index_uuid(fifo_queue_t *queue, int slot)
+{
+	const char *uuid = switch_event_get_header(queue->data[slot], "unique-id");
+
+	if (uuid) {
+		switch_core_hash_insert(queue->uuid_hash, uuid, (void *)(intptr_t)(slot + 1));
+	}
+}
+
+/* Move the waiting callers down to the start of the array, doubling it first if more than half full */
+static void fifo_queue_compact(fifo_queue_t *queue)
+{
+	int i, j = 0;
+
+	if (queue->count >= queue->nelm / 2) {
+		queue->nelm *= 2;
+		queue->data = realloc(queue->data, queue->nelm * sizeof(switch_event_t *));
+		queue->tree = realloc(queue->tree, queue->nelm * sizeof(int));
+		switch_assert(queue->data && queue->tree);
+	}
+
+	for (i = queue->head; i < queue->idx; i++) {
+		if (queue->data[i]) {
+			queue->data[j] = queue->data[i];
+			fifo_queue_index_uuid(queue, j);
+			j++;
+		}
+	}
+
+	memset(queue->data + j, 0, (queue->nelm - j) * sizeof(switch_event_t *));
+	memset(queue->tree, 0, queue->nelm * sizeof(int));
+
+	for (i = 0; i < j; i++) {
+		fifo_queue_tree_add(queue, i, 1);
+	}
+
+	queue->head = 0;
+	queue->idx = j;
+}
+
+/* Take the caller in slot out of the queue, the caller is returned and no longer owned by the queue */
+static switch_event_t *fifo_queue_take(fifo_queue_t *queue, int slot)
+{
+	switch_event_t *event = queue->data[slot];
 	const char *uuid = switch_event_get_header(event, "unique-id");
-	switch_core_session_t *session;
-	switch_channel_t *channel;
-	char tmp[30] = "";
 
-	if (zstr(uuid)) return;
-	if (!(session = switch_core_session_locate(uuid))) {
-		return;
+	if (uuid && (intptr_t)switch_core_hash_find(queue->uuid_hash, uuid) == slot + 1) {
+		switch_core_hash_delete(queue->uuid_hash, uuid);
 	}
-	channel = switch_core_session_get_channel(session);
-	switch_snprintf(tmp, sizeof(tmp), "%d", pos);
-	switch_channel_set_variable(channel, "fifo_position", tmp);
-	switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "fifo_position", tmp);
-	switch_core_session_rwunlock(session);
+
+	queue->data[slot] = NULL;
+	fifo_queue_tree_add(queue, slot, -1);
+	queue->removed++;
+
+	if (--queue->count == 0) {
+		queue->head = queue->idx = 0;
+	} else {
+		while (queue->head < queue->idx && !queue->data[queue->head]) {
+			queue->head++;
+		}
+	}
+
+	return event;
 }
 
 static switch_status_t fifo_queue_push(fifo_queue_t *queue, switch_event_t *ptr)
 {
 	switch_mutex_lock(queue->mutex);
 	if (queue->idx == queue->nelm) {
-		switch_mutex_unlock(queue->mutex);
-		return SWITCH_STATUS_FALSE;
+		fifo_queue_compact(queue);
 	}
-	queue->data[queue->idx++] = ptr;
+	queue->data[queue->idx] = ptr;
+	fifo_queue_index_uuid(queue, queue->idx);
+	fifo_queue_tree_add(queue, queue->idx, 1);
+	queue->idx++;
+	queue->count++;
 	switch_mutex_unlock(queue->mutex);
 	return SWITCH_STATUS_SUCCESS;
 }
@@ -209,11 +299,33 @@ static int fifo_queue_size(fifo_queue_t *queue)
 {
 	int s;
 	switch_mutex_lock(queue->mutex);
-	s = queue->idx;
+	s = queue->count;
 	switch_mutex_unlock(queue->mutex);
 	return s;
 }
 
+/*!\brief Position of the caller with the given uuid
+ *
+ * \return the 1-based position of the caller or 0 if it is not in the queue
+ */
+static int fifo_queue_position(fifo_queue_t *queue, const char *uuid)
+{
+	intptr_t slot;
+	int pos = 0;
+
+	if (zstr(uuid)) {
+		return 0;
+	}
+
+	switch_mutex_lock(queue->mutex);
+	if ((slot = (intptr_t)switch_core_hash_find(queue->uuid_hash, uuid))) {
+		pos = fifo_queue_tree_sum(queue, (int)slot - 1);
+	}
+	switch_mutex_unlock(queue->mutex);
+
+	return pos;
+}
+
 /*!
  * \param remove Whether to remove the popped event from the queue
  *   If remove is 0, do not remove the popped event.  If it is 1,
@@ -222,20 +334,26 @@ static int fifo_queue_size(fifo_queue_t *queue)
  */
 static switch_status_t fifo_queue_pop(fifo_queue_t *queue, switch_event_t **pop, int remove)
 {
-	int i, j;
+	int j;
 
 	switch_mutex_lock(queue->mutex);
 
-	if (queue->idx == 0) {
+	if (queue->count == 0) {
 		switch_mutex_unlock(queue->mutex);
 		return SWITCH_STATUS_FALSE;
 	}
 
-	for (j = 0; j < queue->idx; j++) {
-		const char *uuid = switch_event_get_header(queue->data[j], "unique-id");
+	for (j = queue->head; j < queue->idx; j++) {
+		const char *uuid;
+
+		if (!queue->data[j]) {
+			continue;
+		}
+
+		uuid = switch_event_get_header(queue->data[j], "unique-id");
 		if (uuid && (remove == 2 || !check_caller_outbound_call(uuid))) {
 			if (remove) {
-				*pop = queue->data[j];
+				*pop = fifo_queue_take(queue, j);
 			} else {
 				switch_event_dup(pop, queue->data[j]);
 			}
@@ -248,16 +366,6 @@ static switch_status_t fifo_queue_pop(fifo_queue_t *queue, switch_event_t **pop,
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (remove) {
-		for (i = j+1; i < queue->idx; i++) {
-			queue->data[i-1] = queue->data[i];
-			queue->data[i] = NULL;
-			change_pos(queue->data[i-1], i);
-		}
-
-		queue->idx--;
-	}
-
 	switch_mutex_unlock(queue->mutex);
 	return SWITCH_STATUS_SUCCESS;
 }
@@ -269,12 +377,13 @@ static switch_status_t fifo_queue_pop(fifo_queue_t *queue, switch_event_t **pop,
  * event will be returned unless the event is for an outbound caller.
  * If name starts with '+' or remove == 2 then forcing is enabled and
  * the event will be returned in any case.  If remove > 0 then the
- * returned event will be removed from the queue and the remaining
- * elements shifted to make them contiguous.
+ * returned event will be removed from the queue.
+ *
+ * Lookups on unique-id go straight to the caller's slot.
  */
 static switch_status_t fifo_queue_pop_nameval(fifo_queue_t *queue, const char *name, const char *val, switch_event_t **pop, int remove)
 {
-	int i, j, force = 0;
+	int j, force = 0;
 
 	switch_mutex_lock(queue->mutex);
 
@@ -287,21 +396,32 @@ static switch_status_t fifo_queue_pop_nameval(fifo_queue_t *queue, const char *n
 		force = 1;
 	}
 
-	if (queue->idx == 0 || zstr(name) || zstr(val)) {
+	if (queue->count == 0 || zstr(name) || zstr(val)) {
 		switch_mutex_unlock(queue->mutex);
 		return SWITCH_STATUS_FALSE;
 	}
 
-	for (j = 0; j < queue->idx; j++) {
-		const char *j_val = switch_event_get_header(queue->data[j], name);
-		const char *uuid = switch_event_get_header(queue->data[j], "unique-id");
-		if (j_val && val && !strcmp(j_val, val) && (force || !check_caller_outbound_call(uuid))) {
-			if (remove) {
-				*pop = queue->data[j];
-			} else {
-				switch_event_dup(pop, queue->data[j]);
+	if (!strcasecmp(name, "unique-id")) {
+		intptr_t slot = (intptr_t)switch_core_hash_find(queue->uuid_hash, val);
+
+		j = queue->idx;
+
+		if (slot && (force || !check_caller_outbound_call(val))) {
+			j = (int)slot - 1;
+		}
+	} else {
+		for (j = queue->head; j < queue->idx; j++) {
+			const char *j_val, *uuid;
+
+			if (!queue->data[j]) {
+				continue;
+			}
+
+			j_val = switch_event_get_header(queue->data[j], name);
+			uuid = switch_event_get_header(queue->data[j], "unique-id");
+			if (j_val && val && !strcmp(j_val, val) && (force || !check_caller_outbound_call(uuid))) {
+				break;
 			}
-			break;
 		}
 	}
 
@@ -311,13 +431,9 @@ static switch_status_t fifo_queue_pop_nameval(fifo_queue_t *queue, const char *n
 	}
 
 	if (remove) {
-		for (i = j+1; i < queue->idx; i++) {
-			queue->data[i-1] = queue->data[i];
-			queue->data[i] = NULL;
-			change_pos(queue->data[i-1], i);
-		}
-
-		queue->idx--;
+		*pop = fifo_queue_take(queue, j);
+	} else {
+		switch_event_dup(pop, queue->data[j]);
 	}
 
 	switch_mutex_unlock(queue->mutex);
@@ -327,41 +443,23 @@ static switch_status_t fifo_queue_pop_nameval(fifo_queue_t *queue, const char *n
 
 /*!\brief Destroy event with given uuid and remove it from queue
  *
- * Elements of the queue are searched until a matching uuid is found.
- * That uuid is then destroyed and removed from the queue.  The
- * remaining elements are shifted to make them contiguous.
+ * The caller's slot is looked up by uuid, the event is destroyed and
+ * the slot left empty.
  */
 static switch_status_t fifo_queue_popfly(fifo_queue_t *queue, const char *uuid)
 {
-	int i, j;
+	intptr_t slot;
+	switch_event_t *event;
 
 	switch_mutex_lock(queue->mutex);
 
-	if (queue->idx == 0 || zstr(uuid)) {
+	if (queue->count == 0 || zstr(uuid) || !(slot = (intptr_t)switch_core_hash_find(queue->uuid_hash, uuid))) {
 		switch_mutex_unlock(queue->mutex);
 		return SWITCH_STATUS_FALSE;
 	}
 
-	for (j = 0; j < queue->idx; j++) {
-		const char *j_uuid = switch_event_get_header(queue->data[j], "unique-id");
-		if (j_uuid && !strcmp(j_uuid, uuid)) {
-			switch_event_destroy(&queue->data[j]);
-			break;
-		}
-	}
-
-	if (j == queue->idx) {
-		switch_mutex_unlock(queue->mutex);
-		return SWITCH_STATUS_FALSE;
-	}
-
-	for (i = j+1; i < queue->idx; i++) {
-		queue->data[i-1] = queue->data[i];
-		queue->data[i] = NULL;
-		change_pos(queue->data[i-1], i);
-	}
-
-	queue->idx--;
+	event = fifo_queue_take(queue, (int)slot - 1);
+	switch_event_destroy(&event);
 
 	switch_mutex_unlock(queue->mutex);
 
@@ -596,10 +694,32 @@ struct fifo_chime_data {
 	char *orbit_dialplan;
 	char *orbit_context;
 	char *exit_key;
+	fifo_queue_t *queue;
+	uint32_t removed;
 };
 
 typedef struct fifo_chime_data fifo_chime_data_t;
 
+/*!rief Keep `fifo_position` current
+ *
+ * Only the callers behind one that left the queue move up, so the
+ * position is looked up again only when someone has left since the
+ * last time.
+ */
+static void caller_update_position(switch_core_session_t *session, fifo_chime_data_t *cd)
+{
+	uint32_t removed;
+	char tmp[30] = "";
+
+	if (!cd->queue || (removed = cd->queue->removed) == cd->removed) {
+		return;
+	}
+
+	cd->removed = removed;
+	switch_snprintf(tmp, sizeof(tmp), "%d", fifo_queue_position(cd->queue, switch_core_session_get_uuid(session)));
+	switch_channel_set_variable(switch_core_session_get_channel(session), "fifo_position", tmp);
+}
+
 /*!\brief Enforce the `fifo_orbit_timeout`
  *
  * If the caller has been waiting longer than the `fifo_orbit_timeout`
@@ -630,6 +750,8 @@ static switch_status_t caller_read_frame_callback(switch_core_session_t *session
 		return SWITCH_STATUS_SUCCESS;
 	}
 
+	caller_update_position(session, cd);
+
 	if (cd->total && switch_epoch_time_now(NULL) >= cd->next) {
 		if (cd->index == MAX_CHIME || cd->index == cd->total || !cd->list[cd->index]) {
 			cd->index = 0;
@@ -1027,7 +1149,7 @@ static fifo_node_t *create_node(const char *name, uint32_t importance, switch_mu
 	}
 
 	for (x = 0; x < MAX_PRI; x++) {
-		fifo_queue_create(&node->fifo_list[x], 1000, node->pool);
+		fifo_queue_create(&node->fifo_list[x], 32, node->pool);
 		switch_assert(node->fifo_list[x]);
 	}
 
@@ -2135,6 +2257,10 @@ static void *SWITCH_THREAD_FUNC node_thread_run(switch_thread_t *thread, void *o
 					globals.nodes = this_node->next;
 				}
 
+				for (x = 0; x < MAX_PRI; x++) {
+					fifo_queue_destroy(this_node->fifo_list[x]);
+				}
+
 				switch_core_hash_destroy(&this_node->consumer_hash);
 				switch_mutex_unlock(this_node->mutex);
 				switch_mutex_unlock(this_node->update_mutex);
@@ -2739,6 +2865,8 @@ SWITCH_STANDARD_APP(fifo_function)
 		fifo_queue_push(node->fifo_list[p], call_event);
 		fifo_caller_add(node, session);
 		in_table = 1;
+		cd.queue = node->fifo_list[p];
+		cd.removed = cd.queue->removed;
 
 		call_event = NULL;
 		switch_snprintf(tmp, sizeof(tmp), "%d", fifo_queue_size(node->fifo_list[p]));
@@ -2780,10 +2908,9 @@ SWITCH_STANDARD_APP(fifo_function)
 			args.buf = buf;
 			args.buflen = sizeof(buf);
 
-			if (cd.total || cd.orbit_timeout) {
-				args.read_frame_callback = caller_read_frame_callback;
-				args.user_data = &cd;
-			}
+			/* also keeps fifo_position current while the hold music plays */
+			args.read_frame_callback = caller_read_frame_callback;
+			args.user_data = &cd;
 
 			if (cd.abort || cd.do_orbit) {
 				aborted = 1;
@@ -2796,6 +2923,8 @@ SWITCH_STANDARD_APP(fifo_function)
 
 			switch_core_session_flush_private_events(session);
 
+			caller_update_position(session, &cd);
+
 			if (moh) {
 				rstatus = switch_ivr_play_file(session, NULL, moh, &args);
 			} else {
@@ -3980,16 +4109,16 @@ static int xml_caller(switch_xml_t xml, fifo_node_t *node, char *container, char
 
 		switch_mutex_lock(q->mutex);
 
-		for (i = 0; i < q->idx; i++) {
+		for (i = q->head; i < q->idx; i++) {
 			int c_off = 0, d_off = 0;
 			const char *status;
 			const char *ts;
-			const char *uuid = switch_event_get_header(q->data[i], "unique-id");
+			const char *uuid;
 			char sl[30] = "";
 			char url_buf[512] = "";
 			char *encoded;
 
-			if (!uuid) {
+			if (!q->data[i] || !(uuid = switch_event_get_header(q->data[i], "unique-id"))) {
 				continue;
 			}
 
@@ -4025,9 +4154,10 @@ static int xml_caller(switch_xml_t xml, fifo_node_t *node, char *container, char
 				switch_xml_set_attr_d(x_caller, "target", ts);
 			}
 
-			if ((ts = switch_channel_get_variable(channel, "fifo_position"))) {
-				switch_xml_set_attr_d(x_caller, "position", ts);
-			}
+			/* Positions are not pushed to every caller on each pop, refresh the one we report */
+			switch_snprintf(sl, sizeof(sl), "%d", fifo_queue_tree_sum(q, i));
+			switch_channel_set_variable(channel, "fifo_position", sl);
+			switch_xml_set_attr_d_buf(x_caller, "position", sl);
 
 			switch_snprintf(sl, sizeof(sl), "%d", x);
 			switch_xml_set_attr_d_buf(x_caller, "slot", sl);
@@ -4931,6 +5061,7 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_fifo_shutdown)
 			while (fifo_queue_pop(this_node->fifo_list[x], &pop, 2) == SWITCH_STATUS_SUCCESS) {
 				switch_event_destroy(&pop);
 			}
+			fifo_queue_destroy(this_node->fifo_list[x]);
 		}
 		switch_mutex_unlock(this_node->mutex);
 		switch_core_hash_delete(globals.fifo_hash, this_node->name);
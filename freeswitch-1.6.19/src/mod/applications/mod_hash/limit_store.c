@@ -0,0 +1,504 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * limit_store.c -- Lock striped counter store behind the hash limit backend
+ *
+ * Keys are spread over LIMIT_STORE_STRIPES partitions, each with its own
+ * mutex and hash, so limit checks on different realms and resources do not
+ * serialize on one lock.  Rate limits use a two window sliding counter: the
+ * rate is the hits of the current window plus the hits of the previous one
+ * weighted by how much of it still overlaps the last interval.
+ *
+ */
+#include "limit_store.h"
+
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+} limit_store_stripe_t;
+
+/* A freed entry, kept so delta dumps can tell readers it dropped to 0 */
+typedef struct {
+	char *key;
+	switch_time_t version;
+} limit_store_journal_t;
+
+static struct {
+	limit_store_stripe_t stripes[LIMIT_STORE_STRIPES];
+	char epoch[64];
+	/* Deletions are only journaled once somebody asked for deltas */
+	switch_bool_t journal_enabled;
+	switch_mutex_t *journal_mutex;
+	limit_store_journal_t journal[LIMIT_STORE_JOURNAL_SIZE];
+	uint32_t journal_pos;
+	switch_time_t journal_floor;
+} store;
+
+static limit_store_stripe_t *limit_store_stripe(const char *key)
+{
+	switch_ssize_t hlen = -1;
+
+	return &store.stripes[switch_hashfunc_default(key, &hlen) % LIMIT_STORE_STRIPES];
+}
+
+/* Versions are the monotonic clock, so changing a key only ever takes its own stripe lock */
+static switch_time_t limit_store_next_version(void)
+{
+	return switch_mono_micro_time_now();
+}
+
+/*
+ * The version a delta dump reports: every change already made has a version up to it and, once the
+ * clock has moved past it, every change still to come gets a later one.
+ */
+static switch_time_t limit_store_current_version(void)
+{
+	switch_time_t version = switch_mono_micro_time_now();
+
+	while (switch_mono_micro_time_now() <= version);
+
+	return version;
+}
+
+/* Called with the stripe locked, the version is taken after the lock so a delta dump started before it can't miss the change */
+static void limit_store_touch(limit_hash_item_t *item)
+{
+	item->version = limit_store_next_version();
+}
+
+static void limit_store_journal_delete(const char *key)
+{
+	limit_store_journal_t *entry;
+
+	if (!store.journal_enabled) {
+		return;
+	}
+
+	switch_mutex_lock(store.journal_mutex);
+	entry = &store.journal[store.journal_pos++ % LIMIT_STORE_JOURNAL_SIZE];
+	if (entry->key) {
+		/* Anyone older than this entry can no longer get a complete delta */
+		store.journal_floor = entry->version;
+		free(entry->key);
+	}
+	entry->key = strdup(key);
+	entry->version = limit_store_next_version();
+	switch_mutex_unlock(store.journal_mutex);
+}
+
+/* Move the rate windows forward to now */
+static void limit_store_roll(limit_hash_item_t *item, switch_time_t now)
+{
+	switch_time_t interval = (switch_time_t) item->interval * 1000000;
+	switch_time_t elapsed = now - item->rate_start;
+
+	if (!interval) {
+		return;
+	}
+
+	if (!item->rate_start || elapsed >= interval * 2) {
+		item->rate_prev = 0;
+		item->rate_usage = 0;
+		item->rate_start = now;
+	} else if (elapsed >= interval) {
+		item->rate_prev = item->rate_usage;
+		item->rate_usage = 0;
+		item->rate_start += interval;
+	}
+
+	item->last_check = (time_t) (switch_epoch_time_now(NULL) - (now - item->rate_start) / 1000000);
+}
+
+/* Hits over the last interval, the previous window counted for the part of it still inside the interval */
+static uint32_t limit_store_rate(const limit_hash_item_t *item, switch_time_t now)
+{
+	switch_time_t interval = (switch_time_t) item->interval * 1000000;
+	switch_time_t elapsed = now - item->rate_start;
+
+	if (!interval || elapsed >= interval) {
+		return item->rate_usage;
+	}
+
+	return item->rate_usage + (uint32_t) (((uint64_t) item->rate_prev * (interval - elapsed)) / interval);
+}
+
+/*
+ * Roll the rate windows of an item a delta dump is about to look at.  The sliding rate drops with
+ * time alone, so true while it is still dropping or it just dropped, the item has to be sent again.
+ */
+static switch_bool_t limit_store_decay(limit_hash_item_t *item, switch_time_t now)
+{
+	uint32_t usage = item->rate_usage, prev = item->rate_prev;
+
+	if (!item->interval || (!usage && !prev)) {
+		return SWITCH_FALSE;
+	}
+
+	limit_store_roll(item, now);
+
+	return (item->rate_prev || item->rate_usage != usage) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+static void limit_store_snapshot(const limit_hash_item_t *item, switch_time_t now, limit_hash_item_t *usage)
+{
+	if (usage) {
+		*usage = *item;
+		usage->rate_usage = limit_store_rate(item, now);
+	}
+}
+
+void limit_store_init(switch_memory_pool_t *pool)
+{
+	int i;
+
+	memset(&store, 0, sizeof(store));
+
+	for (i = 0; i < LIMIT_STORE_STRIPES; i++) {
+		switch_mutex_init(&store.stripes[i].mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&store.stripes[i].hash);
+	}
+
+	switch_mutex_init(&store.journal_mutex, SWITCH_MUTEX_NESTED, pool);
+
+	/* Readers seeing a different epoch know our versions and journal restarted and resync */
+	switch_snprintf(store.epoch, sizeof(store.epoch), "%" SWITCH_TIME_T_FMT, switch_micro_time_now());
+}
+
+void limit_store_destroy(void)
+{
+	switch_hash_index_t *hi = NULL;
+	int i;
+
+	for (i = 0; i < LIMIT_STORE_STRIPES; i++) {
+		limit_store_stripe_t *stripe = &store.stripes[i];
+
+		switch_mutex_lock(stripe->mutex);
+		while ((hi = switch_core_hash_first_iter(stripe->hash, hi))) {
+			void *val = NULL;
+			const void *key;
+			switch_ssize_t keylen;
+			switch_core_hash_this(hi, &key, &keylen, &val);
+			free(val);
+			switch_core_hash_delete(stripe->hash, key);
+		}
+		switch_core_hash_destroy(&stripe->hash);
+		switch_mutex_unlock(stripe->mutex);
+	}
+
+	for (i = 0; i < LIMIT_STORE_JOURNAL_SIZE; i++) {
+		switch_safe_free(store.journal[i].key);
+	}
+}
+
+switch_status_t limit_store_incr(const char *key, int max, int interval, switch_bool_t increment, uint32_t remote_total, limit_hash_item_t *usage)
+{
+	limit_store_stripe_t *stripe = limit_store_stripe(key);
+	limit_hash_item_t *item;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_time_t now = switch_mono_micro_time_now();
+
+	switch_mutex_lock(stripe->mutex);
+
+	/* Check if that realm+resource has ever been checked */
+	if (!(item = (limit_hash_item_t *) switch_core_hash_find(stripe->hash, key))) {
+		/* No, create an empty structure and add it, then continue like as if it existed */
+		switch_zmalloc(item, sizeof(limit_hash_item_t));
+		switch_core_hash_insert(stripe->hash, key, item);
+	}
+
+	if (interval > 0) {
+		item->interval = interval;
+		limit_store_roll(item, now);
+
+		/* Always count the hit as it doesnt depend on the channel */
+		item->rate_usage++;
+
+		if ((max >= 0) && (limit_store_rate(item, now) > (uint32_t) max)) {
+			status = SWITCH_STATUS_GENERR;
+		}
+	} else if ((max >= 0) && (item->total_usage + increment + remote_total > (uint32_t) max)) {
+		status = SWITCH_STATUS_GENERR;
+	}
+
+	if (status == SWITCH_STATUS_SUCCESS && increment) {
+		item->total_usage++;
+	}
+
+	limit_store_touch(item);
+	limit_store_snapshot(item, now, usage);
+
+	switch_mutex_unlock(stripe->mutex);
+
+	return status;
+}
+
+int limit_store_release(const char *key)
+{
+	limit_store_stripe_t *stripe = limit_store_stripe(key);
+	limit_hash_item_t *item;
+	int r = -1;
+
+	switch_mutex_lock(stripe->mutex);
+
+	if ((item = (limit_hash_item_t *) switch_core_hash_find(stripe->hash, key))) {
+		if (item->total_usage > 0) {
+			item->total_usage--;
+		}
+		r = item->total_usage;
+		limit_store_touch(item);
+
+		limit_store_roll(item, switch_mono_micro_time_now());
+		if (item->total_usage == 0 && item->rate_usage == 0 && item->rate_prev == 0) {
+			/* Noone is using this item anymore */
+			switch_core_hash_delete(stripe->hash, key);
+			limit_store_journal_delete(key);
+			free(item);
+		}
+	}
+
+	switch_mutex_unlock(stripe->mutex);
+
+	return r;
+}
+
+switch_status_t limit_store_usage(const char *key, limit_hash_item_t *usage)
+{
+	limit_store_stripe_t *stripe = limit_store_stripe(key);
+	limit_hash_item_t *item;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	switch_mutex_lock(stripe->mutex);
+	if ((item = (limit_hash_item_t *) switch_core_hash_find(stripe->hash, key))) {
+		limit_store_snapshot(item, switch_mono_micro_time_now(), usage);
+		status = SWITCH_STATUS_SUCCESS;
+	}
+	switch_mutex_unlock(stripe->mutex);
+
+	return status;
+}
+
+void limit_store_interval_reset(const char *key)
+{
+	limit_store_stripe_t *stripe = limit_store_stripe(key);
+	limit_hash_item_t *item;
+
+	switch_mutex_lock(stripe->mutex);
+	if ((item = (limit_hash_item_t *) switch_core_hash_find(stripe->hash, key))) {
+		item->rate_usage = 0;
+		item->rate_prev = 0;
+		item->rate_start = switch_mono_micro_time_now();
+		item->last_check = switch_epoch_time_now(NULL);
+		limit_store_touch(item);
+	}
+	switch_mutex_unlock(stripe->mutex);
+}
+
+void limit_store_cleanup(void)
+{
+	switch_time_t now = switch_mono_micro_time_now();
+	int i;
+
+	for (i = 0; i < LIMIT_STORE_STRIPES; i++) {
+		limit_store_stripe_t *stripe = &store.stripes[i];
+		switch_hash_index_t *hi = NULL;
+		switch_event_t *expired = NULL;
+		switch_event_header_t *hp;
+
+		switch_mutex_lock(stripe->mutex);
+
+		for (hi = switch_core_hash_first(stripe->hash); hi; hi = switch_core_hash_next(&hi)) {
+			void *val = NULL;
+			const void *key;
+			switch_ssize_t keylen;
+			limit_hash_item_t *item;
+
+			switch_core_hash_this(hi, &key, &keylen, &val);
+			item = (limit_hash_item_t *) val;
+
+			/* reset to 0 once the windows have passed so we can clean it up */
+			if (item->rate_usage || item->rate_prev) {
+				limit_store_roll(item, now);
+				if (!item->rate_usage && !item->rate_prev) {
+					limit_store_touch(item);
+				}
+			}
+
+			if (item->total_usage == 0 && item->rate_usage == 0 && item->rate_prev == 0) {
+				if (!expired) {
+					switch_event_create_plain(&expired, SWITCH_EVENT_CLONE);
+				}
+				switch_event_add_header_string(expired, SWITCH_STACK_BOTTOM, "key", (const char *) key);
+			}
+		}
+
+		if (expired) {
+			for (hp = expired->headers; hp; hp = hp->next) {
+				limit_hash_item_t *item = switch_core_hash_find(stripe->hash, hp->value);
+
+				/* Noone is using this item anymore */
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Freeing limit item: %s\n", hp->value);
+				switch_core_hash_delete(stripe->hash, hp->value);
+				limit_store_journal_delete(hp->value);
+				free(item);
+			}
+			switch_event_destroy(&expired);
+		}
+
+		switch_mutex_unlock(stripe->mutex);
+	}
+}
+
+void limit_store_dump(switch_stream_handle_t *stream)
+{
+	switch_time_t now = switch_mono_micro_time_now();
+	int i;
+
+	for (i = 0; i < LIMIT_STORE_STRIPES; i++) {
+		limit_store_stripe_t *stripe = &store.stripes[i];
+		switch_hash_index_t *hi;
+
+		switch_mutex_lock(stripe->mutex);
+		for (hi = switch_core_hash_first(stripe->hash); hi; hi = switch_core_hash_next(&hi)) {
+			void *val = NULL;
+			const void *key;
+			switch_ssize_t keylen;
+			limit_hash_item_t *item;
+			switch_core_hash_this(hi, &key, &keylen, &val);
+
+			item = (limit_hash_item_t *)val;
+
+			stream->write_function(stream, "L/%s/%d/%d/%d/%d\n", key, item->total_usage, limit_store_rate(item, now), item->interval, item->last_check);
+		}
+		switch_mutex_unlock(stripe->mutex);
+	}
+}
+
+void limit_store_dump_delta(switch_stream_handle_t *stream, const char *epoch, switch_time_t since)
+{
+	switch_time_t version, now;
+	switch_event_t *freed = NULL;
+	switch_event_header_t *hp;
+	switch_bool_t full;
+	uint32_t i;
+
+	store.journal_enabled = SWITCH_TRUE;
+
+	/* Taken before scanning: a change with an older version finished before we reach its stripe */
+	version = limit_store_current_version();
+	now = switch_mono_micro_time_now();
+
+	switch_mutex_lock(store.journal_mutex);
+	full = (zstr(epoch) || strcmp(epoch, store.epoch) || since > version || since < store.journal_floor);
+	switch_mutex_unlock(store.journal_mutex);
+
+	stream->write_function(stream, "V/%s/%" SWITCH_TIME_T_FMT "/%s\n", store.epoch, version, full ? "full" : "delta");
+
+	for (i = 0; i < LIMIT_STORE_STRIPES; i++) {
+		limit_store_stripe_t *stripe = &store.stripes[i];
+		switch_hash_index_t *hi;
+
+		switch_mutex_lock(stripe->mutex);
+		for (hi = switch_core_hash_first(stripe->hash); hi; hi = switch_core_hash_next(&hi)) {
+			void *val = NULL;
+			const void *key;
+			switch_ssize_t keylen;
+			limit_hash_item_t *item;
+			switch_core_hash_this(hi, &key, &keylen, &val);
+
+			item = (limit_hash_item_t *)val;
+
+			if (limit_store_decay(item, now)) {
+				limit_store_touch(item);
+			}
+
+			if (full || item->version > since) {
+				stream->write_function(stream, "L/%s/%d/%d/%d/%d\n", key, item->total_usage, limit_store_rate(item, now), item->interval, item->last_check);
+			}
+		}
+		switch_mutex_unlock(stripe->mutex);
+	}
+
+	if (full) {
+		return;
+	}
+
+	/* Deletions are read after the scan so one racing with it is not lost, copied out since the journal is locked inside stripe locks */
+	switch_mutex_lock(store.journal_mutex);
+	for (i = 0; i < LIMIT_STORE_JOURNAL_SIZE; i++) {
+		limit_store_journal_t *entry = &store.journal[(store.journal_pos + i) % LIMIT_STORE_JOURNAL_SIZE];
+
+		if (entry->key && entry->version > since) {
+			if (!freed) {
+				switch_event_create_plain(&freed, SWITCH_EVENT_CLONE);
+			}
+			switch_event_add_header_string(freed, SWITCH_STACK_BOTTOM, "key", entry->key);
+		}
+	}
+	switch_mutex_unlock(store.journal_mutex);
+
+	if (!freed) {
+		return;
+	}
+
+	for (hp = freed->headers; hp; hp = hp->next) {
+		limit_store_stripe_t *stripe = limit_store_stripe(hp->value);
+		switch_bool_t live;
+
+		/* A key that came back after being freed was already sent with its current usage */
+		switch_mutex_lock(stripe->mutex);
+		live = !!switch_core_hash_find(stripe->hash, hp->value);
+		switch_mutex_unlock(stripe->mutex);
+
+		if (!live) {
+			stream->write_function(stream, "L/%s/0/0/0/0\n", hp->value);
+		}
+	}
+
+	switch_event_destroy(&freed);
+}
+
+char *limit_store_key(char *buf, switch_size_t len, const char *realm, const char *resource)
+{
+	if (strlen(realm) + strlen(resource) + 2 > len) {
+		return switch_mprintf("%s_%s", realm, resource);
+	}
+
+	switch_snprintf(buf, len, "%s_%s", realm, resource);
+
+	return buf;
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
@@ -0,0 +1,111 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * limit_store.h -- Lock striped counter store behind the hash limit backend
+ *
+ */
+#ifndef LIMIT_STORE_H
+#define LIMIT_STORE_H
+
+#include <switch.h>
+
+/* Number of independently locked partitions of the store, keys are spread by hash */
+#define LIMIT_STORE_STRIPES 64
+#define LIMIT_STORE_JOURNAL_SIZE 1024
+
+typedef struct {
+	uint32_t total_usage;	/* < Total */
+	uint32_t rate_usage;	/* < Hits in the current rate window */
+	uint32_t rate_prev;		/* < Hits in the previous rate window */
+	time_t last_check;		/* < Start of the current rate window */
+	uint32_t interval;		/* < Interval used on last rate check */
+	switch_time_t last_update;	/* < Last updated timestamp (rate or total) */
+	switch_time_t rate_start;	/* < Start of the current rate window in microseconds */
+	switch_time_t version;	/* < Monotonic time of the last change */
+} limit_hash_item_t;
+
+void limit_store_init(switch_memory_pool_t *pool);
+void limit_store_destroy(void);
+
+/*!
+  \brief Count a hit on key
+  \param key realm_resource key
+  \param max maximum count (or rate), -1 for no limit
+  \param interval rate window in seconds, 0 to check the total instead
+  \param increment add one to the total usage
+  \param remote_total usage of the same key on remote instances
+  \param usage receives the usage after the call, rate_usage holds the sliding window rate
+  \return SWITCH_STATUS_SUCCESS if allowed, SWITCH_STATUS_GENERR if the limit was hit
+*/
+switch_status_t limit_store_incr(const char *key, int max, int interval, switch_bool_t increment, uint32_t remote_total, limit_hash_item_t *usage);
+
+/*!
+  \brief Give back one total usage of key
+  \return the remaining total usage or -1 if the key is not tracked
+*/
+int limit_store_release(const char *key);
+
+/*!
+  \brief Current usage of key
+  \return SWITCH_STATUS_SUCCESS if the key is tracked
+*/
+switch_status_t limit_store_usage(const char *key, limit_hash_item_t *usage);
+
+void limit_store_interval_reset(const char *key);
+
+/* Free entries nobody uses anymore */
+void limit_store_cleanup(void);
+
+/* Write every entry as L/key/usage/rate/interval/last_check lines */
+void limit_store_dump(switch_stream_handle_t *stream);
+
+/*!
+  \brief Write the entries changed since a version of the store
+  \param epoch epoch the version belongs to, NULL to force a full snapshot
+  \param since version the reader is in sync with, versions are the monotonic time of each change
+
+  The output starts with a V/epoch/version/full|delta line.  A full
+  snapshot is sent when the epoch does not match or the deletion
+  journal no longer covers since.  Freed entries are sent with 0 usage.
+*/
+void limit_store_dump_delta(switch_stream_handle_t *stream, const char *epoch, switch_time_t since);
+
+/* Build "realm_resource" into buf if it fits, otherwise allocate it, free the result if it isn't buf */
+char *limit_store_key(char *buf, switch_size_t len, const char *realm, const char *resource);
+
+#endif
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
@@ -35,6 +35,7 @@
 
 #include <switch.h>
 #include "esl.h"
+#include "limit_store.h"
 
 #define LIMIT_HASH_CLEANUP_INTERVAL 900
 
@@ -43,24 +44,16 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_hash_shutdown);
 SWITCH_MODULE_DEFINITION(mod_hash, mod_hash_load, mod_hash_shutdown, NULL);
 
 /* CORE STUFF */
+
 static struct {
 	switch_memory_pool_t *pool;
-	switch_thread_rwlock_t *limit_hash_rwlock;
-	switch_hash_t *limit_hash;
+	switch_bool_t running;
 	switch_thread_rwlock_t *db_hash_rwlock;
 	switch_hash_t *db_hash;
 	switch_thread_rwlock_t *remote_hash_rwlock;
 	switch_hash_t *remote_hash;
 } globals;
 
-typedef struct {
-	uint32_t total_usage;	/* < Total */
-	uint32_t rate_usage;	/* < Current rate usage */
-	time_t last_check;		/* < Last rate check */
-	uint32_t interval;		/* < Interval used on last rate check */
-	switch_time_t last_update;	/* < Last updated timestamp (rate or total) */
-} limit_hash_item_t;
-
 struct callback {
 	char *buf;
 	size_t len;
@@ -103,6 +96,10 @@ typedef struct {
 	
 	esl_handle_t handle;
 
+	char epoch[64];				/* < Epoch of the remote's limit store, empty until the first snapshot */
+	switch_time_t version;		/* < Last store version we are in sync with */
+	switch_bool_t legacy;		/* < Remote only knows full "hash_dump limit" dumps */
+
 	switch_hash_t *index;
 	switch_thread_rwlock_t *rwlock;
 	switch_memory_pool_t *pool;
@@ -117,7 +114,6 @@ static limit_hash_item_t get_remote_usage(const char *key);
 void limit_remote_destroy(limit_remote_t **r);
 static void do_config(switch_bool_t reload);
 
-
 /* \brief Enforces limit_hash restrictions
  * \param session current session
  * \param realm limit realm
@@ -129,26 +125,15 @@ static void do_config(switch_bool_t reload);
 SWITCH_LIMIT_INCR(limit_incr_hash)
 {
 	switch_channel_t *channel = switch_core_session_get_channel(session);
+	char buf[256];
 	char *hashkey = NULL;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
-	limit_hash_item_t *item = NULL;
-	time_t now = switch_epoch_time_now(NULL);
+	limit_hash_item_t item = { 0 };
 	limit_hash_private_t *pvt = NULL;
-	uint8_t increment = 1;
+	switch_bool_t increment = SWITCH_TRUE;
 	limit_hash_item_t remote_usage;
 
-	hashkey = switch_core_session_sprintf(session, "%s_%s", realm, resource);
-
-	switch_thread_rwlock_wrlock(globals.limit_hash_rwlock);
-	/* Check if that realm+resource has ever been checked */
-	if (!(item = (limit_hash_item_t *) switch_core_hash_find(globals.limit_hash, hashkey))) {
-		/* No, create an empty structure and add it, then continue like as if it existed */
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG10, "Creating new limit structure: key: %s\n", hashkey);
-		item = (limit_hash_item_t *) malloc(sizeof(limit_hash_item_t));
-		switch_assert(item);
-		memset(item, 0, sizeof(limit_hash_item_t));
-		switch_core_hash_insert(globals.limit_hash, hashkey, item);
-	}
+	hashkey = limit_store_key(buf, sizeof(buf), realm, resource);
 
 	if (!(pvt = switch_channel_get_private(channel, "limit_hash"))) {
 		pvt = (limit_hash_private_t *) switch_core_session_alloc(session, sizeof(limit_hash_private_t));
@@ -159,53 +144,40 @@ SWITCH_LIMIT_INCR(limit_incr_hash)
 		switch_core_hash_init(&pvt->hash);
 	}
 	increment = !switch_core_hash_find(pvt->hash, hashkey);
- 	remote_usage = get_remote_usage(hashkey);
-
-	if (interval > 0) {
-		item->interval = interval;
-		if (item->last_check <= (now - interval)) {
-			item->rate_usage = 1;
-			item->last_check = now;
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG10, "Usage for %s reset to 1\n",
-							  hashkey);
+	remote_usage = get_remote_usage(hashkey);
+
+	status = limit_store_incr(hashkey, max, interval, increment, remote_usage.total_usage, &item);
+
+	if (status != SWITCH_STATUS_SUCCESS) {
+		if (interval > 0) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Usage for %s exceeds maximum rate of %d/%ds, now at %d\n",
+							  hashkey, max, interval, item.rate_usage);
 		} else {
-			/* Always increment rate when its checked as it doesnt depend on the channel */
-			item->rate_usage++;
-
-			if ((max >= 0) && (item->rate_usage > (uint32_t) max)) {
-				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Usage for %s exceeds maximum rate of %d/%ds, now at %d\n",
-								  hashkey, max, interval, item->rate_usage);
-				status = SWITCH_STATUS_GENERR;
-				goto end;
-			}
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Usage for %s is already at max value (%d)\n", hashkey, item.total_usage);
 		}
-	} else if ((max >= 0) && (item->total_usage + increment + remote_usage.total_usage > (uint32_t) max)) {
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Usage for %s is already at max value (%d)\n", hashkey, item->total_usage);
-		status = SWITCH_STATUS_GENERR;
 		goto end;
 	}
 
 	if (increment) {
-		item->total_usage++;
-
-		switch_core_hash_insert(pvt->hash, hashkey, item);
+		/* Only the key matters, the usage itself lives in the store */
+		switch_core_hash_insert(pvt->hash, hashkey, (void *) (intptr_t) 1);
 
 		if (max == -1) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d\n", hashkey, item->total_usage + remote_usage.total_usage);
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d\n", hashkey, item.total_usage + remote_usage.total_usage);
 		} else if (interval == 0) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d/%d\n", hashkey, item->total_usage + remote_usage.total_usage, max);
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d/%d\n", hashkey, item.total_usage + remote_usage.total_usage, max);
 		} else {
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d/%d for the last %d seconds\n", hashkey,
-							  item->rate_usage, max, interval);
+							  item.rate_usage, max, interval);
 		}
 
-		switch_limit_fire_event("hash", realm, resource, item->total_usage, item->rate_usage, max, max >= 0 ? (uint32_t) max : 0);
+		switch_limit_fire_event("hash", realm, resource, item.total_usage, item.rate_usage, max, max >= 0 ? (uint32_t) max : 0);
 	}
 
 	/* Save current usage & rate into channel variables so it can be used later in the dialplan, or added to CDR records */
 	{
-		const char *susage = switch_core_session_sprintf(session, "%d", item->total_usage);
-		const char *srate = switch_core_session_sprintf(session, "%d", item->rate_usage);
+		const char *susage = switch_core_session_sprintf(session, "%d", item.total_usage);
+		const char *srate = switch_core_session_sprintf(session, "%d", item.rate_usage);
 
 		switch_channel_set_variable(channel, "limit_usage", susage);
 		switch_channel_set_variable(channel, switch_core_session_sprintf(session, "limit_usage_%s", hashkey), susage);
@@ -215,29 +187,10 @@ SWITCH_LIMIT_INCR(limit_incr_hash)
 	}
 
   end:
-	switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
-	return status;
-}
-
-/* !\brief Determines whether a given entry is ready to be removed. */
-SWITCH_HASH_DELETE_FUNC(limit_hash_cleanup_delete_callback) {
-	limit_hash_item_t *item = (limit_hash_item_t *) val;
-	time_t now = switch_epoch_time_now(NULL);
-
-	/* reset to 0 if window has passed so we can clean it up */
-	if (item->rate_usage > 0 && (item->last_check <= (now - item->interval))) {
-		item->rate_usage = 0;
-	}
-
-	if (item->total_usage == 0 && item->rate_usage == 0) {
-		/* Noone is using this item anymore */
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Freeing limit item: %s\n", (const char *) key);
-		
-		free(item);
-		return SWITCH_TRUE;
+	if (hashkey != buf) {
+		switch_safe_free(hashkey);
 	}
-	
-	return SWITCH_FALSE;
+	return status;
 }
 
 SWITCH_HASH_DELETE_FUNC(limit_hash_remote_cleanup_callback) 
@@ -256,13 +209,8 @@ SWITCH_HASH_DELETE_FUNC(limit_hash_remote_cleanup_callback)
 /* !\brief Periodically checks for unused limit entries and frees them */
 SWITCH_STANDARD_SCHED_FUNC(limit_hash_cleanup_callback)
 {
-	switch_thread_rwlock_wrlock(globals.limit_hash_rwlock);
-	if (globals.limit_hash) {
-		switch_core_hash_delete_multi(globals.limit_hash, limit_hash_cleanup_delete_callback, NULL);
-	}
-	switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
-
-	if (globals.limit_hash) {	
+	if (globals.running) {
+		limit_store_cleanup();
 		task->runtime = switch_epoch_time_now(NULL) + LIMIT_HASH_CLEANUP_INTERVAL;
 	}
 }
@@ -272,19 +220,16 @@ SWITCH_LIMIT_RELEASE(limit_release_hash)
 {
 	switch_channel_t *channel = switch_core_session_get_channel(session);
 	limit_hash_private_t *pvt = switch_channel_get_private(channel, "limit_hash");
-	limit_hash_item_t *item = NULL;
-
-	switch_thread_rwlock_wrlock(globals.limit_hash_rwlock);
+	int usage;
 
 	if (!pvt || !pvt->hash) {
-		switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
 		return SWITCH_STATUS_SUCCESS;
 	}
 
 	/* clear for uuid */
 	if (realm == NULL && resource == NULL) {
 		switch_hash_index_t *hi = NULL;
-		/* Loop through the channel's hashtable which contains mapping to all the limit_hash_item_t referenced by that channel */
+		/* Loop through the channel's hashtable which contains all the keys referenced by that channel */
 		while ((hi = switch_core_hash_first_iter(pvt->hash, hi))) {
 			void *val = NULL;
 			const void *key;
@@ -292,63 +237,55 @@ SWITCH_LIMIT_RELEASE(limit_release_hash)
 
 			switch_core_hash_this(hi, &key, &keylen, &val);
 
-			item = (limit_hash_item_t *) val;
-			item->total_usage--;
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d\n", (const char *) key, item->total_usage);
-
-			if (item->total_usage == 0 && item->rate_usage == 0) {
-				/* Noone is using this item anymore */
-				switch_core_hash_delete(globals.limit_hash, (const char *) key);
-				free(item);
+			if ((usage = limit_store_release((const char *) key)) >= 0) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d\n", (const char *) key, usage);
 			}
 
 			switch_core_hash_delete(pvt->hash, (const char *) key);
 		}
 		switch_core_hash_destroy(&pvt->hash);
 	} else {
-		char *hashkey = switch_core_session_sprintf(session, "%s_%s", realm, resource);
+		char buf[256];
+		char *hashkey = limit_store_key(buf, sizeof(buf), realm, resource);
 
-		if ((item = (limit_hash_item_t *) switch_core_hash_find(pvt->hash, hashkey))) {
-			item->total_usage--;
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d\n", (const char *) hashkey, item->total_usage);
+		if (switch_core_hash_find(pvt->hash, hashkey)) {
+			if ((usage = limit_store_release(hashkey)) >= 0) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Usage for %s is now %d\n", (const char *) hashkey, usage);
+			}
 
 			switch_core_hash_delete(pvt->hash, hashkey);
+		}
 
-			if (item->total_usage == 0 && item->rate_usage == 0) {
-				/* Noone is using this item anymore */
-				switch_core_hash_delete(globals.limit_hash, (const char *) hashkey);
-				free(item);
-			}
+		if (hashkey != buf) {
+			switch_safe_free(hashkey);
 		}
 	}
 
-	switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
-	
 	return SWITCH_STATUS_SUCCESS;
 }
 
 SWITCH_LIMIT_USAGE(limit_usage_hash)
 {
+	char buf[256];
 	char *hash_key = NULL;
-	limit_hash_item_t *item = NULL;
+	limit_hash_item_t item = { 0 };
 	int count = 0;
 	limit_hash_item_t remote_usage;
 
-	switch_thread_rwlock_rdlock(globals.limit_hash_rwlock);
-
-	hash_key = switch_mprintf("%s_%s", realm, resource);
+	hash_key = limit_store_key(buf, sizeof(buf), realm, resource);
 	remote_usage = get_remote_usage(hash_key);
-	
+
 	count = remote_usage.total_usage;
 	*rcount = remote_usage.rate_usage;
 
-	if ((item = switch_core_hash_find(globals.limit_hash, hash_key))) {
-		count += item->total_usage;
-		*rcount += item->rate_usage;
+	if (limit_store_usage(hash_key, &item) == SWITCH_STATUS_SUCCESS) {
+		count += item.total_usage;
+		*rcount += item.rate_usage;
 	}
 
- 	switch_safe_free(hash_key);
-	switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
+	if (hash_key != buf) {
+		switch_safe_free(hash_key);
+	}
 
 	return count;
 }
@@ -360,19 +297,16 @@ SWITCH_LIMIT_RESET(limit_reset_hash)
 
 SWITCH_LIMIT_INTERVAL_RESET(limit_interval_reset_hash)
 {
+	char buf[256];
 	char *hash_key = NULL;
-	limit_hash_item_t *item = NULL;
 
-	switch_thread_rwlock_rdlock(globals.limit_hash_rwlock);
+	hash_key = limit_store_key(buf, sizeof(buf), realm, resource);
+	limit_store_interval_reset(hash_key);
 
-	hash_key = switch_mprintf("%s_%s", realm, resource);
-	if ((item = switch_core_hash_find(globals.limit_hash, hash_key))) {
-		item->rate_usage = 0;
-		item->last_check = switch_epoch_time_now(NULL);
+	if (hash_key != buf) {
+		switch_safe_free(hash_key);
 	}
 
- 	switch_safe_free(hash_key);
-	switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
 	return SWITCH_STATUS_SUCCESS;
 }
 
@@ -576,7 +510,7 @@ SWITCH_STANDARD_API(hash_api_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
-#define HASH_DUMP_SYNTAX "all|limit|db [<realm>]"
+#define HASH_DUMP_SYNTAX "all|limit|db [<realm>]|delta <epoch> <version>"
 SWITCH_STANDARD_API(hash_dump_function) 
 {
 	int mode;
@@ -608,27 +542,22 @@ SWITCH_STANDARD_API(hash_dump_function)
 		mode = 1;
 	} else if (!strcmp(cmd, "db")) {
 		mode = 2;
+	} else if (!strcmp(cmd, "delta")) {
+		mode = 4;
 	} else {
 		stream->write_function(stream, "Usage: "HASH_DUMP_SYNTAX"\n");
 		goto done;
 	}
 	
 	if (mode & 1) {
-		switch_thread_rwlock_rdlock(globals.limit_hash_rwlock);
-		for (hi = switch_core_hash_first(globals.limit_hash); hi; hi = switch_core_hash_next(&hi)) {
-			void *val = NULL;
-			const void *key;
-			switch_ssize_t keylen;
-			limit_hash_item_t *item;
-			switch_core_hash_this(hi, &key, &keylen, &val);
-						
-			item = (limit_hash_item_t *)val;
-
-			stream->write_function(stream, "L/%s/%d/%d/%d/%d\n", key, item->total_usage, item->rate_usage, item->interval, item->last_check);
-		}
-		switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
+		limit_store_dump(stream);
 	}
 	
+	if (mode & 4) {
+		/* Limit entries changed since <version>, or a full snapshot if that is not possible */
+		limit_store_dump_delta(stream, argc > 2 ? argv[1] : NULL, argc > 2 ? (switch_time_t) strtoll(argv[2], NULL, 10) : 0);
+	}
+
 	if (mode & 2) {
 		switch_thread_rwlock_rdlock(globals.db_hash_rwlock);
 		for (hi = switch_core_hash_first(globals.db_hash); hi; hi = switch_core_hash_next(&hi)) {
@@ -842,13 +771,25 @@ static void *SWITCH_THREAD_FUNC limit_remote_thread(switch_thread_t *thread, voi
 				memset(&remote->handle, 0, sizeof(remote->handle));
 			}
 		} else {
-			if (esl_send_recv_timed(&remote->handle, "api hash_dump limit", 5000) != ESL_SUCCESS) {
+			char cmd[128];
+
+			if (remote->legacy) {
+				switch_snprintf(cmd, sizeof(cmd), "api hash_dump limit");
+			} else {
+				switch_snprintf(cmd, sizeof(cmd), "api hash_dump delta %s %" SWITCH_TIME_T_FMT, zstr(remote->epoch) ? "0" : remote->epoch, remote->version);
+			}
+
+			if (esl_send_recv_timed(&remote->handle, cmd, 5000) != ESL_SUCCESS) {
 				esl_disconnect(&remote->handle);
 				memset(&remote->handle, 0, sizeof(remote->handle));
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Disconnected from remote FreeSWITCH (%s) at %s:%d\n",
 					remote->name, remote->host, remote->port);
 				memset(&remote->handle, 0, sizeof(remote->handle));
 				remote->state = REMOTE_DOWN;
+				/* Start over with a full snapshot once we are back */
+				*remote->epoch = '\0';
+				remote->version = 0;
+				remote->legacy = SWITCH_FALSE;
 				/* Delete all remote tracking entries */
 				switch_thread_rwlock_wrlock(remote->rwlock);
 				switch_core_hash_delete_multi(remote->index, limit_hash_remote_cleanup_callback, NULL);
@@ -858,6 +799,30 @@ static void *SWITCH_THREAD_FUNC limit_remote_thread(switch_thread_t *thread, voi
 					char *data = strdup(remote->handle.last_sr_event->body);
 					char *p = data, *p2;
 					switch_time_t now = switch_epoch_time_now(NULL);
+					switch_bool_t full = SWITCH_TRUE;
+
+					if (!remote->legacy) {
+						/* First line is V/epoch/version/full|delta, anything else means the remote can't do deltas */
+						char *argv[3];
+
+						if ((p2 = strchr(p, '\n'))) {
+							*p2++ = '\0';
+						}
+
+						if (*p != 'V' || switch_split(p+2, '/', argv) < 3) {
+							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "[%s] Remote does not support delta updates, using full dumps\n", remote->name);
+							remote->legacy = SWITCH_TRUE;
+							/* Nothing usable in this reply, ask for a full dump after the usual wait */
+							p = NULL;
+							full = SWITCH_FALSE;
+						} else {
+							switch_set_string(remote->epoch, argv[0]);
+							remote->version = (switch_time_t) strtoll(argv[1], NULL, 10);
+							full = !strcmp(argv[2], "full");
+							p = p2;
+						}
+					}
+
 					while (p && *p) {
 						/* We are getting the limit data as:
 							L/key/usage/rate/interval/last_checked 
@@ -878,15 +843,24 @@ static void *SWITCH_THREAD_FUNC limit_remote_thread(switch_thread_t *thread, voi
 							} else {
 								limit_hash_item_t *item;
 								switch_thread_rwlock_wrlock(remote->rwlock);
-								if (!(item = switch_core_hash_find(remote->index, argv[0]))) {
-									item = malloc(sizeof(*item));
-									switch_core_hash_insert(remote->index, argv[0], item);
+								item = switch_core_hash_find(remote->index, argv[0]);
+								if (!full && !atoi(argv[1]) && !atoi(argv[2])) {
+									/* Entry was freed on the remote */
+									if (item) {
+										switch_core_hash_delete(remote->index, argv[0]);
+										free(item);
+									}
+								} else {
+									if (!item) {
+										item = malloc(sizeof(*item));
+										switch_core_hash_insert(remote->index, argv[0], item);
+									}
+									item->total_usage = atoi(argv[1]);
+									item->rate_usage = atoi(argv[2]);
+									item->interval = atoi(argv[3]);
+									item->last_check = atoi(argv[4]);
+									item->last_update = now;
 								}
-								item->total_usage = atoi(argv[1]);
-								item->rate_usage = atoi(argv[2]);
-								item->interval = atoi(argv[3]);
-								item->last_check = atoi(argv[4]);
-								item->last_update = now;
 								switch_thread_rwlock_unlock(remote->rwlock);
 							}
 						}
@@ -895,10 +869,12 @@ static void *SWITCH_THREAD_FUNC limit_remote_thread(switch_thread_t *thread, voi
 					}
 					free(data);
 					
-					/* Now free up anything that wasn't in this update since it means their usage is 0 */
-					switch_thread_rwlock_wrlock(remote->rwlock);
-					switch_core_hash_delete_multi(remote->index, limit_hash_remote_cleanup_callback, (void*)(intptr_t)now);
-					switch_thread_rwlock_unlock(remote->rwlock);
+					if (full) {
+						/* Now free up anything that wasn't in this update since it means their usage is 0 */
+						switch_thread_rwlock_wrlock(remote->rwlock);
+						switch_core_hash_delete_multi(remote->index, limit_hash_remote_cleanup_callback, (void*)(intptr_t)now);
+						switch_thread_rwlock_unlock(remote->rwlock);
+					}
 				}
 			}
 		}
@@ -975,10 +951,10 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_hash_load)
 		return SWITCH_STATUS_FALSE;
 	}
 
-	switch_thread_rwlock_create(&globals.limit_hash_rwlock, globals.pool);
+	limit_store_init(globals.pool);
+	globals.running = SWITCH_TRUE;
 	switch_thread_rwlock_create(&globals.db_hash_rwlock, globals.pool);
 	switch_thread_rwlock_create(&globals.remote_hash_rwlock, globals.pool);
-	switch_core_hash_init(&globals.limit_hash);
 	switch_core_hash_init(&globals.db_hash);
 	switch_core_hash_init(&globals.remote_hash);
 
@@ -1016,6 +992,7 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_hash_shutdown)
 	switch_hash_index_t *hi = NULL;
 	switch_bool_t remote_clean = SWITCH_TRUE;
 	
+	globals.running = SWITCH_FALSE;
 	switch_scheduler_del_task_group("mod_hash");
 
 	/* Kill remote connections, destroy needs a wrlock so we unlock after finding a pointer */
@@ -1042,18 +1019,10 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_hash_shutdown)
 		}
 	}
 
-	switch_thread_rwlock_wrlock(globals.limit_hash_rwlock);
+	limit_store_destroy();
+
 	switch_thread_rwlock_wrlock(globals.db_hash_rwlock);
 	
-	while ((hi = switch_core_hash_first_iter( globals.limit_hash, hi))) {
-		void *val = NULL;
-		const void *key;
-		switch_ssize_t keylen;
-		switch_core_hash_this(hi, &key, &keylen, &val);
-		free(val);
-		switch_core_hash_delete(globals.limit_hash, key);
-	}
-	
 	while ((hi = switch_core_hash_first_iter( globals.db_hash, hi))) {
 		void *val = NULL;
 		const void *key;
@@ -1063,15 +1032,12 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_hash_shutdown)
 		switch_core_hash_delete(globals.db_hash, key);
 	}
 
-	switch_core_hash_destroy(&globals.limit_hash);
 	switch_core_hash_destroy(&globals.db_hash);	
 	switch_core_hash_destroy(&globals.remote_hash);
 
-	switch_thread_rwlock_unlock(globals.limit_hash_rwlock);
 	switch_thread_rwlock_unlock(globals.db_hash_rwlock);
 
 	switch_thread_rwlock_destroy(globals.db_hash_rwlock);
-	switch_thread_rwlock_destroy(globals.limit_hash_rwlock);
 	switch_thread_rwlock_destroy(globals.remote_hash_rwlock);
 
 
@@ -157,6 +157,8 @@ struct http_get_data {
 	int fd;
 	/** The cached URL data */
 	cached_url_t *url;
+	/** The transfer, to check its status */
+	switch_CURL *curl;
 };
 typedef struct http_get_data http_get_data_t;
 
@@ -239,10 +241,13 @@ struct url_cache {
 	long connect_timeout;
 	/** How long to wait, in seconds, for download of file.  If 0, use default value of 300 seconds */
 	long download_timeout;
+	/** Bytes that must be on disk before playback of a download starts.  If 0, wait for the whole file */
+	size_t progressive_min_bytes;
 };
 static url_cache_t gcache;
 
-static char *url_cache_get(url_cache_t *cache, http_profile_t *profile, switch_core_session_t *session, const char *url, int download, int refresh, switch_memory_pool_t *pool);
+static char *url_cache_get(url_cache_t *cache, http_profile_t *profile, switch_core_session_t *session, const char *url, int download, int refresh, cached_url_t **rx_url, switch_memory_pool_t *pool);
+static void url_cache_release(url_cache_t *cache, switch_core_session_t *session, cached_url_t *url);
 static switch_status_t url_cache_add(url_cache_t *cache, switch_core_session_t *session, cached_url_t *url);
 static void url_cache_remove(url_cache_t *cache, switch_core_session_t *session, cached_url_t *url);
 static void url_cache_remove_soft(url_cache_t *cache, switch_core_session_t *session, cached_url_t *url);
@@ -488,8 +493,17 @@ static size_t get_file_callback(void *ptr, size_t size, size_t nmemb, void *get)
 {
 	size_t realsize = (size * nmemb);
 	http_get_data_t *get_data = get;
-	ssize_t bytes_written = write(get_data->fd, ptr, realsize);
+	ssize_t bytes_written;
 	size_t result = 0;
+	long httpRes = 0;
+
+	/* only count the body of a 200, progressive readers start playing as soon as there is enough of it */
+	switch_curl_easy_getinfo(get_data->curl, CURLINFO_RESPONSE_CODE, &httpRes);
+	if (httpRes != 200) {
+		return realsize;
+	}
+
+	bytes_written = write(get_data->fd, ptr, realsize);
 	if (bytes_written == -1) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "write(): %s\n", strerror(errno));
 	} else {
@@ -702,6 +716,92 @@ static void url_cache_clear(url_cache_t *cache, switch_core_session_t *session)
 	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Emptied cache\n");
 }
 
+/**
+ * Finish a download.  The caller must lock the cache.
+ * @param cache The cache
+ * @param session the (optional) session
+ * @param u the downloaded URL
+ * @param status result of http_get()
+ */
+static void url_cache_download_done(url_cache_t *cache, switch_core_session_t *session, cached_url_t *u, switch_status_t status)
+{
+	if (status == SWITCH_STATUS_SUCCESS) {
+		/* Got the file, let the waiters know it is available */
+		u->status = CACHED_URL_AVAILABLE;
+		cache->size += u->size;
+	} else {
+		/* Did not get the file, flag for replacement */
+		url_cache_remove_soft(cache, session, u);
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Failed to download URL %s\n", u->url);
+		cache->errors++;
+	}
+}
+
+/**
+ * A download running in the background
+ */
+struct http_get_job {
+	url_cache_t *cache;
+	http_profile_t *profile;
+	cached_url_t *url;
+};
+
+/**
+ * Thread to download a URL while it is being played
+ * @param thread the thread
+ * @param obj the job
+ * @return NULL
+ */
+static void *SWITCH_THREAD_FUNC http_get_thread(switch_thread_t *thread, void *obj)
+{
+	struct http_get_job *job = obj;
+	switch_status_t status = http_get(job->cache, job->profile, job->url, NULL);
+
+	url_cache_lock(job->cache, NULL);
+	url_cache_download_done(job->cache, NULL, job->url, status);
+	url_cache_unlock(job->cache, NULL);
+
+	switch_thread_rwlock_unlock(job->cache->shutdown_lock);
+	free(job);
+
+	return NULL;
+}
+
+/**
+ * Start downloading a URL in the background
+ * @param cache The cache
+ * @param profile optional profile
+ * @param u the URL to download
+ * @return SWITCH_STATUS_SUCCESS if the download was started
+ */
+static switch_status_t url_cache_download_start(url_cache_t *cache, http_profile_t *profile, cached_url_t *u)
+{
+	switch_thread_data_t *td;
+	struct http_get_job *job;
+
+	if (switch_thread_rwlock_tryrdlock(cache->shutdown_lock) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_zmalloc(job, sizeof(*job));
+	job->cache = cache;
+	job->profile = profile;
+	job->url = u;
+
+	switch_zmalloc(td, sizeof(*td));
+	td->func = http_get_thread;
+	td->obj = job;
+	td->alloc = 1;
+
+	if (switch_thread_pool_launch_thread(&td) != SWITCH_STATUS_SUCCESS) {
+		switch_thread_rwlock_unlock(cache->shutdown_lock);
+		free(job);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 /**
  * Get a URL from the cache, add it if it does not exist
  * @param cache The cache
@@ -710,14 +810,24 @@ static void url_cache_clear(url_cache_t *cache, switch_core_session_t *session)
  * @param url The URL
  * @param download If DOWNLOAD, the file will be downloaded if it does not exist in the cache.  If PREFETCH, the file will be downloaded if not in cache and not being downloaded by another thread.
  * @param refresh If true, existing cache entry is invalidated
+ * @param rx_url If set and progressive-min-bytes is configured, the filename may be returned while the download is still running.
+ *               The entry is then stored here and must be passed to url_cache_release() when done with the file.
  * @param pool The pool to use for allocating the filename
  * @return The filename or NULL if there is an error
  */
-static char *url_cache_get(url_cache_t *cache, http_profile_t *profile, switch_core_session_t *session, const char *url, int download, int refresh, switch_memory_pool_t *pool)
+static char *url_cache_get(url_cache_t *cache, http_profile_t *profile, switch_core_session_t *session, const char *url, int download, int refresh, cached_url_t **rx_url, switch_memory_pool_t *pool)
 {
 	switch_time_t download_timeout_ns = cache->download_timeout * 1000 * 1000;
 	char *filename = NULL;
 	cached_url_t *u = NULL;
+	int progressive = rx_url && download == DOWNLOAD && cache->progressive_min_bytes > 0;
+	/* 1 if this call started a background download, -1 if the URL was already known */
+	int started = 0;
+
+	if (rx_url) {
+		*rx_url = NULL;
+	}
+
 	if (zstr(url)) {
 		return NULL;
 	}
@@ -758,48 +868,86 @@ static char *url_cache_get(url_cache_t *cache, http_profile_t *profile, switch_c
 			return NULL;
 		}
 
-		/* download the file */
-		url_cache_unlock(cache, session);
-		if (http_get(cache, profile, u, session) == SWITCH_STATUS_SUCCESS) {
-			/* Got the file, let the waiters know it is available */
-			url_cache_lock(cache, session);
-			u->status = CACHED_URL_AVAILABLE;
-			filename = switch_core_strdup(pool, u->filename);
-			cache->size += u->size;
+		/* the file can't be renamed once it is being played, so the extension must be known up front */
+		if (progressive && u->extension && url_cache_download_start(cache, profile, u) == SWITCH_STATUS_SUCCESS) {
+			started = 1;
 		} else {
-			/* Did not get the file, flag for replacement */
+			switch_status_t status;
+
+			/* download the file */
+			url_cache_unlock(cache, session);
+			status = http_get(cache, profile, u, session);
 			url_cache_lock(cache, session);
-			url_cache_remove_soft(cache, session, u);
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Failed to download URL %s\n", url);
-			cache->errors++;
+			url_cache_download_done(cache, session, u, status);
+
+			if (u->status == CACHED_URL_AVAILABLE) {
+				filename = switch_core_strdup(pool, u->filename);
+			}
 		}
 	} else if (!u || (u->status == CACHED_URL_RX_IN_PROGRESS && download != DOWNLOAD)) {
 		filename = DOWNLOAD_NEEDED;
 	} else {
-		/* Wait until file is downloaded */
+		started = -1;
+	}
+
+	if (started) {
+		int partial = progressive && u->extension;
+
+		/* Wait until file is downloaded, or until enough of it is to start playing */
 		if (u->status == CACHED_URL_RX_IN_PROGRESS) {
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Waiting for URL %s to be available\n", url);
 			u->waiters++;
 			url_cache_unlock(cache, session);
-			while(u->status == CACHED_URL_RX_IN_PROGRESS && switch_time_now() < (u->download_time + download_timeout_ns)) {
+			while(u->status == CACHED_URL_RX_IN_PROGRESS && switch_time_now() < (u->download_time + download_timeout_ns) &&
+				  !(partial && u->size >= cache->progressive_min_bytes)) {
 				switch_sleep(10 * 1000); /* 10 ms */
 			}
 			url_cache_lock(cache, session);
+
+			if (partial && u->status == CACHED_URL_RX_IN_PROGRESS && u->size >= cache->progressive_min_bytes) {
+				/* the caller keeps the entry from being replaced until it is released */
+				filename = switch_core_strdup(pool, u->filename);
+				if (started < 0) {
+					cache->hits++;
+				}
+				u->used = 1;
+				*rx_url = u;
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Playing URL %s while downloading, %zu bytes so far\n", url, u->size);
+				goto end;
+			}
+
 			u->waiters--;
 		}
 
 		/* grab filename if everything is OK */
 		if (u->status == CACHED_URL_AVAILABLE) {
 			filename = switch_core_strdup(pool, u->filename);
-			cache->hits++;
+			if (started < 0) {
+				cache->hits++;
+			}
 			u->used = 1;
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Cache HIT: size = %zu (%zu MB), hit ratio = %d/%d\n", cache->queue.size, cache->size / 1000000, cache->hits, cache->hits + cache->misses);
 		}
 	}
+
+  end:
 	url_cache_unlock(cache, session);
 	return filename;
 }
 
+/**
+ * Done with a URL that was returned while still downloading
+ * @param cache The cache
+ * @param session the (optional) session
+ * @param url the entry returned by url_cache_get()
+ */
+static void url_cache_release(url_cache_t *cache, switch_core_session_t *session, cached_url_t *url)
+{
+	url_cache_lock(cache, session);
+	url->waiters--;
+	url_cache_unlock(cache, session);
+}
+
 /**
  * Add a URL to the cache.  The caller must lock the cache.
  * @param cache the cache
@@ -1113,6 +1261,7 @@ static switch_status_t http_get(url_cache_t *cache, http_profile_t *profile, cac
 	}
 
 	curl_handle = switch_curl_easy_init();
+	get_data.curl = curl_handle;
 	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "opening %s for URL cache\n", get_data.url->filename);
 	if ((get_data.fd = open(get_data.url->filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
 		switch_curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1);
@@ -1277,7 +1426,7 @@ SWITCH_STANDARD_API(http_cache_get)
 		refresh = switch_true(switch_event_get_header(params, "refresh"));
 	}
 
-	filename = url_cache_get(&gcache, profile, session, url, download, refresh, pool);
+	filename = url_cache_get(&gcache, profile, session, url, download, refresh, NULL, pool);
 	if (filename) {
 		stream->write_function(stream, "%s", filename);
 
@@ -1328,7 +1477,7 @@ SWITCH_STANDARD_API(http_cache_tryget)
 		switch_event_create_brackets(url, '{', '}', ',', &params, &url, SWITCH_FALSE);
 	}
 
-	filename = url_cache_get(&gcache, NULL, session, url, 0, params ? switch_true(switch_event_get_header(params, "refresh")) : SWITCH_FALSE, pool);
+	filename = url_cache_get(&gcache, NULL, session, url, 0, params ? switch_true(switch_event_get_header(params, "refresh")) : SWITCH_FALSE, NULL, pool);
 	if (filename) {
 		if (!strcmp(DOWNLOAD_NEEDED, filename)) {
 			stream->write_function(stream, "-ERR %s\n", DOWNLOAD_NEEDED);
@@ -1463,7 +1612,7 @@ SWITCH_STANDARD_API(http_cache_remove)
 		switch_event_create_brackets(url, '{', '}', ',', &params, &url, SWITCH_FALSE);
 	}
 
-	url_cache_get(&gcache, NULL, session, url, 0, 1, pool);
+	url_cache_get(&gcache, NULL, session, url, 0, 1, NULL, pool);
 	stream->write_function(stream, "+OK\n");
 
 	if (lpool) {
@@ -1592,6 +1741,12 @@ static switch_status_t do_config(url_cache_t *cache)
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Setting download-timeout to %s\n", val);
 					cache->download_timeout = int_val;
 				}
+			} else if (!strcasecmp(var, "progressive-min-bytes")) {
+				int int_val = atoi(val);
+				if (int_val >= 0) {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Setting progressive-min-bytes to %s\n", val);
+					cache->progressive_min_bytes = int_val;
+				}
 			} else {
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unsupported param: %s\n", var);
 			}
@@ -1696,8 +1851,85 @@ struct http_context {
 	http_profile_t *profile;
 	char *local_path;
 	const char *write_url;
+	/** set while the file is still being downloaded */
+	cached_url_t *rx_url;
+	/** bytes that were on disk when the file was last opened */
+	size_t rx_size;
+	/** samples played so far, to continue from after reopening */
+	int64_t rx_samples;
+	int rx_flags;
 };
 
+/**
+ * Wait for the rest of a download and give up the entry
+ * @param context the playback state
+ */
+static void http_file_wait(struct http_context *context)
+{
+	switch_time_t timeout = context->rx_url->download_time + gcache.download_timeout * 1000 * 1000;
+
+	while (context->rx_url->status == CACHED_URL_RX_IN_PROGRESS && switch_time_now() < timeout) {
+		switch_sleep(10 * 1000); /* 10 ms */
+	}
+
+	url_cache_release(&gcache, NULL, context->rx_url);
+	context->rx_url = NULL;
+}
+
+/**
+ * Continue a file that ran out of data while it is still being downloaded
+ * @param handle
+ * @param data
+ * @param len in samples, the number wanted on entry
+ * @return SWITCH_STATUS_SUCCESS if there is audio or silence to play
+ */
+static switch_status_t http_file_follow(switch_file_handle_t *handle, void *data, size_t *len)
+{
+	struct http_context *context = (struct http_context *)handle->private_info;
+	cached_url_t *u = context->rx_url;
+	size_t want = *len;
+	unsigned int pos = 0;
+	switch_status_t status;
+
+	if (u->status == CACHED_URL_RX_IN_PROGRESS && u->size < context->rx_size + gcache.progressive_min_bytes) {
+		/* caught up with the download, play silence until there is more */
+		memset(data, 0, want * 2 * context->fh.channels);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (u->status != CACHED_URL_RX_IN_PROGRESS) {
+		url_cache_release(&gcache, NULL, u);
+		context->rx_url = NULL;
+
+		if (u->status != CACHED_URL_AVAILABLE) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Download of %s failed while playing\n", context->local_path);
+			return SWITCH_STATUS_FALSE;
+		}
+	} else {
+		context->rx_size = u->size;
+	}
+
+	/* reopen to pick up what was written since and carry on from the same sample */
+	switch_core_file_close(&context->fh);
+
+	if (switch_core_file_open(&context->fh, context->local_path, handle->channels, handle->samplerate, context->rx_flags, NULL) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Failed to reopen HTTP cache file: %s\n", context->local_path);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* seek positions are in the rate of the file */
+	if (context->rx_samples && context->fh.samplerate) {
+		switch_core_file_seek(&context->fh, &pos, context->rx_samples * context->fh.native_rate / context->fh.samplerate, SEEK_SET);
+	}
+
+	*len = want;
+	if ((status = switch_core_file_read(&context->fh, data, len)) == SWITCH_STATUS_SUCCESS && context->rx_url) {
+		context->rx_samples += *len;
+	}
+
+	return status;
+}
+
 /**
  * Open URL
  * @param handle
@@ -1722,11 +1954,21 @@ static switch_status_t http_cache_file_open(switch_file_handle_t *handle, const
 		context->local_path = cached_url_filename_create(&gcache, context->write_url, NULL);
 	} else {
 		/* READ = HTTP GET */
+		int progressive = handle->params ? !switch_false(switch_event_get_header(handle->params, "progressive")) : 1;
+
 		file_flags |= SWITCH_FILE_FLAG_READ;
-		context->local_path = url_cache_get(&gcache, context->profile, NULL, path, 1, handle->params ? switch_true(switch_event_get_header(handle->params, "refresh")) : 0, handle->memory_pool);
+		context->local_path = url_cache_get(&gcache, context->profile, NULL, path, 1, handle->params ? switch_true(switch_event_get_header(handle->params, "refresh")) : 0,
+											progressive ? &context->rx_url : NULL, handle->memory_pool);
 		if (!context->local_path) {
 			return SWITCH_STATUS_FALSE;
 		}
+
+		if (context->rx_url) {
+			/* the file will be reopened as it grows, keep the partial file out of the prompt cache */
+			file_flags |= SWITCH_FILE_NOCACHE;
+			context->rx_size = context->rx_url->size;
+			context->rx_flags = file_flags;
+		}
 	}
 
 	if ((status = switch_core_file_open(&context->fh,
@@ -1738,7 +1980,21 @@ static switch_status_t http_cache_file_open(switch_file_handle_t *handle, const
 			if (switch_test_flag(handle, SWITCH_FILE_FLAG_WRITE)) {
 				switch_safe_free(context->local_path);
 			}
+			if (context->rx_url) {
+				url_cache_release(&gcache, NULL, context->rx_url);
+			}
+			return status;
+	}
+
+	if (context->rx_url && (switch_test_flag(&context->fh, SWITCH_FILE_NATIVE) || !context->fh.seekable)) {
+		/* playing on while downloading needs to seek back to where it was, wait for the rest instead */
+		switch_core_file_close(&context->fh);
+		http_file_wait(context);
+
+		if ((status = switch_core_file_open(&context->fh, context->local_path, handle->channels, handle->samplerate, file_flags, NULL)) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Failed to open HTTP cache file: %s, %s\n", context->local_path, path);
 			return status;
+		}
 	}
 
 	handle->private_info = context;
@@ -1798,7 +2054,19 @@ static switch_status_t https_file_open(switch_file_handle_t *handle, const char
 static switch_status_t http_file_read(switch_file_handle_t *handle, void *data, size_t *len)
 {
 	struct http_context *context = (struct http_context *)handle->private_info;
-	return switch_core_file_read(&context->fh, data, len);
+	size_t want = *len;
+	switch_status_t status = switch_core_file_read(&context->fh, data, len);
+
+	if (context->rx_url) {
+		if (status == SWITCH_STATUS_SUCCESS && *len) {
+			context->rx_samples += *len;
+		} else {
+			*len = want;
+			status = http_file_follow(handle, data, len);
+		}
+	}
+
+	return status;
 }
 
 /**
@@ -1849,6 +2117,11 @@ static switch_status_t http_file_close(switch_file_handle_t *handle)
 	switch_status_t status = switch_core_file_close(&context->fh);
 	long httpRes = 0;
 
+	if (context->rx_url) {
+		url_cache_release(&gcache, NULL, context->rx_url);
+		context->rx_url = NULL;
+	}
+
 	if (status == SWITCH_STATUS_SUCCESS && !zstr(context->write_url)) {
 		status = http_put(&gcache, context->profile, NULL, context->write_url, context->local_path, 1, &httpRes);
 	}
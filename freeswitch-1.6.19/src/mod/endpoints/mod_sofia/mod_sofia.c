@@ -2815,6 +2815,10 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 					stream->write_function(stream, "FAILED-CALLS-IN  \t%u\n", profile->ib_failed_calls);
 					stream->write_function(stream, "CALLS-OUT        \t%u\n", profile->ob_calls);
 					stream->write_function(stream, "FAILED-CALLS-OUT \t%u\n", profile->ob_failed_calls);
+					if (profile->flood_ip_max || profile->flood_user_max || profile->flood_acl) {
+						stream->write_function(stream, "FLOOD-ACCEPTED   \t%u\n", switch_atomic_read(&profile->flood_accepted));
+						stream->write_function(stream, "FLOOD-SHED       \t%u\n", switch_atomic_read(&profile->flood_shed));
+					}
 					stream->write_function(stream, "REGISTRATIONS    \t%lu\n", sofia_profile_reg_count(profile));
 				}
 
@@ -3120,6 +3124,10 @@ static switch_status_t cmd_xml_status(char **argv, int argc, switch_stream_handl
 					stream->write_function(stream, "    <calls-out>%u</calls-out>\n", profile->ob_calls);
 					stream->write_function(stream, "    <failed-calls-in>%u</failed-calls-in>\n", profile->ib_failed_calls);
 					stream->write_function(stream, "    <failed-calls-out>%u</failed-calls-out>\n", profile->ob_failed_calls);
+					if (profile->flood_ip_max || profile->flood_user_max || profile->flood_acl) {
+						stream->write_function(stream, "    <flood-accepted>%u</flood-accepted>\n", switch_atomic_read(&profile->flood_accepted));
+						stream->write_function(stream, "    <flood-shed>%u</flood-shed>\n", switch_atomic_read(&profile->flood_shed));
+					}
 					stream->write_function(stream, "    <registrations>%lu</registrations>\n", sofia_profile_reg_count(profile));
 					stream->write_function(stream, "  </profile-info>\n");
 				}
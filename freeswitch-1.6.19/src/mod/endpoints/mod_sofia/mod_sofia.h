@@ -51,6 +51,8 @@
 #include <switch.h>
 #define SOFIA_NAT_SESSION_TIMEOUT 90
 #define SOFIA_MAX_ACL 100
+/* Sources and users tracked at once by the flood limiters */
+#define SOFIA_FLOOD_SLOTS 8192
 #ifdef _MSC_VER
 #define HAVE_FUNCTION 1
 #else
@@ -720,6 +722,16 @@ struct sofia_profile {
 	uint32_t ob_calls;
 	uint32_t ib_failed_calls;
 	uint32_t ob_failed_calls;
+	uint32_t flood_ip_max;
+	uint32_t flood_ip_interval;
+	uint32_t flood_user_max;
+	uint32_t flood_user_interval;
+	char *flood_acl;
+	char *flood_exempt_acl;
+	switch_rate_limiter_t *flood_ip_limiter;
+	switch_rate_limiter_t *flood_user_limiter;
+	volatile switch_atomic_t flood_accepted;
+	volatile switch_atomic_t flood_shed;
 	uint32_t timer_t1;
 	uint32_t timer_t1x64;
 	uint32_t timer_t2;
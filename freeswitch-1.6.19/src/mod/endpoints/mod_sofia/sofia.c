@@ -2303,6 +2303,85 @@ static void set_call_id(private_object_t *tech_pvt, sip_t const *sip)
 	}
 }
 
+/* Cheap admission stage for new requests, runs before anything is queued or a session exists */
+static switch_bool_t sofia_flood_shed(nua_event_t event, nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip)
+{
+	char network_ip[80] = "";
+	msg_t *msg;
+
+	switch (event) {
+	case nua_i_invite:
+	case nua_i_register:
+	case nua_i_options:
+	case nua_i_notify:
+	case nua_i_info:
+	case nua_i_subscribe:
+	case nua_i_message:
+	case nua_i_publish:
+	case nua_i_refer:
+		break;
+	default:
+		return SWITCH_FALSE;
+	}
+
+	if (!profile->flood_ip_max && !profile->flood_user_max && !profile->flood_acl) {
+		return SWITCH_FALSE;
+	}
+
+	if (!(msg = nua_current_request(nua))) {
+		return SWITCH_FALSE;
+	}
+
+	sofia_glue_get_addr(msg, network_ip, sizeof(network_ip), NULL);
+
+	if (profile->flood_exempt_acl && switch_check_network_list_ip(network_ip, profile->flood_exempt_acl)) {
+		switch_atomic_inc(&profile->flood_accepted);
+		return SWITCH_FALSE;
+	}
+
+	if (profile->flood_acl && !switch_check_network_list_ip(network_ip, profile->flood_acl)) {
+		switch_atomic_inc(&profile->flood_shed);
+		nua_respond(nh, SIP_403_FORBIDDEN, NUTAG_WITH_THIS(nua), TAG_END());
+		/* never queued and never bound, so nothing else will free it */
+		nua_handle_destroy(nh);
+		return SWITCH_TRUE;
+	}
+
+	if (profile->flood_ip_max &&
+		switch_rate_limiter_check(profile->flood_ip_limiter, network_ip, profile->flood_ip_max, profile->flood_ip_interval, 0) != SWITCH_STATUS_SUCCESS) {
+		goto shed;
+	}
+
+	if (profile->flood_user_max && sip) {
+		const url_t *url = NULL;
+
+		/* the AOR being registered, otherwise who it claims to be from */
+		if (event == nua_i_register && sip->sip_to) {
+			url = sip->sip_to->a_url;
+		} else if (sip->sip_from) {
+			url = sip->sip_from->a_url;
+		}
+
+		if (url && !zstr(url->url_user)) {
+			char key[256];
+
+			switch_snprintf(key, sizeof(key), "%s@%s", url->url_user, switch_str_nil(url->url_host));
+
+			if (switch_rate_limiter_check(profile->flood_user_limiter, key, profile->flood_user_max, profile->flood_user_interval, 0) != SWITCH_STATUS_SUCCESS) {
+				goto shed;
+			}
+		}
+	}
+
+	switch_atomic_inc(&profile->flood_accepted);
+	return SWITCH_FALSE;
+
+ shed:
+	switch_atomic_inc(&profile->flood_shed);
+	nua_respond(nh, 503, "Rate Limited", SIPTAG_RETRY_AFTER_STR("30"), NUTAG_WITH_THIS(nua), TAG_END());
+	nua_handle_destroy(nh);
+	return SWITCH_TRUE;
+}
 
 void sofia_event_callback(nua_event_t event,
 						  int status,
@@ -2315,6 +2394,10 @@ void sofia_event_callback(nua_event_t event,
 	uint32_t sess_count = switch_core_session_count();
 	uint32_t sess_max = switch_core_session_limit(0);
 
+	if (!sofia_private && sofia_flood_shed(event, nua, profile, nh, sip)) {
+		goto end;
+	}
+
 	switch(event) {
 	case nua_i_terminated:
 		if ((status == 401 || status == 407 || status == 403) && sofia_private) {
@@ -4433,6 +4516,10 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 					profile->ob_calls = 0;
 					profile->ib_failed_calls = 0;
 					profile->ob_failed_calls = 0;
+					profile->flood_ip_max = 0;
+					profile->flood_user_max = 0;
+					profile->flood_acl = NULL;
+					profile->flood_exempt_acl = NULL;
 					profile->shutdown_type = "false";
 					profile->rtpip_index = 0;
 					profile->rtpip_index6 = 0;
@@ -4850,6 +4937,33 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 						profile->user_agent_filter = switch_core_strdup(profile->pool, val);
 					} else if (!strcasecmp(var, "max-registrations-per-extension") && !zstr(val)) {
 						profile->max_registrations_perext = atoi(val);
+					} else if ((!strcasecmp(var, "flood-limit-ip") || !strcasecmp(var, "flood-limit-user")) && !zstr(val)) {
+						/* <max>[/<seconds>] new requests, extra requests are refused before they are queued */
+						switch_bool_t ip = !strcasecmp(var, "flood-limit-ip");
+						uint32_t max = (uint32_t) atoi(val), interval = 1000;
+						const char *p;
+
+						if ((p = strchr(val, '/')) && atoi(p + 1) > 0) {
+							interval = atoi(p + 1) * 1000;
+						}
+
+						if (ip) {
+							profile->flood_ip_max = max;
+							profile->flood_ip_interval = interval;
+							if (max && !profile->flood_ip_limiter) {
+								switch_rate_limiter_create(&profile->flood_ip_limiter, SWITCH_RATE_TOKEN_BUCKET, SOFIA_FLOOD_SLOTS, 0, profile->pool);
+							}
+						} else {
+							profile->flood_user_max = max;
+							profile->flood_user_interval = interval;
+							if (max && !profile->flood_user_limiter) {
+								switch_rate_limiter_create(&profile->flood_user_limiter, SWITCH_RATE_TOKEN_BUCKET, SOFIA_FLOOD_SLOTS, 0, profile->pool);
+							}
+						}
+					} else if (!strcasecmp(var, "flood-acl") && !zstr(val)) {
+						profile->flood_acl = switch_core_strdup(profile->pool, val);
+					} else if (!strcasecmp(var, "flood-exempt-acl") && !zstr(val)) {
+						profile->flood_exempt_acl = switch_core_strdup(profile->pool, val);
 					} else if (!strcasecmp(var, "rfc2833-pt") && !zstr(val)) {
 						profile->te = (switch_payload_t) atoi(val);
 					} else if (!strcasecmp(var, "cng-pt") && !sofia_test_media_flag(profile, SCMF_SUPPRESS_CNG) && !zstr(val)) {
@@ -624,44 +624,175 @@ static switch_ssize_t ws_write_json(jsock_t *jsock, cJSON **json, switch_bool_t
 	return r;
 }
 
-static switch_status_t jsock_queue_event(jsock_t *jsock, cJSON **json, switch_bool_t destroy)
+/* an event serialized once and shared by every socket it is delivered to */
+typedef struct verto_event_text_s {
+	char *text;
+	switch_size_t len;
+	switch_atomic_t refs;
+} verto_event_text_t;
+
+typedef struct jsock_event_s {
+	cJSON *json;
+	verto_event_text_t *etext;
+	uint32_t serno;
+} jsock_event_t;
+
+static verto_event_text_t *verto_event_text_create(cJSON *event)
 {
-	switch_status_t status = SWITCH_STATUS_FALSE;
-	cJSON *jp;
+	verto_event_text_t *etext;
+	char *text;
 
-	if (destroy) {
-		jp = *json;
-	} else {
-		jp = cJSON_Duplicate(*json, 1);
+	if (!(text = cJSON_PrintUnformatted(event))) {
+		return NULL;
 	}
 
-	if (switch_queue_trypush(jsock->event_queue, jp) == SWITCH_STATUS_SUCCESS) {
-		status = SWITCH_STATUS_SUCCESS;
-		
+	switch_zmalloc(etext, sizeof(*etext));
+	etext->text = text;
+	etext->len = strlen(text);
+	switch_atomic_set(&etext->refs, 1);
+
+	return etext;
+}
+
+static void verto_event_text_release(verto_event_text_t **etextP)
+{
+	verto_event_text_t *etext = *etextP;
+
+	*etextP = NULL;
+
+	if (etext && !switch_atomic_dec(&etext->refs)) {
+		free(etext->text);
+		free(etext);
+	}
+}
+
+static void jsock_event_destroy(jsock_event_t **evP)
+{
+	jsock_event_t *ev = *evP;
+
+	*evP = NULL;
+
+	if (!ev) {
+		return;
+	}
+
+	if (ev->json) {
+		cJSON_Delete(ev->json);
+	}
+
+	verto_event_text_release(&ev->etext);
+	free(ev);
+}
+
+/* 
+ * Wrap the shared event text in this socket's jsonrpc envelope, splicing the per subscriber
+ * eventSerno in before the closing brace, and frame it straight into a reusable buffer.
+ */
+static switch_ssize_t ws_write_event_text(jsock_t *jsock, verto_event_text_t *etext, uint32_t serno)
+{
+	char head[128], tail[64];
+	switch_size_t hlen, blen, tlen, plen, flen, need;
+	uint8_t *bp;
+	switch_ssize_t r;
+
+	switch_snprintf(head, sizeof(head), "{\"jsonrpc\":\"2.0\",\"id\":%u,\"method\":\"verto.event\",\"params\":", next_id());
+	hlen = strlen(head);
+
+	blen = etext->len - 1;
+	switch_snprintf(tail, sizeof(tail), "%s\"eventSerno\":%u}}", blen > 1 ? "," : "", serno);
+	tlen = strlen(tail);
+
+	plen = hlen + blen + tlen;
+	need = WS_MAX_HEADER_LEN + plen;
+
+	if (jsock->event_frame_len < need) {
+		void *tmp;
+
+		if (!(tmp = realloc(jsock->event_frame, need))) {
+			return -1;
+		}
+
+		jsock->event_frame = tmp;
+		jsock->event_frame_len = need;
+	}
+
+	bp = jsock->event_frame;
+	flen = ws_build_frame_header(bp, WSOC_TEXT, plen);
+	memcpy(bp + flen, head, hlen);
+	memcpy(bp + flen + hlen, etext->text, blen);
+	memcpy(bp + flen + hlen + blen, tail, tlen);
+	flen += plen;
+
+	if (jsock->profile->debug || verto_globals.debug) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ALERT, "WRITE %s [%.*s]\n", jsock->name, (int) plen, (char *) bp + (flen - plen));
+	}
+
+	switch_mutex_lock(jsock->write_mutex);
+	r = ws_write_prepared_frame(&jsock->ws, bp, flen);
+	switch_mutex_unlock(jsock->write_mutex);
+
+	if (r <= 0) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ALERT, "WRITE RETURNED ERROR %" SWITCH_SIZE_T_FMT " \n", r);
+		jsock->drop = 1;
+		jsock->ready = 0;
+	}
+
+	return r;
+}
+
+static switch_status_t jsock_push_event(jsock_t *jsock, jsock_event_t **evP)
+{
+	if (switch_queue_trypush(jsock->event_queue, *evP) == SWITCH_STATUS_SUCCESS) {
+		*evP = NULL;
+
 		if (jsock->lost_events) {
 			int le = jsock->lost_events;
 			jsock->lost_events = 0;
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Lost %d json events!\n", le);
 		}
-	} else {
-		if (++jsock->lost_events > MAX_MISSED) {
-			jsock->drop++;
-		}
 
-		if (!destroy) {
-			cJSON_Delete(jp);
-			jp = NULL;
-		}
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (++jsock->lost_events > MAX_MISSED) {
+		jsock->drop++;
 	}
 
+	jsock_event_destroy(evP);
+
+	return SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t jsock_queue_event(jsock_t *jsock, cJSON **json, switch_bool_t destroy)
+{
+	jsock_event_t *ev;
+
+	switch_zmalloc(ev, sizeof(*ev));
+
 	if (destroy) {
+		ev->json = *json;
 		*json = NULL;
+	} else {
+		ev->json = cJSON_Duplicate(*json, 1);
 	}
 
-	return status;
+	return jsock_push_event(jsock, &ev);
+}
+
+static switch_status_t jsock_queue_event_text(jsock_t *jsock, verto_event_text_t *etext, uint32_t serno)
+{
+	jsock_event_t *ev;
+
+	switch_zmalloc(ev, sizeof(*ev));
+
+	switch_atomic_inc(&etext->refs);
+	ev->etext = etext;
+	ev->serno = serno;
+
+	return jsock_push_event(jsock, &ev);
 }
 
-static void write_event(const char *event_channel, jsock_t *use_jsock, cJSON *event)
+static void write_event(const char *event_channel, jsock_t *use_jsock, cJSON *event, verto_event_text_t **etextP)
 {
 	jsock_sub_node_head_t *head;
 
@@ -669,13 +800,13 @@ static void write_event(const char *event_channel, jsock_t *use_jsock, cJSON *ev
 		jsock_sub_node_t *np;
 		
 		for(np = head->node; np; np = np->next) {
-			cJSON *msg = NULL, *params;
-			
 			if (!use_jsock || use_jsock == np->jsock) {
-				params = cJSON_Duplicate(event, 1);
-				cJSON_AddItemToObject(params, "eventSerno", cJSON_CreateNumber(np->serno++));
-				msg = jrpc_new_req("verto.event", NULL, &params);
-				jsock_queue_event(np->jsock, &msg, SWITCH_TRUE);
+				if (!*etextP && !(*etextP = verto_event_text_create(event))) {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "JSON ERROR!\n");
+					return;
+				}
+
+				jsock_queue_event_text(np->jsock, *etextP, np->serno++);
 			}
 		}
 	}
@@ -687,6 +818,7 @@ static void jsock_send_event(cJSON *event)
 	const char *event_channel, *session_uuid = NULL;
 	jsock_t *use_jsock = NULL;
 	switch_core_session_t *session = NULL;
+	verto_event_text_t *etext = NULL;
 
 	if (!(event_channel = cJSON_GetObjectCstr(event, "eventChannel"))) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "NO EVENT CHANNEL SPECIFIED\n");
@@ -722,16 +854,18 @@ static void jsock_send_event(cJSON *event)
 	}
 
 	switch_thread_rwlock_rdlock(verto_globals.event_channel_rwlock);
-	write_event(event_channel, use_jsock, event);
+	write_event(event_channel, use_jsock, event, &etext);
 	if (strchr(event_channel, '.')) {
 		char *main_channel = strdup(event_channel);
 		char *p = strchr(main_channel, '.');
 		if (p) *p = '\0';
-		write_event(main_channel, use_jsock, event);		
+		write_event(main_channel, use_jsock, event, &etext);
 		free(main_channel);
 	}
 	switch_thread_rwlock_unlock(verto_globals.event_channel_rwlock);
 
+	verto_event_text_release(&etext);
+
 	if (use_jsock) {
 		switch_thread_rwlock_unlock(use_jsock->rwlock);
 		use_jsock = NULL;
@@ -1423,8 +1557,15 @@ static void jsock_check_event_queue(jsock_t *jsock)
 
 	switch_mutex_lock(jsock->write_mutex);
 	while(this_pass-- > 0 && switch_queue_trypop(jsock->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
-		cJSON *json = (cJSON *) pop;
-		ws_write_json(jsock, &json, SWITCH_TRUE);
+		jsock_event_t *ev = (jsock_event_t *) pop;
+
+		if (ev->etext) {
+			ws_write_event_text(jsock, ev->etext, ev->serno);
+		} else {
+			ws_write_json(jsock, &ev->json, SWITCH_TRUE);
+		}
+
+		jsock_event_destroy(&ev);
 	}
 	switch_mutex_unlock(jsock->write_mutex);
 }
@@ -1970,9 +2111,12 @@ static void jsock_flush(jsock_t *jsock)
 
 	switch_mutex_lock(jsock->write_mutex);
 	while(switch_queue_trypop(jsock->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
-		cJSON *json = (cJSON *) pop;
-		cJSON_Delete(json);
+		jsock_event_t *ev = (jsock_event_t *) pop;
+		jsock_event_destroy(&ev);
 	}
+
+	switch_safe_free(jsock->event_frame);
+	jsock->event_frame_len = 0;
 	switch_mutex_unlock(jsock->write_mutex);
 }
 
@@ -3905,7 +4049,14 @@ static switch_bool_t verto__broadcast_func(const char *method, cJSON *params, js
 	broadcast = cJSON_GetObjectItem(params, "localBroadcast");
 
 	if (broadcast && broadcast->type == cJSON_True) {
-		write_event(event_channel, NULL, jevent);
+		verto_event_text_t *etext = NULL;
+
+		switch_thread_rwlock_rdlock(verto_globals.event_channel_rwlock);
+		write_event(event_channel, NULL, jevent, &etext);
+		switch_thread_rwlock_unlock(verto_globals.event_channel_rwlock);
+
+		verto_event_text_release(&etext);
+		cJSON_Delete(jevent);
 	} else {
 		switch_event_channel_broadcast(event_channel, &jevent, modname, verto_globals.event_channel_id);
 	}
@@ -150,6 +150,8 @@ struct jsock_s {
 
 	switch_queue_t *event_queue;
 	int lost_events;
+	uint8_t *event_frame;
+	switch_size_t event_frame_len;
 	int ready;
 
 	struct jsock_s *next;
@@ -4,6 +4,7 @@
 
 #ifndef _MSC_VER
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #if defined(__linux__) || defined(__GLIBC__)
@@ -470,6 +471,59 @@ ssize_t ws_raw_write(wsh_t *wsh, void *data, size_t bytes)
 	return r;
 }
 
+#ifndef _MSC_VER
+/* header and payload go out in one syscall without being copied together first */
+static ssize_t ws_raw_writev(wsh_t *wsh, struct iovec *iov, int iovcnt)
+{
+	ssize_t r;
+	int sanity = 2000;
+	size_t wrote = 0, bytes = 0;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		bytes += iov[i].iov_len;
+	}
+
+	do {
+		r = writev(wsh->sock, iov, iovcnt);
+
+		if (r > 0) {
+			size_t adv = (size_t) r;
+
+			wrote += r;
+
+			while (iovcnt && adv >= iov->iov_len) {
+				adv -= iov->iov_len;
+				iov++;
+				iovcnt--;
+			}
+
+			if (iovcnt) {
+				iov->iov_base = (unsigned char *)iov->iov_base + adv;
+				iov->iov_len -= adv;
+			}
+		}
+
+		if (sanity < 2000) {
+			ms_sleep(1);
+		}
+
+		if (r == -1) {
+			if (!xp_is_blocking(xp_errno())) {
+				break;
+			}
+		}
+
+	} while (--sanity > 0 && wsh->block && wrote < bytes);
+
+	if (wrote == bytes) {
+		return wrote;
+	}
+
+	return r;
+}
+#endif
+
 #ifdef _MSC_VER
 static int setup_socket(ws_socket_t sock)
 {
@@ -737,6 +791,34 @@ uint64_t ntoh64(uint64_t val)
 #endif
 }
 
+/* unmask in place, a machine word at a time once the pointer is aligned */
+static void ws_unmask(uint8_t *data, size_t len, const uint8_t *maskp)
+{
+	uint8_t mask[4];
+	uint8_t wmask[sizeof(uint64_t)];
+	uint64_t m64;
+	size_t i = 0, j;
+
+	memcpy(mask, maskp, sizeof(mask));
+
+	while (i < len && ((uintptr_t)(data + i) & (sizeof(uint64_t) - 1))) {
+		data[i] ^= mask[i & 3];
+		i++;
+	}
+
+	for (j = 0; j < sizeof(wmask); j++) {
+		wmask[j] = mask[(i + j) & 3];
+	}
+	memcpy(&m64, wmask, sizeof(m64));
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		*(uint64_t *)(data + i) ^= m64;
+	}
+
+	for (; i < len; i++) {
+		data[i] ^= mask[i & 3];
+	}
+}
 
 ssize_t ws_read_frame(wsh_t *wsh, ws_opcode_t *oc, uint8_t **data)
 {
@@ -884,7 +966,7 @@ ssize_t ws_read_frame(wsh_t *wsh, ws_opcode_t *oc, uint8_t **data)
 			if (need + blen > (ssize_t)wsh->bbuflen) {
 				void *tmp;
 				
-				wsh->bbuflen = need + blen + wsh->rplen;
+				wsh->bbuflen = need + blen + wsh->rplen + 1;
 
 				if ((tmp = realloc(wsh->bbuffer, wsh->bbuflen))) {
 					wsh->bbuffer = tmp;
@@ -916,11 +998,7 @@ ssize_t ws_read_frame(wsh_t *wsh, ws_opcode_t *oc, uint8_t **data)
 			}
 			
 			if (mask && maskp) {
-				ssize_t i;
-
-				for (i = 0; i < wsh->datalen; i++) {
-					wsh->body[i] ^= maskp[i % 4];
-				}
+				ws_unmask((uint8_t *)wsh->body, wsh->rplen, (uint8_t *)maskp);
 			}
 			
 
@@ -955,10 +1033,76 @@ ssize_t ws_read_frame(wsh_t *wsh, ws_opcode_t *oc, uint8_t **data)
 	}
 }
 
-ssize_t ws_write_frame(wsh_t *wsh, ws_opcode_t oc, void *data, size_t bytes)
+size_t ws_build_frame_header(uint8_t *hdr, ws_opcode_t oc, size_t bytes)
 {
-	uint8_t hdr[14] = { 0 };
 	size_t hlen = 2;
+
+	hdr[0] = (uint8_t)(oc | 0x80);
+
+	if (bytes < 126) {
+		hdr[1] = (uint8_t)bytes;
+	} else if (bytes < 0x10000) {
+		uint16_t u16;
+
+		hdr[1] = 126;
+		u16 = htons((uint16_t) bytes);
+		memcpy(&hdr[2], &u16, sizeof(u16));
+		hlen += 2;
+	} else {
+		uint64_t u64;
+
+		hdr[1] = 127;
+		u64 = hton64(bytes);
+		memcpy(&hdr[2], &u64, sizeof(u64));
+		hlen += 8;
+	}
+
+	return hlen;
+}
+
+ssize_t ws_build_frame(ws_opcode_t oc, void *data, size_t bytes, uint8_t **frame)
+{
+	uint8_t hdr[WS_MAX_HEADER_LEN];
+	size_t hlen;
+	uint8_t *bp;
+
+	hlen = ws_build_frame_header(hdr, oc, bytes);
+
+	if (!(bp = malloc(hlen + bytes + 1))) {
+		*frame = NULL;
+		return -1;
+	}
+
+	memcpy(bp, hdr, hlen);
+	memcpy(bp + hlen, data, bytes);
+	*(bp + hlen + bytes) = '\0';
+
+	*frame = bp;
+
+	return hlen + bytes;
+}
+
+ssize_t ws_write_prepared_frame(wsh_t *wsh, void *frame, size_t bytes)
+{
+	ssize_t raw_ret = 0;
+
+	if (wsh->down) {
+		return -1;
+	}
+
+	raw_ret = ws_raw_write(wsh, frame, bytes);
+
+	if (raw_ret != (ssize_t) bytes) {
+		return raw_ret;
+	}
+
+	return bytes;
+}
+
+ssize_t ws_write_frame(wsh_t *wsh, ws_opcode_t oc, void *data, size_t bytes)
+{
+	uint8_t hdr[WS_MAX_HEADER_LEN] = { 0 };
+	size_t hlen;
 	uint8_t *bp;
 	ssize_t raw_ret = 0;
 
@@ -968,29 +1112,28 @@ ssize_t ws_write_frame(wsh_t *wsh, ws_opcode_t oc, void *data, size_t bytes)
 
 	//printf("WRITE[%ld]-----------------------------:\n[%s]\n-----------------------------------\n", bytes, (char *) data);
 
-	hdr[0] = (uint8_t)(oc | 0x80);
+	hlen = ws_build_frame_header(hdr, oc, bytes);
 
-	if (bytes < 126) {
-		hdr[1] = (uint8_t)bytes;
-	} else if (bytes < 0x10000) {
-		uint16_t *u16;
+#ifndef _MSC_VER
+	if (!wsh->ssl) {
+		struct iovec iov[2];
 
-		hdr[1] = 126;
-		hlen += 2;
+		iov[0].iov_base = hdr;
+		iov[0].iov_len = hlen;
+		iov[1].iov_base = data;
+		iov[1].iov_len = bytes;
 
-		u16 = (uint16_t *) &hdr[2];
-		*u16 = htons((uint16_t) bytes);
+		raw_ret = ws_raw_writev(wsh, iov, bytes ? 2 : 1);
 
-	} else {
-		uint64_t *u64;
+		if (raw_ret != (ssize_t) (hlen + bytes)) {
+			return raw_ret;
+		}
 
-		hdr[1] = 127;
-		hlen += 8;
-		
-		u64 = (uint64_t *) &hdr[2];
-		*u64 = hton64(bytes);
+		return bytes;
 	}
+#endif
 
+	/* TLS records can't be gathered, coalesce so the frame costs a single SSL_write */
 	if (wsh->write_buffer_len < (hlen + bytes + 1)) {
 		void *tmp;
 
@@ -5,6 +5,7 @@
 
 #define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
 #define B64BUFFLEN 1024
+#define WS_MAX_HEADER_LEN 14
 
 #include <sys/types.h>
 #ifndef _MSC_VER
@@ -125,6 +126,9 @@ ssize_t ws_raw_read(wsh_t *wsh, void *data, size_t bytes, int block);
 ssize_t ws_raw_write(wsh_t *wsh, void *data, size_t bytes);
 ssize_t ws_read_frame(wsh_t *wsh, ws_opcode_t *oc, uint8_t **data);
 ssize_t ws_write_frame(wsh_t *wsh, ws_opcode_t oc, void *data, size_t bytes);
+size_t ws_build_frame_header(uint8_t *hdr, ws_opcode_t oc, size_t bytes);
+ssize_t ws_build_frame(ws_opcode_t oc, void *data, size_t bytes, uint8_t **frame);
+ssize_t ws_write_prepared_frame(wsh_t *wsh, void *frame, size_t bytes);
 int ws_init(wsh_t *wsh, ws_socket_t sock, SSL_CTX *ssl_ctx, int close_sock, int block, int stay_open);
 ssize_t ws_close(wsh_t *wsh, int16_t reason);
 void ws_destroy(wsh_t *wsh);
@@ -28,27 +28,54 @@
  */
 #include <switch.h>
 #include <sys/stat.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
+/* most lines handed to one writev() */
+#define CDR_WRITER_IOV 256
+/* longest the writer sleeps when nothing wakes it */
+#define CDR_WRITER_WAIT 100000
+
+#ifdef WIN32
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+#define fsync _commit
+#endif
 
 typedef enum {
 	CDR_LEG_A = (1 << 0),
 	CDR_LEG_B = (1 << 1)
 } cdr_leg_t;
 
+/* only ever touched by the writer thread */
 struct cdr_fd {
 	int fd;
 	char *path;
 	int64_t bytes;
-	switch_mutex_t *mutex;
+	int dirty;
+	switch_time_t last_sync;
 };
 typedef struct cdr_fd cdr_fd_t;
 
+/* one cdr line on its way to the writer, path and line are stored behind it */
+struct cdr_line {
+	struct cdr_line *next;
+	cdr_fd_t *fd;
+	char *path;
+	char *line;
+	switch_size_t len;
+};
+typedef struct cdr_line cdr_line_t;
+
 const char *default_template =
 	"\"${caller_id_name}\",\"${caller_id_number}\",\"${destination_number}\",\"${context}\",\"${start_stamp}\","
 	"\"${answer_stamp}\",\"${end_stamp}\",\"${duration}\",\"${billsec}\",\"${hangup_cause}\",\"${uuid}\",\"${bleg_uuid}\", \"${accountcode}\"\n";
 
 static struct {
 	switch_memory_pool_t *pool;
-	switch_mutex_t *mutex;
 	switch_hash_t *fd_hash;
 	switch_hash_t *template_hash;
 	char *log_dir;
@@ -58,6 +85,20 @@ static struct {
 	int rotate;
 	int debug;
 	cdr_leg_t legs;
+	/* newest first list of lines waiting for the writer, pushed without a lock */
+	volatile void *lines;
+	switch_atomic_t pending;
+	uint32_t max_pending;
+	switch_atomic_t rotate_all;
+	/* -1 never, 0 after every write, otherwise at most every so many seconds */
+	int fsync_interval;
+	switch_memory_pool_t *writer_pool;
+	switch_thread_t *writer_thread;
+	switch_mutex_t *writer_mutex;
+	switch_thread_cond_t *writer_cond;
+	uint64_t lines_written;
+	uint64_t write_calls;
+	uint64_t fsync_calls;
 } globals;
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load);
@@ -74,12 +115,23 @@ static off_t fd_size(int fd)
 static void do_reopen(cdr_fd_t *fd)
 {
 	int x = 0;
+	char *dir, *p;
 
 	if (fd->fd > -1) {
 		close(fd->fd);
 		fd->fd = -1;
 	}
 
+	dir = strdup(fd->path);
+	switch_assert(dir);
+	if ((p = strrchr(dir, *SWITCH_PATH_SEPARATOR))) {
+		*p = '\0';
+		if (switch_dir_make_recursive(dir, SWITCH_DEFAULT_DIR_PERMS, globals.writer_pool) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error creating %s\n", dir);
+		}
+	}
+	free(dir);
+
 	for (x = 0; x < 10; x++) {
 #ifdef _MSC_VER
 		if ((fd->fd = open(fd->path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR)) > -1) {
@@ -110,7 +162,7 @@ static void do_rotate(cdr_fd_t *fd)
 
 		p = switch_mprintf("%s.%s", fd->path, date);
 		assert(p);
-		switch_file_rename(fd->path, p, globals.pool);
+		switch_file_rename(fd->path, p, globals.writer_pool);
 		free(p);
 	}
 
@@ -129,32 +181,39 @@ static void do_rotate(cdr_fd_t *fd)
 
 }
 
-static void write_cdr(const char *path, const char *log_line)
+static cdr_fd_t *get_fd(const char *path)
 {
-	cdr_fd_t *fd = NULL;
-	unsigned int bytes_in, bytes_out;
-	int loops = 0;
+	cdr_fd_t *fd;
 
-	switch_mutex_lock(globals.mutex);
 	if (!(fd = switch_core_hash_find(globals.fd_hash, path))) {
-		fd = switch_core_alloc(globals.pool, sizeof(*fd));
+		fd = switch_core_alloc(globals.writer_pool, sizeof(*fd));
 		switch_assert(fd);
-		memset(fd, 0, sizeof(*fd));
 		fd->fd = -1;
-		switch_mutex_init(&fd->mutex, SWITCH_MUTEX_NESTED, globals.pool);
-		fd->path = switch_core_strdup(globals.pool, path);
+		fd->path = switch_core_strdup(globals.writer_pool, path);
 		switch_core_hash_insert(globals.fd_hash, path, fd);
 	}
-	switch_mutex_unlock(globals.mutex);
 
-	switch_mutex_lock(fd->mutex);
-	bytes_out = (unsigned) strlen(log_line);
+	return fd;
+}
+
+#ifdef WIN32
+static int cdr_writev(int fd, struct iovec *iov, int cnt)
+{
+	return write(fd, iov->iov_base, (unsigned) iov->iov_len);
+}
+#else
+#define cdr_writev writev
+#endif
+
+static void write_iov(cdr_fd_t *fd, struct iovec *iov, int cnt, switch_size_t bytes_out)
+{
+	int loops = 0;
 
 	if (fd->fd < 0) {
 		do_reopen(fd);
 		if (fd->fd < 0) {
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error opening %s\n", path);
-			goto end;
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error opening %s\n", fd->path);
+			return;
 		}
 	}
 
@@ -162,19 +221,219 @@ static void write_cdr(const char *path, const char *log_line)
 		do_rotate(fd);
 	}
 
-	while ((bytes_in = write(fd->fd, log_line, bytes_out)) != bytes_out && ++loops < 10) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Write error to file %s %d/%d\n", path, (int) bytes_in, (int) bytes_out);
-		do_rotate(fd);
-		switch_yield(250000);
-	}
+	while (cnt > 0 && fd->fd > -1) {
+		int bytes_in = (int) cdr_writev(fd->fd, iov, cnt);
+
+		globals.write_calls++;
+
+		if (bytes_in <= 0) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Write error to file %s %d/%d\n", fd->path, bytes_in, (int) bytes_out);
+			if (++loops >= 10) {
+				break;
+			}
+			do_rotate(fd);
+			switch_yield(250000);
+			continue;
+		}
 
-	if (bytes_in > 0) {
 		fd->bytes += bytes_in;
+		fd->dirty = 1;
+		bytes_out -= bytes_in;
+
+		/* carry on from where a short write stopped */
+		while (cnt > 0 && (switch_size_t) bytes_in >= iov->iov_len) {
+			bytes_in -= (int) iov->iov_len;
+			iov++;
+			cnt--;
+		}
+
+		if (cnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + bytes_in;
+			iov->iov_len -= bytes_in;
+		}
+	}
+}
+
+/* All the lines of one file, coalesced into as few writev() calls as possible */
+static void write_group(cdr_fd_t *fd, cdr_line_t *group)
+{
+	struct iovec iov[CDR_WRITER_IOV];
+	cdr_line_t *line = group, *next;
+
+	while (line) {
+		switch_size_t bytes_out = 0;
+		int cnt = 0;
+		cdr_line_t *first = line;
+
+		for (; line && cnt < CDR_WRITER_IOV; line = line->next) {
+			iov[cnt].iov_base = line->line;
+			iov[cnt].iov_len = line->len;
+			bytes_out += line->len;
+			cnt++;
+		}
+
+		write_iov(fd, iov, cnt, bytes_out);
+		globals.lines_written += cnt;
+
+		for (; first != line; first = next) {
+			next = first->next;
+			free(first);
+			switch_atomic_dec(&globals.pending);
+		}
+	}
+}
+
+static void write_lines(cdr_line_t *lines)
+{
+	cdr_line_t *line, *prev = NULL;
+
+	for (line = lines; line; line = line->next) {
+		line->fd = (prev && !strcmp(prev->path, line->path)) ? prev->fd : get_fd(line->path);
+		prev = line;
+	}
+
+	/* split off the lines of one file at a time, keeping their order */
+	while (lines) {
+		cdr_fd_t *fd = lines->fd;
+		cdr_line_t *group = NULL, **gtail = &group, **tail = &lines, *next;
+
+		for (line = lines; line; line = next) {
+			next = line->next;
+			if (line->fd == fd) {
+				*gtail = line;
+				gtail = &line->next;
+			} else {
+				*tail = line;
+				tail = &line->next;
+			}
+		}
+		*gtail = NULL;
+		*tail = NULL;
+
+		write_group(fd, group);
 	}
+}
+
+static void sync_all(switch_bool_t force)
+{
+	switch_hash_index_t *hi;
+	void *val;
+	cdr_fd_t *fd;
+	switch_time_t now = switch_micro_time_now();
 
-  end:
+	if (globals.fsync_interval < 0 && !force) {
+		return;
+	}
 
-	switch_mutex_unlock(fd->mutex);
+	for (hi = switch_core_hash_first(globals.fd_hash); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		fd = (cdr_fd_t *) val;
+		if (fd->fd > -1 && fd->dirty && (force || now - fd->last_sync >= (switch_time_t) globals.fsync_interval * 1000000)) {
+			fsync(fd->fd);
+			fd->dirty = 0;
+			fd->last_sync = now;
+			globals.fsync_calls++;
+		}
+	}
+}
+
+/* Take every queued line, the list is newest first so turn it around */
+static cdr_line_t *take_lines(void)
+{
+	void *head;
+	cdr_line_t *line, *next, *lines = NULL;
+
+	do {
+		head = (void *) globals.lines;
+	} while (head && switch_atomic_casptr(&globals.lines, NULL, head) != head);
+
+	for (line = (cdr_line_t *) head; line; line = next) {
+		next = line->next;
+		line->next = lines;
+		lines = line;
+	}
+
+	return lines;
+}
+
+static void do_rotate_all(void);
+static void do_teardown(void);
+
+static void *SWITCH_THREAD_FUNC cdr_writer_thread(switch_thread_t *thread, void *obj)
+{
+	for (;;) {
+		int stop = globals.shutdown;
+		cdr_line_t *lines;
+
+		if (switch_atomic_cas(&globals.rotate_all, 0, 1) == 1) {
+			do_rotate_all();
+		}
+
+		if ((lines = take_lines())) {
+			write_lines(lines);
+			sync_all(SWITCH_FALSE);
+			continue;
+		}
+
+		if (stop) {
+			break;
+		}
+
+		switch_mutex_lock(globals.writer_mutex);
+		if (!globals.lines && !globals.shutdown && !switch_atomic_read(&globals.rotate_all)) {
+			switch_thread_cond_timedwait(globals.writer_cond, globals.writer_mutex, CDR_WRITER_WAIT);
+		}
+		switch_mutex_unlock(globals.writer_mutex);
+
+		/* the last batch before traffic stops is synced once its interval is up too */
+		sync_all(SWITCH_FALSE);
+	}
+
+	sync_all(SWITCH_TRUE);
+	do_teardown();
+
+	return NULL;
+}
+
+static void wake_writer(void)
+{
+	switch_mutex_lock(globals.writer_mutex);
+	switch_thread_cond_signal(globals.writer_cond);
+	switch_mutex_unlock(globals.writer_mutex);
+}
+
+/* Hand a line to the writer thread, the session never waits on the disk */
+static void write_cdr(const char *path, const char *log_line)
+{
+	switch_size_t plen = strlen(path) + 1, llen = strlen(log_line);
+	cdr_line_t *line;
+	void *head;
+
+	/* the disk is not keeping up, hold hangups back rather than queue without bound */
+	while (globals.max_pending && switch_atomic_read(&globals.pending) >= globals.max_pending && !globals.shutdown) {
+		switch_yield(10000);
+	}
+
+	line = malloc(sizeof(*line) + plen + llen + 1);
+	switch_assert(line);
+	line->fd = NULL;
+	line->path = (char *) (line + 1);
+	memcpy(line->path, path, plen);
+	line->line = line->path + plen;
+	memcpy(line->line, log_line, llen + 1);
+	line->len = llen;
+
+	switch_atomic_inc(&globals.pending);
+
+	do {
+		head = (void *) globals.lines;
+		line->next = (cdr_line_t *) head;
+	} while (switch_atomic_casptr(&globals.lines, line, head) != head);
+
+	/* only the first line into an empty list can find the writer asleep */
+	if (!head) {
+		wake_writer();
+	}
 }
 
 static switch_status_t my_on_reporting(switch_core_session_t *session)
@@ -204,11 +463,6 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 		log_dir = globals.log_dir;
 	}
 
-	if (switch_dir_make_recursive(log_dir, SWITCH_DEFAULT_DIR_PERMS, switch_core_session_get_pool(session)) != SWITCH_STATUS_SUCCESS) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error creating %s\n", log_dir);
-		return SWITCH_STATUS_FALSE;
-	}
-
 	if (globals.debug) {
 		switch_event_t *event;
 		if (switch_event_create_plain(&event, SWITCH_EVENT_CHANNEL_DATA) == SWITCH_STATUS_SUCCESS) {
@@ -272,7 +526,8 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 }
 
 
-static void do_rotate_all()
+/* rotation and teardown run on the writer thread, which owns the files */
+static void do_rotate_all(void)
 {
 	switch_hash_index_t *hi;
 	void *val;
@@ -282,35 +537,35 @@ static void do_rotate_all()
 		return;
 	}
 
-	switch_mutex_lock(globals.mutex);
 	for (hi = switch_core_hash_first(globals.fd_hash); hi; hi = switch_core_hash_next(&hi)) {
 		switch_core_hash_this(hi, NULL, NULL, &val);
 		fd = (cdr_fd_t *) val;
-		switch_mutex_lock(fd->mutex);
 		do_rotate(fd);
-		switch_mutex_unlock(fd->mutex);
 	}
-	switch_mutex_unlock(globals.mutex);
 }
 
 
-static void do_teardown()
+static void do_teardown(void)
 {
 	switch_hash_index_t *hi;
 	void *val;
 	cdr_fd_t *fd;
-	switch_mutex_lock(globals.mutex);
+
 	for (hi = switch_core_hash_first(globals.fd_hash); hi; hi = switch_core_hash_next(&hi)) {
 		switch_core_hash_this(hi, NULL, NULL, &val);
 		fd = (cdr_fd_t *) val;
-		switch_mutex_lock(fd->mutex);
 		if (fd->fd > -1) {
 			close(fd->fd);
 			fd->fd = -1;
 		}
-		switch_mutex_unlock(fd->mutex);
 	}
-	switch_mutex_unlock(globals.mutex);
+}
+
+
+static void request_rotate_all(void)
+{
+	switch_atomic_set(&globals.rotate_all, 1);
+	wake_writer();
 }
 
 
@@ -319,19 +574,31 @@ static void event_handler(switch_event_t *event)
 	const char *sig = switch_event_get_header(event, "Trapped-Signal");
 
 	if (sig && !strcmp(sig, "HUP")) {
-		do_rotate_all();
+		request_rotate_all();
 	}
 }
 
 
 SWITCH_STANDARD_API(cdr_csv_function)
 {
+	if (zstr(cmd)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	if (!strcmp(cmd, "rotate")) {
-		do_rotate_all();
+		request_rotate_all();
 		stream->write_function(stream, "+OK");
 		return SWITCH_STATUS_SUCCESS;
 	}
 
+	if (!strcmp(cmd, "status")) {
+		stream->write_function(stream, "Pending      \t%u\n", switch_atomic_read(&globals.pending));
+		stream->write_function(stream, "Lines        \t%" SWITCH_UINT64_T_FMT "\n", globals.lines_written);
+		stream->write_function(stream, "Writes       \t%" SWITCH_UINT64_T_FMT "\n", globals.write_calls);
+		stream->write_function(stream, "Fsyncs       \t%" SWITCH_UINT64_T_FMT "\n", globals.fsync_calls);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	return SWITCH_STATUS_FALSE;
 }
 
@@ -367,6 +634,8 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 	switch_core_hash_insert(globals.template_hash, "default", default_template);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Adding default template.\n");
 	globals.legs = CDR_LEG_A;
+	globals.fsync_interval = -1;
+	globals.max_pending = 100000;
 
 	if ((xml = switch_xml_open_cfg(cf, &cfg, NULL))) {
 
@@ -394,6 +663,16 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 					globals.default_template = switch_core_strdup(pool, val);
 				} else if (!strcasecmp(var, "master-file-only")) {
 					globals.masterfileonly = switch_true(val);
+				} else if (!strcasecmp(var, "fsync")) {
+					if (!strcasecmp(val, "always")) {
+						globals.fsync_interval = 0;
+					} else if (switch_is_number(val) && atoi(val) > 0) {
+						globals.fsync_interval = atoi(val);
+					} else {
+						globals.fsync_interval = -1;
+					}
+				} else if (!strcasecmp(var, "max-pending")) {
+					globals.max_pending = (uint32_t) atoi(val);
 				}
 			}
 		}
@@ -437,15 +716,24 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
 	switch_api_interface_t *api_interface;
 
-	load_config(pool);
+	switch_threadattr_t *thd_attr = NULL;
 
-	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	load_config(pool);
 
 	if ((status = switch_dir_make_recursive(globals.log_dir, SWITCH_DEFAULT_DIR_PERMS, pool)) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error creating %s\n", globals.log_dir);
 		return status;
 	}
 
+	/* the writer allocates from its own pool, the module pool is not safe to share with it */
+	switch_core_new_memory_pool(&globals.writer_pool);
+	switch_mutex_init(&globals.writer_mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_thread_cond_create(&globals.writer_cond, globals.pool);
+
+	switch_threadattr_create(&thd_attr, globals.pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	switch_thread_create(&globals.writer_thread, thd_attr, cdr_writer_thread, NULL, globals.pool);
+
 	if ((status = switch_event_bind(modname, SWITCH_EVENT_TRAP, SWITCH_EVENT_SUBCLASS_ANY, event_handler, NULL)) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind!\n");
 		return status;
@@ -456,6 +744,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 
 	SWITCH_ADD_API(api_interface, "cdr_csv", "cdr_csv controls", cdr_csv_function, "parameters");
 	switch_console_set_complete("add cdr_csv rotate");
+	switch_console_set_complete("add cdr_csv status");
 
 	return status;
 }
@@ -463,15 +752,25 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_cdr_csv_shutdown)
 {
+	switch_status_t st;
+
 	switch_console_set_complete("del cdr_csv");
 
-	globals.shutdown = 1;
 	switch_event_unbind_callback(event_handler);
 	switch_core_remove_state_handler(&state_handlers);
 
-	do_teardown();
+	/* the writer drains what is queued, syncs and closes the files */
+	globals.shutdown = 1;
+	if (globals.writer_thread) {
+		wake_writer();
+		switch_thread_join(&st, globals.writer_thread);
+	}
+
 	switch_core_hash_destroy(&globals.fd_hash);
 	switch_core_hash_destroy(&globals.template_hash);
+	if (globals.writer_pool) {
+		switch_core_destroy_memory_pool(&globals.writer_pool);
+	}
 
 	return SWITCH_STATUS_SUCCESS;
 }
@@ -34,6 +34,7 @@
 #define CMD_BUFLEN 1024 * 1000
 #define MAX_QUEUE_LEN 100000
 #define MAX_MISSED 500
+#define EVENT_BATCH_LEN 64
 SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_event_socket_shutdown);
 SWITCH_MODULE_RUNTIME_FUNCTION(mod_event_socket_runtime);
@@ -64,9 +65,27 @@ typedef enum {
 typedef enum {
 	EVENT_FORMAT_PLAIN,
 	EVENT_FORMAT_XML,
-	EVENT_FORMAT_JSON
+	EVENT_FORMAT_JSON,
+	EVENT_FORMAT_BINARY
 } event_format_t;
 
+#define EVENT_FORMAT_COUNT 4
+
+typedef enum {
+	BACKPRESSURE_KILL,
+	BACKPRESSURE_DROP,
+	BACKPRESSURE_DROP_OLDEST
+} backpressure_policy_t;
+
+/* one copy of an event, and its rendering in each format, shared by every listener it is queued to */
+typedef struct queued_event_s {
+	switch_event_t *event;
+	switch_atomic_t refs;
+	switch_time_t created;
+	/* rendered on the listener threads by the first one that needs the format */
+	volatile void *buf[EVENT_FORMAT_COUNT];
+} queued_event_t;
+
 struct listener {
 	switch_socket_t *sock;
 	switch_queue_t *event_queue;
@@ -98,6 +117,14 @@ struct listener {
 	time_t linger_timeout;
 	struct listener *next;
 	switch_pollfd_t *pollfd;
+	backpressure_policy_t policy;
+	uint64_t events_queued;
+	uint64_t events_sent;
+	uint64_t events_dropped;
+	uint32_t queue_peak;
+	switch_time_t lag_last;
+	switch_time_t lag_max;
+	switch_time_t lag_total;
 };
 
 typedef struct listener listener_t;
@@ -129,6 +156,7 @@ static struct {
 	uint32_t id;
 	int nat_map;
 	int stop_on_bind_error;
+	backpressure_policy_t policy;
 } prefs;
 
 
@@ -141,12 +169,211 @@ static const char *format2str(event_format_t format)
 		return "xml";
 	case EVENT_FORMAT_JSON:
 		return "json";
+	case EVENT_FORMAT_BINARY:
+		return "binary";
+	}
+
+	return "invalid";
+}
+
+static const char *policy2str(backpressure_policy_t policy)
+{
+	switch (policy) {
+	case BACKPRESSURE_KILL:
+		return "kill";
+	case BACKPRESSURE_DROP:
+		return "drop";
+	case BACKPRESSURE_DROP_OLDEST:
+		return "drop-oldest";
 	}
 
 	return "invalid";
 }
 
+static switch_status_t str2policy(const char *str, backpressure_policy_t *policy)
+{
+	if (!strcasecmp(str, "kill")) {
+		*policy = BACKPRESSURE_KILL;
+	} else if (!strcasecmp(str, "drop")) {
+		*policy = BACKPRESSURE_DROP;
+	} else if (!strcasecmp(str, "drop-oldest")) {
+		*policy = BACKPRESSURE_DROP_OLDEST;
+	} else {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static queued_event_t *queued_event_create(switch_event_t **event, switch_bool_t dup)
+{
+	queued_event_t *qe;
+
+	switch_zmalloc(qe, sizeof(*qe));
+
+	if (dup) {
+		if (switch_event_dup(&qe->event, *event) != SWITCH_STATUS_SUCCESS) {
+			free(qe);
+			return NULL;
+		}
+	} else {
+		qe->event = *event;
+		*event = NULL;
+	}
+
+	qe->created = switch_micro_time_now();
+	switch_atomic_set(&qe->refs, 1);
+
+	return qe;
+}
+
+static void queued_event_release(queued_event_t **qeP)
+{
+	queued_event_t *qe = *qeP;
+	int x;
+
+	*qeP = NULL;
+
+	if (!qe || switch_atomic_dec(&qe->refs)) {
+		return;
+	}
+
+	for (x = 0; x < EVENT_FORMAT_COUNT; x++) {
+		if (qe->buf[x]) {
+			free((void *) qe->buf[x]);
+		}
+	}
+
+	if (qe->event) {
+		switch_event_destroy(&qe->event);
+	}
+
+	free(qe);
+}
+
+/* the complete text/event-* message, headers included, ready to go on the wire */
+static switch_status_t render_event(switch_event_t *event, event_format_t format, char **bufP, switch_size_t *lenP)
+{
+	char hbuf[512];
+	char *ebuf = NULL, *buf;
+	const char *etype;
+	switch_size_t hlen, elen = 0;
+
+	if (format == EVENT_FORMAT_PLAIN) {
+		etype = "plain";
+		switch_event_serialize(event, &ebuf, SWITCH_TRUE);
+	} else if (format == EVENT_FORMAT_JSON) {
+		etype = "json";
+		switch_event_serialize_json(event, &ebuf);
+	} else if (format == EVENT_FORMAT_BINARY) {
+		etype = "binary";
+		switch_event_serialize_compact(event, &ebuf, &elen);
+	} else {
+		switch_xml_t xml;
+		etype = "xml";
+
+		if ((xml = switch_event_xmlize(event, SWITCH_VA_NONE))) {
+			ebuf = switch_xml_toxml(xml, SWITCH_FALSE);
+			switch_xml_free(xml);
+		}
+	}
+
+	if (!ebuf) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (format != EVENT_FORMAT_BINARY) {
+		elen = strlen(ebuf);
+	}
+
+	switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n", elen, etype);
+	hlen = strlen(hbuf);
+
+	switch_malloc(buf, hlen + elen + 1);
+	memcpy(buf, hbuf, hlen);
+	memcpy(buf + hlen, ebuf, elen);
+	buf[hlen + elen] = '\0';
+	free(ebuf);
+
+	*bufP = buf;
+	*lenP = hlen + elen;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* the rendering of a queued event another listener already made, or a new one shared with the ones after us */
+static const char *queued_event_render(queued_event_t *qe, event_format_t format, switch_size_t *lenP)
+{
+	char *buf = (char *) qe->buf[format];
+
+	if (buf) {
+		*lenP = strlen(buf);
+		return buf;
+	}
+
+	if (render_event(qe->event, format, &buf, lenP) != SWITCH_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	/* another listener got there first, use theirs */
+	if (switch_atomic_casptr(&qe->buf[format], buf, NULL)) {
+		free(buf);
+		buf = (char *) qe->buf[format];
+		*lenP = strlen(buf);
+	}
+
+	return buf;
+}
+
 static void remove_listener(listener_t *listener);
+
+/* drain the event queue in batches, gathering each batch into one socket write */
+static int listener_send_events(listener_t *listener)
+{
+	queued_event_t *batch[EVENT_BATCH_LEN];
+	switch_io_vec_t vec[EVENT_BATCH_LEN];
+	int x, n, total = 0;
+	void *pop;
+
+	do {
+		switch_time_t now = switch_micro_time_now();
+		switch_size_t len = 0;
+
+		for (n = 0; n < EVENT_BATCH_LEN && switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS; n++) {
+			queued_event_t *qe = (queued_event_t *) pop;
+			event_format_t format = listener->format;
+			switch_time_t lag = now - qe->created;
+
+			batch[n] = qe;
+			vec[n].len = 0;
+
+			if (!(vec[n].base = queued_event_render(qe, format, &vec[n].len))) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "%s ERROR!\n", format2str(format));
+			}
+
+			listener->lag_last = lag;
+			listener->lag_total += lag;
+			if (lag > listener->lag_max) {
+				listener->lag_max = lag;
+			}
+		}
+
+		if (!n) {
+			break;
+		}
+
+		switch_socket_sendv(listener->sock, vec, n, &len);
+
+		for (x = 0; x < n; x++) {
+			queued_event_release(&batch[x]);
+		}
+
+		listener->events_sent += n;
+		total += n;
+	} while (n == EVENT_BATCH_LEN);
+
+	return total;
+}
 static void kill_listener(listener_t *l, const char *message);
 static void kill_all_listeners(void);
 
@@ -215,10 +442,8 @@ static void flush_listener(listener_t *listener, switch_bool_t flush_log, switch
 
 	if (flush_events && listener->event_queue) {
 		while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
-			switch_event_t *pevent = (switch_event_t *) pop;
-			if (!pop)
-				continue;
-			switch_event_destroy(&pevent);
+			queued_event_t *qe = (queued_event_t *) pop;
+			queued_event_release(&qe);
 		}
 	}
 }
@@ -239,7 +464,8 @@ static switch_status_t expire_listener(listener_t ** listener)
 		return SWITCH_STATUS_FALSE;
 	}
 
-	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_CRIT, "Stateful Listener %u has expired\n", l->id);
+	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_CRIT, "Stateful Listener %u has expired, discarding %u queued events (%" SWITCH_UINT64_T_FMT " dropped before)\n",
+					  l->id, switch_queue_size(l->event_queue), l->events_dropped);
 
 	flush_listener(*listener, SWITCH_TRUE, SWITCH_TRUE);
 	switch_core_hash_destroy(&l->event_hash);
@@ -266,12 +492,82 @@ static switch_status_t expire_listener(listener_t ** listener)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+static switch_status_t listener_queue_event(listener_t *l, queued_event_t *qe)
+{
+	switch_status_t qstatus;
+	unsigned int qsize;
+	int evicted = 0;
+
+	switch_atomic_inc(&qe->refs);
+
+	if ((qstatus = switch_queue_trypush(l->event_queue, qe)) != SWITCH_STATUS_SUCCESS && l->policy == BACKPRESSURE_DROP_OLDEST) {
+		void *pop;
+
+		if (switch_queue_trypop(l->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
+			queued_event_t *old = (queued_event_t *) pop;
+			queued_event_release(&old);
+			evicted = 1;
+		}
+
+		qstatus = switch_queue_trypush(l->event_queue, qe);
+	}
+
+	qsize = switch_queue_size(l->event_queue);
+
+	if (qstatus == SWITCH_STATUS_SUCCESS) {
+		l->events_queued++;
+
+		if (qsize > l->queue_peak) {
+			l->queue_peak = qsize;
+		}
+
+		if (evicted) {
+			l->events_dropped++;
+
+			if (!l->lost_events++) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_WARNING, "Listener %u is falling behind, dropping its oldest events. Queue size: [%u/%u]\n",
+								  l->id, qsize, MAX_QUEUE_LEN);
+			}
+		} else if (l->lost_events) {
+			int le = l->lost_events;
+			l->lost_events = 0;
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_CRIT, "Lost [%d] events! Event Queue size: [%u/%u]\n", le, qsize, MAX_QUEUE_LEN);
+		}
+
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	l->events_dropped++;
+
+	if (l->policy == BACKPRESSURE_KILL) {
+		char errbuf[512] = {0};
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, 
+						  "Event enqueue ERROR [%d] | [%s] | Queue size: [%u/%u] %s\n", 
+						  (int)qstatus, switch_strerror(qstatus, errbuf, sizeof(errbuf)), qsize, MAX_QUEUE_LEN, (qsize == MAX_QUEUE_LEN)?"Max queue size reached":"");
+		if (++l->lost_events > MAX_MISSED) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Killing listener because of too many lost events. Lost [%d] Queue size[%u/%u]\n", l->lost_events, qsize, MAX_QUEUE_LEN);
+			kill_listener(l, "killed listener because of lost events\n");
+		}
+	} else if (!l->lost_events++) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_WARNING, "Listener %u is falling behind, dropping new events. Queue size: [%u/%u]\n",
+						  l->id, qsize, MAX_QUEUE_LEN);
+	}
+
+	/* drop the reference taken for the queue, the caller still holds its own */
+	switch_atomic_dec(&qe->refs);
+
+	return SWITCH_STATUS_FALSE;
+}
+
 static void event_handler(switch_event_t *event)
 {
-	switch_event_t *clone = NULL;
+	queued_event_t *qe = NULL;
+	listener_t *matched_stack[64];
+	listener_t **matched = matched_stack;
+	int nmatched = 0, mcap = sizeof(matched_stack) / sizeof(matched_stack[0]);
 	listener_t *l, *lp, *last = NULL;
 	time_t now = switch_epoch_time_now(NULL);
-	switch_status_t qstatus;
+	int x;
 
 	switch_assert(event != NULL);
 
@@ -378,33 +674,41 @@ static void event_handler(switch_event_t *event)
 		}
 
 		if (send) {
-			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
-				qstatus = switch_queue_trypush(l->event_queue, clone); 
-				if (qstatus == SWITCH_STATUS_SUCCESS) {
-					if (l->lost_events) {
-						int le = l->lost_events;
-						l->lost_events = 0;
-						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_CRIT, "Lost [%d] events! Event Queue size: [%u/%u]\n", le, switch_queue_size(l->event_queue), MAX_QUEUE_LEN);
-					}
+			if (nmatched == mcap) {
+				listener_t **tmp;
+
+				mcap *= 2;
+				if (matched == matched_stack) {
+					switch_malloc(tmp, mcap * sizeof(*tmp));
+					memcpy(tmp, matched_stack, sizeof(matched_stack));
 				} else {
-					char errbuf[512] = {0};
-					unsigned int qsize = switch_queue_size(l->event_queue);
-					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, 
-							"Event enqueue ERROR [%d] | [%s] | Queue size: [%u/%u] %s\n", 
-							(int)qstatus, switch_strerror(qstatus, errbuf, sizeof(errbuf)), qsize, MAX_QUEUE_LEN, (qsize == MAX_QUEUE_LEN)?"Max queue size reached":"");
-					if (++l->lost_events > MAX_MISSED) {
-						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Killing listener because of too many lost events. Lost [%d] Queue size[%u/%u]\n", l->lost_events, qsize, MAX_QUEUE_LEN);
-						kill_listener(l, "killed listener because of lost events\n");
-					}
-					switch_event_destroy(&clone);
+					tmp = realloc(matched, mcap * sizeof(*tmp));
+					switch_assert(tmp);
 				}
-			} else {
-				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_ERROR, "Memory Error!\n");
+				matched = tmp;
 			}
+
+			matched[nmatched++] = l;
 		}
 		last = l;
 	}
+
+	/* dup once, every listener gets the same copy and renders it on its own thread */
+	if (nmatched && (qe = queued_event_create(&event, SWITCH_TRUE))) {
+		for (x = 0; x < nmatched; x++) {
+			listener_queue_event(matched[x], qe);
+		}
+
+		queued_event_release(&qe);
+	} else if (nmatched) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Memory Error!\n");
+	}
+
 	switch_mutex_unlock(globals.listener_mutex);
+
+	if (matched != matched_stack) {
+		free(matched);
+	}
 }
 
 SWITCH_STANDARD_APP(socket_function)
@@ -493,6 +797,7 @@ SWITCH_STANDARD_APP(socket_function)
 
 	switch_thread_rwlock_create(&listener->rwlock, switch_core_session_get_pool(session));
 	switch_queue_create(&listener->event_queue, MAX_QUEUE_LEN, switch_core_session_get_pool(session));
+	listener->policy = prefs.policy;
 	switch_queue_create(&listener->log_queue, MAX_QUEUE_LEN, switch_core_session_get_pool(session));
 
 	listener->sock = new_sock;
@@ -879,6 +1184,7 @@ SWITCH_STANDARD_API(event_sink_function)
 		switch_set_flag(listener, LFLAG_STATEFUL);
 		switch_set_flag(listener, LFLAG_ALLOW_LOG);
 		switch_queue_create(&listener->event_queue, MAX_QUEUE_LEN, listener->pool);
+		listener->policy = prefs.policy;
 		switch_queue_create(&listener->log_queue, MAX_QUEUE_LEN, listener->pool);
 
 		if (loglevel) {
@@ -1010,6 +1316,7 @@ SWITCH_STANDARD_API(event_sink_function)
 		char *id = switch_event_get_header(stream->param_event, "listen-id");
 		uint32_t idl = 0;
 		void *pop;
+		queued_event_t *qe = NULL;
 		switch_event_t *pevent = NULL;
 		cJSON *cj = NULL, *cjevents = NULL;
 
@@ -1073,7 +1380,8 @@ SWITCH_STANDARD_API(event_sink_function)
 
 		while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
 			//char *etype;
-			pevent = (switch_event_t *) pop;
+			qe = (queued_event_t *) pop;
+			pevent = qe->event;
 
 			if (listener->format == EVENT_FORMAT_PLAIN) {
 				//etype = "plain";
@@ -1101,7 +1409,7 @@ SWITCH_STANDARD_API(event_sink_function)
 			}
 
 			switch_safe_free(listener->ebuf);
-			switch_event_destroy(&pevent);
+			queued_event_release(&qe);
 		}
 
 		if (listener->format == EVENT_FORMAT_JSON) {
@@ -1116,8 +1424,8 @@ SWITCH_STANDARD_API(event_sink_function)
 			stream->write_function(stream, " </events>\n</data>\n");
 		}
 
-		if (pevent) {
-			switch_event_destroy(&pevent);
+		if (qe) {
+			queued_event_release(&qe);
 		}
 
 		switch_thread_rwlock_unlock(listener->rwlock);
@@ -1162,6 +1470,37 @@ SWITCH_STANDARD_API(event_sink_function)
 }
 
 
+SWITCH_STANDARD_API(event_socket_status_function)
+{
+	listener_t *l;
+	int count = 0;
+
+	stream->write_function(stream, "%-6s %-40s %-6s %-12s %-11s %-12s %-12s %-12s %-6s %-10s %-10s %-10s\n",
+						   "id", "remote", "format", "policy", "queue", "peak", "queued", "sent", "dropped", "lag-ms", "max-ms", "avg-ms");
+
+	switch_mutex_lock(globals.listener_mutex);
+	for (l = listen_list.listeners; l; l = l->next) {
+		char remote[128];
+		char queue[32];
+
+		switch_snprintf(remote, sizeof(remote), "%s:%d%s%s", l->remote_ip, l->remote_port,
+						l->session ? " " : "", l->session ? switch_core_session_get_uuid(l->session) : "");
+		switch_snprintf(queue, sizeof(queue), "%u/%u", switch_queue_size(l->event_queue), MAX_QUEUE_LEN);
+
+		stream->write_function(stream, "%-6u %-40s %-6s %-12s %-11s %-12u %-12" SWITCH_UINT64_T_FMT " %-12" SWITCH_UINT64_T_FMT " %-6" SWITCH_UINT64_T_FMT
+							   " %-10.3f %-10.3f %-10.3f\n",
+							   l->id, remote, format2str(l->format), policy2str(l->policy), queue, l->queue_peak,
+							   l->events_queued, l->events_sent, l->events_dropped,
+							   l->lag_last / 1000.0f, l->lag_max / 1000.0f, l->events_sent ? (l->lag_total / (double) l->events_sent) / 1000.0f : 0.0f);
+		count++;
+	}
+	switch_mutex_unlock(globals.listener_mutex);
+
+	stream->write_function(stream, "\n%d total.\n", count);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load)
 {
 	switch_application_interface_t *app_interface;
@@ -1185,6 +1524,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load)
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 	SWITCH_ADD_APP(app_interface, "socket", "Connect to a socket", "Connect to a socket", socket_function, "<ip>[:<port>]", SAF_SUPPORT_NOMEDIA);
 	SWITCH_ADD_API(api_interface, "event_sink", "event_sink", event_sink_function, "<web data>");
+	SWITCH_ADD_API(api_interface, "event_socket_status", "Show event socket listener queue statistics", event_socket_status_function, "");
 
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
@@ -1386,57 +1726,28 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 				if (switch_channel_get_state(chan) < CS_HANGUP && switch_channel_test_flag(chan, CF_DIVERT_EVENTS)) {
 					switch_event_t *e = NULL;
 					while (switch_core_session_dequeue_event(listener->session, &e, SWITCH_TRUE) == SWITCH_STATUS_SUCCESS) {
-						if (switch_queue_trypush(listener->event_queue, e) != SWITCH_STATUS_SUCCESS) {
+						queued_event_t *qe;
+
+						if (!(qe = queued_event_create(&e, SWITCH_FALSE))) {
+							break;
+						}
+
+						if (switch_queue_trypush(listener->event_queue, qe) != SWITCH_STATUS_SUCCESS) {
+							e = qe->event;
+							qe->event = NULL;
+							queued_event_release(&qe);
 							switch_core_session_queue_event(listener->session, &e);
 							break;
 						}
+
+						listener->events_queued++;
 					}
 				}
 			}
 
 			if (switch_test_flag(listener, LFLAG_EVENTS)) {
-				while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
-					char hbuf[512];
-					switch_event_t *pevent = (switch_event_t *) pop;
-					char *etype;
-
+				if (listener_send_events(listener) > 0) {
 					do_sleep = 0;
-					if (listener->format == EVENT_FORMAT_PLAIN) {
-						etype = "plain";
-						switch_event_serialize(pevent, &listener->ebuf, SWITCH_TRUE);
-					} else if (listener->format == EVENT_FORMAT_JSON) {
-						etype = "json";
-						switch_event_serialize_json(pevent, &listener->ebuf);
-					} else {
-						switch_xml_t xml;
-						etype = "xml";
-
-						if ((xml = switch_event_xmlize(pevent, SWITCH_VA_NONE))) {
-							listener->ebuf = switch_xml_toxml(xml, SWITCH_FALSE);
-							switch_xml_free(xml);
-						} else {
-							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "XML ERROR!\n");
-							goto endloop;
-						}
-					}
-
-					switch_assert(listener->ebuf);
-
-					len = strlen(listener->ebuf);
-
-					switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n", len, etype);
-
-					len = strlen(hbuf);
-					switch_socket_send(listener->sock, hbuf, &len);
-
-					len = strlen(listener->ebuf);
-					switch_socket_send(listener->sock, listener->ebuf, &len);
-
-					switch_safe_free(listener->ebuf);
-
-				  endloop:
-
-					switch_event_destroy(&pevent);
 				}
 			}
 		}
@@ -2075,6 +2386,8 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 							listener->format = EVENT_FORMAT_PLAIN;
 						} else if (!strcasecmp(fmt, "json")) {
 							listener->format = EVENT_FORMAT_JSON;
+						} else if (!strcasecmp(fmt, "binary")) {
+							listener->format = EVENT_FORMAT_BINARY;
 						}						
 					}
 
@@ -2116,6 +2429,9 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 			if (strstr(cmd, "json") || strstr(cmd, "JSON")) {
 				listener->format = EVENT_FORMAT_JSON;
 			}
+			if (strstr(cmd, "binary") || strstr(cmd, "BINARY")) {
+				listener->format = EVENT_FORMAT_BINARY;
+			}
 			switch_snprintf(reply, reply_len, "+OK Events Enabled");
 			goto done;
 		}
@@ -2441,6 +2757,21 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 		} else {
 			switch_snprintf(reply, reply_len, "-ERR not controlling a session");
 		}
+	} else if (!strncasecmp(cmd, "backpressure", 12)) {
+		char *policy = cmd + 12;
+
+		strip_cr(policy);
+		while (*policy == ' ' || *policy == '\t') {
+			policy++;
+		}
+
+		if (zstr(policy)) {
+			switch_snprintf(reply, reply_len, "+OK backpressure %s", policy2str(listener->policy));
+		} else if (str2policy(policy, &listener->policy) == SWITCH_STATUS_SUCCESS) {
+			switch_snprintf(reply, reply_len, "+OK backpressure %s", policy2str(listener->policy));
+		} else {
+			switch_snprintf(reply, reply_len, "-ERR invalid backpressure policy, use kill, drop or drop-oldest");
+		}
 	} else if (!strncasecmp(cmd, "nolog", 5)) {
 		flush_listener(listener, SWITCH_TRUE, SWITCH_FALSE);
 		if (switch_test_flag(listener, LFLAG_LOG)) {
@@ -2475,6 +2806,9 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 					} else if (!strcasecmp(cur, "json")) {
 						listener->format = EVENT_FORMAT_JSON;
 						goto end;
+					} else if (!strcasecmp(cur, "binary")) {
+						listener->format = EVENT_FORMAT_BINARY;
+						goto end;
 					}
 				}
 
@@ -2884,6 +3218,10 @@ static int config(void)
 					}
 				} else if (!strcasecmp(var, "stop-on-bind-error")) {
 					prefs.stop_on_bind_error = switch_true(val) ? 1 : 0;
+				} else if (!strcasecmp(var, "backpressure-policy")) {
+					if (str2policy(val, &prefs.policy) != SWITCH_STATUS_SUCCESS) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Invalid backpressure-policy [%s], using [%s]\n", val, policy2str(prefs.policy));
+					}
 				}
 			}
 		}
@@ -3007,6 +3345,7 @@ SWITCH_MODULE_RUNTIME_FUNCTION(mod_event_socket_runtime)
 
 		switch_thread_rwlock_create(&listener->rwlock, listener_pool);
 		switch_queue_create(&listener->event_queue, MAX_QUEUE_LEN, listener_pool);
+		listener->policy = prefs.policy;
 		switch_queue_create(&listener->log_queue, MAX_QUEUE_LEN, listener_pool);
 
 		listener->sock = inbound_socket;
@@ -36,6 +36,7 @@
 
 #define MAX_URLS 20
 #define MAX_ERR_DIRS 20
+#define JSON_CDR_SYNTAX "status"
 
 #define ENCODING_NONE 0
 #define ENCODING_DEFAULT 1
@@ -45,7 +46,6 @@ static struct {
 	char *cred;
 	char *urls[MAX_URLS];
 	int url_count;
-	int url_index;
 	switch_thread_rwlock_t *log_path_lock;
 	char *base_log_dir;
 	char *base_err_log_dir[MAX_ERR_DIRS];
@@ -54,6 +54,7 @@ static struct {
 	int err_dir_count;
 	uint32_t delay;
 	uint32_t retries;
+	uint32_t timeout;
 	uint32_t shutdown;
 	uint32_t enable_cacert_check;
 	char *ssl_cert_file;
@@ -73,31 +74,19 @@ static struct {
 	switch_memory_pool_t *pool;
 	switch_event_node_t *node;
 	int encode_values;
-	switch_queue_t *queue;
-	switch_thread_t *thread;
+	char *spool_dir;
+	uint32_t spool_max;
+	uint32_t queue_size;
+	uint32_t workers;
+	uint32_t connections;
+	uint32_t batch_size;
+	switch_curl_spool_t *spool;
 } globals;
 
-typedef struct {
-	char *json_text;
-	char *json_text_escaped;
-	char *logdir;
-	char *uuid;
-	char *filename;
-} cdr_data_t;
-
 SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_json_cdr_shutdown);
 SWITCH_MODULE_DEFINITION(mod_json_cdr, mod_json_cdr_load, mod_json_cdr_shutdown, NULL);
 
-/* this function would have access to the HTML returned by the webserver, we don't need it 
- * and the default curl activity is to print to stdout, something not as desirable
- * so we have a dummy function here
- */
-static size_t httpCallBack(char *buffer, size_t size, size_t nitems, void *outstream)
-{
-	return size * nitems;
-}
-
 static switch_status_t set_json_cdr_log_dirs()
 {
 	switch_time_exp_t tm;
@@ -193,19 +182,18 @@ static switch_status_t set_json_cdr_log_dirs()
 	return status;
 }
 
-static void backup_cdr(cdr_data_t *data)
+static void backup_cdr(const char *id, const char *json_text, switch_size_t json_len)
 {
 	if (globals.log_errors_to_disk) {
 		int fd = -1, err_dir_index;
 		char *path = NULL;
-		const char *json_text = data->json_text_escaped ? data->json_text_escaped : data->json_text;
 
 		for (err_dir_index = 0; err_dir_index < globals.err_dir_count; err_dir_index++) {
 			switch_thread_rwlock_rdlock(globals.log_path_lock);
-			path = switch_mprintf("%s%s%s", globals.err_log_dir[err_dir_index], SWITCH_PATH_SEPARATOR, data->filename);
+			path = switch_mprintf("%s%s%s.cdr.json", globals.err_log_dir[err_dir_index], SWITCH_PATH_SEPARATOR, id);
 			switch_thread_rwlock_unlock(globals.log_path_lock);
 
-			switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Backup file %s\n", path);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Backup file %s\n", path);
 			if (path) {
 #ifdef _MSC_VER 
 				mode_t mode = S_IRUSR | S_IWUSR;
@@ -213,23 +201,22 @@ static void backup_cdr(cdr_data_t *data)
 				mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
 #endif 
 				if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, mode)) > -1) { 
-					switch_size_t json_len = strlen(json_text);
 					switch_ssize_t wrote = 0, x;
-					do { x = write(fd, json_text, json_len);
+					do { x = write(fd, json_text + wrote, json_len - wrote);
 					} while (!(x<0) && json_len > (wrote += x));
 					if (!(x<0)) do { x = write(fd, "\n", 1);
 						} while (!(x<0) && x<1);
 					close(fd); fd = -1;
 					if (x < 0) {
-						switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
 						if (0 > unlink(path))
-							switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
+							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
 					}
 					switch_safe_free(path);
 					break;
 				} else {
 					char ebuf[512] = { 0 };
-					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Can't open %s! [%s]\n",
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Can't open %s! [%s]\n",
 									  path, switch_strerror_r(errno, ebuf, sizeof(ebuf)));
 				
 				}
@@ -237,200 +224,105 @@ static void backup_cdr(cdr_data_t *data)
 			}
 		}
 	} else {
-		switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_NOTICE, "Not writing to file\n");
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Not writing to file\n");
 	}	
 }
 
-	
-void destroy_cdr_data(cdr_data_t *data) 
+/* the spool gave up on a cdr */
+static void json_cdr_post_failed(const char *id, const char *body, switch_size_t len, void *user_data)
 {
-	switch_safe_free(data->json_text);
-	switch_safe_free(data->json_text_escaped);
-	switch_safe_free(data->uuid);
-	switch_safe_free(data->filename);
-	switch_safe_free(data->logdir);
-	switch_safe_free(data);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to post to web server\n");
+	backup_cdr(id, body, len);
 }
 
-static void process_cdr(cdr_data_t *data)
+/* called by the spool workers for each post, the url picks the tls options */
+static void json_cdr_setup_curl(switch_CURL *curl_handle, const char *url, void *user_data)
 {
-	char *curl_json_text = NULL;
-	long httpRes;
-	CURL *curl_handle = NULL;
-	switch_curl_slist_t *headers = NULL;
-	switch_curl_slist_t *slist = NULL;
-	int fd = -1;
-	uint32_t cur_try;
+	if (!zstr(globals.cred)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
+	}
 
-	switch_assert(data != NULL);
+	if (!zstr(globals.ssl_cert_file)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
+	}
 
-	if (globals.shutdown) {
-		goto end;
+	if (!zstr(globals.ssl_key_file)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
+	}
+
+	if (!zstr(globals.ssl_key_password)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
+	}
+
+	if (!zstr(globals.ssl_version)) {
+		if (!strcasecmp(globals.ssl_version, "SSLv3")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
+		} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
+		}
+	}
+
+	if (!zstr(globals.ssl_cacert_file)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
+	}
+
+	if (!strncasecmp(url, "https", 5)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
+	}
+
+	if (globals.enable_cacert_check) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
 	}
 
-	switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Process [%s]\n", data->filename);
+	if (globals.enable_ssl_verifyhost) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
+	}
+}
 
-	if (!zstr(data->logdir) && (globals.log_http_and_disk || !globals.url_count)) {
-		char *path = switch_mprintf("%s%s%s", data->logdir, SWITCH_PATH_SEPARATOR, data->filename);
-		switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Log to disk [%s]\n", path);
+static void process_cdr(switch_core_session_t *session, const char *id, const char *logdir, const char *json_text, const char *json_text_escaped)
+{
+	int fd = -1;
+
+	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Process [%s.cdr.json]\n", id);
+
+	if (!zstr(logdir) && (globals.log_http_and_disk || !globals.url_count)) {
+		char *path = switch_mprintf("%s%s%s.cdr.json", logdir, SWITCH_PATH_SEPARATOR, id);
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_INFO, "Log to disk [%s]\n", path);
 		if (path) {
 #ifdef _MSC_VER
 			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
 #else
 			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) > -1) {
 #endif
-				switch_size_t json_len = strlen(data->json_text);
+				switch_size_t json_len = strlen(json_text);
 				switch_ssize_t wrote = 0, x;
-				do { x = write(fd, data->json_text, json_len);
+				do { x = write(fd, json_text + wrote, json_len - wrote);
 				} while (!(x<0) && json_len > (wrote += x));
 				if (!(x<0)) do { x = write(fd, "\n", 1);
 					} while (!(x<0) && x<1);
 				close(fd); fd = -1;
 				if (x < 0) {
-					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
+					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
 					if (0 > unlink(path))
-						switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
 				}
 			} else {
 				char ebuf[512] = { 0 };
-				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s][%s]\n",
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing [%s][%s]\n",
 								  path, switch_strerror_r(errno, ebuf, sizeof(ebuf)));
 			}
 			switch_safe_free(path);
 		}
 	}
 
-	/* try to post it to the web server */
-	if (globals.url_count) {
-		char *destUrl = NULL;
-		curl_handle = switch_curl_easy_init();
-
-		if (globals.encode) {
-			if (globals.encode == ENCODING_DEFAULT) {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
-			} else {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-base64-encoded");
-			}
-
-			curl_json_text = switch_mprintf("cdr=%s", data->json_text_escaped);
-			switch_assert(curl_json_text != NULL);
-			
-		} else {
-			headers = switch_curl_slist_append(headers, "Content-Type: application/json");
-			curl_json_text = (char *)data->json_text;
-		}
-
-		if (!zstr(globals.cred)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
-		}
-
-		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, curl_json_text);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-json/1.0");
-		switch_curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, httpCallBack);
-
-		if (globals.disable100continue) {
-			slist = switch_curl_slist_append(slist, "Expect:");
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, slist);
-		}
-
-		if (!zstr(globals.ssl_cert_file)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
-		}
-
-		if (!zstr(globals.ssl_key_file)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
-		}
-
-		if (!zstr(globals.ssl_key_password)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
-		}
-
-		if (!zstr(globals.ssl_version)) {
-			if (!strcasecmp(globals.ssl_version, "SSLv3")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
-			} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
-			}
-		}
-
-		if (!zstr(globals.ssl_cacert_file)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
-		}
-
-		/* these were used for testing, optionally they may be enabled if someone desires
-		   switch_curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 120); // tcp timeout
-		   switch_curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1); // 302 recursion level
-		 */
-
-		for (cur_try = 0; cur_try < globals.retries; cur_try++) {
-			if (cur_try > 0) {
-				switch_yield(globals.delay * 1000000);
-			}
-
-			destUrl = switch_mprintf("%s?uuid=%s", globals.urls[globals.url_index], data->uuid);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_URL, destUrl);
-
-			if (!strncasecmp(destUrl, "https", 5)) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
-			}
-
-			if (globals.enable_cacert_check) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
-			}
-
-			if (globals.enable_ssl_verifyhost) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
-			}
-
-			switch_curl_easy_perform(curl_handle);
-			switch_curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
-			switch_safe_free(destUrl);
-			if (httpRes >= 200 && httpRes < 300) {
-				goto end;
-			} else {
-				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Got error [%ld] posting to web server [%s]\n",
-								  httpRes, globals.urls[globals.url_index]);
-				globals.url_index++;
-				switch_assert(globals.url_count <= MAX_URLS);
-				if (globals.url_index >= globals.url_count) {
-					globals.url_index = 0;
-				} else {
-					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Retry will be with url [%s]\n", globals.urls[globals.url_index]);
-					}
-			}
-		}
-		switch_curl_easy_cleanup(curl_handle);
-		switch_curl_slist_free_all(headers);
-		switch_curl_slist_free_all(slist);
-		slist = NULL;
-		headers = NULL;
-		curl_handle = NULL;
-
-		/* if we are here the web post failed for some reason */
-		switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Unable to post to web server\n");
-		backup_cdr(data);
-	}
-
-	end:
-	if (curl_handle) {
-		switch_curl_easy_cleanup(curl_handle);
-	}
-	if (headers) {
-		switch_curl_slist_free_all(headers);
+	/* hand it to the spool, the post happens on its workers */
+	if (globals.spool) {
+		switch_curl_spool_submit(globals.spool, id, json_text_escaped ? json_text_escaped : json_text);
+	} else if (globals.url_count) {
+		backup_cdr(id, json_text_escaped ? json_text_escaped : json_text, strlen(json_text_escaped ? json_text_escaped : json_text));
 	}
-	if (slist) {
-		switch_curl_slist_free_all(slist);
-	}
-	if (curl_json_text != data->json_text) {
-		switch_safe_free(curl_json_text);
-	}
-
-	destroy_cdr_data(data);
 }
 
 static switch_status_t my_on_reporting(switch_core_session_t *session)
@@ -441,8 +333,8 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 	switch_channel_t *channel = switch_core_session_get_channel(session);
 	int is_b;
 	const char *a_prefix = "";
-	cdr_data_t *cdr_data = NULL;
-	const char *logdir = NULL;
+	char *logdir = NULL;
+	char *id = NULL;
 
 	if (globals.shutdown) {
 		return SWITCH_STATUS_SUCCESS;
@@ -464,9 +356,6 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 		return SWITCH_STATUS_FALSE;
 	}
 	
-	cdr_data = malloc(sizeof(cdr_data_t));
-	switch_assert(cdr_data);
-	
 	json_text = cJSON_PrintUnformatted(json_cdr);
 
 	if (globals.url_count && globals.encode) {
@@ -482,63 +371,45 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 		}
 	}
 
-	cdr_data->uuid = strdup(switch_core_session_get_uuid(session));
-	cdr_data->filename = switch_mprintf("%s%s.cdr.json", a_prefix, cdr_data->uuid);
-	cdr_data->json_text = json_text;
-    cdr_data->json_text_escaped = json_text_escaped;
+	id = switch_mprintf("%s%s", a_prefix, switch_core_session_get_uuid(session));
+	switch_assert(id);
 
 	switch_thread_rwlock_rdlock(globals.log_path_lock);
 
-	if (!(logdir = switch_channel_get_variable(channel, "json_cdr_base"))) {
-		logdir = globals.log_dir;
+	if ((logdir = (char *) switch_channel_get_variable(channel, "json_cdr_base"))) {
+		logdir = strdup(logdir);
+	} else {
+		logdir = switch_safe_strdup(globals.log_dir);
 	}
-	cdr_data->logdir = switch_safe_strdup(logdir);
 
 	switch_thread_rwlock_unlock(globals.log_path_lock);
 
-	if (globals.queue) {
-		if (switch_queue_trypush(globals.queue, cdr_data) != SWITCH_STATUS_SUCCESS) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Unable to push cdr to queue\n");
-			backup_cdr(cdr_data);
-			destroy_cdr_data(cdr_data);			
-		}
-	} else {
-		process_cdr(cdr_data);
-	}
-	
+	process_cdr(session, id, logdir, json_text, json_text_escaped);
+
+	switch_safe_free(logdir);
+	switch_safe_free(id);
+	switch_safe_free(json_text);
+	switch_safe_free(json_text_escaped);
 	cJSON_Delete(json_cdr);
 
 	return SWITCH_STATUS_SUCCESS;
 }
 
-static void *SWITCH_THREAD_FUNC cdr_thread(switch_thread_t *t, void *obj)
+SWITCH_STANDARD_API(json_cdr_function)
 {
-	void *pop = NULL;
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Cdr thread started.\n");
-
-	while (!globals.shutdown) {
-		cdr_data_t *data = NULL;
-
-		if (switch_queue_pop(globals.queue, &pop) != SWITCH_STATUS_SUCCESS) {
-			break;
-		}
-
-		if (!pop) {
-			break;
-		}
-
-		data = (cdr_data_t *) pop;
-		process_cdr(data);
+	if (zstr(cmd) || strcasecmp(cmd, "status")) {
+		stream->write_function(stream, "-USAGE: %s\n", JSON_CDR_SYNTAX);
+		return SWITCH_STATUS_SUCCESS;
 	}
 
-	while (switch_queue_trypop(globals.queue, &pop) == SWITCH_STATUS_SUCCESS) {
-		destroy_cdr_data((cdr_data_t *) pop);
+	if (!globals.spool) {
+		stream->write_function(stream, "-ERR no urls configured\n");
+		return SWITCH_STATUS_SUCCESS;
 	}
 
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Cdr thread ended.\n");
-	switch_thread_exit(t, SWITCH_STATUS_SUCCESS);
+	switch_curl_spool_status(globals.spool, stream);
 
-	return NULL;
+	return SWITCH_STATUS_SUCCESS;
 }
 
 static void event_handler(switch_event_t *event)
@@ -571,6 +442,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 	char *cf = "json_cdr.conf";
 	switch_xml_t cfg, xml, settings, param;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_api_interface_t *api_interface;
 
 	memset(&globals, 0, sizeof(globals));
 
@@ -581,6 +453,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 	globals.pool = pool;
 	globals.auth_scheme = CURLAUTH_BASIC;
 	globals.encode_values = ENCODING_DEFAULT;
+	globals.batch_size = 1;
 
 	switch_thread_rwlock_create(&globals.log_path_lock, pool);
 
@@ -684,17 +557,29 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 				}
 			} else if (!strcasecmp(var, "encode-values") && !zstr(val)) {
 				globals.encode_values = switch_true(val) ? ENCODING_DEFAULT : ENCODING_NONE;
-			} else if (!strcasecmp(var, "queue-capacity") && !zstr(val)) {
+			} else if ((!strcasecmp(var, "queue-size") || !strcasecmp(var, "queue-capacity")) && !zstr(val)) {
 				int capacity = atoi(val);
 				if (capacity > 0) {
-					switch_threadattr_t *thd_attr;
-
-					switch_queue_create(&globals.queue, capacity, globals.pool);
-
-					switch_threadattr_create(&thd_attr, globals.pool);
-					switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
-					switch_thread_create(&globals.thread, thd_attr, cdr_thread, NULL, globals.pool);
+					globals.queue_size = (uint32_t) capacity;
 				}
+			} else if (!strcasecmp(var, "spool-dir") && !zstr(val)) {
+				if (switch_is_file_path(val)) {
+					globals.spool_dir = switch_core_strdup(globals.pool, val);
+				} else {
+					globals.spool_dir = switch_core_sprintf(globals.pool, "%s%s%s", SWITCH_GLOBAL_dirs.log_dir, SWITCH_PATH_SEPARATOR, val);
+				}
+			} else if (!strcasecmp(var, "spool-max") && !zstr(val)) {
+				globals.spool_max = (uint32_t) atoi(val);
+			} else if (!strcasecmp(var, "workers") && !zstr(val)) {
+				globals.workers = (uint32_t) atoi(val);
+			} else if (!strcasecmp(var, "connections") && !zstr(val)) {
+				globals.connections = (uint32_t) atoi(val);
+			} else if (!strcasecmp(var, "batch-size") && !zstr(val)) {
+				int tmp = atoi(val);
+				globals.batch_size = tmp > 0 ? (uint32_t) tmp : 1;
+			} else if (!strcasecmp(var, "timeout") && !zstr(val)) {
+				int tmp = atoi(val);
+				globals.timeout = tmp > 0 ? (uint32_t) tmp : 0;
 			}
 		}
 
@@ -716,6 +601,48 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 
 	set_json_cdr_log_dirs();
 
+	if (globals.url_count) {
+		switch_curl_spool_settings_t spool_settings = { 0 };
+
+		spool_settings.name = "json_cdr";
+		spool_settings.urls = (const char **) globals.urls;
+		spool_settings.url_count = globals.url_count;
+		if (globals.spool_dir) {
+			spool_settings.spool_dir = globals.spool_dir;
+		} else if (globals.err_dir_count) {
+			spool_settings.spool_dir = switch_core_sprintf(globals.pool, "%s%sspool", globals.base_err_log_dir[0], SWITCH_PATH_SEPARATOR);
+		}
+		spool_settings.spool_max = globals.spool_max;
+		spool_settings.queue_size = globals.queue_size;
+		spool_settings.workers = globals.workers;
+		spool_settings.connections = globals.connections;
+		spool_settings.batch_size = globals.batch_size;
+		spool_settings.retries = globals.retries;
+		spool_settings.delay = globals.delay;
+		spool_settings.timeout = globals.timeout;
+		spool_settings.user_agent = "freeswitch-json/1.0";
+		spool_settings.disable_expect = globals.disable100continue ? SWITCH_TRUE : SWITCH_FALSE;
+		spool_settings.setup = json_cdr_setup_curl;
+		spool_settings.fail = json_cdr_post_failed;
+
+		if (globals.encode) {
+			spool_settings.content_type = globals.encode == ENCODING_DEFAULT ?
+				"application/x-www-form-urlencoded" : "application/x-www-form-base64-encoded";
+			spool_settings.record_prefix = "cdr=";
+			spool_settings.batch_separator = "&";
+		} else {
+			/* batches post a json array of cdrs */
+			spool_settings.content_type = "application/json";
+			spool_settings.batch_open = "[";
+			spool_settings.batch_separator = ",";
+			spool_settings.batch_close = "]";
+		}
+
+		if (switch_curl_spool_create(&globals.spool, &spool_settings, globals.pool) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to start the cdr spool\n");
+		}
+	}
+
 	if (switch_event_bind_removable(modname, SWITCH_EVENT_TRAP, SWITCH_EVENT_SUBCLASS_ANY, event_handler, NULL, &globals.node) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind!\n");
 		return SWITCH_STATUS_GENERR;
@@ -726,6 +653,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 
+	SWITCH_ADD_API(api_interface, "json_cdr", "JSON CDR delivery", json_cdr_function, JSON_CDR_SYNTAX);
+	switch_console_set_complete("add json_cdr status");
+
 	switch_xml_free(xml);
 	return status;
 }
@@ -734,14 +664,15 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_json_cdr_shutdown)
 {
 	int err_dir_index = 0;
-	switch_status_t status;
 
 	globals.shutdown = 1;
 
-	if (globals.queue) {
-		switch_queue_push(globals.queue, NULL);
-		switch_thread_join(&status, globals.thread);
-	}
+	switch_console_set_complete("del json_cdr");
+	switch_event_unbind(&globals.node);
+	switch_core_remove_state_handler(&state_handlers);
+
+	/* what is left goes to the spool dir, failures still need the error dirs */
+	switch_curl_spool_destroy(&globals.spool);
 
 	switch_safe_free(globals.log_dir);
 	
@@ -749,9 +680,6 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_json_cdr_shutdown)
 		switch_safe_free(globals.err_log_dir[err_dir_index]);
 	}
 
-	switch_event_unbind(&globals.node);
-	switch_core_remove_state_handler(&state_handlers);
-
 	switch_thread_rwlock_destroy(globals.log_path_lock);
 
 	return SWITCH_STATUS_SUCCESS;
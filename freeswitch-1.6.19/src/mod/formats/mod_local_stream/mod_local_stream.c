@@ -46,6 +46,27 @@ static const char *global_cf = "local_stream.conf";
 
 struct local_stream_source;
 
+/* encoded frames each output keeps, listeners further behind skip ahead */
+#define LOCAL_STREAM_OUTPUT_FRAMES 16
+
+/* the stream encoded once per interval for every listener sending the same codec */
+struct local_stream_output {
+	char *iananame;
+	switch_codec_t codec;
+	uint32_t frame_len;
+	uint8_t *frames;
+	uint32_t lens[LOCAL_STREAM_OUTPUT_FRAMES];
+	uint8_t *silence;
+	uint32_t silence_len;
+	/* frames encoded so far, readers keep their own count */
+	uint32_t seq;
+	int users;
+	switch_thread_rwlock_t *rwlock;
+	struct local_stream_output *next;
+};
+
+typedef struct local_stream_output local_stream_output_t;
+
 static struct {
 	switch_mutex_t *mutex;
 	switch_hash_t *source_hash;
@@ -76,6 +97,8 @@ struct local_stream_context {
 	switch_image_t *banner_img;
 	switch_time_t banner_timeout;
 	switch_memory_pool_t *pool;
+	local_stream_output_t *output;
+	uint32_t out_seq;
 	struct local_stream_context *next;
 };
 
@@ -127,6 +150,9 @@ struct local_stream_source {
 	uint8_t logo_opacity;
 	uint8_t text_opacity;
 	switch_mm_t mm;
+	int native_total;
+	char *native_list[SWITCH_MAX_CODECS];
+	local_stream_output_t *outputs;
 };
 
 typedef struct local_stream_source local_stream_source_t;
@@ -214,6 +240,95 @@ static void flush_video_queue(switch_queue_t *q)
 
 }
 
+/* Find or start the output for a listener sending impl, call with source->mutex held */
+static local_stream_output_t *get_output(local_stream_source_t *source, const switch_codec_implementation_t *impl)
+{
+	local_stream_output_t *out;
+	uint32_t len = SWITCH_RECOMMENDED_BUFFER_SIZE, rate = source->rate;
+	uint8_t pcm[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 }, silence[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	unsigned int flag = 0;
+	int x;
+
+	if (!impl->encoded_bytes_per_packet || source->abuflen > sizeof(pcm) || impl->actual_samples_per_second != (uint32_t) source->rate ||
+		impl->number_of_channels != source->channels || impl->microseconds_per_packet != source->interval * 1000) {
+		return NULL;
+	}
+
+	for (x = 0; x < source->native_total; x++) {
+		if (!strcasecmp(source->native_list[x], impl->iananame)) {
+			break;
+		}
+	}
+
+	if (x == source->native_total) {
+		return NULL;
+	}
+
+	for (out = source->outputs; out; out = out->next) {
+		if (!strcasecmp(out->iananame, impl->iananame) && out->frame_len == impl->encoded_bytes_per_packet) {
+			return out;
+		}
+	}
+
+	out = switch_core_alloc(source->pool, sizeof(*out));
+
+	if (switch_core_codec_init(&out->codec, impl->iananame, impl->modname, impl->fmtp, impl->samples_per_second, source->interval,
+							   source->channels, SWITCH_CODEC_FLAG_ENCODE | SWITCH_CODEC_FLAG_DECODE, NULL, source->pool) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Can't encode local_stream://%s as %s\n", source->name, impl->iananame);
+		return NULL;
+	}
+
+	if (switch_core_codec_encode(&out->codec, NULL, pcm, (uint32_t) source->abuflen, source->rate,
+								 silence, &len, &rate, &flag) != SWITCH_STATUS_SUCCESS || len > impl->encoded_bytes_per_packet) {
+		switch_core_codec_destroy(&out->codec);
+		return NULL;
+	}
+
+	out->iananame = switch_core_strdup(source->pool, impl->iananame);
+	out->frame_len = impl->encoded_bytes_per_packet;
+	out->frames = switch_core_alloc(source->pool, out->frame_len * LOCAL_STREAM_OUTPUT_FRAMES);
+	out->silence = switch_core_alloc(source->pool, len);
+	memcpy(out->silence, silence, len);
+	out->silence_len = len;
+	switch_thread_rwlock_create(&out->rwlock, source->pool);
+
+	out->next = source->outputs;
+	source->outputs = out;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "local_stream://%s now also encodes %s\n", source->name, out->iananame);
+
+	return out;
+}
+
+/* Encode the next interval once for all listeners of each output, call with source->mutex held */
+static void encode_outputs(local_stream_source_t *source, switch_byte_t *data)
+{
+	local_stream_output_t *out;
+	uint8_t enc[SWITCH_RECOMMENDED_BUFFER_SIZE];
+
+	for (out = source->outputs; out; out = out->next) {
+		uint32_t len = sizeof(enc), rate = source->rate, slot;
+		unsigned int flag = 0;
+
+		if (!out->users) {
+			continue;
+		}
+
+		if (switch_core_codec_encode(&out->codec, NULL, data, (uint32_t) source->abuflen, source->rate,
+									 enc, &len, &rate, &flag) != SWITCH_STATUS_SUCCESS || len > out->frame_len) {
+			len = out->silence_len;
+			memcpy(enc, out->silence, len);
+		}
+
+		switch_thread_rwlock_wrlock(out->rwlock);
+		slot = out->seq % LOCAL_STREAM_OUTPUT_FRAMES;
+		memcpy(out->frames + slot * out->frame_len, enc, len);
+		out->lens[slot] = len;
+		out->seq++;
+		switch_thread_rwlock_unlock(out->rwlock);
+	}
+}
+
 static void *SWITCH_THREAD_FUNC read_stream_thread(switch_thread_t *thread, void *obj)
 {
 	volatile local_stream_source_t *s = (local_stream_source_t *) obj;
@@ -598,9 +713,17 @@ static void *SWITCH_THREAD_FUNC read_stream_thread(switch_thread_t *thread, void
 					used = switch_buffer_read(audio_buffer, dist_buf, source->abuflen);
 					
 					switch_mutex_lock(source->mutex);
+
+					if (source->outputs) {
+						if (used < source->abuflen) {
+							memset(dist_buf + used, 0, source->abuflen - used);
+						}
+						encode_outputs(source, dist_buf);
+					}
+
 					for (cp = source->context_list; cp && RUNNING; cp = cp->next) {
 
-						if (!cp->ready) {
+						if (!cp->ready || cp->output) {
 							continue;
 						}
 						
@@ -781,6 +904,13 @@ static void *SWITCH_THREAD_FUNC read_stream_thread(switch_thread_t *thread, void
 	switch_thread_rwlock_wrlock(source->rwlock);
 	switch_thread_rwlock_unlock(source->rwlock);
 
+	while (source->outputs) {
+		local_stream_output_t *out = source->outputs;
+
+		source->outputs = out->next;
+		switch_core_codec_destroy(&out->codec);
+	}
+
 	switch_buffer_destroy(&audio_buffer);
 
 	flush_video_queue(source->video_q);
@@ -889,6 +1019,14 @@ static switch_status_t local_stream_file_open(switch_file_handle_t *handle, cons
 	context->handle = handle;
 	context->ready = 1;
 	switch_mutex_lock(source->mutex);
+
+	/* listeners sending the same codec share one encoder instead of each encoding the stream */
+	if (handle->native_impl && source->native_total && (context->output = get_output(source, handle->native_impl))) {
+		context->output->users++;
+		context->out_seq = context->output->seq;
+		switch_set_flag_locked(handle, SWITCH_FILE_NATIVE);
+	}
+
 	context->next = source->context_list;
 	source->context_list = context;
 	source->total++;
@@ -941,6 +1079,11 @@ static switch_status_t local_stream_file_close(switch_file_handle_t *handle)
 							
 	source->total--;
 
+	if (context->output) {
+		context->output->users--;
+		context->output = NULL;
+	}
+
 	switch_img_free(&context->banner_img);
 	switch_buffer_destroy(&context->audio_buffer);
 	switch_mutex_unlock(context->audio_mutex);
@@ -1110,6 +1253,42 @@ static switch_status_t local_stream_file_read_video(switch_file_handle_t *handle
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* Copy the frames encoded since the last read, len is in bytes */
+static void read_output(local_stream_context_t *context, void *data, size_t *len)
+{
+	local_stream_output_t *out = context->output;
+	size_t got = 0;
+
+	switch_thread_rwlock_rdlock(out->rwlock);
+
+	if (out->seq - context->out_seq > LOCAL_STREAM_OUTPUT_FRAMES) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "Skipping ahead in %s output [%s() %s:%d]\n",
+						  out->iananame, context->func, context->file, context->line);
+		context->out_seq = out->seq - 1;
+	}
+
+	while (context->out_seq != out->seq) {
+		uint32_t slot = context->out_seq % LOCAL_STREAM_OUTPUT_FRAMES;
+
+		if (got + out->lens[slot] > *len) {
+			break;
+		}
+
+		memcpy((uint8_t *) data + got, out->frames + slot * out->frame_len, out->lens[slot]);
+		got += out->lens[slot];
+		context->out_seq++;
+	}
+
+	switch_thread_rwlock_unlock(out->rwlock);
+
+	if (!got && *len >= out->silence_len) {
+		memcpy(data, out->silence, out->silence_len);
+		got = out->silence_len;
+	}
+
+	*len = got;
+}
+
 static switch_status_t local_stream_file_read(switch_file_handle_t *handle, void *data, size_t *len)
 {
 	local_stream_context_t *context = handle->private_info;
@@ -1131,6 +1310,12 @@ static switch_status_t local_stream_file_read(switch_file_handle_t *handle, void
 		}
 	}
 
+	if (context->output) {
+		read_output(context, data, len);
+		handle->sample_count += *len;
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	switch_mutex_lock(context->audio_mutex);
 	need = *len * 2 * context->source->channels;
 
@@ -1232,6 +1417,10 @@ static void launch_thread(const char *name, const char *path, switch_xml_t direc
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
 								  "Interval must be multiple of 10 and less than %d, Using default of 20\n", SWITCH_MAX_INTERVAL);
 			}
+		} else if (!strcasecmp(var, "native-codecs") && !zstr(val)) {
+			char *list_dup = switch_core_strdup(source->pool, val);
+			source->native_total =
+				switch_separate_string(list_dup, ',', source->native_list, (sizeof(source->native_list) / sizeof(source->native_list[0])));
 		} else if (!strcasecmp(var, "timer-name")) {
 			source->timer_name = switch_core_strdup(source->pool, val);
 		} else if (!strcasecmp(var, "blank-img") && !zstr(val)) {
@@ -1309,6 +1498,7 @@ static void event_handler(switch_event_t *event)
 SWITCH_STANDARD_API(local_stream_function)
 {
 	local_stream_source_t *source = NULL;
+	local_stream_output_t *out = NULL;
 	char *mycmd = NULL, *argv[5] = { 0 };
 	char *local_stream_name = NULL;
 	int argc = 0;
@@ -1398,6 +1588,11 @@ SWITCH_STANDARD_API(local_stream_function)
 					stream->write_function(stream, "  <shuffle>%s</shuffle>\n", (source->shuffle) ? "true" : "false");
 					stream->write_function(stream, "  <ready>%s</ready>\n", (source->ready) ? "true" : "false");
 					stream->write_function(stream, "  <stopped>%s</stopped>\n", (source->stopped) ? "true" : "false");
+					switch_mutex_lock(source->mutex);
+					for (out = source->outputs; out; out = out->next) {
+						stream->write_function(stream, "  <output codec=\"%s\" listeners=\"%d\" frames=\"%u\"/>\n", out->iananame, out->users, out->seq);
+					}
+					switch_mutex_unlock(source->mutex);
 					stream->write_function(stream, "</local_stream>\n");
 				} else {
 					stream->write_function(stream, "%s\n", source->name);
@@ -1413,6 +1608,11 @@ SWITCH_STANDARD_API(local_stream_function)
 					stream->write_function(stream, "  ready:    %s\n", (source->ready) ? "true" : "false");
 					stream->write_function(stream, "  stopped:  %s\n", (source->stopped) ? "true" : "false");
 					stream->write_function(stream, "  reloading: %s\n", (source->full_reload) ? "true" : "false");
+					switch_mutex_lock(source->mutex);
+					for (out = source->outputs; out; out = out->next) {
+						stream->write_function(stream, "  output:   %s listeners: %d frames: %u\n", out->iananame, out->users, out->seq);
+					}
+					switch_mutex_unlock(source->mutex);
 				}
 				switch_thread_rwlock_unlock(source->rwlock);
 			} else {
@@ -98,6 +98,13 @@ static switch_status_t native_file_file_open(switch_file_handle_t *handle, const
 	handle->pos = 0;
 	handle->private_info = context;
 	handle->flags |= SWITCH_FILE_NATIVE;
+
+	/* playback is served from memory, frames can be sent straight from the mapping */
+	if (switch_core_file_map(handle, path, 0) == SWITCH_STATUS_SUCCESS) {
+		switch_file_close(context->fd);
+		context->fd = NULL;
+	}
+
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Opening File [%s] %dhz\n", path, handle->samplerate);
 
 	return SWITCH_STATUS_SUCCESS;
@@ -108,6 +115,10 @@ static switch_status_t native_file_file_truncate(switch_file_handle_t *handle, i
 	native_file_context *context = handle->private_info;
 	switch_status_t status;
 
+	if (!context->fd) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	if ((status = switch_file_trunc(context->fd, offset)) == SWITCH_STATUS_SUCCESS) {
 		handle->pos = 0;
 	}
@@ -134,6 +145,27 @@ static switch_status_t native_file_file_seek(switch_file_handle_t *handle, unsig
 
 	native_file_context *context = handle->private_info;
 
+	if (handle->map_data) {
+		int64_t pos = samples;
+
+		if (whence == SEEK_CUR) {
+			pos += handle->map_pos;
+		} else if (whence == SEEK_END) {
+			pos += handle->map_len;
+		}
+
+		if (pos < 0) {
+			pos = 0;
+		} else if (pos > (int64_t) handle->map_len) {
+			pos = handle->map_len;
+		}
+
+		handle->map_pos = handle->pos = (switch_size_t) pos;
+		*cur_sample = (unsigned int) pos;
+
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	status = switch_file_seek(context->fd, whence, &samples);
 	if (status == SWITCH_STATUS_SUCCESS) {
 		handle->pos += samples;
@@ -147,6 +179,24 @@ static switch_status_t native_file_file_read(switch_file_handle_t *handle, void
 
 	native_file_context *context = handle->private_info;
 
+	if (handle->map_data) {
+		switch_size_t left = handle->map_len - handle->map_pos;
+
+		if (*len > left) {
+			*len = left;
+		}
+
+		if (!*len) {
+			return SWITCH_STATUS_FALSE;
+		}
+
+		memcpy(data, handle->map_data + handle->map_pos, *len);
+		handle->map_pos += *len;
+		handle->pos += *len;
+
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	status = switch_file_read(context->fd, data, len);
 	if (status == SWITCH_STATUS_SUCCESS) {
 		handle->pos += *len;
@@ -158,6 +208,10 @@ static switch_status_t native_file_file_write(switch_file_handle_t *handle, void
 {
 	native_file_context *context = handle->private_info;
 
+	if (!context->fd) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	return switch_file_write(context->fd, data, len);
 }
 
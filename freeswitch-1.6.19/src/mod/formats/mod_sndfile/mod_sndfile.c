@@ -31,6 +31,7 @@
  */
 #include <switch.h>
 #include <sndfile.h>
+#include "g711.h"
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_sndfile_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_sndfile_shutdown);
@@ -50,6 +51,8 @@ struct format_map {
 struct sndfile_context {
 	SF_INFO sfinfo;
 	SNDFILE *handle;
+	/* subtype of a headerless file read from a memory mapping, 0 when read through libsndfile */
+	int map_subtype;
 };
 
 typedef struct sndfile_context sndfile_context;
@@ -221,6 +224,17 @@ static switch_status_t sndfile_file_open(switch_file_handle_t *handle, const cha
 		handle->offset_pos = 0;
 	}
 
+	/* headerless mono pcm and g711 are simple enough to read straight from a mapping */
+	if (mode == SFM_READ && switch_test_flag(handle, SWITCH_FILE_DATA_SHORT) && context->sfinfo.channels == 1 &&
+		(context->sfinfo.format & SF_FORMAT_TYPEMASK) == SF_FORMAT_RAW && !(context->sfinfo.format & SF_FORMAT_ENDMASK)) {
+		int subtype = context->sfinfo.format & SF_FORMAT_SUBMASK;
+
+		if ((subtype == SF_FORMAT_PCM_16 || subtype == SF_FORMAT_ULAW || subtype == SF_FORMAT_ALAW) &&
+			switch_core_file_map(handle, path, 0) == SWITCH_STATUS_SUCCESS) {
+			context->map_subtype = subtype;
+		}
+	}
+
 	if (switch_test_flag(handle, SWITCH_FILE_WRITE_APPEND)) {
 		handle->pos = sf_seek(context->handle, frames, SEEK_END);
 	} else if (switch_test_flag(handle, SWITCH_FILE_WRITE_OVER)) {
@@ -285,6 +299,29 @@ static switch_status_t sndfile_file_seek(switch_file_handle_t *handle, unsigned
 		return SWITCH_STATUS_NOTIMPL;
 	}
 
+	if (context->map_subtype) {
+		int width = context->map_subtype == SF_FORMAT_PCM_16 ? 2 : 1;
+		int64_t end = handle->map_len / width, pos = samples;
+
+		if (whence == SEEK_CUR) {
+			pos += handle->map_pos / width;
+		} else if (whence == SEEK_END) {
+			pos += end;
+		}
+
+		if (pos < 0) {
+			pos = 0;
+		} else if (pos > end) {
+			pos = end;
+		}
+
+		handle->map_pos = (switch_size_t) pos * width;
+		*cur_sample = (unsigned int) pos;
+		handle->pos = *cur_sample;
+
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	if ((count = sf_seek(context->handle, samples, whence)) == ((sf_count_t) -1)) {
 		r = SWITCH_STATUS_BREAK;
 		count = sf_seek(context->handle, -1, SEEK_END);
@@ -296,12 +333,49 @@ static switch_status_t sndfile_file_seek(switch_file_handle_t *handle, unsigned
 	return r;
 }
 
+static switch_size_t sndfile_map_read(switch_file_handle_t *handle, sndfile_context *context, int16_t *data, switch_size_t len)
+{
+	const uint8_t *src = handle->map_data + handle->map_pos;
+	switch_size_t left, x;
+
+	if (context->map_subtype == SF_FORMAT_PCM_16) {
+		left = (handle->map_len - handle->map_pos) / 2;
+		if (len > left) {
+			len = left;
+		}
+		memcpy(data, src, len * 2);
+		handle->map_pos += len * 2;
+		return len;
+	}
+
+	left = handle->map_len - handle->map_pos;
+	if (len > left) {
+		len = left;
+	}
+
+	if (context->map_subtype == SF_FORMAT_ULAW) {
+		for (x = 0; x < len; x++) {
+			data[x] = ulaw_to_linear(src[x]);
+		}
+	} else {
+		for (x = 0; x < len; x++) {
+			data[x] = alaw_to_linear(src[x]);
+		}
+	}
+
+	handle->map_pos += len;
+
+	return len;
+}
+
 static switch_status_t sndfile_file_read(switch_file_handle_t *handle, void *data, size_t *len)
 {
 	size_t inlen = *len;
 	sndfile_context *context = handle->private_info;
 
-	if (switch_test_flag(handle, SWITCH_FILE_DATA_RAW)) {
+	if (context->map_subtype) {
+		*len = (size_t) sndfile_map_read(handle, context, (int16_t *) data, inlen);
+	} else if (switch_test_flag(handle, SWITCH_FILE_DATA_RAW)) {
 		*len = (size_t) sf_read_raw(context->handle, data, inlen);
 	} else if (switch_test_flag(handle, SWITCH_FILE_DATA_INT)) {
 		*len = (size_t) sf_readf_int(context->handle, (int *) data, inlen);
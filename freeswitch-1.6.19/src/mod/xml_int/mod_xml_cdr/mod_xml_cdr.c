@@ -35,6 +35,7 @@
 #include <sys/stat.h>
 #include <switch_curl.h>
 #define MAX_URLS 20
+#define XML_CDR_SYNTAX "status"
 
 #define ENCODING_NONE 0
 #define ENCODING_DEFAULT 1
@@ -45,9 +46,7 @@ static struct {
 	char *cred;
 	char *urls[MAX_URLS + 1];
 	int url_count;
-	int url_index;
 	switch_thread_rwlock_t *log_path_lock;
-	switch_mutex_t *url_index_mutex;
 	char *base_log_dir;
 	char *base_err_log_dir;
 	char *log_dir;
@@ -73,21 +72,19 @@ static struct {
 	switch_memory_pool_t *pool;
 	switch_event_node_t *node;
 	char *cookie_file;
+	char *spool_dir;
+	uint32_t spool_max;
+	uint32_t queue_size;
+	uint32_t workers;
+	uint32_t connections;
+	uint32_t batch_size;
+	switch_curl_spool_t *spool;
 } globals;
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_cdr_shutdown);
 SWITCH_MODULE_DEFINITION(mod_xml_cdr, mod_xml_cdr_load, mod_xml_cdr_shutdown, NULL);
 
-/* this function would have access to the HTML returned by the webserver, we don't need it 
- * and the default curl activity is to print to stdout, something not as desirable
- * so we have a dummy function here
- */
-static size_t httpCallBack(char *buffer, size_t size, size_t nitems, void *outstream)
-{
-	return size * nitems;
-}
-
 static switch_status_t set_xml_cdr_log_dirs()
 {
 	switch_time_exp_t tm;
@@ -182,25 +179,100 @@ static switch_status_t set_xml_cdr_log_dirs()
 	return status;
 }
 
+/* called by the spool workers for each post, the url picks the tls options */
+static void xml_cdr_setup_curl(switch_CURL *curl_handle, const char *url, void *user_data)
+{
+	if (!zstr(globals.cred)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
+	}
+
+	if (globals.ssl_cert_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
+	}
+
+	if (globals.ssl_key_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
+	}
+
+	if (globals.ssl_key_password) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
+	}
+
+	if (globals.ssl_version) {
+		if (!strcasecmp(globals.ssl_version, "SSLv3")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
+		} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
+		}
+	}
+
+	if (globals.ssl_cacert_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
+	}
+
+	if (globals.cookie_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEJAR, globals.cookie_file);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEFILE, globals.cookie_file);
+	}
+
+	if (!strncasecmp(url, "https", 5)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
+	}
+
+	if (globals.enable_cacert_check) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
+	}
+
+	if (globals.enable_ssl_verifyhost) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
+	}
+}
+
+/* the spool gave up on a cdr, write it to the error dir */
+static void xml_cdr_post_failed(const char *id, const char *body, switch_size_t len, void *user_data)
+{
+	char *path = NULL;
+	int fd = -1;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to post to web server, writing to file\n");
+
+	switch_thread_rwlock_rdlock(globals.log_path_lock);
+	path = switch_mprintf("%s%s%s.cdr.xml", globals.err_log_dir, SWITCH_PATH_SEPARATOR, id);
+	switch_thread_rwlock_unlock(globals.log_path_lock);
+	if (path) {
+#ifdef _MSC_VER
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
+#else
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) > -1) {
+#endif
+			int wrote;
+			wrote = write(fd, body, (unsigned) len);
+			wrote++;
+			close(fd);
+			fd = -1;
+		} else {
+			char ebuf[512] = { 0 };
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error![%s]\n",
+					switch_strerror_r(errno, ebuf, sizeof(ebuf)));
+		}
+		switch_safe_free(path);
+	}
+}
+
 static switch_status_t my_on_reporting(switch_core_session_t *session)
 {
 	switch_xml_t cdr = NULL;
 	char *xml_text = NULL;
 	char *path = NULL;
-	char *curl_xml_text = NULL;
 	const char *logdir = NULL;
 	char *xml_text_escaped = NULL;
 	int fd = -1;
-	uint32_t cur_try;
-	long httpRes;
-	switch_CURL *curl_handle = NULL;
-	switch_curl_slist_t *headers = NULL;
-	switch_curl_slist_t *slist = NULL;
 	switch_channel_t *channel = switch_core_session_get_channel(session);
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int is_b;
 	const char *a_prefix = "";
-	char url_joiner = '?';
 	int prefix_a;
 	const char *prefix_a_var = NULL;
 
@@ -230,8 +302,8 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 		return SWITCH_STATUS_FALSE;
 	}
 
-	/* build the XML */
-	xml_text = switch_xml_toxml(cdr, SWITCH_TRUE);
+	/* build the XML, batched text/xml posts wrap the cdrs so they go without the prolog */
+	xml_text = switch_xml_toxml(cdr, !(globals.encode == ENCODING_TEXTXML && globals.batch_size > 1));
 	if (!xml_text) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Memory Error!\n");
 		goto error;
@@ -268,193 +340,37 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 		switch_thread_rwlock_unlock(globals.log_path_lock);
 	}
 
-	/* try to post it to the web server */
-	if (globals.url_count) {
-		char *destUrl = NULL;
-		int g_url_index = -1;
-
-		switch_mutex_lock(globals.url_index_mutex);
-		g_url_index = globals.url_index;
-		switch_mutex_unlock(globals.url_index_mutex);
+	/* hand it to the spool, the post happens on its workers */
+	if (globals.spool) {
+		char *id;
 
-		curl_handle = switch_curl_easy_init();
-
-		if (globals.encode == ENCODING_TEXTXML) {
-			headers = switch_curl_slist_append(headers, "Content-Type: text/xml");
-		} else if (globals.encode) {
+		if (globals.encode && globals.encode != ENCODING_TEXTXML) {
 			switch_size_t need_bytes = strlen(xml_text) * 3 + 1;
 
 			xml_text_escaped = malloc(need_bytes);
 			switch_assert(xml_text_escaped);
 			memset(xml_text_escaped, 0, need_bytes);
 			if (globals.encode == ENCODING_DEFAULT) {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
 				switch_url_encode_opt(xml_text, xml_text_escaped, need_bytes, SWITCH_TRUE);
 			} else {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-base64-encoded");
 				switch_b64_encode((unsigned char *) xml_text, need_bytes / 3, (unsigned char *) xml_text_escaped, need_bytes);
 			}
 			switch_safe_free(xml_text);
 			xml_text = xml_text_escaped;
-		} else {
-			headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-plaintext");
 		}
 
-		if (globals.encode == ENCODING_TEXTXML) {
-			curl_xml_text = xml_text;
-		} else if (!(curl_xml_text = switch_mprintf("cdr=%s", xml_text))) {
+		if (!(id = switch_mprintf("%s%s", a_prefix, switch_core_session_get_uuid(session)))) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Memory Error!\n");
 			goto error;
 		}
 
-		if (!zstr(globals.cred)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
-		}
-
-		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, curl_xml_text);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-xml/1.0");
-		switch_curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, httpCallBack);
-
-		if (globals.disable100continue) {
-			slist = switch_curl_slist_append(slist, "Expect:");
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, slist);
-		}
-
-		if (globals.ssl_cert_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
-		}
-
-		if (globals.ssl_key_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
-		}
-
-		if (globals.ssl_key_password) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
-		}
-
-		if (globals.ssl_version) {
-			if (!strcasecmp(globals.ssl_version, "SSLv3")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
-			} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
-			}
-		}
-
-		if (globals.ssl_cacert_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
-		}
-		
-		if (globals.cookie_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEJAR, globals.cookie_file);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEFILE, globals.cookie_file);
-		}
-
-		switch_curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, globals.timeout);
-
-		/* these were used for testing, optionally they may be enabled if someone desires
-		   switch_curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1); // 302 recursion level
-		 */
-
-		for (cur_try = 0; cur_try < globals.retries; cur_try++) {
-			if (cur_try > 0) {
-				switch_yield(globals.delay * 1000000);
-			}
-
-			if( strchr(globals.urls[g_url_index], '?') != NULL ) {
-				url_joiner = '&';
-			}
-			destUrl = switch_mprintf("%s%cuuid=%s%s", globals.urls[g_url_index], url_joiner, a_prefix, switch_core_session_get_uuid(session));
-			switch_curl_easy_setopt(curl_handle, CURLOPT_URL, destUrl);
-
-			if (!strncasecmp(destUrl, "https", 5)) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
-			}
-
-			if (globals.enable_cacert_check) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
-			}
-
-			if (globals.enable_ssl_verifyhost) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
-			}
-
-			/* overrides default 300s timeout, could be usefull if the current web server is down to prevent long time waiting for nothing */
-			/* connection_timeout = retry_timeout  */
-			switch_curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT, !globals.delay ? 5 : (long)globals.delay);
-			switch_curl_easy_perform(curl_handle);
-			switch_curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
-			switch_safe_free(destUrl);
-			if (httpRes >= 200 && httpRes <= 299) {
-				goto success;
-			} else {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Got error [%ld] posting to web server [%s]\n",
-								  httpRes, globals.urls[g_url_index]);
-				g_url_index++;
-				switch_assert(globals.url_count <= MAX_URLS);
-				if (g_url_index >= globals.url_count) {
-					g_url_index = 0;
-				}
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Retry will be with url [%s]\n", globals.urls[g_url_index]);
-				switch_mutex_lock(globals.url_index_mutex);
-				if (globals.url_index != g_url_index) {
-					globals.url_index = g_url_index;
-				}
-				switch_mutex_unlock(globals.url_index_mutex);
-			}
-		}
-		switch_curl_easy_cleanup(curl_handle);
-		switch_curl_slist_free_all(headers);
-		switch_curl_slist_free_all(slist);
-		slist = NULL;
-		headers = NULL;
-		curl_handle = NULL;
-
-		/* if we are here the web post failed for some reason */
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to post to web server, writing to file\n");
-
-		switch_thread_rwlock_rdlock(globals.log_path_lock);
-		path = switch_mprintf("%s%s%s%s.cdr.xml", globals.err_log_dir, SWITCH_PATH_SEPARATOR, a_prefix, switch_core_session_get_uuid(session));
-		switch_thread_rwlock_unlock(globals.log_path_lock);
-		if (path) {
-#ifdef _MSC_VER
-			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
-#else
-			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) > -1) {
-#endif
-				int wrote;
-				wrote = write(fd, xml_text, (unsigned) strlen(xml_text));
-				wrote++;
-				close(fd);
-				fd = -1;
-			} else {
-				char ebuf[512] = { 0 };
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error![%s]\n",
-						switch_strerror_r(errno, ebuf, sizeof(ebuf)));
-			}
-		}
+		switch_curl_spool_submit(globals.spool, id, xml_text);
+		switch_safe_free(id);
 	}
 
-  success:
 	status = SWITCH_STATUS_SUCCESS;
 
   error:
-	if (curl_handle) {
-		switch_curl_easy_cleanup(curl_handle);
-	}
-	if (headers) {
-		switch_curl_slist_free_all(headers);
-	}
-	if (slist) {
-		switch_curl_slist_free_all(slist);
-	}
-	if (curl_xml_text != xml_text) {
-		switch_safe_free(curl_xml_text);
-	}
 	switch_safe_free(xml_text);
 	switch_safe_free(path);
 	switch_xml_free(cdr);
@@ -462,6 +378,23 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 	return status;
 }
 
+SWITCH_STANDARD_API(xml_cdr_function)
+{
+	if (zstr(cmd) || strcasecmp(cmd, "status")) {
+		stream->write_function(stream, "-USAGE: %s\n", XML_CDR_SYNTAX);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!globals.spool) {
+		stream->write_function(stream, "-ERR no urls configured\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_curl_spool_status(globals.spool, stream);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 static void event_handler(switch_event_t *event)
 {
 	const char *sig = switch_event_get_header(event, "Trapped-Signal");
@@ -492,6 +425,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 	char *cf = "xml_cdr.conf";
 	switch_xml_t cfg, xml, settings, param;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_api_interface_t *api_interface;
 
 	/* test global state handlers */
 	switch_core_add_state_handler(&state_handlers);
@@ -513,7 +447,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 	globals.auth_scheme = CURLAUTH_BASIC;
 
 	switch_thread_rwlock_create(&globals.log_path_lock, pool);
-	switch_mutex_init(&globals.url_index_mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	globals.batch_size = 1;
 
 	/* parse the config */
 	if (!(xml = switch_xml_open_cfg(cf, &cfg, NULL))) {
@@ -620,6 +554,23 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 				}
 			} else if (!strcasecmp(var, "cookie-file")) {
 				globals.cookie_file = switch_core_strdup(globals.pool, val);
+			} else if (!strcasecmp(var, "spool-dir") && !zstr(val)) {
+				if (switch_is_file_path(val)) {
+					globals.spool_dir = switch_core_strdup(globals.pool, val);
+				} else {
+					globals.spool_dir = switch_core_sprintf(globals.pool, "%s%s%s", SWITCH_GLOBAL_dirs.log_dir, SWITCH_PATH_SEPARATOR, val);
+				}
+			} else if (!strcasecmp(var, "spool-max") && !zstr(val)) {
+				globals.spool_max = switch_atoui(val);
+			} else if (!strcasecmp(var, "queue-size") && !zstr(val)) {
+				globals.queue_size = switch_atoui(val);
+			} else if (!strcasecmp(var, "workers") && !zstr(val)) {
+				globals.workers = switch_atoui(val);
+			} else if (!strcasecmp(var, "connections") && !zstr(val)) {
+				globals.connections = switch_atoui(val);
+			} else if (!strcasecmp(var, "batch-size") && !zstr(val)) {
+				uint32_t tmp = switch_atoui(val);
+				globals.batch_size = tmp ? tmp : 1;
 			}
 		}
 		
@@ -642,6 +593,53 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 
 	set_xml_cdr_log_dirs();
 
+	if (globals.url_count) {
+		switch_curl_spool_settings_t spool_settings = { 0 };
+
+		spool_settings.name = "xml_cdr";
+		spool_settings.urls = (const char **) globals.urls;
+		spool_settings.url_count = globals.url_count;
+		spool_settings.spool_dir = globals.spool_dir ? globals.spool_dir :
+			switch_core_sprintf(globals.pool, "%s%sspool", globals.base_err_log_dir, SWITCH_PATH_SEPARATOR);
+		spool_settings.spool_max = globals.spool_max;
+		spool_settings.queue_size = globals.queue_size;
+		spool_settings.workers = globals.workers;
+		spool_settings.connections = globals.connections;
+		spool_settings.batch_size = globals.batch_size;
+		spool_settings.retries = globals.retries;
+		spool_settings.delay = globals.delay;
+		spool_settings.timeout = globals.timeout;
+		/* connection_timeout = retry_timeout, no point waiting on a web server that is down */
+		spool_settings.connect_timeout = !globals.delay ? 5 : globals.delay;
+		spool_settings.user_agent = "freeswitch-xml/1.0";
+		spool_settings.disable_expect = globals.disable100continue ? SWITCH_TRUE : SWITCH_FALSE;
+		spool_settings.setup = xml_cdr_setup_curl;
+		spool_settings.fail = xml_cdr_post_failed;
+
+		if (globals.encode == ENCODING_TEXTXML) {
+			spool_settings.content_type = "text/xml";
+			spool_settings.batch_open = "<cdrs>";
+			spool_settings.batch_close = "</cdrs>";
+		} else {
+			if (globals.encode == ENCODING_DEFAULT) {
+				spool_settings.content_type = "application/x-www-form-urlencoded";
+			} else if (globals.encode == ENCODING_BASE64) {
+				spool_settings.content_type = "application/x-www-form-base64-encoded";
+			} else {
+				spool_settings.content_type = "application/x-www-form-plaintext";
+			}
+			spool_settings.record_prefix = "cdr=";
+			spool_settings.batch_separator = "&";
+		}
+
+		if (switch_curl_spool_create(&globals.spool, &spool_settings, globals.pool) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to start the cdr spool\n");
+		}
+	}
+
+	SWITCH_ADD_API(api_interface, "xml_cdr", "XML CDR delivery", xml_cdr_function, XML_CDR_SYNTAX);
+	switch_console_set_complete("add xml_cdr status");
+
 	switch_xml_free(xml);
 
 	return status;
@@ -652,12 +650,16 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_cdr_shutdown)
 
 	globals.shutdown = 1;
 
-	switch_safe_free(globals.log_dir);
-	switch_safe_free(globals.err_log_dir);
-
+	switch_console_set_complete("del xml_cdr");
 	switch_event_unbind(&globals.node);
 	switch_core_remove_state_handler(&state_handlers);
 
+	/* what is left goes to the spool dir, failures still need the error dir */
+	switch_curl_spool_destroy(&globals.spool);
+
+	switch_safe_free(globals.log_dir);
+	switch_safe_free(globals.err_log_dir);
+
 	switch_thread_rwlock_destroy(globals.log_path_lock);
 
 	return SWITCH_STATUS_SUCCESS;
@@ -61,6 +61,7 @@
 
 /* apr_vformatter_buff_t definition*/
 #include <apr_lib.h>
+#include <apr_mmap.h>
 
 /* apr-util headers */
 #include <apr_queue.h>
@@ -477,6 +478,31 @@ SWITCH_DECLARE(switch_size_t) switch_file_get_size(switch_file_t *thefile)
 	return apr_file_info_get(&finfo, APR_FINFO_SIZE, thefile) == SWITCH_STATUS_SUCCESS ? (switch_size_t) finfo.size : 0;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_mmap_create(switch_mmap_t **newmmap, const void **data, switch_file_t *file, int64_t offset, switch_size_t size,
+												   switch_memory_pool_t *pool)
+{
+#if APR_HAS_MMAP
+	switch_status_t status;
+
+	if ((status = apr_mmap_create(newmmap, file, (apr_off_t) offset, size, APR_MMAP_READ, pool)) == SWITCH_STATUS_SUCCESS) {
+		*data = (*newmmap)->mm;
+	}
+
+	return status;
+#else
+	return SWITCH_STATUS_NOTIMPL;
+#endif
+}
+
+SWITCH_DECLARE(switch_status_t) switch_mmap_delete(switch_mmap_t *mm)
+{
+#if APR_HAS_MMAP
+	return apr_mmap_delete(mm);
+#else
+	return SWITCH_STATUS_NOTIMPL;
+#endif
+}
+
 SWITCH_DECLARE(switch_status_t) switch_directory_exists(const char *dirname, switch_memory_pool_t *pool)
 {
 	apr_dir_t *dir_handle;
@@ -526,6 +552,20 @@ SWITCH_DECLARE(switch_status_t) switch_file_exists(const char *filename, switch_
 	return status;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_file_stat(const char *filename, switch_time_t *mtime, switch_size_t *size, switch_memory_pool_t *pool)
+{
+	apr_finfo_t info = { 0 };
+
+	if (zstr(filename) || apr_stat(&info, filename, APR_FINFO_MTIME | APR_FINFO_SIZE | APR_FINFO_TYPE, pool) != APR_SUCCESS || info.filetype != APR_REG) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*mtime = (switch_time_t) info.mtime;
+	*size = (switch_size_t) info.size;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_dir_make(const char *path, switch_fileperms_t perm, switch_memory_pool_t *pool)
 {
 	return apr_dir_make(path, perm, pool);
@@ -767,6 +807,66 @@ SWITCH_DECLARE(switch_status_t) switch_socket_send(switch_socket_t *sock, const
 	return (switch_status_t)status;
 }
 
+#define SWITCH_SOCKET_SENDV_MAX 64
+
+SWITCH_DECLARE(switch_status_t) switch_socket_sendv(switch_socket_t *sock, const switch_io_vec_t *vec, int32_t nvec, switch_size_t *len)
+{
+	struct iovec iov[SWITCH_SOCKET_SENDV_MAX];
+	int status = SWITCH_STATUS_SUCCESS;
+	switch_size_t wrote = 0;
+	int32_t x = 0, first = 0, n = 0;
+	int to_count = 0;
+
+	while (status == SWITCH_STATUS_SUCCESS || status == SWITCH_STATUS_BREAK || status == 730035 || status == 35) {
+		apr_size_t sent = 0;
+
+		if (first == n) {
+			first = n = 0;
+
+			for (; x < nvec && n < SWITCH_SOCKET_SENDV_MAX; x++) {
+				if (vec[x].len) {
+					iov[n].iov_base = (void *) vec[x].base;
+					iov[n].iov_len = vec[x].len;
+					n++;
+				}
+			}
+
+			if (!n) {
+				status = SWITCH_STATUS_SUCCESS;
+				break;
+			}
+		}
+
+		status = apr_socket_sendv(sock, iov + first, n - first, &sent);
+
+		if (status == SWITCH_STATUS_BREAK || status == 730035 || status == 35) {
+			if (++to_count > 60000) {
+				status = SWITCH_STATUS_FALSE;
+				break;
+			}
+			switch_yield(10000);
+		} else {
+			to_count = 0;
+		}
+
+		wrote += sent;
+
+		while (sent && first < n) {
+			if (sent >= iov[first].iov_len) {
+				sent -= iov[first].iov_len;
+				first++;
+			} else {
+				iov[first].iov_base = (char *) iov[first].iov_base + sent;
+				iov[first].iov_len -= sent;
+				sent = 0;
+			}
+		}
+	}
+
+	*len = wrote;
+	return (switch_status_t)status;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_socket_send_nonblock(switch_socket_t *sock, const char *buf, switch_size_t *len)
 {
 	if (!sock || !buf || !len) {
@@ -1342,6 +1442,20 @@ SWITCH_DECLARE(int) switch_atomic_dec(volatile switch_atomic_t *mem)
 #endif
 }
 
+SWITCH_DECLARE(uint32_t) switch_atomic_cas(volatile switch_atomic_t *mem, uint32_t with, uint32_t cmp)
+{
+#ifdef apr_atomic_t
+	return apr_atomic_cas((apr_atomic_t *)mem, with, cmp);
+#else
+	return apr_atomic_cas32((apr_uint32_t *)mem, with, cmp);
+#endif
+}
+
+SWITCH_DECLARE(void *) switch_atomic_casptr(volatile void **mem, void *with, const void *cmp)
+{
+	return apr_atomic_casptr(mem, with, cmp);
+}
+
 SWITCH_DECLARE(char *) switch_strerror(switch_status_t statcode, char *buf, switch_size_t bufsize)
 {
 	return apr_strerror(statcode, buf, bufsize);
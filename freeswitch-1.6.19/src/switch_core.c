@@ -1826,6 +1826,11 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 
 	runtime.max_db_handles = 50;
 	runtime.db_handle_timeout = 5000000;
+	runtime.prompt_cache_max_file_size = 2 * 1048576;
+	runtime.record_writer_threads = 4;
+	runtime.file_open_threads = 4;
+	runtime.file_open_timeout = SWITCH_DEFAULT_FILE_OPEN_TIMEOUT;
+	runtime.record_ring_size = 65536;
 	runtime.event_heartbeat_interval = 20;
 	runtime.runlevel++;
 	runtime.dummy_cng_frame.data = runtime.dummy_data;
@@ -1904,6 +1909,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_thread_rwlock_create(&runtime.global_var_rwlock, runtime.memory_pool);
 	switch_core_set_globals();
 	switch_core_session_init(runtime.memory_pool);
+	switch_core_file_cache_init(runtime.memory_pool);
 	switch_event_create_plain(&runtime.global_vars, SWITCH_EVENT_CHANNEL_DATA);
 	switch_core_hash_init_case(&runtime.mime_types, SWITCH_FALSE);
 	switch_core_hash_init_case(&runtime.mime_type_exts, SWITCH_FALSE);
@@ -1957,6 +1963,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_console_init(runtime.memory_pool);
 	switch_event_init(runtime.memory_pool);
 	switch_channel_global_init(runtime.memory_pool);
+	switch_limit_init(runtime.memory_pool);
 
 	if (switch_xml_init(runtime.memory_pool, err) != SWITCH_STATUS_SUCCESS) {
 		apr_terminate();
@@ -1978,6 +1985,9 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_load_core_config("switch.conf");
 
 	switch_core_state_machine_init(runtime.memory_pool);
+	switch_core_video_init(runtime.memory_pool);
+	switch_ivr_record_writer_init(runtime.memory_pool);
+	switch_core_file_io_init(runtime.memory_pool);
 
 	if (switch_core_sqldb_start(runtime.memory_pool, switch_test_flag((&runtime), SCF_USE_SQL) ? SWITCH_TRUE : SWITCH_FALSE) != SWITCH_STATUS_SUCCESS) {
 		*err = "Error activating database";
@@ -2147,6 +2157,60 @@ static void switch_load_core_config(const char *file)
 					} else {
 						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "heartbeat-interval must be a greater than 0\n");
 					}
+				} else if (!strcasecmp(var, "prompt-cache-size") || !strcasecmp(var, "prompt-cache-max-file-size")) {
+					switch_size_t tmp = (switch_size_t) atol(val);
+
+					if (strrchr(val, 'k')) {
+						tmp *= 1024;
+					} else if (strrchr(val, 'm')) {
+						tmp *= 1048576;
+					}
+
+					if (!strcasecmp(var, "prompt-cache-size")) {
+						runtime.prompt_cache_size = tmp;
+					} else {
+						runtime.prompt_cache_max_file_size = tmp;
+					}
+				} else if (!strcasecmp(var, "prompt-prefetch-depth")) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0) {
+						runtime.prompt_prefetch_depth = (uint32_t) tmp;
+					}
+				} else if (!strcasecmp(var, "file-open-threads")) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0) {
+						runtime.file_open_threads = (uint32_t) tmp;
+					}
+				} else if (!strcasecmp(var, "file-open-timeout")) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0) {
+						runtime.file_open_timeout = (uint32_t) tmp;
+					}
+				} else if (!strcasecmp(var, "map-audio-files")) {
+					runtime.map_audio_files = switch_true(val);
+				} else if (!strcasecmp(var, "record-writer-threads")) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0) {
+						runtime.record_writer_threads = (uint32_t) tmp;
+					}
+				} else if (!strcasecmp(var, "record-ring-size")) {
+					uint32_t tmp = (uint32_t) atol(val), size = 16384;
+
+					if (strrchr(val, 'k')) {
+						tmp *= 1024;
+					} else if (strrchr(val, 'm')) {
+						tmp *= 1048576;
+					}
+
+					while (size < tmp && size < 0x40000000) {
+						size <<= 1;
+					}
+
+					runtime.record_ring_size = size;
 				} else if (!strcasecmp(var, "multiple-registrations")) {
 					runtime.multiple_registrations = switch_true(val);
 				} else if (!strcasecmp(var, "auto-create-schemas")) {
@@ -2929,9 +2993,11 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "End existing sessions\n");
 	switch_core_session_hupall(SWITCH_CAUSE_SYSTEM_SHUTDOWN);
+	switch_core_file_io_shutdown();
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Clean up modules.\n");
 
 	switch_loadable_module_shutdown();
+	switch_ivr_record_writer_shutdown();
 
 	switch_ssl_destroy_ssl_locks();
 
@@ -2956,6 +3022,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_log_shutdown();
 
 	switch_core_session_uninit();
+	switch_core_file_cache_uninit();
 	switch_core_unset_variables();
 	switch_core_memory_stop();
 
@@ -2997,6 +3064,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	}
 
 	switch_core_media_deinit();
+	switch_core_video_deinit();
 
 	if (runtime.memory_pool) {
 		apr_pool_destroy(runtime.memory_pool);
@@ -600,6 +600,67 @@ SWITCH_DECLARE(switch_status_t) switch_core_codec_parse_fmtp(const char *codec_n
 	return status;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_core_codec_parse_video_encoder_params(const char *params, switch_codec_settings_t *codec_settings)
+{
+	char *dup, *argv[16] = { 0 };
+	int argc, i;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_codec_settings_t settings;
+
+	if (zstr(params) || !codec_settings) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* a profile is taken whole or not at all */
+	settings = *codec_settings;
+	dup = strdup(params);
+	argc = switch_separate_string(dup, ';', argv, (sizeof(argv) / sizeof(argv[0])));
+
+	for (i = 0; i < argc; i++) {
+		char *var = argv[i], *val;
+
+		if (!(val = strchr(var, '='))) {
+			status = SWITCH_STATUS_FALSE;
+			continue;
+		}
+
+		*val++ = '\0';
+
+		if (!strcasecmp(var, "row-mt")) {
+			settings.video.row_mt = switch_true(val) ? 1 : -1;
+		} else if (!strcasecmp(var, "deadline") && !strcasecmp(val, "realtime")) {
+			settings.video.deadline = 1;
+		} else if (!strcasecmp(var, "deadline") && !strcasecmp(val, "good")) {
+			settings.video.deadline = 1000000;
+		} else if (zstr(val) || !switch_is_number(val)) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Invalid value for video encoder param [%s=%s]\n", var, val);
+			status = SWITCH_STATUS_FALSE;
+		} else if (!strcasecmp(var, "threads")) {
+			settings.video.threads = atoi(val);
+		} else if (!strcasecmp(var, "cpu-used")) {
+			settings.video.cpu_used = atoi(val);
+			settings.video.cpu_used_set = 1;
+		} else if (!strcasecmp(var, "token-partitions")) {
+			settings.video.token_partitions = atoi(val);
+		} else if (!strcasecmp(var, "tile-columns")) {
+			settings.video.tile_columns = atoi(val);
+		} else if (!strcasecmp(var, "deadline")) {
+			settings.video.deadline = atoi(val);
+		} else {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unknown video encoder param [%s]\n", var);
+			status = SWITCH_STATUS_FALSE;
+		}
+	}
+
+	free(dup);
+
+	if (status == SWITCH_STATUS_SUCCESS) {
+		*codec_settings = settings;
+	}
+
+	return status;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_codec_reset(switch_codec_t *codec)
 {
 	switch_assert(codec != NULL);
@@ -36,6 +36,841 @@
 #include <switch.h>
 #include "private/switch_core_pvt.h"
 
+/* Decoded prompts, shared read only by every handle playing them at the same rate and channel count */
+typedef struct prompt_cache_entry_s {
+	char *key;
+	switch_time_t mtime;
+	switch_size_t fsize;
+	uint32_t rate;
+	uint32_t channels;
+	/* NULL when the prompt was too long or not PCM, so it is not decoded again just to find out */
+	int16_t *data;
+	switch_size_t samples;
+	switch_size_t bytes;
+	int refs;
+	int linked;
+	struct prompt_cache_entry_s *prev;
+	struct prompt_cache_entry_s *next;
+} prompt_cache_entry_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	/* least recently used at the tail */
+	prompt_cache_entry_t *head;
+	prompt_cache_entry_t *tail;
+	switch_size_t bytes;
+	uint32_t entries;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t expired;
+	uint64_t uncacheable;
+} prompt_cache;
+
+/* Files being opened ahead of their turn, keyed like the prompt cache so a prompt is fetched once at a time */
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	switch_bool_t running;
+	uint32_t jobs;
+	uint64_t started;
+	uint64_t dropped;
+} prefetch;
+
+#define PREFETCH_MAX_JOBS 64
+
+typedef struct {
+	char *key;
+	char *path;
+	uint32_t channels;
+	uint32_t rate;
+} prefetch_job_t;
+
+#define FILE_IO_MAX_THREADS 64
+#define FILE_IO_QUEUE_LEN 1024
+
+typedef enum {
+	FILE_OPEN_JOB_IDLE,
+	FILE_OPEN_JOB_RUNNING,
+	FILE_OPEN_JOB_DONE
+} file_open_job_state_t;
+
+/* A handle opened on the file I/O threads, owned by the job so a caller that gives up on it can just walk away */
+struct switch_file_open_job {
+	switch_file_handle_t fh;
+	/* copies of what fh points to, the caller's may be gone before the open is */
+	switch_codec_implementation_t native_impl;
+	char *prefix;
+	char *file_path;
+	uint32_t channels;
+	uint32_t rate;
+	unsigned int flags;
+	switch_status_t status;
+	file_open_job_state_t state;
+	int abandoned;
+};
+
+static struct {
+	/* guards the state of every job, signalled whenever one is done */
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	switch_queue_t *queue;
+	switch_thread_t *threads[FILE_IO_MAX_THREADS];
+	uint32_t thread_count;
+	/* jobs queued or being opened */
+	uint32_t pending;
+	uint64_t opened;
+	uint64_t inline_opens;
+	uint64_t rejected;
+	uint64_t abandoned;
+} file_io;
+
+static void prompt_cache_free(prompt_cache_entry_t *entry)
+{
+	switch_safe_free(entry->data);
+	free(entry->key);
+	free(entry);
+}
+
+/* caller holds the cache mutex */
+static void prompt_cache_unlink(prompt_cache_entry_t *entry)
+{
+	if (!entry->linked) {
+		return;
+	}
+
+	switch_core_hash_delete(prompt_cache.hash, entry->key);
+
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		prompt_cache.head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		prompt_cache.tail = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+	entry->linked = 0;
+	prompt_cache.bytes -= entry->bytes;
+	prompt_cache.entries--;
+
+	/* handles still playing it free it on close */
+	if (!entry->refs) {
+		prompt_cache_free(entry);
+	}
+}
+
+/* caller holds the cache mutex */
+static void prompt_cache_push(prompt_cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = prompt_cache.head;
+
+	if (prompt_cache.head) {
+		prompt_cache.head->prev = entry;
+	} else {
+		prompt_cache.tail = entry;
+	}
+
+	prompt_cache.head = entry;
+}
+
+static void prompt_cache_release(prompt_cache_entry_t *entry)
+{
+	switch_mutex_lock(prompt_cache.mutex);
+	if (!--entry->refs && !entry->linked) {
+		prompt_cache_free(entry);
+	}
+	switch_mutex_unlock(prompt_cache.mutex);
+}
+
+/* Decode the whole prompt at the rate and channel count it is played at.
+ * file_path is the path as the caller gave it, so {modname=...} and other params reach the nested open. */
+static prompt_cache_entry_t *prompt_cache_decode(const char *file_path, uint32_t channels, uint32_t rate, unsigned int flags)
+{
+	switch_file_handle_t fh = { 0 };
+	prompt_cache_entry_t *entry;
+	switch_size_t max = runtime.prompt_cache_max_file_size, alloced = 0;
+	int16_t buf[SWITCH_RECOMMENDED_BUFFER_SIZE / 2];
+	switch_size_t len, chunk = sizeof(buf) / 2 / channels;
+
+	if (max > runtime.prompt_cache_size) {
+		max = runtime.prompt_cache_size;
+	}
+
+	if (switch_core_file_open(&fh, file_path, channels, rate, flags | SWITCH_FILE_NOCACHE, NULL) != SWITCH_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->rate = rate;
+	entry->channels = channels;
+
+	/* native formats hand back encoded frames, keep the entry without data so the file is not tried again */
+	if (switch_test_flag(&fh, SWITCH_FILE_NATIVE)) {
+		switch_core_file_close(&fh);
+		return entry;
+	}
+
+	for (;;) {
+		len = chunk;
+
+		if (switch_core_file_read(&fh, buf, &len) != SWITCH_STATUS_SUCCESS || !len) {
+			break;
+		}
+
+		if ((entry->samples + len) * 2 * channels > max) {
+			switch_safe_free(entry->data);
+			entry->samples = 0;
+			break;
+		}
+
+		if ((entry->samples + len) * 2 * channels > alloced) {
+			void *mem;
+
+			alloced = alloced ? alloced * 2 : 65536;
+			if (alloced > max) {
+				alloced = max;
+			}
+
+			mem = realloc(entry->data, alloced);
+			switch_assert(mem);
+			entry->data = mem;
+		}
+
+		memcpy(entry->data + entry->samples * channels, buf, len * 2 * channels);
+		entry->samples += len;
+	}
+
+	switch_core_file_close(&fh);
+
+	if (entry->data && !entry->samples) {
+		switch_safe_free(entry->data);
+	}
+
+	return entry;
+}
+
+/* Serve fh from the cache, decoding the prompt first if nobody has yet */
+static switch_bool_t prompt_cache_open(switch_file_handle_t *fh, const char *file_path, uint32_t channels, uint32_t rate, unsigned int flags)
+{
+	prompt_cache_entry_t *entry, *found;
+	switch_time_t mtime;
+	switch_size_t fsize;
+	char *key;
+
+	if (switch_file_stat(fh->file_path, &mtime, &fsize, fh->memory_pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_FALSE;
+	}
+
+	key = switch_core_sprintf(fh->memory_pool, "%s|%u|%u", file_path, rate, channels);
+
+	switch_mutex_lock(prompt_cache.mutex);
+	if ((entry = switch_core_hash_find(prompt_cache.hash, key))) {
+		if (entry->mtime != mtime || entry->fsize != fsize) {
+			prompt_cache.expired++;
+			prompt_cache_unlink(entry);
+			entry = NULL;
+		}
+	}
+
+	if (entry) {
+		if (!entry->data) {
+			switch_mutex_unlock(prompt_cache.mutex);
+			return SWITCH_FALSE;
+		}
+
+		prompt_cache.hits++;
+		entry->refs++;
+
+		if (entry != prompt_cache.head) {
+			entry->prev->next = entry->next;
+			if (entry->next) {
+				entry->next->prev = entry->prev;
+			} else {
+				prompt_cache.tail = entry->prev;
+			}
+			prompt_cache_push(entry);
+		}
+	} else {
+		prompt_cache.misses++;
+	}
+	switch_mutex_unlock(prompt_cache.mutex);
+
+	if (!entry) {
+		if (!(entry = prompt_cache_decode(file_path, channels, rate, flags))) {
+			return SWITCH_FALSE;
+		}
+
+		entry->key = strdup(key);
+		entry->mtime = mtime;
+		entry->fsize = fsize;
+		entry->bytes = sizeof(*entry) + strlen(key) + entry->samples * 2 * channels;
+
+		switch_mutex_lock(prompt_cache.mutex);
+		if ((found = switch_core_hash_find(prompt_cache.hash, key)) && found->mtime == mtime && found->fsize == fsize) {
+			/* decoded by someone else meanwhile */
+			prompt_cache_free(entry);
+			entry = found;
+		} else {
+			if (found) {
+				prompt_cache_unlink(found);
+			}
+
+			if (!entry->data) {
+				prompt_cache.uncacheable++;
+			}
+
+			switch_core_hash_insert(prompt_cache.hash, entry->key, entry);
+			entry->linked = 1;
+			prompt_cache.bytes += entry->bytes;
+			prompt_cache.entries++;
+			prompt_cache_push(entry);
+
+			while (prompt_cache.bytes > runtime.prompt_cache_size && prompt_cache.tail && prompt_cache.tail != entry) {
+				prompt_cache.evictions++;
+				prompt_cache_unlink(prompt_cache.tail);
+			}
+		}
+
+		if (!entry->data) {
+			switch_mutex_unlock(prompt_cache.mutex);
+			return SWITCH_FALSE;
+		}
+
+		entry->refs++;
+		switch_mutex_unlock(prompt_cache.mutex);
+	}
+
+	fh->prompt_cache = entry;
+	fh->prompt_cache_pos = 0;
+	fh->samplerate = fh->native_rate = entry->rate;
+	fh->channels = fh->real_channels = entry->channels;
+	fh->sample_count = entry->samples;
+	fh->seekable = 1;
+
+	return SWITCH_TRUE;
+}
+
+static switch_status_t prompt_cache_read(switch_file_handle_t *fh, void *data, switch_size_t *len)
+{
+	prompt_cache_entry_t *entry = (prompt_cache_entry_t *) fh->prompt_cache;
+	switch_size_t left = entry->samples - fh->prompt_cache_pos;
+
+	if (fh->max_samples > 0 && fh->samples_in + left > (switch_size_t)fh->max_samples) {
+		left = fh->samples_in < (switch_size_t)fh->max_samples ? fh->max_samples - fh->samples_in : 0;
+	}
+
+	if (*len > left) {
+		*len = left;
+	}
+
+	if (!*len) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	memcpy(data, entry->data + fh->prompt_cache_pos * entry->channels, *len * 2 * entry->channels);
+	fh->prompt_cache_pos += *len;
+	fh->samples_in += *len;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void prompt_cache_seek(switch_file_handle_t *fh, unsigned int *cur_pos, int64_t samples, int whence)
+{
+	prompt_cache_entry_t *entry = (prompt_cache_entry_t *) fh->prompt_cache;
+	int64_t pos = samples;
+
+	if (whence == SEEK_CUR) {
+		pos += fh->prompt_cache_pos;
+	} else if (whence == SEEK_END) {
+		pos += entry->samples;
+	}
+
+	if (pos < 0) {
+		pos = 0;
+	} else if (pos > (int64_t) entry->samples) {
+		pos = entry->samples;
+	}
+
+	fh->prompt_cache_pos = (switch_size_t) pos;
+	*cur_pos = (unsigned int) pos;
+}
+
+static void *SWITCH_THREAD_FUNC prefetch_thread(switch_thread_t *thread, void *obj)
+{
+	prefetch_job_t *job = (prefetch_job_t *) obj;
+	switch_file_handle_t fh = { 0 };
+
+	if (!runtime.prompt_cache_size && !strstr(job->path, SWITCH_URL_SEPARATOR)) {
+		/* nothing to decode into, reading the file gets it off the disk for the open that follows */
+		const char *path = job->path;
+		switch_memory_pool_t *pool = NULL;
+		switch_file_t *fd = NULL;
+		char buf[SWITCH_RECOMMENDED_BUFFER_SIZE];
+		switch_size_t len, total = 0;
+
+		while (*path == '{' && (path = switch_find_end_paren(path, '{', '}'))) {
+			path++;
+			while (*path == ' ') path++;
+		}
+
+		switch_core_new_memory_pool(&pool);
+
+		if (path && switch_file_open(&fd, path, SWITCH_FOPEN_READ | SWITCH_FOPEN_BINARY, SWITCH_FPROT_OS_DEFAULT, pool) == SWITCH_STATUS_SUCCESS) {
+			do {
+				len = sizeof(buf);
+				if (switch_file_read(fd, buf, &len) != SWITCH_STATUS_SUCCESS) {
+					break;
+				}
+				total += len;
+			} while (len && total < runtime.prompt_cache_max_file_size);
+
+			switch_file_close(fd);
+		} else {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Prefetch of %s failed\n", job->path);
+		}
+
+		switch_core_destroy_memory_pool(&pool);
+	} else if (switch_core_file_open(&fh, job->path, job->channels, job->rate, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL) == SWITCH_STATUS_SUCCESS) {
+		/* opening fills the prompt cache or the stream module's own cache */
+		switch_core_file_close(&fh);
+	} else {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Prefetch of %s failed\n", job->path);
+	}
+
+	switch_mutex_lock(prefetch.mutex);
+	switch_core_hash_delete(prefetch.hash, job->key);
+	prefetch.jobs--;
+	switch_mutex_unlock(prefetch.mutex);
+
+	free(job);
+
+	return NULL;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_file_prefetch(const char *file, uint32_t channels, uint32_t rate)
+{
+	prefetch_job_t *job;
+	switch_thread_data_t *td;
+	switch_size_t klen, plen;
+
+	if (zstr(file) || !channels || !rate || !prefetch.mutex) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* tones, silence and live streams are generated on the spot, only files and downloads are slow to open */
+	if (strstr(file, SWITCH_URL_SEPARATOR) && strncasecmp(file, "http://", 7) && strncasecmp(file, "https://", 8) &&
+		strncasecmp(file, "http_cache://", 13)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	plen = strlen(file) + 1;
+	klen = plen + 24;
+
+	/* one allocation for the job, its key and its path */
+	switch_zmalloc(job, sizeof(*job) + klen + plen);
+	job->key = (char *) (job + 1);
+	job->path = job->key + klen;
+	switch_snprintf(job->key, klen, "%s|%u|%u", file, rate, channels);
+	memcpy(job->path, file, plen);
+	job->channels = channels;
+	job->rate = rate;
+
+	switch_mutex_lock(prefetch.mutex);
+	if (!prefetch.running || prefetch.jobs >= PREFETCH_MAX_JOBS || switch_core_hash_find(prefetch.hash, job->key)) {
+		if (prefetch.jobs >= PREFETCH_MAX_JOBS) {
+			prefetch.dropped++;
+		}
+		switch_mutex_unlock(prefetch.mutex);
+		free(job);
+		return SWITCH_STATUS_FALSE;
+	}
+	switch_core_hash_insert(prefetch.hash, job->key, job);
+	prefetch.jobs++;
+	prefetch.started++;
+	switch_mutex_unlock(prefetch.mutex);
+
+	switch_zmalloc(td, sizeof(*td));
+	td->func = prefetch_thread;
+	td->obj = job;
+	td->alloc = 1;
+
+	if (switch_thread_pool_launch_thread(&td) != SWITCH_STATUS_SUCCESS) {
+		switch_mutex_lock(prefetch.mutex);
+		switch_core_hash_delete(prefetch.hash, job->key);
+		prefetch.jobs--;
+		switch_mutex_unlock(prefetch.mutex);
+		free(job);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(uint32_t) switch_core_file_prefetch_depth(void)
+{
+	return runtime.prompt_prefetch_depth;
+}
+
+static void file_open_job_free(switch_file_open_job_t *job)
+{
+	char *remove = NULL;
+
+	if (switch_test_flag((&job->fh), SWITCH_FILE_OPEN)) {
+		/* nothing is ever going to be written to a recording its caller gave up on, do not leave it behind empty */
+		if (job->abandoned && (job->flags & SWITCH_FILE_FLAG_WRITE) && !(job->flags & SWITCH_FILE_WRITE_APPEND) && !job->fh.stream_name) {
+			remove = strdup(job->fh.file_path);
+		}
+
+		switch_core_file_close(&job->fh);
+	}
+
+	if (remove) {
+		switch_file_remove(remove, NULL);
+		free(remove);
+	}
+
+	switch_safe_free(job->prefix);
+	switch_safe_free(job->file_path);
+	free(job);
+}
+
+static void file_open_job_run(switch_file_open_job_t *job)
+{
+	switch_status_t status;
+	int abandoned;
+
+	switch_mutex_lock(file_io.mutex);
+	abandoned = job->abandoned;
+	switch_mutex_unlock(file_io.mutex);
+
+	/* given up on while still queued */
+	if (abandoned) {
+		file_open_job_free(job);
+		return;
+	}
+
+	status = switch_core_file_open(&job->fh, job->file_path, job->channels, job->rate, job->flags, NULL);
+
+	switch_mutex_lock(file_io.mutex);
+	job->status = status;
+	job->state = FILE_OPEN_JOB_DONE;
+	abandoned = job->abandoned;
+	file_io.opened++;
+	switch_thread_cond_broadcast(file_io.cond);
+	switch_mutex_unlock(file_io.mutex);
+
+	if (abandoned) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Open of %s finished after its caller gave up on it\n", job->file_path);
+		file_open_job_free(job);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC file_io_thread(switch_thread_t *thread, void *obj)
+{
+	void *pop;
+
+	while (switch_queue_pop(file_io.queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		file_open_job_run((switch_file_open_job_t *) pop);
+
+		switch_mutex_lock(file_io.mutex);
+		file_io.pending--;
+		switch_mutex_unlock(file_io.mutex);
+	}
+
+	return NULL;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_file_open_job_create(switch_file_open_job_t **jobp, const switch_file_handle_t *settings)
+{
+	switch_file_open_job_t *job;
+
+	switch_assert(jobp);
+
+	if (settings && switch_test_flag(settings, SWITCH_FILE_OPEN)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Handle already open\n");
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_zmalloc(job, sizeof(*job));
+
+	if (settings) {
+		job->fh = *settings;
+	}
+
+	*jobp = job;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_file_handle_t *) switch_core_file_open_job_handle(switch_file_open_job_t *job)
+{
+	return &job->fh;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_file_open_job_start(switch_file_open_job_t *job, const char *file_path, uint32_t channels, uint32_t rate,
+																unsigned int flags)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if (job->state == FILE_OPEN_JOB_RUNNING || switch_test_flag((&job->fh), SWITCH_FILE_OPEN)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Open of %s already started\n", file_path);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_safe_free(job->file_path);
+	job->file_path = strdup(file_path);
+	job->channels = channels;
+	job->rate = rate;
+	job->flags = flags;
+
+	if (job->fh.native_impl && job->fh.native_impl != &job->native_impl) {
+		job->native_impl = *job->fh.native_impl;
+		job->fh.native_impl = &job->native_impl;
+	}
+
+	if (job->fh.prefix && job->fh.prefix != job->prefix) {
+		switch_safe_free(job->prefix);
+		job->prefix = strdup(job->fh.prefix);
+		job->fh.prefix = job->prefix;
+	}
+
+	/* queue it even when every thread is busy, the caller keeps its media going while it waits */
+	switch_mutex_lock(file_io.mutex);
+	if (file_io.thread_count) {
+		if ((status = switch_queue_trypush(file_io.queue, job)) == SWITCH_STATUS_SUCCESS) {
+			job->state = FILE_OPEN_JOB_RUNNING;
+			file_io.pending++;
+		} else {
+			file_io.rejected++;
+		}
+		switch_mutex_unlock(file_io.mutex);
+
+		if (status != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Too many files waiting to be opened, not opening %s\n", file_path);
+		}
+
+		return status;
+	}
+
+	/* no threads, open it right here like a plain open */
+	job->state = FILE_OPEN_JOB_RUNNING;
+	file_io.inline_opens++;
+	switch_mutex_unlock(file_io.mutex);
+
+	file_open_job_run(job);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_file_open_job_wait(switch_file_open_job_t *job, uint32_t ms)
+{
+	switch_time_t done = switch_micro_time_now() + ms * 1000;
+	switch_status_t status;
+
+	switch_mutex_lock(file_io.mutex);
+	while (job->state == FILE_OPEN_JOB_RUNNING && ms) {
+		switch_time_t now = switch_micro_time_now();
+
+		if (now >= done) {
+			break;
+		}
+
+		switch_thread_cond_timedwait(file_io.cond, file_io.mutex, done - now);
+	}
+
+	if (job->state == FILE_OPEN_JOB_RUNNING) {
+		status = SWITCH_STATUS_TIMEOUT;
+	} else if (job->state == FILE_OPEN_JOB_DONE) {
+		status = job->status;
+	} else {
+		status = SWITCH_STATUS_FALSE;
+	}
+	switch_mutex_unlock(file_io.mutex);
+
+	return status;
+}
+
+SWITCH_DECLARE(void) switch_core_file_open_job_destroy(switch_file_open_job_t **jobp)
+{
+	switch_file_open_job_t *job;
+
+	switch_assert(jobp);
+
+	if (!(job = *jobp)) {
+		return;
+	}
+
+	*jobp = NULL;
+
+	switch_mutex_lock(file_io.mutex);
+	if (job->state == FILE_OPEN_JOB_RUNNING) {
+		/* the I/O thread closes and frees it once the open returns */
+		job->abandoned = 1;
+		file_io.abandoned++;
+		switch_mutex_unlock(file_io.mutex);
+		return;
+	}
+	switch_mutex_unlock(file_io.mutex);
+
+	file_open_job_free(job);
+}
+
+SWITCH_DECLARE(uint32_t) switch_core_file_open_timeout(void)
+{
+	return runtime.file_open_timeout;
+}
+
+SWITCH_DECLARE(void) switch_core_file_io_status(switch_stream_handle_t *stream)
+{
+	switch_mutex_lock(file_io.mutex);
+	stream->write_function(stream, "Threads     \t%u\n", file_io.thread_count);
+	stream->write_function(stream, "Pending     \t%u\n", file_io.pending);
+	stream->write_function(stream, "Opened      \t%" SWITCH_UINT64_T_FMT "\n", file_io.opened);
+	stream->write_function(stream, "Inline      \t%" SWITCH_UINT64_T_FMT "\n", file_io.inline_opens);
+	stream->write_function(stream, "Rejected    \t%" SWITCH_UINT64_T_FMT "\n", file_io.rejected);
+	stream->write_function(stream, "Abandoned   \t%" SWITCH_UINT64_T_FMT "\n", file_io.abandoned);
+	switch_mutex_unlock(file_io.mutex);
+}
+
+void switch_core_file_io_init(switch_memory_pool_t *pool)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i, threads = runtime.file_open_threads;
+
+	if (!threads) {
+		return;
+	}
+
+	if (threads > FILE_IO_MAX_THREADS) {
+		threads = FILE_IO_MAX_THREADS;
+	}
+
+	switch_queue_create(&file_io.queue, FILE_IO_QUEUE_LEN, pool);
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (i = 0; i < threads; i++) {
+		if (switch_thread_create(&file_io.threads[i], thd_attr, file_io_thread, NULL, pool) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+	}
+
+	switch_mutex_lock(file_io.mutex);
+	file_io.thread_count = i;
+	switch_mutex_unlock(file_io.mutex);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Started %u file open threads\n", i);
+}
+
+void switch_core_file_io_shutdown(void)
+{
+	uint32_t i, count, jobs;
+	switch_status_t st;
+	int waited = 0;
+
+	/* prefetches use the format modules, they have to be done before the modules are unloaded */
+	switch_mutex_lock(prefetch.mutex);
+	prefetch.running = SWITCH_FALSE;
+	switch_mutex_unlock(prefetch.mutex);
+
+	for (;;) {
+		switch_mutex_lock(prefetch.mutex);
+		jobs = prefetch.jobs;
+		switch_mutex_unlock(prefetch.mutex);
+
+		if (!jobs) {
+			break;
+		}
+
+		if (++waited % 500 == 0) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Waiting for %u prefetches to finish\n", jobs);
+		}
+
+		switch_yield(10000);
+	}
+
+	/* jobs started from now on are opened inline, the ones queued are ahead of the stop markers */
+	switch_mutex_lock(file_io.mutex);
+	count = file_io.thread_count;
+	file_io.thread_count = 0;
+	switch_mutex_unlock(file_io.mutex);
+
+	for (i = 0; i < count; i++) {
+		switch_queue_push(file_io.queue, NULL);
+	}
+
+	for (i = 0; i < count; i++) {
+		switch_thread_join(&st, file_io.threads[i]);
+	}
+}
+
+void switch_core_file_cache_init(switch_memory_pool_t *pool)
+{
+	switch_mutex_init(&prompt_cache.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_hash_init(&prompt_cache.hash);
+	switch_mutex_init(&prefetch.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_hash_init(&prefetch.hash);
+	prefetch.running = SWITCH_TRUE;
+	switch_mutex_init(&file_io.mutex, SWITCH_MUTEX_DEFAULT, pool);
+	switch_thread_cond_create(&file_io.cond, pool);
+}
+
+void switch_core_file_cache_uninit(void)
+{
+	/* switch_core_file_io_shutdown has waited for the prefetches */
+	switch_core_hash_destroy(&prefetch.hash);
+
+	switch_core_file_cache_flush();
+	switch_core_hash_destroy(&prompt_cache.hash);
+}
+
+SWITCH_DECLARE(void) switch_core_file_cache_flush(void)
+{
+	if (!prompt_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(prompt_cache.mutex);
+	while (prompt_cache.tail) {
+		prompt_cache_unlink(prompt_cache.tail);
+	}
+	switch_mutex_unlock(prompt_cache.mutex);
+}
+
+SWITCH_DECLARE(void) switch_core_file_cache_status(switch_stream_handle_t *stream)
+{
+	uint64_t lookups;
+
+	if (!prompt_cache.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(prompt_cache.mutex);
+	lookups = prompt_cache.hits + prompt_cache.misses;
+	stream->write_function(stream, "Size        \t%" SWITCH_SIZE_T_FMT "/%" SWITCH_SIZE_T_FMT "\n", prompt_cache.bytes, runtime.prompt_cache_size);
+	stream->write_function(stream, "Entries     \t%u\n", prompt_cache.entries);
+	stream->write_function(stream, "Hits        \t%" SWITCH_UINT64_T_FMT "\n", prompt_cache.hits);
+	stream->write_function(stream, "Misses      \t%" SWITCH_UINT64_T_FMT "\n", prompt_cache.misses);
+	stream->write_function(stream, "Hit Rate    \t%.1f%%\n", lookups ? prompt_cache.hits * 100.0 / lookups : 0.0);
+	stream->write_function(stream, "Evictions   \t%" SWITCH_UINT64_T_FMT "\n", prompt_cache.evictions);
+	stream->write_function(stream, "Expired     \t%" SWITCH_UINT64_T_FMT "\n", prompt_cache.expired);
+	stream->write_function(stream, "Uncacheable \t%" SWITCH_UINT64_T_FMT "\n", prompt_cache.uncacheable);
+	switch_mutex_unlock(prompt_cache.mutex);
+
+	switch_mutex_lock(prefetch.mutex);
+	stream->write_function(stream, "Prefetching \t%u\n", prefetch.jobs);
+	stream->write_function(stream, "Prefetched  \t%" SWITCH_UINT64_T_FMT "\n", prefetch.started);
+	stream->write_function(stream, "Prefetch Drop\t%" SWITCH_UINT64_T_FMT "\n", prefetch.dropped);
+	switch_mutex_unlock(prefetch.mutex);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file, const char *func, int line,
 															  switch_file_handle_t *fh,
 															  const char *file_path,
@@ -49,6 +884,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file,
 	int is_stream = 0;
 	char *fp = NULL;
 	int to = 0;
+	const char *orig_path = file_path;
 
 	if (switch_test_flag(fh, SWITCH_FILE_OPEN)) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Handle already open\n");
@@ -304,6 +1140,18 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file,
 		fh->channels = 1;
 	}
 
+	/* plain prompts are decoded once and then played from memory */
+	if (runtime.prompt_cache_size && rate && channels && !is_stream && !fh->spool_path && (flags & SWITCH_FILE_FLAG_READ) &&
+		!switch_test_flag(fh, SWITCH_FILE_FLAG_WRITE | SWITCH_FILE_NATIVE | SWITCH_FILE_NOMUX | SWITCH_FILE_NOCACHE | SWITCH_FILE_FLAG_VIDEO) &&
+		prompt_cache_open(fh, orig_path, channels, rate, flags)) {
+		if (to) {
+			fh->max_samples = (fh->samplerate / 1000) * to;
+		}
+
+		switch_set_flag_locked(fh, SWITCH_FILE_OPEN);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	file_path = fh->spool_path ? fh->spool_path : fh->file_path;
 
 	if ((status = fh->file_interface->file_open(fh, file_path)) != SWITCH_STATUS_SUCCESS) {
@@ -349,7 +1197,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file,
 		fh->pre_buffer_datalen = 0;
 	}
 
-	if (fh->pre_buffer_datalen) {
+	/* a mapped file is read from memory already */
+	if (fh->pre_buffer_datalen && !fh->map_data) {
 		//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Prebuffering %d bytes\n", (int)fh->pre_buffer_datalen);
 		switch_buffer_create_dynamic(&fh->pre_buffer, fh->pre_buffer_datalen * fh->channels, fh->pre_buffer_datalen * fh->channels, 0);
 		fh->pre_buffer_data = switch_core_alloc(fh->memory_pool, fh->pre_buffer_datalen * fh->channels);
@@ -393,6 +1242,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_read(switch_file_handle_t *fh,
 		return SWITCH_STATUS_FALSE;
 	}
 
+	if (fh->prompt_cache) {
+		return prompt_cache_read(fh, data, len);
+	}
+
   top:
 
 	if (fh->max_samples > 0 && fh->samples_in >= (switch_size_t)fh->max_samples) {
@@ -513,6 +1366,62 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_read(switch_file_handle_t *fh,
 	return status;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_core_file_map(switch_file_handle_t *fh, const char *path, int64_t offset)
+{
+	switch_file_t *fd = NULL;
+	switch_size_t size;
+	const void *data = NULL;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	/* a mapped file truncated while it plays faults the thread reading it, so this is opt in */
+	if (!runtime.map_audio_files) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!switch_test_flag(fh, SWITCH_FILE_FLAG_READ) || switch_test_flag(fh, SWITCH_FILE_FLAG_WRITE) || fh->map) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (switch_file_open(&fd, path, SWITCH_FOPEN_READ | SWITCH_FOPEN_BINARY, SWITCH_FPROT_OS_DEFAULT, fh->memory_pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* the mapping outlives the descriptor */
+	if ((size = switch_file_get_size(fd)) > (switch_size_t) offset &&
+		(status = switch_mmap_create(&fh->map, &data, fd, offset, size - (switch_size_t) offset, fh->memory_pool)) == SWITCH_STATUS_SUCCESS) {
+		fh->map_data = data;
+		fh->map_len = size - (switch_size_t) offset;
+		fh->map_pos = 0;
+	} else {
+		fh->map = NULL;
+		status = SWITCH_STATUS_FALSE;
+	}
+
+	switch_file_close(fd);
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_file_read_ref(switch_file_handle_t *fh, const void **data, switch_size_t len)
+{
+	switch_assert(fh != NULL);
+
+	if (!switch_test_flag(fh, SWITCH_FILE_OPEN) || !switch_test_flag(fh, SWITCH_FILE_NATIVE) || !fh->map_data || fh->pre_buffer) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (fh->map_len - fh->map_pos < len || (fh->max_samples > 0 && fh->samples_in + len > (switch_size_t)fh->max_samples)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*data = fh->map_data + fh->map_pos;
+	fh->map_pos += len;
+	fh->pos += len;
+	fh->samples_in += len;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_DECLARE(switch_bool_t) switch_core_file_has_video(switch_file_handle_t *fh, switch_bool_t check_open)
 {
 	return ((!check_open || switch_test_flag(fh, SWITCH_FILE_OPEN)) && switch_test_flag(fh, SWITCH_FILE_FLAG_VIDEO)) ? SWITCH_TRUE : SWITCH_FALSE;
@@ -529,7 +1438,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_write(switch_file_handle_t *fh,
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (!fh->file_interface->file_write) {
+	if (!fh->file_interface->file_write || fh->prompt_cache) {
 		return SWITCH_STATUS_FALSE;
 	}
 
@@ -612,7 +1521,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_write_video(switch_file_handle_
 		return SWITCH_STATUS_GENERR;
 	}
 
-	if (!fh->file_interface->file_write_video) {
+	if (!fh->file_interface->file_write_video || fh->prompt_cache) {
 		return SWITCH_STATUS_FALSE;
 	}
 
@@ -635,7 +1544,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_read_video(switch_file_handle_t
 		return SWITCH_STATUS_GENERR;
 	}
 
-	if (!fh->file_interface->file_read_video) {
+	if (!fh->file_interface->file_read_video || fh->prompt_cache) {
 		return SWITCH_STATUS_FALSE;
 	}
 
@@ -655,6 +1564,13 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_seek(switch_file_handle_t *fh,
 	
 	switch_assert(fh != NULL);
 
+	if (fh->prompt_cache && switch_test_flag(fh, SWITCH_FILE_OPEN)) {
+		switch_set_flag_locked(fh, SWITCH_FILE_SEEK);
+		prompt_cache_seek(fh, cur_pos, samples, whence);
+		fh->offset_pos = *cur_pos;
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	if (!switch_test_flag(fh, SWITCH_FILE_OPEN) || !fh->file_interface->file_seek) {
 		ok = 0;
 	} else if (switch_test_flag(fh, SWITCH_FILE_FLAG_WRITE)) {
@@ -708,7 +1624,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_set_string(switch_file_handle_t
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (!fh->file_interface->file_set_string) {
+	if (!fh->file_interface->file_set_string || fh->prompt_cache) {
 		return SWITCH_STATUS_FALSE;
 	}
 
@@ -724,7 +1640,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_get_string(switch_file_handle_t
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (!fh->file_interface->file_get_string) {
+	if (!fh->file_interface->file_get_string || fh->prompt_cache) {
 		return SWITCH_STATUS_FALSE;
 	}
 
@@ -782,7 +1698,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_command(switch_file_handle_t *f
 		break;
 	}
 
-	if (fh->file_interface->file_command) {
+	if (fh->file_interface->file_command && !fh->prompt_cache) {
 		switch_mutex_lock(fh->flag_mutex);
 		status = fh->file_interface->file_command(fh, command);
 		switch_mutex_unlock(fh->flag_mutex);
@@ -825,7 +1741,21 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_close(switch_file_handle_t *fh)
 	}
 
 	switch_clear_flag_locked(fh, SWITCH_FILE_OPEN);
-	status = fh->file_interface->file_close(fh);
+
+	if (fh->prompt_cache) {
+		prompt_cache_release((prompt_cache_entry_t *) fh->prompt_cache);
+		fh->prompt_cache = NULL;
+		status = SWITCH_STATUS_SUCCESS;
+	} else {
+		status = fh->file_interface->file_close(fh);
+	}
+
+	if (fh->map) {
+		switch_mmap_delete(fh->map);
+		fh->map = NULL;
+		fh->map_data = NULL;
+		fh->map_len = fh->map_pos = 0;
+	}
 
 	if (fh->params) {
 		switch_event_destroy(&fh->params);
@@ -2782,6 +2782,11 @@ static void switch_core_session_parse_codec_settings(switch_core_session_t *sess
 			engine->codec_settings.video.try_hardware_encoder = switch_true(var);
 		}
 
+		if ((var = switch_channel_get_variable(session->channel, "video_encoder_params")) &&
+			switch_core_codec_parse_video_encoder_params(var, &engine->codec_settings) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Invalid video_encoder_params [%s]\n", var);
+		}
+
 		if (!(bwv = switch_channel_get_variable(session->channel, "rtp_video_max_bandwidth"))) {
 			bwv = switch_channel_get_variable(session->channel, "rtp_video_max_bandwidth_out");
 		}
@@ -9858,6 +9863,19 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_set_outgoing_bitrate(switch_co
 	return status;
 }
 
+SWITCH_DECLARE(uint32_t) switch_core_media_get_remote_bitrate(switch_core_session_t *session, switch_media_type_t type)
+{
+	switch_media_handle_t *smh;
+
+	switch_assert(session);
+
+	if (!(smh = session->media_handle)) {
+		return 0;
+	}
+
+	return switch_rtp_get_remote_bitrate(smh->engines[type].rtp_session);
+}
+
 //?
 SWITCH_DECLARE(switch_status_t) switch_core_media_reset_jb(switch_core_session_t *session, switch_media_type_t type)
 {
@@ -11900,6 +11918,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_video_frame(switch_cor
 				switch_queue_push(bp->write_video_queue, dimg);
 
 				if (switch_core_media_bug_test_flag(bp, SMBF_SPY_VIDEO_STREAM_BLEG)) {
+					if (!dup_img && switch_img_shared(img)) {
+						switch_img_copy(img, &dup_img);
+						img = dup_img;
+					}
 					switch_core_media_bug_patch_spy_frame(bp, img, SWITCH_RW_WRITE);
 					patched = 1;
 				}
@@ -11910,6 +11932,12 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_video_frame(switch_cor
 				(switch_test_flag(bp, SMBF_WRITE_VIDEO_PING) || (switch_core_media_bug_test_flag(bp, SMBF_SPY_VIDEO_STREAM) && !patched))) {
 				switch_frame_t bug_frame = { 0 };
 
+				/* ping callbacks may draw on the image, so they must never see one shared with other channels */
+				if (bp->callback && switch_test_flag(bp, SMBF_WRITE_VIDEO_PING) && !dup_img && switch_img_shared(img)) {
+					switch_img_copy(img, &dup_img);
+					img = dup_img;
+				}
+
 				bug_frame.img = img;
 
 				if (bp->callback && switch_test_flag(bp, SMBF_WRITE_VIDEO_PING)) {
@@ -11922,6 +11950,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_video_frame(switch_cor
 				}
 
 				if (switch_core_media_bug_test_flag(bp, SMBF_SPY_VIDEO_STREAM_BLEG) && !patched) {
+					if (!dup_img && switch_img_shared(img)) {
+						switch_img_copy(img, &dup_img);
+						img = dup_img;
+					}
 					switch_core_media_bug_patch_spy_frame(bp, img, SWITCH_RW_WRITE);
 				}
 
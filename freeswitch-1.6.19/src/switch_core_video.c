@@ -43,6 +43,10 @@
 #include <libyuv.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // #define HAVE_LIBGD
 #ifdef HAVE_LIBGD
 #include <gd.h>
@@ -167,6 +171,249 @@ SWITCH_DECLARE(switch_bool_t) switch_core_has_video(void)
 #endif
 }
 
+#ifdef SWITCH_HAVE_VPX
+/* Image pool
+ *
+ * Every frame, scaled layer and copy in the video path used to be a fresh
+ * vpx_img_alloc()/vpx_img_free() pair. Storage is recycled here instead, keyed
+ * by format, size and alignment. Pooled images carry a refcount so a frame can
+ * be handed to several readers without copying it; they are recognized by
+ * fb_priv pointing back at the image itself.
+ */
+
+#define IMG_POOL_CLASSES 32
+#define IMG_POOL_CLASS_MAX 32
+#define IMG_POOL_MAX_BYTES (128 * 1024 * 1024)
+
+typedef struct img_pool_entry_s {
+	vpx_image_t img;
+	vpx_image_t orig;
+	switch_atomic_t refs;
+	unsigned int align;
+	switch_size_t size;
+	struct img_pool_entry_s *next;
+} img_pool_entry_t;
+
+typedef struct img_pool_class_s {
+	switch_img_fmt_t fmt;
+	unsigned int d_w;
+	unsigned int d_h;
+	unsigned int align;
+	uint32_t count;
+	uint64_t last_used;
+	img_pool_entry_t *head;
+} img_pool_class_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	img_pool_class_t classes[IMG_POOL_CLASSES];
+	uint32_t cached;
+	switch_size_t cached_bytes;
+	switch_size_t max_bytes;
+	uint64_t allocs;
+	uint64_t hits;
+	uint64_t releases;
+	switch_atomic_t refs;
+	switch_atomic_t in_use;
+} img_pool;
+
+static inline img_pool_entry_t *img_pool_entry(switch_image_t *img)
+{
+	if (img && img->fb_priv == (void *) img) {
+		return (img_pool_entry_t *) img;
+	}
+
+	return NULL;
+}
+
+static void img_pool_entry_destroy(img_pool_entry_t *entry)
+{
+	vpx_img_free(&entry->orig);
+	free(entry);
+}
+
+static void img_pool_class_clear(img_pool_class_t *class)
+{
+	img_pool_entry_t *entry;
+
+	while ((entry = class->head)) {
+		class->head = entry->next;
+		img_pool.cached--;
+		img_pool.cached_bytes -= entry->size;
+		img_pool_entry_destroy(entry);
+	}
+
+	class->count = 0;
+}
+
+static img_pool_class_t *img_pool_find_class(switch_img_fmt_t fmt, unsigned int d_w, unsigned int d_h, unsigned int align, switch_bool_t create)
+{
+	img_pool_class_t *class, *lru = NULL;
+	int i;
+
+	for (i = 0; i < IMG_POOL_CLASSES; i++) {
+		class = &img_pool.classes[i];
+
+		if (class->fmt == fmt && class->d_w == d_w && class->d_h == d_h && class->align == align) {
+			return class;
+		}
+
+		if (!lru || (lru->count && !class->count) || (!!lru->count == !!class->count && class->last_used < lru->last_used)) {
+			lru = class;
+		}
+	}
+
+	if (!create) {
+		return NULL;
+	}
+
+	/* recycle an empty class if there is one, otherwise the least recently used size */
+	img_pool_class_clear(lru);
+	lru->fmt = fmt;
+	lru->d_w = d_w;
+	lru->d_h = d_h;
+	lru->align = align;
+
+	return lru;
+}
+
+static switch_image_t *img_pool_alloc(switch_img_fmt_t fmt, unsigned int d_w, unsigned int d_h, unsigned int align)
+{
+	img_pool_entry_t *entry = NULL;
+	img_pool_class_t *class;
+
+	if (img_pool.mutex) {
+		switch_mutex_lock(img_pool.mutex);
+		img_pool.allocs++;
+
+		if ((class = img_pool_find_class(fmt, d_w, d_h, align, SWITCH_FALSE)) && (entry = class->head)) {
+			class->head = entry->next;
+			class->count--;
+			class->last_used = img_pool.allocs;
+			img_pool.cached--;
+			img_pool.cached_bytes -= entry->size;
+			img_pool.hits++;
+		}
+
+		switch_mutex_unlock(img_pool.mutex);
+	}
+
+	if (!entry) {
+		int i;
+
+		switch_zmalloc(entry, sizeof(*entry));
+
+		if (!vpx_img_alloc(&entry->orig, (vpx_img_fmt_t)fmt, d_w, d_h, align)) {
+			free(entry);
+			return NULL;
+		}
+
+		entry->align = align;
+
+		for (i = 0; i < 4; i++) {
+			if (entry->orig.planes[i]) {
+				entry->size += (switch_size_t) entry->orig.stride[i] * (i == 1 || i == 2 ? entry->orig.h >> entry->orig.y_chroma_shift : entry->orig.h);
+			}
+		}
+	}
+
+	entry->img = entry->orig;
+	entry->img.fb_priv = &entry->img;
+	entry->next = NULL;
+	switch_atomic_set(&entry->refs, 1);
+	switch_atomic_inc(&img_pool.in_use);
+
+	return (switch_image_t *) &entry->img;
+}
+
+static void img_pool_release(img_pool_entry_t *entry)
+{
+	img_pool_class_t *class;
+
+	switch_atomic_dec(&img_pool.in_use);
+
+	if (img_pool.mutex) {
+		switch_mutex_lock(img_pool.mutex);
+		img_pool.releases++;
+
+		if (img_pool.cached_bytes + entry->size <= img_pool.max_bytes &&
+			(class = img_pool_find_class((switch_img_fmt_t)entry->orig.fmt, entry->orig.d_w, entry->orig.d_h, entry->align, SWITCH_TRUE)) &&
+			class->count < IMG_POOL_CLASS_MAX) {
+			entry->next = class->head;
+			class->head = entry;
+			class->count++;
+			class->last_used = img_pool.allocs;
+			img_pool.cached++;
+			img_pool.cached_bytes += entry->size;
+			entry = NULL;
+		}
+
+		switch_mutex_unlock(img_pool.mutex);
+	}
+
+	if (entry) {
+		img_pool_entry_destroy(entry);
+	}
+}
+#endif
+
+SWITCH_DECLARE(void) switch_img_pool_stats(switch_img_pool_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+#ifdef SWITCH_HAVE_VPX
+	if (!img_pool.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(img_pool.mutex);
+	stats->allocs = img_pool.allocs;
+	stats->hits = img_pool.hits;
+	stats->releases = img_pool.releases;
+	stats->cached = img_pool.cached;
+	stats->cached_bytes = img_pool.cached_bytes;
+	stats->max_bytes = img_pool.max_bytes;
+	switch_mutex_unlock(img_pool.mutex);
+
+	stats->refs = switch_atomic_read(&img_pool.refs);
+	stats->in_use = switch_atomic_read(&img_pool.in_use);
+#endif
+}
+
+SWITCH_DECLARE(void) switch_img_pool_flush(void)
+{
+#ifdef SWITCH_HAVE_VPX
+	int i;
+
+	if (!img_pool.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(img_pool.mutex);
+	for (i = 0; i < IMG_POOL_CLASSES; i++) {
+		img_pool_class_clear(&img_pool.classes[i]);
+	}
+	switch_mutex_unlock(img_pool.mutex);
+#endif
+}
+
+SWITCH_DECLARE(void) switch_core_video_init(switch_memory_pool_t *pool)
+{
+#ifdef SWITCH_HAVE_VPX
+	memset(&img_pool, 0, sizeof(img_pool));
+	img_pool.max_bytes = IMG_POOL_MAX_BYTES;
+	switch_mutex_init(&img_pool.mutex, SWITCH_MUTEX_NESTED, pool);
+#endif
+}
+
+SWITCH_DECLARE(void) switch_core_video_deinit(void)
+{
+#ifdef SWITCH_HAVE_VPX
+	switch_img_pool_flush();
+	img_pool.mutex = NULL;
+#endif
+}
+
 SWITCH_DECLARE(switch_image_t *)switch_img_alloc(switch_image_t  *img,
 						 switch_img_fmt_t fmt,
 						 unsigned int d_w,
@@ -199,7 +446,13 @@ SWITCH_DECLARE(switch_image_t *)switch_img_alloc(switch_image_t  *img,
 
 	switch_assert(d_w > 0);
 	switch_assert(d_h > 0);
-	r = (switch_image_t *)vpx_img_alloc((vpx_image_t *)img, (vpx_img_fmt_t)fmt, d_w, d_h, align);
+
+	if (img) {
+		r = (switch_image_t *)vpx_img_alloc((vpx_image_t *)img, (vpx_img_fmt_t)fmt, d_w, d_h, align);
+	} else {
+		r = img_pool_alloc(fmt, d_w, d_h, align);
+	}
+
 	switch_assert(r);
 	switch_assert(r->d_w == d_w);
 	switch_assert(r->d_h = d_h);
@@ -274,6 +527,14 @@ SWITCH_DECLARE(void) switch_img_free(switch_image_t **img)
 {
 #ifdef SWITCH_HAVE_VPX
 	if (img && *img) {
+		img_pool_entry_t *entry = img_pool_entry(*img);
+
+		if (entry && switch_atomic_dec(&entry->refs)) {
+			/* someone else still holds it */
+			*img = NULL;
+			return;
+		}
+
 		if ((*img)->fmt == SWITCH_IMG_FMT_GD) {
 #ifdef HAVE_LIBGD
 			gdImageDestroy((gdImagePtr)(*img)->user_priv);
@@ -286,12 +547,55 @@ SWITCH_DECLARE(void) switch_img_free(switch_image_t **img)
 		switch_assert((*img)->fmt <= SWITCH_IMG_FMT_I44016);
 		switch_assert((*img)->d_w <= 7860 && (*img)->d_w > 0);
 		switch_assert((*img)->d_h <= 4320 && (*img)->d_h > 0);
-		vpx_img_free((vpx_image_t *)*img);
+
+		if (entry) {
+			img_pool_release(entry);
+		} else {
+			vpx_img_free((vpx_image_t *)*img);
+		}
+
 		*img = NULL;
 	}
 #endif
 }
 
+SWITCH_DECLARE(switch_image_t *) switch_img_ref(switch_image_t *img)
+{
+#ifdef SWITCH_HAVE_VPX
+	img_pool_entry_t *entry;
+	switch_image_t *new_img = NULL;
+
+	if (!img) {
+		return NULL;
+	}
+
+	if ((entry = img_pool_entry(img))) {
+		switch_atomic_inc(&entry->refs);
+		switch_atomic_inc(&img_pool.refs);
+		return img;
+	}
+
+	switch_img_copy(img, &new_img);
+
+	return new_img;
+#else
+	return NULL;
+#endif
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_img_shared(switch_image_t *img)
+{
+#ifdef SWITCH_HAVE_VPX
+	img_pool_entry_t *entry;
+
+	if ((entry = img_pool_entry(img))) {
+		return switch_atomic_read(&entry->refs) > 1 ? SWITCH_TRUE : SWITCH_FALSE;
+	}
+#endif
+
+	return SWITCH_FALSE;
+}
+
 #ifndef MIN
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #endif
@@ -301,6 +605,73 @@ SWITCH_DECLARE(void) switch_img_free(switch_image_t **img)
 #endif
 
 #ifdef SWITCH_HAVE_YUV
+/* Blend a row of src under the pixels of dst that are still transparent.
+ * alpha is scaled to 0..256 so that 0 and 255 leave dst and copy src exactly.
+ */
+static inline void blend_argb_under_row_c(uint8_t *dst, const uint8_t *src, int width)
+{
+	int j;
+
+	for (j = 0; j < width; j++, dst += 4, src += 4) {
+		switch_rgb_color_t *RGB = (switch_rgb_color_t *) dst;
+		const switch_rgb_color_t *rgb = (const switch_rgb_color_t *) src;
+		int alpha = rgb->a + (rgb->a >> 7);
+
+		if (RGB->a != 0 || alpha == 0) {
+			continue;
+		}
+
+		RGB->a = 255;
+		RGB->r = ((RGB->r * (256 - alpha)) + (rgb->r * alpha)) >> 8;
+		RGB->g = ((RGB->g * (256 - alpha)) + (rgb->g * alpha)) >> 8;
+		RGB->b = ((RGB->b * (256 - alpha)) + (rgb->b * alpha)) >> 8;
+	}
+}
+
+#if defined(__SSE2__)
+static void blend_argb_under_row(uint8_t *dst, const uint8_t *src, int width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(0xff000000);
+	const __m128i c256 = _mm_set1_epi16(256);
+	int j = 0;
+
+	for (; j + 4 <= width; j += 4, dst += 16, src += 16) {
+		__m128i d = _mm_loadu_si128((const __m128i *) dst);
+		__m128i s = _mm_loadu_si128((const __m128i *) src);
+		__m128i open = _mm_cmpeq_epi32(_mm_and_si128(d, amask), zero);
+		__m128i take = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(s, amask), zero), open);
+		__m128i dlo, dhi, slo, shi, alo, ahi, b;
+
+		if (_mm_movemask_epi8(take) == 0) {
+			continue;
+		}
+
+		dlo = _mm_unpacklo_epi8(d, zero);
+		dhi = _mm_unpackhi_epi8(d, zero);
+		slo = _mm_unpacklo_epi8(s, zero);
+		shi = _mm_unpackhi_epi8(s, zero);
+
+		/* spread each pixel's alpha over its 4 channels */
+		alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, 0xff), 0xff);
+		ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, 0xff), 0xff);
+		alo = _mm_add_epi16(alo, _mm_srli_epi16(alo, 7));
+		ahi = _mm_add_epi16(ahi, _mm_srli_epi16(ahi, 7));
+
+		dlo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dlo, _mm_sub_epi16(c256, alo)), _mm_mullo_epi16(slo, alo)), 8);
+		dhi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dhi, _mm_sub_epi16(c256, ahi)), _mm_mullo_epi16(shi, ahi)), 8);
+
+		b = _mm_or_si128(_mm_packus_epi16(dlo, dhi), amask);
+		d = _mm_or_si128(_mm_and_si128(take, b), _mm_andnot_si128(take, d));
+		_mm_storeu_si128((__m128i *) dst, d);
+	}
+
+	blend_argb_under_row_c(dst, src, width - j);
+}
+#else
+#define blend_argb_under_row blend_argb_under_row_c
+#endif
+
 static void switch_img_patch_rgb_noalpha(switch_image_t *IMG, switch_image_t *img, int x, int y)
 {
 	int i;
@@ -308,33 +679,85 @@ static void switch_img_patch_rgb_noalpha(switch_image_t *IMG, switch_image_t *im
 	if (img->fmt == SWITCH_IMG_FMT_ARGB && IMG->fmt == SWITCH_IMG_FMT_ARGB) {
 		int max_w = MIN(img->d_w, IMG->d_w - abs(x));
 		int max_h = MIN(img->d_h, IMG->d_h - abs(y));
-		int j;
-		uint8_t alpha, alphadiff;
-		switch_rgb_color_t *rgb, *RGB; 
 
-		for (i = 0; i < max_h; i++) {		
-			for (j = 0; j < max_w; j++) {
-				rgb = (switch_rgb_color_t *)(img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED] + j * 4);
-				RGB = (switch_rgb_color_t *)(IMG->planes[SWITCH_PLANE_PACKED] + (y + i) * IMG->stride[SWITCH_PLANE_PACKED] + (x + j) * 4);
-				
-				alpha = rgb->a;
-				
-				if (RGB->a != 0) {
-					continue;
-				}
+		for (i = 0; i < max_h; i++) {
+			blend_argb_under_row(IMG->planes[SWITCH_PLANE_PACKED] + (y + i) * IMG->stride[SWITCH_PLANE_PACKED] + x * 4,
+								 img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED], max_w);
+		}
+	}
+}
 
-				if (alpha == 255) {
-					*RGB = *rgb;
-				} else if (alpha != 0) {
-					alphadiff = 255 - alpha;
-					RGB->a = 255;
-					RGB->r = ((RGB->r * alphadiff) + (rgb->r * alpha)) >> 8;
-					RGB->g = ((RGB->g * alphadiff) + (rgb->g * alpha)) >> 8;
-					RGB->b = ((RGB->b * alphadiff) + (rgb->b * alpha)) >> 8;
-				}
+/* Blend an ARGB image onto an I420 one.
+ * Luma and alpha are converted a whole block at a time and blended with libyuv.
+ * Chroma is taken from the pixel on each even row and column, as switch_img_draw_pixel() does.
+ */
+static void switch_img_patch_argb_i420(switch_image_t *IMG, switch_image_t *img, int x, int y)
+{
+	int sx = 0, sy = 0, w, h, cx0, cy0, cw, ch, i, j;
+	int src_stride = img->stride[SWITCH_PLANE_PACKED];
+	const uint8_t *src;
+	uint8_t *buf, *ybuf, *abuf, *ubuf, *vbuf, *cybuf, *cabuf;
+	uint32_t *gbuf;
+
+	if (x < 0) {
+		sx = -x;
+		x = 0;
+	}
+
+	if (y < 0) {
+		sy = -y;
+		y = 0;
+	}
+
+	w = MIN((int)img->d_w - sx, (int)IMG->d_w - x);
+	h = MIN((int)img->d_h - sy, (int)IMG->d_h - y);
+
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+
+	cx0 = (x + 1) / 2;
+	cy0 = (y + 1) / 2;
+	cw = (x + w + 1) / 2 - cx0;
+	ch = (y + h + 1) / 2 - cy0;
+
+	buf = malloc(cw * ch * 8 + w * h * 2);
+	switch_assert(buf);
+
+	gbuf = (uint32_t *) buf;
+	ubuf = buf + cw * ch * 4;
+	vbuf = ubuf + cw * ch;
+	cybuf = vbuf + cw * ch;
+	cabuf = cybuf + cw * ch;
+	ybuf = cabuf + cw * ch;
+	abuf = ybuf + w * h;
+
+	src = img->planes[SWITCH_PLANE_PACKED] + sy * src_stride + sx * 4;
+
+	ARGBToI400(src, src_stride, ybuf, w, w, h);
+	ARGBExtractAlpha(src, src_stride, abuf, w, w, h);
+	BlendPlane(ybuf, w, IMG->planes[SWITCH_PLANE_Y] + y * IMG->stride[SWITCH_PLANE_Y] + x, IMG->stride[SWITCH_PLANE_Y], abuf, w,
+			   IMG->planes[SWITCH_PLANE_Y] + y * IMG->stride[SWITCH_PLANE_Y] + x, IMG->stride[SWITCH_PLANE_Y], w, h);
+
+	if (cw > 0 && ch > 0) {
+		for (i = 0; i < ch; i++) {
+			const uint32_t *row = (const uint32_t *)(src + ((cy0 + i) * 2 - y) * src_stride);
+
+			for (j = 0; j < cw; j++) {
+				gbuf[i * cw + j] = row[(cx0 + j) * 2 - x];
 			}
 		}
+
+		ARGBToI444((uint8_t *) gbuf, cw * 4, cybuf, cw, ubuf, cw, vbuf, cw, cw, ch);
+		ARGBExtractAlpha((uint8_t *) gbuf, cw * 4, cabuf, cw, cw, ch);
+
+		BlendPlane(ubuf, cw, IMG->planes[SWITCH_PLANE_U] + cy0 * IMG->stride[SWITCH_PLANE_U] + cx0, IMG->stride[SWITCH_PLANE_U], cabuf, cw,
+				   IMG->planes[SWITCH_PLANE_U] + cy0 * IMG->stride[SWITCH_PLANE_U] + cx0, IMG->stride[SWITCH_PLANE_U], cw, ch);
+		BlendPlane(vbuf, cw, IMG->planes[SWITCH_PLANE_V] + cy0 * IMG->stride[SWITCH_PLANE_V] + cx0, IMG->stride[SWITCH_PLANE_V], cabuf, cw,
+				   IMG->planes[SWITCH_PLANE_V] + cy0 * IMG->stride[SWITCH_PLANE_V] + cx0, IMG->stride[SWITCH_PLANE_V], cw, ch);
 	}
+
+	free(buf);
 }
 #endif
 
@@ -421,6 +844,9 @@ SWITCH_DECLARE(void) switch_img_patch(switch_image_t *IMG, switch_image_t *img,
 	switch_assert(IMG->fmt == SWITCH_IMG_FMT_I420);
 
 	if (img->fmt == SWITCH_IMG_FMT_ARGB) {
+#ifdef SWITCH_HAVE_YUV
+		switch_img_patch_argb_i420(IMG, img, x, y);
+#else
 		int max_w = MIN(img->d_w, IMG->d_w - abs(x));
 		int max_h = MIN(img->d_h, IMG->d_h - abs(y));
 		int j;
@@ -436,18 +862,18 @@ SWITCH_DECLARE(void) switch_img_patch(switch_image_t *IMG, switch_image_t *img,
 					switch_img_draw_pixel(IMG, x + j, y + i, rgb);
 				} else if (alpha != 0) {
 					switch_rgb_color_t RGB = { 0 };
-					
+
 					switch_img_get_rgb_pixel(IMG, &RGB, x + j, y + i);
 					RGB.a = 255;
 					RGB.r = ((RGB.r * (255 - alpha)) >> 8) + ((rgb->r * alpha) >> 8);
 					RGB.g = ((RGB.g * (255 - alpha)) >> 8) + ((rgb->g * alpha) >> 8);
 					RGB.b = ((RGB.b * (255 - alpha)) >> 8) + ((rgb->b * alpha) >> 8);
-					
+
 					switch_img_draw_pixel(IMG, x + j, y + i, &RGB);
 				}
 			}
 		}
-
+#endif
 		return;
 
 #ifdef HAVE_LIBGD
@@ -553,7 +979,7 @@ SWITCH_DECLARE(void) switch_img_copy(switch_image_t *img, switch_image_t **new_i
 
 	if (*new_img) {
 		if ((*new_img)->fmt != SWITCH_IMG_FMT_I420 && (*new_img)->fmt != SWITCH_IMG_FMT_ARGB) return;
-		if (img->d_w != (*new_img)->d_w || img->d_h != (*new_img)->d_w ) {
+		if (img->d_w != (*new_img)->d_w || img->d_h != (*new_img)->d_h || switch_img_shared(*new_img)) {
 			new_fmt = (*new_img)->fmt;
 			switch_img_free(new_img);
 		}
@@ -912,17 +1338,16 @@ SWITCH_DECLARE(void) switch_img_fill_noalpha(switch_image_t *img, int x, int y,
 		int max_w = img->d_w;
 		int max_h = img->d_h;
 		int j;
-		switch_rgb_color_t *rgb; 
+		uint32_t value;
 
-		for (i = 0; i < max_h; i++) {		
-			for (j = 0; j < max_w; j++) {
-				rgb = (switch_rgb_color_t *)(img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED] + j * 4);
+		memcpy(&value, color, sizeof(value));
 
-				if (rgb->a != 0) {
-					continue;
-				}
-				
-				*rgb = *color;
+		/* whole words and no early exit so the compiler can vectorize the row */
+		for (i = 0; i < max_h; i++) {
+			uint32_t *row = (uint32_t *)(img->planes[SWITCH_PLANE_PACKED] + i * img->stride[SWITCH_PLANE_PACKED]);
+
+			for (j = 0; j < max_w; j++) {
+				row[j] = (row[j] & 0xff000000) ? row[j] : value;
 			}
 		}
 	}
@@ -961,13 +1386,14 @@ SWITCH_DECLARE(void) switch_img_fill(switch_image_t *img, int x, int y, int w, i
 			memset(img->planes[SWITCH_PLANE_V] + img->stride[SWITCH_PLANE_V] * (i / 2) + x / 2, yuv_color.v, len);
 		}
 	} else if (img->fmt == SWITCH_IMG_FMT_ARGB) {
-		for (i = 0; i < img->d_w; i++) {
-			*((switch_rgb_color_t *)img->planes[SWITCH_PLANE_PACKED] + i) = *color;
-		}
+		uint32_t value;
 
-		for (i = 1; i < img->d_h; i++) {
-			memcpy( img->planes[SWITCH_PLANE_PACKED] + i * img->d_w * 4,
-					img->planes[SWITCH_PLANE_PACKED], img->d_w * 4);
+		w = MIN(w, img->d_w - x);
+		h = MIN(h, img->d_h - y);
+
+		if (w > 0 && h > 0) {
+			memcpy(&value, color, sizeof(value));
+			ARGBRect(img->planes[SWITCH_PLANE_PACKED], img->stride[SWITCH_PLANE_PACKED], x, y, w, h, value);
 		}
 	}
 #endif
@@ -1028,6 +1454,30 @@ SWITCH_DECLARE(void) switch_img_overlay(switch_image_t *IMG, switch_image_t *img
 	if (y & 1) y++;
 	if (len <= 0) return;
 
+#ifdef SWITCH_HAVE_YUV
+	if (img->fmt == SWITCH_IMG_FMT_I420 && max_h > y) {
+		/* constant alpha, blend the planes directly */
+		uint8_t *abuf = malloc(len);
+		int clen = (len + 1) / 2, ch = (max_h - y + 1) / 2;
+
+		switch_assert(abuf);
+		memset(abuf, alpha, len);
+
+		BlendPlane(img->planes[SWITCH_PLANE_Y] + yoff * img->stride[SWITCH_PLANE_Y] + xoff, img->stride[SWITCH_PLANE_Y],
+				   IMG->planes[SWITCH_PLANE_Y] + y * IMG->stride[SWITCH_PLANE_Y] + x, IMG->stride[SWITCH_PLANE_Y], abuf, 0,
+				   IMG->planes[SWITCH_PLANE_Y] + y * IMG->stride[SWITCH_PLANE_Y] + x, IMG->stride[SWITCH_PLANE_Y], len, max_h - y);
+
+		for (i = SWITCH_PLANE_U; i <= SWITCH_PLANE_V; i++) {
+			BlendPlane(img->planes[i] + (yoff / 2) * img->stride[i] + xoff / 2, img->stride[i],
+					   IMG->planes[i] + (y / 2) * IMG->stride[i] + x / 2, IMG->stride[i], abuf, 0,
+					   IMG->planes[i] + (y / 2) * IMG->stride[i] + x / 2, IMG->stride[i], clen, ch);
+		}
+
+		free(abuf);
+		return;
+	}
+#endif
+
 	for (i = y; i < max_h; i++) {
 		for (j = 0; j < len; j++) {
 			switch_img_get_rgb_pixel(IMG, &RGB, x + j, i);
@@ -1341,8 +1791,37 @@ static void draw_bitmap(switch_img_txt_handle_t *handle, switch_image_t *img, FT
 			return;
 	}
 
-	for ( i = x, p = 0; i < x_max; i++, p++ ) {
-		for ( j = y, q = 0; j < y_max; j++, q++ ) {
+	if (handle->use_bgcolor && img->fmt == SWITCH_IMG_FMT_I420) {
+		/* convert the gradient once per glyph instead of once per pixel */
+		switch_yuv_color_t yuv_table[MAX_GRADIENT];
+
+		for (i = 0; i < MAX_GRADIENT; i++) {
+			switch_color_rgb2yuv(&handle->gradient_table[i], &yuv_table[i]);
+		}
+
+		for ( j = MAX(y, 0), q = j - y; j < y_max && j < img->d_h; j++, q++ ) {
+			const uint8_t *row = bitmap->buffer + q * bitmap->width;
+			uint8_t *Y = img->planes[SWITCH_PLANE_Y] + j * img->stride[SWITCH_PLANE_Y];
+			uint8_t *U = img->planes[SWITCH_PLANE_U] + (j / 2) * img->stride[SWITCH_PLANE_U];
+			uint8_t *V = img->planes[SWITCH_PLANE_V] + (j / 2) * img->stride[SWITCH_PLANE_V];
+
+			for ( i = MAX(x, 0), p = i - x; i < x_max && i < img->d_w; i++, p++ ) {
+				switch_yuv_color_t *yuv = &yuv_table[row[p] * MAX_GRADIENT / 256];
+
+				Y[i] = yuv->y;
+
+				if (((i & 0x1) == 0) && ((j & 0x1) == 0)) {
+					U[i / 2] = yuv->u;
+					V[i / 2] = yuv->v;
+				}
+			}
+		}
+
+		return;
+	}
+
+	for ( j = y, q = 0; j < y_max; j++, q++ ) {
+		for ( i = x, p = 0; i < x_max; i++, p++ ) {
 			int gradient = bitmap->buffer[q * bitmap->width + p];
 			if ( i < 0 || j < 0 || i >= img->d_w || j >= img->d_h) continue;
 
@@ -2541,7 +3020,7 @@ SWITCH_DECLARE(switch_status_t) switch_img_scale(switch_image_t *src, switch_ima
 	switch_assert(width > 0);
 	switch_assert(height > 0);
 	
-	if (dest && src->fmt != dest->fmt) switch_img_free(&dest);
+	if (dest && (src->fmt != dest->fmt || dest->d_w != width || dest->d_h != height || switch_img_shared(dest))) switch_img_free(&dest);
 
 	if (!dest) dest = switch_img_alloc(NULL, src->fmt, width, height, 1);
 
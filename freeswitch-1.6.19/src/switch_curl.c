@@ -112,6 +112,867 @@ SWITCH_DECLARE(switch_status_t) switch_curl_process_form_post_params(switch_even
 
 }
 
+#define SPOOL_EXT ".spool"
+#define SPOOL_SENDING_EXT ".sending"
+#define SPOOL_TMP_EXT ".tmp"
+/* how long in flight posts may take to finish once the spool is stopped */
+#define SPOOL_SHUTDOWN_GRACE 5000000
+#define SPOOL_IDLE_WAIT 100000
+
+typedef struct spool_record {
+	char *id;
+	char *body;
+	switch_size_t len;
+	switch_time_t created;
+	/* claimed spool file, removed once the record is settled */
+	char *spool_path;
+	struct spool_record *next;
+} spool_record_t;
+
+typedef enum {
+	SPOOL_SLOT_IDLE,
+	SPOOL_SLOT_ACTIVE,
+	SPOOL_SLOT_WAITING
+} spool_slot_state_t;
+
+typedef struct {
+	CURL *curl_handle;
+	spool_slot_state_t state;
+	spool_record_t *records;
+	uint32_t count;
+	char *post;
+	char *url;
+	int url_index;
+	uint32_t tries;
+	switch_time_t started;
+	switch_time_t next_try;
+} spool_slot_t;
+
+typedef struct {
+	switch_curl_spool_t *spool;
+	CURLM *multi_handle;
+	spool_slot_t *slots;
+	uint32_t active;
+	switch_thread_t *thread;
+} spool_worker_t;
+
+struct switch_curl_spool {
+	switch_curl_spool_settings_t settings;
+	switch_memory_pool_t *pool;
+	switch_queue_t *queue;
+	struct curl_slist *headers;
+	spool_worker_t *workers;
+	switch_mutex_t *mutex;
+	switch_mutex_t *dir_mutex;
+	int url_index;
+	volatile int running;
+	/* records are counted from submit on, so the backlog never reads 0 while one is in hand */
+	uint32_t queued;
+	uint32_t spooled;
+	uint32_t in_flight;
+	switch_time_t next_scan;
+	uint64_t submitted;
+	uint64_t delivered;
+	uint64_t failed;
+	uint64_t spool_writes;
+	uint64_t retries;
+	uint64_t posts;
+	switch_time_t latency_avg;
+	switch_time_t latency_max;
+	switch_time_t post_avg;
+	long last_code;
+};
+
+static size_t spool_write_callback(char *buffer, size_t size, size_t nitems, void *outstream)
+{
+	return size * nitems;
+}
+
+static spool_record_t *spool_record_create(const char *id, const char *body, switch_size_t len)
+{
+	spool_record_t *rec;
+
+	switch_zmalloc(rec, sizeof(*rec));
+	rec->id = strdup(id);
+	rec->body = malloc(len + 1);
+	switch_assert(rec->id && rec->body);
+	memcpy(rec->body, body, len);
+	rec->body[len] = '\0';
+	rec->len = len;
+	rec->created = switch_micro_time_now();
+
+	return rec;
+}
+
+static void spool_record_destroy(spool_record_t *rec)
+{
+	switch_safe_free(rec->id);
+	switch_safe_free(rec->body);
+	switch_safe_free(rec->spool_path);
+	free(rec);
+}
+
+static char *spool_path(switch_curl_spool_t *spool, const char *id, const char *ext)
+{
+	return switch_mprintf("%s%s%s%s", spool->settings.spool_dir, SWITCH_PATH_SEPARATOR, id, ext);
+}
+
+static switch_status_t spool_write_file(const char *path, const char *body, switch_size_t len)
+{
+	FILE *f;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if ((f = fopen(path, "wb"))) {
+		if (fwrite(body, 1, len, f) == len) {
+			status = SWITCH_STATUS_SUCCESS;
+		}
+		if (fclose(f)) {
+			status = SWITCH_STATUS_FALSE;
+		}
+	}
+
+	return status;
+}
+
+static char *spool_read_file(const char *path, switch_size_t *len)
+{
+	FILE *f;
+	char *body = NULL;
+	long size;
+
+	if (!(f = fopen(path, "rb"))) {
+		return NULL;
+	}
+
+	if (!fseek(f, 0, SEEK_END) && (size = ftell(f)) >= 0 && !fseek(f, 0, SEEK_SET)) {
+		body = malloc(size + 1);
+		switch_assert(body);
+		if (fread(body, 1, size, f) == (size_t) size) {
+			body[size] = '\0';
+			*len = size;
+		} else {
+			switch_safe_free(body);
+		}
+	}
+
+	fclose(f);
+
+	return body;
+}
+
+/* Keep a record on disk for later, a record already loaded from the spool just goes back */
+static switch_status_t spool_store(switch_curl_spool_t *spool, spool_record_t *rec)
+{
+	char *tmp, *path;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if (zstr(spool->settings.spool_dir)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	path = spool_path(spool, rec->id, SPOOL_EXT);
+
+	if (rec->spool_path) {
+		if (!rename(rec->spool_path, path)) {
+			switch_mutex_lock(spool->mutex);
+			spool->spooled++;
+			switch_mutex_unlock(spool->mutex);
+			switch_safe_free(rec->spool_path);
+			status = SWITCH_STATUS_SUCCESS;
+		}
+		switch_safe_free(path);
+		return status;
+	}
+
+	switch_mutex_lock(spool->mutex);
+	if (spool->spooled < spool->settings.spool_max) {
+		spool->spooled++;
+		status = SWITCH_STATUS_SUCCESS;
+	}
+	switch_mutex_unlock(spool->mutex);
+
+	if (status != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "[%s] Spool is full, not spooling %s\n", spool->settings.name, rec->id);
+		switch_safe_free(path);
+		return status;
+	}
+
+	/* written aside first so a worker scanning the spool never reads half a record */
+	tmp = spool_path(spool, rec->id, SPOOL_TMP_EXT);
+	if ((status = spool_write_file(tmp, rec->body, rec->len)) == SWITCH_STATUS_SUCCESS && rename(tmp, path)) {
+		status = SWITCH_STATUS_FALSE;
+	}
+
+	if (status != SWITCH_STATUS_SUCCESS) {
+		char ebuf[512] = { 0 };
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] Error writing [%s][%s]\n",
+						  spool->settings.name, path, switch_strerror_r(errno, ebuf, sizeof(ebuf)));
+		remove(tmp);
+		switch_mutex_lock(spool->mutex);
+		if (spool->spooled) {
+			spool->spooled--;
+		}
+		switch_mutex_unlock(spool->mutex);
+	} else {
+		switch_mutex_lock(spool->mutex);
+		spool->spool_writes++;
+		switch_mutex_unlock(spool->mutex);
+	}
+
+	switch_safe_free(tmp);
+	switch_safe_free(path);
+
+	return status;
+}
+
+/* The record could not be posted, keep it on disk or hand it to the owner */
+static switch_status_t spool_stash(switch_curl_spool_t *spool, spool_record_t *rec)
+{
+	switch_status_t status;
+
+	if ((status = spool_store(spool, rec)) != SWITCH_STATUS_SUCCESS) {
+		if (spool->settings.fail) {
+			spool->settings.fail(rec->id, rec->body, rec->len, spool->settings.user_data);
+		}
+		if (rec->spool_path) {
+			remove(rec->spool_path);
+		}
+		switch_mutex_lock(spool->mutex);
+		spool->failed++;
+		switch_mutex_unlock(spool->mutex);
+	}
+
+	spool_record_destroy(rec);
+
+	return status;
+}
+
+/* Claim up to max spooled records by renaming them, the files go once the records are settled */
+static uint32_t spool_load(switch_curl_spool_t *spool, spool_record_t ***tail, uint32_t max)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_dir_t *dir = NULL;
+	char buf[256];
+	const char *fname;
+	uint32_t n = 0, taken = 0;
+	switch_time_t now = switch_micro_time_now();
+
+	if (zstr(spool->settings.spool_dir) || !spool->spooled || now < spool->next_scan) {
+		return 0;
+	}
+
+	if (switch_mutex_trylock(spool->dir_mutex) != SWITCH_STATUS_SUCCESS) {
+		return 0;
+	}
+
+	switch_core_new_memory_pool(&pool);
+
+	if (switch_dir_open(&dir, spool->settings.spool_dir, pool) == SWITCH_STATUS_SUCCESS) {
+		while (n < max && (fname = switch_dir_next_file(dir, buf, sizeof(buf)))) {
+			switch_size_t flen = strlen(fname), elen = strlen(SPOOL_EXT);
+			char *id, *path, *sending, *body;
+			switch_size_t len = 0;
+			spool_record_t *rec;
+
+			if (flen <= elen || strcmp(fname + flen - elen, SPOOL_EXT)) {
+				continue;
+			}
+
+			id = switch_core_strdup(pool, fname);
+			id[flen - elen] = '\0';
+			path = spool_path(spool, id, SPOOL_EXT);
+			sending = spool_path(spool, id, SPOOL_SENDING_EXT);
+
+			if (rename(path, sending)) {
+				switch_safe_free(path);
+				switch_safe_free(sending);
+				continue;
+			}
+
+			/* out of the spool now, an unreadable one is left for the next run to retry */
+			taken++;
+
+			if ((body = spool_read_file(sending, &len))) {
+				switch_zmalloc(rec, sizeof(*rec));
+				rec->id = strdup(id);
+				rec->body = body;
+				rec->len = len;
+				rec->created = now;
+				rec->spool_path = sending;
+				sending = NULL;
+				**tail = rec;
+				*tail = &rec->next;
+				n++;
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] Error reading spooled record [%s]\n", spool->settings.name, path);
+			}
+
+			switch_safe_free(path);
+			switch_safe_free(sending);
+		}
+		switch_dir_close(dir);
+	}
+
+	switch_core_destroy_memory_pool(&pool);
+
+	/* only what was taken out, a record being stored right now is counted before its file shows up */
+	switch_mutex_lock(spool->mutex);
+	spool->in_flight += n;
+	spool->spooled = spool->spooled > taken ? spool->spooled - taken : 0;
+	if (!n) {
+		spool->next_scan = now + 1000000;
+	}
+	switch_mutex_unlock(spool->mutex);
+
+	switch_mutex_unlock(spool->dir_mutex);
+
+	return n;
+}
+
+static void spool_slot_reset(switch_curl_spool_t *spool, spool_slot_t *slot)
+{
+	switch_mutex_lock(spool->mutex);
+	spool->in_flight -= slot->count;
+	switch_mutex_unlock(spool->mutex);
+
+	switch_safe_free(slot->post);
+	switch_safe_free(slot->url);
+	slot->records = NULL;
+	slot->count = 0;
+	slot->tries = 0;
+	slot->state = SPOOL_SLOT_IDLE;
+}
+
+/* Nothing more will be tried for these records, keep them for the next run */
+static void spool_slot_abandon(switch_curl_spool_t *spool, spool_slot_t *slot)
+{
+	spool_record_t *rec, *next;
+
+	for (rec = slot->records; rec; rec = next) {
+		next = rec->next;
+		spool_stash(spool, rec);
+	}
+
+	spool_slot_reset(spool, slot);
+}
+
+/* Take what is waiting in the queue, topped up from the spool */
+static uint32_t spool_slot_fill(spool_worker_t *worker, spool_slot_t *slot, switch_interval_time_t wait)
+{
+	switch_curl_spool_t *spool = worker->spool;
+	spool_record_t **tail = &slot->records;
+	uint32_t n = 0, from_queue;
+	void *pop = NULL;
+
+	if (wait && switch_queue_pop_timeout(spool->queue, &pop, wait) == SWITCH_STATUS_SUCCESS && pop) {
+		*tail = (spool_record_t *) pop;
+		tail = &(*tail)->next;
+		n++;
+	}
+
+	while (n < spool->settings.batch_size && switch_queue_trypop(spool->queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		if (pop) {
+			*tail = (spool_record_t *) pop;
+			tail = &(*tail)->next;
+			n++;
+		}
+	}
+
+	if ((from_queue = n)) {
+		switch_mutex_lock(spool->mutex);
+		spool->queued -= from_queue;
+		spool->in_flight += from_queue;
+		switch_mutex_unlock(spool->mutex);
+	}
+
+	if (n < spool->settings.batch_size && spool->running) {
+		n += spool_load(spool, &tail, spool->settings.batch_size - n);
+	}
+
+	*tail = NULL;
+	slot->count = n;
+
+	return n;
+}
+
+static void spool_slot_post(spool_worker_t *worker, spool_slot_t *slot)
+{
+	switch_curl_spool_t *spool = worker->spool;
+	switch_curl_spool_settings_t *settings = &spool->settings;
+	const char *url;
+
+	if (!slot->post) {
+		switch_size_t prefix_len = strlen(settings->record_prefix), sep_len = strlen(settings->batch_separator);
+		switch_size_t open_len = strlen(settings->batch_open), close_len = strlen(settings->batch_close);
+		switch_size_t need = 1;
+		spool_record_t *rec;
+		char *p;
+		int batch = settings->batch_size > 1;
+
+		if (batch) {
+			need += open_len + close_len;
+		}
+
+		for (rec = slot->records; rec; rec = rec->next) {
+			need += prefix_len + rec->len + sep_len;
+		}
+
+		p = slot->post = malloc(need);
+		switch_assert(p);
+
+		if (batch) {
+			memcpy(p, settings->batch_open, open_len);
+			p += open_len;
+		}
+
+		for (rec = slot->records; rec; rec = rec->next) {
+			if (rec != slot->records) {
+				memcpy(p, settings->batch_separator, sep_len);
+				p += sep_len;
+			}
+			memcpy(p, settings->record_prefix, prefix_len);
+			p += prefix_len;
+			memcpy(p, rec->body, rec->len);
+			p += rec->len;
+		}
+
+		if (batch) {
+			memcpy(p, settings->batch_close, close_len);
+			p += close_len;
+		}
+
+		*p = '\0';
+	}
+
+	switch_mutex_lock(spool->mutex);
+	slot->url_index = spool->url_index;
+	switch_mutex_unlock(spool->mutex);
+
+	url = settings->urls[slot->url_index];
+	switch_safe_free(slot->url);
+
+	if (settings->batch_size > 1) {
+		slot->url = switch_mprintf("%s%ccount=%u", url, strchr(url, '?') ? '&' : '?', slot->count);
+	} else {
+		slot->url = switch_mprintf("%s%cuuid=%s", url, strchr(url, '?') ? '&' : '?', slot->records->id);
+	}
+
+	curl_easy_setopt(slot->curl_handle, CURLOPT_URL, slot->url);
+	curl_easy_setopt(slot->curl_handle, CURLOPT_POSTFIELDS, slot->post);
+	curl_easy_setopt(slot->curl_handle, CURLOPT_POSTFIELDSIZE, (long) strlen(slot->post));
+
+	if (settings->setup) {
+		settings->setup(slot->curl_handle, slot->url, settings->user_data);
+	}
+
+	slot->started = switch_micro_time_now();
+	slot->state = SPOOL_SLOT_ACTIVE;
+	curl_multi_add_handle(worker->multi_handle, slot->curl_handle);
+	worker->active++;
+}
+
+static void spool_slot_done(spool_worker_t *worker, spool_slot_t *slot, CURLcode result)
+{
+	switch_curl_spool_t *spool = worker->spool;
+	switch_curl_spool_settings_t *settings = &spool->settings;
+	switch_time_t now = switch_micro_time_now();
+	spool_record_t *rec, *next;
+	long httpRes = 0;
+
+	curl_multi_remove_handle(worker->multi_handle, slot->curl_handle);
+	worker->active--;
+
+	if (result == CURLE_OK) {
+		curl_easy_getinfo(slot->curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
+	}
+
+	switch_mutex_lock(spool->mutex);
+	spool->posts++;
+	spool->last_code = httpRes;
+	spool->post_avg = spool->post_avg ? (spool->post_avg * 7 + (now - slot->started)) / 8 : now - slot->started;
+	switch_mutex_unlock(spool->mutex);
+
+	if (httpRes >= 200 && httpRes <= 299) {
+		switch_mutex_lock(spool->mutex);
+		for (rec = slot->records; rec; rec = rec->next) {
+			switch_time_t latency = now - rec->created;
+
+			spool->latency_avg = spool->latency_avg ? (spool->latency_avg * 7 + latency) / 8 : latency;
+			if (latency > spool->latency_max) {
+				spool->latency_max = latency;
+			}
+		}
+		spool->delivered += slot->count;
+		switch_mutex_unlock(spool->mutex);
+
+		for (rec = slot->records; rec; rec = next) {
+			next = rec->next;
+			if (rec->spool_path) {
+				remove(rec->spool_path);
+			}
+			spool_record_destroy(rec);
+		}
+
+		spool_slot_reset(spool, slot);
+		return;
+	}
+
+	if (result != CURLE_OK) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] Got error [%s] posting %u records to web server [%s]\n",
+						  settings->name, curl_easy_strerror(result), slot->count, settings->urls[slot->url_index]);
+	} else {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] Got error [%ld] posting %u records to web server [%s]\n",
+						  settings->name, httpRes, slot->count, settings->urls[slot->url_index]);
+	}
+
+	switch_mutex_lock(spool->mutex);
+	if (spool->url_index == slot->url_index) {
+		spool->url_index = (slot->url_index + 1) % settings->url_count;
+		if (settings->url_count > 1) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] Retry will be with url [%s]\n", settings->name, settings->urls[spool->url_index]);
+		}
+	}
+	switch_mutex_unlock(spool->mutex);
+
+	if (++slot->tries < settings->retries && spool->running) {
+		switch_mutex_lock(spool->mutex);
+		spool->retries++;
+		switch_mutex_unlock(spool->mutex);
+		slot->next_try = now + settings->delay * 1000000;
+		slot->state = SPOOL_SLOT_WAITING;
+		return;
+	}
+
+	if (!spool->running) {
+		spool_slot_abandon(spool, slot);
+		return;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] Unable to post %u records to web server\n", settings->name, slot->count);
+
+	for (rec = slot->records; rec; rec = next) {
+		next = rec->next;
+		if (settings->fail) {
+			settings->fail(rec->id, rec->body, rec->len, settings->user_data);
+		}
+		if (rec->spool_path) {
+			remove(rec->spool_path);
+		}
+		spool_record_destroy(rec);
+	}
+
+	switch_mutex_lock(spool->mutex);
+	spool->failed += slot->count;
+	switch_mutex_unlock(spool->mutex);
+
+	spool_slot_reset(spool, slot);
+}
+
+static void *SWITCH_THREAD_FUNC spool_worker_run(switch_thread_t *thread, void *obj)
+{
+	spool_worker_t *worker = (spool_worker_t *) obj;
+	switch_curl_spool_t *spool = worker->spool;
+	uint32_t connections = spool->settings.connections;
+	switch_time_t stopped = 0;
+
+	for (;;) {
+		switch_time_t now = switch_micro_time_now();
+		int idle = 1, waiting = 0;
+		uint32_t i;
+
+		if (!spool->running && !stopped) {
+			stopped = now;
+		}
+
+		for (i = 0; i < connections; i++) {
+			spool_slot_t *slot = &worker->slots[i];
+
+			if (slot->state == SPOOL_SLOT_WAITING) {
+				if (!spool->running) {
+					spool_slot_abandon(spool, slot);
+				} else if (now >= slot->next_try) {
+					spool_slot_post(worker, slot);
+				} else {
+					waiting++;
+				}
+			} else if (slot->state == SPOOL_SLOT_IDLE && spool->running && spool_slot_fill(worker, slot, 0)) {
+				spool_slot_post(worker, slot);
+			}
+
+			if (slot->state != SPOOL_SLOT_IDLE) {
+				idle = 0;
+			}
+		}
+
+		if (worker->active) {
+			CURLMsg *msg;
+			int running_handles = 0, left = 0, numfds = 0;
+
+			curl_multi_perform(worker->multi_handle, &running_handles);
+
+			while ((msg = curl_multi_info_read(worker->multi_handle, &left))) {
+				if (msg->msg == CURLMSG_DONE) {
+					spool_slot_t *slot = NULL;
+
+					curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &slot);
+					spool_slot_done(worker, slot, msg->data.result);
+				}
+			}
+
+			if (stopped && now - stopped > SPOOL_SHUTDOWN_GRACE) {
+				for (i = 0; i < connections; i++) {
+					spool_slot_t *slot = &worker->slots[i];
+
+					if (slot->state == SPOOL_SLOT_ACTIVE) {
+						curl_multi_remove_handle(worker->multi_handle, slot->curl_handle);
+						worker->active--;
+						spool_slot_abandon(spool, slot);
+					}
+				}
+			} else if (worker->active) {
+				curl_multi_wait(worker->multi_handle, NULL, 0, 50, &numfds);
+			}
+		} else if (!spool->running) {
+			break;
+		} else if (idle) {
+			/* nothing to do, sleep on the queue */
+			if (spool_slot_fill(worker, &worker->slots[0], SPOOL_IDLE_WAIT)) {
+				spool_slot_post(worker, &worker->slots[0]);
+			}
+		} else if (waiting) {
+			switch_yield(SPOOL_IDLE_WAIT / 2);
+		}
+	}
+
+	return NULL;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_curl_spool_create(switch_curl_spool_t **spoolp, const switch_curl_spool_settings_t *settings, switch_memory_pool_t *pool)
+{
+	switch_curl_spool_t *spool;
+	switch_curl_spool_settings_t *s;
+	switch_threadattr_t *thd_attr = NULL;
+	char *header;
+	int i;
+	uint32_t w, c;
+
+	*spoolp = NULL;
+
+	if (!settings->url_count) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	spool = switch_core_alloc(pool, sizeof(*spool));
+	spool->pool = pool;
+	spool->settings = *settings;
+	s = &spool->settings;
+
+	s->name = switch_core_strdup(pool, zstr(settings->name) ? "curl_spool" : settings->name);
+	s->urls = switch_core_alloc(pool, sizeof(char *) * settings->url_count);
+	for (i = 0; i < settings->url_count; i++) {
+		s->urls[i] = switch_core_strdup(pool, settings->urls[i]);
+	}
+	s->spool_dir = zstr(settings->spool_dir) ? NULL : switch_core_strdup(pool, settings->spool_dir);
+	s->content_type = switch_core_strdup(pool, zstr(settings->content_type) ? "application/x-www-form-urlencoded" : settings->content_type);
+	s->user_agent = switch_core_strdup(pool, zstr(settings->user_agent) ? "freeswitch/1.0" : settings->user_agent);
+	s->record_prefix = switch_core_strdup(pool, switch_str_nil(settings->record_prefix));
+	s->batch_open = switch_core_strdup(pool, switch_str_nil(settings->batch_open));
+	s->batch_separator = switch_core_strdup(pool, switch_str_nil(settings->batch_separator));
+	s->batch_close = switch_core_strdup(pool, switch_str_nil(settings->batch_close));
+
+	if (!s->workers) s->workers = 1;
+	if (!s->connections) s->connections = 4;
+	if (!s->batch_size) s->batch_size = 1;
+	if (!s->queue_size) s->queue_size = 1000;
+	if (!s->spool_max) s->spool_max = 10000;
+	if (!s->retries) s->retries = 1;
+
+	switch_mutex_init(&spool->mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_mutex_init(&spool->dir_mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_queue_create(&spool->queue, s->queue_size, pool);
+
+	header = switch_core_sprintf(pool, "Content-Type: %s", s->content_type);
+	spool->headers = curl_slist_append(spool->headers, header);
+	if (s->disable_expect) {
+		spool->headers = curl_slist_append(spool->headers, "Expect:");
+	}
+
+	if (s->spool_dir) {
+		switch_dir_t *dir = NULL;
+		char buf[256];
+		const char *fname;
+
+		switch_dir_make_recursive(s->spool_dir, SWITCH_DEFAULT_DIR_PERMS, pool);
+
+		/* count what a previous run left, records it was still sending go back in the spool */
+		if (switch_dir_open(&dir, s->spool_dir, pool) == SWITCH_STATUS_SUCCESS) {
+			while ((fname = switch_dir_next_file(dir, buf, sizeof(buf)))) {
+				switch_size_t flen = strlen(fname);
+
+				if (flen > strlen(SPOOL_EXT) && !strcmp(fname + flen - strlen(SPOOL_EXT), SPOOL_EXT)) {
+					spool->spooled++;
+				} else if (flen > strlen(SPOOL_SENDING_EXT) && !strcmp(fname + flen - strlen(SPOOL_SENDING_EXT), SPOOL_SENDING_EXT)) {
+					char *id = switch_core_strdup(pool, fname), *from, *to;
+
+					id[flen - strlen(SPOOL_SENDING_EXT)] = '\0';
+					from = spool_path(spool, id, SPOOL_SENDING_EXT);
+					to = spool_path(spool, id, SPOOL_EXT);
+
+					if (!rename(from, to)) {
+						spool->spooled++;
+					}
+					switch_safe_free(from);
+					switch_safe_free(to);
+				}
+			}
+			switch_dir_close(dir);
+		}
+
+		if (spool->spooled) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "[%s] %u spooled records to deliver\n", s->name, spool->spooled);
+		}
+	}
+
+	spool->running = 1;
+	spool->workers = switch_core_alloc(pool, sizeof(spool_worker_t) * s->workers);
+
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (w = 0; w < s->workers; w++) {
+		spool_worker_t *worker = &spool->workers[w];
+
+		worker->spool = spool;
+		worker->multi_handle = curl_multi_init();
+		worker->slots = switch_core_alloc(pool, sizeof(spool_slot_t) * s->connections);
+		curl_multi_setopt(worker->multi_handle, CURLMOPT_MAXCONNECTS, (long) s->connections);
+
+		for (c = 0; c < s->connections; c++) {
+			spool_slot_t *slot = &worker->slots[c];
+			CURL *curl_handle = curl_easy_init();
+
+			/* the handles live as long as the spool so their connections are reused */
+			curl_easy_setopt(curl_handle, CURLOPT_PRIVATE, (char *) slot);
+			curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, spool->headers);
+			curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
+			curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
+			curl_easy_setopt(curl_handle, CURLOPT_TCP_KEEPALIVE, 1);
+			curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, s->user_agent);
+			curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, spool_write_callback);
+			if (s->timeout) {
+				curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, (long) s->timeout);
+			}
+			if (s->connect_timeout) {
+				curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT, (long) s->connect_timeout);
+			}
+			slot->curl_handle = curl_handle;
+		}
+
+		switch_thread_create(&worker->thread, thd_attr, spool_worker_run, worker, pool);
+	}
+
+	*spoolp = spool;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_curl_spool_submit(switch_curl_spool_t *spool, const char *id, const char *body)
+{
+	spool_record_t *rec = spool_record_create(id, body, strlen(body));
+
+	switch_mutex_lock(spool->mutex);
+	spool->submitted++;
+	spool->queued++;
+	switch_mutex_unlock(spool->mutex);
+
+	if (spool->running && switch_queue_trypush(spool->queue, rec) == SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_mutex_lock(spool->mutex);
+	spool->queued--;
+	switch_mutex_unlock(spool->mutex);
+
+	return spool_stash(spool, rec);
+}
+
+SWITCH_DECLARE(uint32_t) switch_curl_spool_backlog(switch_curl_spool_t *spool)
+{
+	uint32_t backlog;
+
+	switch_mutex_lock(spool->mutex);
+	backlog = spool->queued + spool->in_flight + spool->spooled;
+	switch_mutex_unlock(spool->mutex);
+
+	return backlog;
+}
+
+SWITCH_DECLARE(void) switch_curl_spool_status(switch_curl_spool_t *spool, switch_stream_handle_t *stream)
+{
+	switch_mutex_lock(spool->mutex);
+	stream->write_function(stream, "Name             \t%s\n", spool->settings.name);
+	stream->write_function(stream, "URL              \t%s\n", spool->settings.urls[spool->url_index]);
+	stream->write_function(stream, "Backlog          \t%u\n", spool->queued + spool->in_flight + spool->spooled);
+	stream->write_function(stream, "Queued           \t%u\n", spool->queued);
+	stream->write_function(stream, "In-Flight        \t%u\n", spool->in_flight);
+	stream->write_function(stream, "Spooled          \t%u\n", spool->spooled);
+	stream->write_function(stream, "Submitted        \t%" SWITCH_UINT64_T_FMT "\n", spool->submitted);
+	stream->write_function(stream, "Delivered        \t%" SWITCH_UINT64_T_FMT "\n", spool->delivered);
+	stream->write_function(stream, "Failed           \t%" SWITCH_UINT64_T_FMT "\n", spool->failed);
+	stream->write_function(stream, "Spool-Writes     \t%" SWITCH_UINT64_T_FMT "\n", spool->spool_writes);
+	stream->write_function(stream, "Posts            \t%" SWITCH_UINT64_T_FMT "\n", spool->posts);
+	stream->write_function(stream, "Retries          \t%" SWITCH_UINT64_T_FMT "\n", spool->retries);
+	stream->write_function(stream, "Last-Code        \t%ld\n", spool->last_code);
+	stream->write_function(stream, "Latency-Avg-ms   \t%.3f\n", spool->latency_avg / 1000.0);
+	stream->write_function(stream, "Latency-Max-ms   \t%.3f\n", spool->latency_max / 1000.0);
+	stream->write_function(stream, "Post-Avg-ms      \t%.3f\n", spool->post_avg / 1000.0);
+	switch_mutex_unlock(spool->mutex);
+}
+
+SWITCH_DECLARE(void) switch_curl_spool_destroy(switch_curl_spool_t **spoolp)
+{
+	switch_curl_spool_t *spool = *spoolp;
+	switch_status_t st;
+	void *pop = NULL;
+	uint32_t w, c;
+
+	if (!spool) {
+		return;
+	}
+
+	*spoolp = NULL;
+	spool->running = 0;
+
+	for (w = 0; w < spool->settings.workers; w++) {
+		switch_thread_join(&st, spool->workers[w].thread);
+	}
+
+	while (switch_queue_trypop(spool->queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		if (pop) {
+			switch_mutex_lock(spool->mutex);
+			spool->queued--;
+			switch_mutex_unlock(spool->mutex);
+			spool_stash(spool, (spool_record_t *) pop);
+		}
+	}
+
+	if (spool->spooled) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "[%s] %u records left in the spool\n", spool->settings.name, spool->spooled);
+	}
+
+	for (w = 0; w < spool->settings.workers; w++) {
+		spool_worker_t *worker = &spool->workers[w];
+
+		for (c = 0; c < spool->settings.connections; c++) {
+			curl_easy_cleanup(worker->slots[c].curl_handle);
+		}
+		curl_multi_cleanup(worker->multi_handle);
+	}
+
+	curl_slist_free_all(spool->headers);
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
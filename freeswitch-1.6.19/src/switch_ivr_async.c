@@ -1028,6 +1028,37 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_displace_session(switch_core_session_
 }
 
 
+/* most writer threads record_writer_threads may ask for */
+#define RECORD_WRITER_MAX_THREADS 64
+/* recordings waiting for a writer, each one is queued at most once */
+#define RECORD_WRITER_QUEUE_LEN 65536
+/* how many milliseconds a media thread waits for room before dropping audio */
+#define RECORD_WRITER_GRACE_MS 5
+
+/*
+  Audio of one recording on its way from the media thread to a writer thread.
+  The ring has a single producer and a single consumer, head and tail only
+  ever grow and wrap with the 32 bit arithmetic.
+*/
+typedef struct record_writer_s {
+	uint8_t *ring;
+	uint32_t size;
+	volatile switch_atomic_t head;
+	volatile switch_atomic_t tail;
+	/* set while the recording sits in the writer queue or is being written */
+	volatile switch_atomic_t queued;
+	volatile switch_atomic_t failed;
+	int closing;
+	uint32_t chunk;
+	uint32_t channels;
+	/* audio the media thread could not queue and how often it found the ring full */
+	switch_size_t dropped;
+	uint32_t full;
+	switch_file_handle_t *fh;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+} record_writer_t;
+
 struct record_helper {
 	char *file;
 	switch_file_handle_t *fh;
@@ -1048,10 +1079,7 @@ struct record_helper {
 	switch_bool_t hangup_on_error;
 	switch_codec_implementation_t read_impl;
 	switch_bool_t speech_detected;
-	switch_buffer_t *thread_buffer;
-	switch_thread_t *thread;
-	switch_mutex_t *buffer_mutex;
-	int thread_ready;
+	record_writer_t *writer;
 	uint32_t writes;
 	uint32_t vwrites;
 	const char *completion_cause;
@@ -1097,6 +1125,12 @@ static switch_bool_t is_silence_frame(switch_frame_t *frame, int silence_thresho
 static void send_record_stop_event(switch_channel_t *channel, switch_codec_implementation_t *read_impl, struct record_helper *rh)
 {
 	switch_event_t *event;
+	switch_size_t dropped = 0;
+
+	if (rh->writer) {
+		dropped = rh->writer->dropped / 2 / rh->writer->channels;
+		switch_channel_set_variable_printf(channel, "record_dropped_samples", "%" SWITCH_SIZE_T_FMT, dropped);
+	}
 
 	if (rh->fh) {
 		switch_channel_set_variable_printf(channel, "record_samples", "%d", rh->fh->samples_out);
@@ -1116,71 +1150,206 @@ static void send_record_stop_event(switch_channel_t *channel, switch_codec_imple
 		if (!zstr(rh->completion_cause)) {
 			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Record-Completion-Cause", rh->completion_cause);
 		}
+		if (rh->writer) {
+			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Record-Dropped-Samples", "%" SWITCH_SIZE_T_FMT, dropped);
+		}
 		switch_event_fire(&event);
 	}
 }
 
-static void *SWITCH_THREAD_FUNC recording_thread(switch_thread_t *thread, void *obj)
+static struct {
+	switch_queue_t *queue;
+	switch_thread_t *threads[RECORD_WRITER_MAX_THREADS];
+	uint32_t thread_count;
+} record_writers;
+
+/* a full barrier read of a position the other side moves */
+static inline uint32_t record_writer_load(volatile switch_atomic_t *pos)
 {
-	switch_media_bug_t *bug = (switch_media_bug_t *) obj;
-	switch_core_session_t *session = switch_core_media_bug_get_session(bug);
-	switch_channel_t *channel = switch_core_session_get_channel(session);
-	struct record_helper *rh;
-	switch_size_t bsize = SWITCH_RECOMMENDED_BUFFER_SIZE, samples = 0, inuse = 0;
-	unsigned char *data;
-	int channels = 1;
-	switch_codec_implementation_t read_impl = { 0 };
+	return switch_atomic_cas(pos, 0, 0);
+}
 
-	if (switch_core_session_read_lock(session) != SWITCH_STATUS_SUCCESS) {
-		return NULL;
+static void record_writer_kick(record_writer_t *w)
+{
+	if (switch_atomic_cas(&w->queued, 1, 0) == 0 && switch_queue_trypush(record_writers.queue, w) != SWITCH_STATUS_SUCCESS) {
+		/* try again with the next frame */
+		switch_atomic_set(&w->queued, 0);
 	}
+}
 
-	rh = switch_core_media_bug_get_user_data(bug);
-	switch_buffer_create_dynamic(&rh->thread_buffer, 1024 * 512, 1024 * 64, 0);
-	rh->thread_ready = 1;
+/* Called on the media thread only, never blocks for longer than the grace period */
+static void record_writer_push(record_writer_t *w, const void *data, uint32_t len)
+{
+	uint32_t head = w->head, tail = record_writer_load(&w->tail), off, first;
+	int grace = RECORD_WRITER_GRACE_MS;
 
-	channels = switch_core_media_bug_test_flag(bug, SMBF_STEREO) ? 2 : rh->read_impl.number_of_channels;
-	data = switch_core_session_alloc(session, SWITCH_RECOMMENDED_BUFFER_SIZE);
+	if (w->size - (head - tail) < len) {
+		w->full++;
+		record_writer_kick(w);
 
-	while(switch_test_flag(rh->fh, SWITCH_FILE_OPEN)) {
-		if (switch_core_file_has_video(rh->fh, SWITCH_TRUE)) {
-			switch_core_session_get_read_impl(session, &read_impl);
-			if (read_impl.decoded_bytes_per_packet > 0 && read_impl.decoded_bytes_per_packet <= SWITCH_RECOMMENDED_BUFFER_SIZE) {
-				bsize = read_impl.decoded_bytes_per_packet;
-			}
+		while (w->size - (head - (tail = record_writer_load(&w->tail))) < len && grace-- > 0) {
+			switch_yield(1000);
 		}
 
-		switch_mutex_lock(rh->buffer_mutex);
-		inuse = switch_buffer_inuse(rh->thread_buffer);
+		if (w->size - (head - tail) < len) {
+			w->dropped += len;
+			return;
+		}
+	}
 
-		if (rh->thread_ready && switch_channel_up_nosig(channel) && inuse < bsize) {
-			switch_mutex_unlock(rh->buffer_mutex);
-			switch_yield(20000);
-			continue;
-		} else if ((!rh->thread_ready || switch_channel_down_nosig(channel)) && !inuse) {
-			switch_mutex_unlock(rh->buffer_mutex);
-			break;
+	off = head & (w->size - 1);
+	first = w->size - off < len ? w->size - off : len;
+	memcpy(w->ring + off, data, first);
+	memcpy(w->ring, (const uint8_t *) data + first, len - first);
+	switch_atomic_add(&w->head, len);
+
+	/* let the writers collect a good amount before waking one */
+	if (head + len - tail >= w->size / 4) {
+		record_writer_kick(w);
+	}
+}
+
+/* Write out everything queued so far, one chunk at a time */
+static void record_writer_drain(record_writer_t *w, uint8_t *scratch)
+{
+	uint32_t head = record_writer_load(&w->head), tail = w->tail;
+
+	while (head != tail) {
+		uint32_t len = head - tail, off = tail & (w->size - 1), first;
+		switch_size_t samples;
+
+		if (len > w->chunk) {
+			len = w->chunk;
 		}
-		
-		samples = switch_buffer_read(rh->thread_buffer, data, bsize) / 2 / channels;
-		switch_mutex_unlock(rh->buffer_mutex);
-
-		if (switch_core_file_write(rh->fh, data, &samples) != SWITCH_STATUS_SUCCESS) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing %s\n", rh->file);
-			/* File write failed */
-			set_completion_cause(rh, "uri-failure");
-			if (rh->hangup_on_error) {
-				switch_channel_hangup(channel, SWITCH_CAUSE_DESTINATION_OUT_OF_ORDER);
-				switch_core_session_reset(session, SWITCH_TRUE, SWITCH_TRUE);
-			}
+
+		first = w->size - off < len ? w->size - off : len;
+		memcpy(scratch, w->ring + off, first);
+		memcpy(scratch + first, w->ring, len - first);
+
+		/* hand the room back before the slow part */
+		switch_atomic_add(&w->tail, len);
+		tail += len;
+
+		samples = len / 2 / w->channels;
+
+		if (!switch_atomic_read(&w->failed) && switch_core_file_write(w->fh, scratch, &samples) != SWITCH_STATUS_SUCCESS) {
+			switch_atomic_set(&w->failed, 1);
+		}
+
+		if (head == tail) {
+			head = record_writer_load(&w->head);
 		}
 	}
+}
 
-	switch_core_session_rwunlock(session);
+static void *SWITCH_THREAD_FUNC record_writer_thread(switch_thread_t *thread, void *obj)
+{
+	uint8_t scratch[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	void *pop;
+
+	while (switch_queue_pop(record_writers.queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		record_writer_t *w = (record_writer_t *) pop;
+		uint32_t used;
+
+		record_writer_drain(w, scratch);
+
+		switch_mutex_lock(w->mutex);
+		switch_atomic_set(&w->queued, 0);
+		used = record_writer_load(&w->head) - w->tail;
+		if (used >= w->size / 4 || (w->closing && used)) {
+			record_writer_kick(w);
+		}
+		switch_thread_cond_signal(w->cond);
+		switch_mutex_unlock(w->mutex);
+	}
 
 	return NULL;
 }
 
+static record_writer_t *record_writer_create(switch_core_session_t *session, switch_file_handle_t *fh, uint32_t channels, uint32_t packet_len)
+{
+	switch_memory_pool_t *pool = switch_core_session_get_pool(session);
+	record_writer_t *w;
+
+	if (!record_writers.thread_count || !channels) {
+		return NULL;
+	}
+
+	w = switch_core_session_alloc(session, sizeof(*w));
+	w->size = runtime.record_ring_size;
+	w->ring = switch_core_session_alloc(session, w->size);
+	w->fh = fh;
+	w->channels = channels;
+	w->chunk = SWITCH_RECOMMENDED_BUFFER_SIZE;
+
+	/* video files want the audio in packets to keep it in step */
+	if (switch_core_file_has_video(fh, SWITCH_TRUE) && packet_len > 0 && packet_len <= SWITCH_RECOMMENDED_BUFFER_SIZE) {
+		w->chunk = packet_len;
+	}
+
+	w->chunk -= w->chunk % (2 * channels);
+
+	switch_mutex_init(&w->mutex, SWITCH_MUTEX_DEFAULT, pool);
+	switch_thread_cond_create(&w->cond, pool);
+
+	return w;
+}
+
+/* Wait for the writers to finish with the recording, it must not be touched by them afterwards */
+static void record_writer_close(record_writer_t *w)
+{
+	switch_mutex_lock(w->mutex);
+	w->closing = 1;
+	while (w->head != record_writer_load(&w->tail) || switch_atomic_read(&w->queued)) {
+		record_writer_kick(w);
+		switch_thread_cond_timedwait(w->cond, w->mutex, 20000);
+	}
+	switch_mutex_unlock(w->mutex);
+}
+
+void switch_ivr_record_writer_init(switch_memory_pool_t *pool)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i, threads = runtime.record_writer_threads;
+
+	if (!threads) {
+		return;
+	}
+
+	if (threads > RECORD_WRITER_MAX_THREADS) {
+		threads = RECORD_WRITER_MAX_THREADS;
+	}
+
+	switch_queue_create(&record_writers.queue, RECORD_WRITER_QUEUE_LEN, pool);
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (i = 0; i < threads; i++) {
+		if (switch_thread_create(&record_writers.threads[i], thd_attr, record_writer_thread, NULL, pool) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+	}
+
+	record_writers.thread_count = i;
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Started %u recording writer threads\n", i);
+}
+
+void switch_ivr_record_writer_shutdown(void)
+{
+	uint32_t i, count = record_writers.thread_count;
+	switch_status_t st;
+
+	record_writers.thread_count = 0;
+
+	for (i = 0; i < count; i++) {
+		switch_queue_push(record_writers.queue, NULL);
+	}
+
+	for (i = 0; i < count; i++) {
+		switch_thread_join(&st, record_writers.threads[i]);
+	}
+}
+
 static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, switch_abc_type_t type)
 {
 	switch_core_session_t *session = switch_core_media_bug_get_session(bug);
@@ -1197,21 +1366,15 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 		{
 			const char *var = switch_channel_get_variable(channel, "RECORD_USE_THREAD");
 
+			/* a copy made by switch_ivr_transfer_recordings gets its own writer */
+			rh->writer = NULL;
+
 			if (!rh->native && rh->fh && (zstr(var) || switch_true(var))) {
-				switch_threadattr_t *thd_attr = NULL;
-				switch_memory_pool_t *pool = switch_core_session_get_pool(session);
-				int sanity = 200;
+				uint32_t channels;
 
-				
 				switch_core_session_get_read_impl(session, &rh->read_impl);
-				switch_mutex_init(&rh->buffer_mutex, SWITCH_MUTEX_NESTED, pool);
-				switch_threadattr_create(&thd_attr, pool);
-				switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
-				switch_thread_create(&rh->thread, thd_attr, recording_thread, bug, pool);
-				
-				while(--sanity > 0 && !rh->thread_ready) {
-					switch_yield(10000);
-				}
+				channels = switch_core_media_bug_test_flag(bug, SMBF_STEREO) ? 2 : rh->read_impl.number_of_channels;
+				rh->writer = record_writer_create(session, rh->fh, channels, rh->read_impl.decoded_bytes_per_packet);
 			}
 
 			if (switch_event_create(&event, SWITCH_EVENT_RECORD_START) == SWITCH_STATUS_SUCCESS) {
@@ -1324,15 +1487,18 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 				uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
 				switch_frame_t frame = { 0 };
 
-				if (rh->thread_ready) {
-					switch_status_t st;
+				if (rh->writer) {
+					record_writer_close(rh->writer);
 
-					rh->thread_ready = 0;
-					switch_thread_join(&st, rh->thread);
-				}
+					if (rh->writer->dropped) {
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Dropped %" SWITCH_SIZE_T_FMT " bytes of %s, the writers fell behind %u times\n",
+										  rh->writer->dropped, rh->file, rh->writer->full);
+					}
 
-				if (rh->thread_buffer) {
-					switch_buffer_destroy(&rh->thread_buffer);
+					if (switch_atomic_read(&rh->writer->failed)) {
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing %s\n", rh->file);
+						set_completion_cause(rh, "uri-failure");
+					}
 				}
 
 
@@ -1440,13 +1606,22 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 				if (status != SWITCH_STATUS_SUCCESS || !frame.datalen) {
 					break;
 				} else {
+					switch_status_t wstatus = SWITCH_STATUS_SUCCESS;
+
 					len = (switch_size_t) frame.datalen / 2 / frame.channels;
 					
-					if (rh->thread_buffer) {
-						switch_mutex_lock(rh->buffer_mutex);
-						switch_buffer_write(rh->thread_buffer, mask ? null_data : data, frame.datalen);
-						switch_mutex_unlock(rh->buffer_mutex);
-					} else if (switch_core_file_write(rh->fh, mask ? null_data : data, &len) != SWITCH_STATUS_SUCCESS) {
+					if (rh->writer) {
+						/* a writer thread failed on an earlier chunk */
+						if (switch_atomic_read(&rh->writer->failed)) {
+							wstatus = SWITCH_STATUS_FALSE;
+						} else {
+							record_writer_push(rh->writer, mask ? null_data : data, frame.datalen);
+						}
+					} else {
+						wstatus = switch_core_file_write(rh->fh, mask ? null_data : data, &len);
+					}
+
+					if (wstatus != SWITCH_STATUS_SUCCESS) {
 						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing %s\n", rh->file);
 						/* File write failed */
 						set_completion_cause(rh, "uri-failure");
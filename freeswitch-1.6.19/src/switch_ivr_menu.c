@@ -323,6 +323,43 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_menu_stack_free(switch_ivr_menu_t *st
 	return status;
 }
 
+/* Open the sounds likely to follow the greeting while it plays: the short greeting, the invalid sound, then what the digits lead to */
+static void menu_prefetch(switch_core_session_t *session, switch_ivr_menu_t *stack, switch_ivr_menu_t *menu, uint32_t depth)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	switch_ivr_menu_action_t *ap;
+	switch_ivr_menu_t *sub;
+	const char *sounds[16];
+	uint32_t x, count = 0;
+
+	sounds[count++] = menu->short_greeting_sound;
+	sounds[count++] = menu->invalid_sound;
+
+	for (ap = menu->actions; ap && count < sizeof(sounds) / sizeof(sounds[0]); ap = ap->next) {
+		if (ap->ivr_action == SWITCH_IVR_ACTION_EXECMENU && (sub = switch_ivr_menu_find(stack, ap->arg)) && sub != menu) {
+			sounds[count++] = sub->greeting_sound;
+		} else if (ap->ivr_action == SWITCH_IVR_ACTION_PLAYSOUND) {
+			sounds[count++] = ap->arg;
+		}
+	}
+
+	for (x = 0; x < count && depth; x++) {
+		char *expanded;
+
+		if (zstr(sounds[x])) {
+			continue;
+		}
+
+		expanded = switch_channel_expand_variables(channel, sounds[x]);
+		switch_ivr_prefetch_file(session, expanded);
+		if (expanded != sounds[x]) {
+			free(expanded);
+		}
+
+		depth--;
+	}
+}
+
 static switch_status_t play_and_collect(switch_core_session_t *session, switch_ivr_menu_t *menu, char *sound, switch_size_t need)
 {
 	char terminator;
@@ -457,6 +494,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_menu_execute(switch_core_session_t *s
 	switch_ivr_menu_t *menu = NULL;
 	switch_channel_t *channel;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	uint32_t depth;
 
 	if (++stack->stack_count > 12) {
 		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Too many levels of recursion.\n");
@@ -485,6 +523,10 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_menu_execute(switch_core_session_t *s
 
 	ivr_send_event(session, MENU_EVENT_ENTER, menu);
 
+	if ((depth = switch_ivr_prefetch_depth(session))) {
+		menu_prefetch(session, stack, menu, depth);
+	}
+
 	if (!zstr(menu->pin)) {
 		char digit_buffer[128] = "";
 		char *digits_regex = switch_core_session_sprintf(session, "^%s$", menu->pin);
@@ -36,6 +36,43 @@
 
 #include <switch.h>
 
+/* The data of a phrase action with the pattern's captures and the variables filled in, NULL when out of memory */
+static char *phrase_action_data(switch_core_session_t *session, switch_event_t *event, switch_xml_t action, const char *pattern,
+								switch_regex_t *re, int proceed, int *ovector, const char *data, const char *field_expanded)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	char *adata = (char *) switch_xml_attr_soft(action, "data");
+	char *substituted = NULL;
+	char *expanded;
+	uint32_t len;
+
+	if (strchr(pattern, '(') && strchr(adata, '$') && proceed > 0) {
+		len = (uint32_t) (strlen(data) + strlen(adata) + 10) * proceed;
+		if (!(substituted = malloc(len))) {
+			return NULL;
+		}
+		memset(substituted, 0, len);
+		switch_perform_substitution(re, proceed, adata, field_expanded, substituted, len, ovector);
+		adata = substituted;
+	}
+
+	if (event) {
+		expanded = switch_event_expand_headers(event, adata);
+	} else {
+		expanded = switch_channel_expand_variables(channel, adata);
+	}
+
+	if (expanded != adata) {
+		switch_safe_free(substituted);
+	} else if (substituted) {
+		expanded = substituted;
+	} else {
+		expanded = strdup(adata);
+	}
+
+	return expanded;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_ivr_phrase_macro_event(switch_core_session_t *session, const char *macro_name, const char *data, switch_event_t *event, const char *lang,
 														switch_input_args_t *args)
 {
@@ -53,6 +90,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_phrase_macro_event(switch_core_sessio
 	const char *local_macro_name = macro_name;
 	switch_bool_t sound_prefix_enforced = switch_true(switch_channel_get_variable(channel, "sound_prefix_enforced"));
 	switch_bool_t local_sound_prefix_enforced = SWITCH_FALSE;
+	uint32_t depth = switch_ivr_prefetch_depth(session);
 
 
 	if (!macro_name) {
@@ -211,40 +249,41 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_phrase_macro_event(switch_core_sessio
 		}
 
 		if (match) {
+			int index = 0, prefetched = 0;
+
 			matches++;
-			for (action = switch_xml_child(match, "action"); action; action = action->next) {
-				char *adata = (char *) switch_xml_attr_soft(action, "data");
+			for (action = switch_xml_child(match, "action"); action; action = action->next, index++) {
 				char *func = (char *) switch_xml_attr_soft(action, "function");
-				char *substituted = NULL;
-				uint32_t len = 0;
 				char *odata = NULL;
-				char *expanded = NULL;
-
-				if (strchr(pattern, '(') && strchr(adata, '$') && proceed > 0) {
-					len = (uint32_t) (strlen(data) + strlen(adata) + 10) * proceed;
-					if (!(substituted = malloc(len))) {
-						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Memory Error!\n");
-						switch_regex_safe_free(re);
-						switch_safe_free(field_expanded_alloc);
-						goto done;
-					}
-					memset(substituted, 0, len);
-					switch_perform_substitution(re, proceed, adata, field_expanded, substituted, len, ovector);
-					odata = substituted;
-				} else {
-					odata = adata;
-				}
 
-				if (event) {
-					expanded = switch_event_expand_headers(event, odata);
-				} else {
-					expanded = switch_channel_expand_variables(channel, odata);
+				if (!(odata = phrase_action_data(session, event, action, pattern, re, proceed, ovector, data, field_expanded))) {
+					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Memory Error!\n");
+					switch_regex_safe_free(re);
+					switch_safe_free(field_expanded_alloc);
+					goto done;
 				}
 
-				if (expanded == odata) {
-					expanded = NULL;
-				} else {
-					odata = expanded;
+				if (depth) {
+					switch_xml_t next;
+					uint32_t ahead = 0;
+					int next_index = index + 1;
+
+					/* open the files of the next play-file actions while this one plays */
+					for (next = action->next; next && ahead < depth; next = next->next, next_index++) {
+						char *ndata;
+
+						if (strcasecmp(switch_xml_attr_soft(next, "function"), "play-file")) {
+							continue;
+						}
+
+						ahead++;
+
+						if (next_index > prefetched && (ndata = phrase_action_data(session, event, next, pattern, re, proceed, ovector, data, field_expanded))) {
+							switch_ivr_prefetch_file(session, ndata);
+							free(ndata);
+							prefetched = next_index;
+						}
+					}
 				}
 
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Handle %s:[%s] (%s:%s)\n", func, odata, chan_lang,
@@ -310,8 +349,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_phrase_macro_event(switch_core_sessio
 				}
 
 				switch_ivr_sleep(session, pause, SWITCH_FALSE, NULL);
-				switch_safe_free(expanded);
-				switch_safe_free(substituted);
+				switch_safe_free(odata);
 				if (done || status != SWITCH_STATUS_SUCCESS) break;
 			}
 		}
@@ -353,6 +391,58 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_phrase_macro_event(switch_core_sessio
 	return status;
 }
 
+/* Open a file on the file I/O threads, keeping the channel's media and digits flowing while a slow one opens */
+static switch_status_t ivr_file_open_job(switch_core_session_t *session, switch_file_open_job_t *job, const char *file,
+										 uint32_t channels, uint32_t rate, int flags, switch_input_args_t *args)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	switch_codec_implementation_t read_impl = { 0 };
+	switch_time_t start = switch_micro_time_now();
+	uint32_t timeout = switch_core_file_open_timeout(), interval;
+	switch_status_t status;
+	const char *var;
+
+	if ((var = switch_channel_get_variable(channel, "file_open_timeout"))) {
+		int tmp = atoi(var);
+
+		if (tmp >= 0) {
+			timeout = (uint32_t) tmp;
+		}
+	}
+
+	switch_core_session_get_read_impl(session, &read_impl);
+
+	if (!(interval = read_impl.microseconds_per_packet / 1000)) {
+		interval = 20;
+	}
+
+	if ((status = switch_core_file_open_job_start(job, file, channels, rate, flags)) != SWITCH_STATUS_SUCCESS) {
+		return status;
+	}
+
+	/* most opens are done well within a packet */
+	if ((status = switch_core_file_open_job_wait(job, interval)) != SWITCH_STATUS_TIMEOUT) {
+		return status;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Still opening %s, keeping the media going meanwhile\n", file);
+
+	for (;;) {
+		if (timeout && (switch_micro_time_now() - start) / 1000 >= timeout) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Gave up opening %s after %ums\n", file, timeout);
+			return SWITCH_STATUS_TIMEOUT;
+		}
+
+		if ((status = switch_ivr_sleep(session, interval, SWITCH_FALSE, args)) != SWITCH_STATUS_SUCCESS) {
+			return status;
+		}
+
+		if ((status = switch_core_file_open_job_wait(job, 0)) != SWITCH_STATUS_TIMEOUT) {
+			return status;
+		}
+	}
+}
+
 SWITCH_DECLARE(switch_status_t) switch_ivr_record_file(switch_core_session_t *session,
 													   switch_file_handle_t *fh, const char *file, switch_input_args_t *args, uint32_t limit)
 {
@@ -382,6 +472,8 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_record_file(switch_core_session_t *se
 	const char *prefix, *var, *video_file = NULL;
 	int vid_play_file_flags = SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT | SWITCH_FILE_FLAG_VIDEO;
 	int echo_on = 0;
+	switch_file_open_job_t *open_job = NULL;
+	int own_fh = 0;
 
 	if (switch_channel_pre_answer(channel) != SWITCH_STATUS_SUCCESS) {
 		return SWITCH_STATUS_FALSE;
@@ -407,6 +499,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_record_file(switch_core_session_t *se
 
 	if (!fh) {
 		fh = &lfh;
+		own_fh = 1;
 	}
 
 	fh->channels = read_impl.number_of_channels;
@@ -505,7 +598,16 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_record_file(switch_core_session_t *se
 		}
 	}
 
-	if (switch_core_file_open(fh, file, fh->channels, read_impl.actual_samples_per_second, file_flags, NULL) != SWITCH_STATUS_SUCCESS) {
+	/* handles we own can be opened by the I/O threads and left to them if the open hangs, digits wait for the recording */
+	if (own_fh && switch_core_file_open_job_create(&open_job, fh) == SWITCH_STATUS_SUCCESS) {
+		fh = switch_core_file_open_job_handle(open_job);
+		status = ivr_file_open_job(session, open_job, file, fh->channels, read_impl.actual_samples_per_second, file_flags, NULL);
+	} else {
+		status = switch_core_file_open(fh, file, fh->channels, read_impl.actual_samples_per_second, file_flags, NULL);
+	}
+
+	if (status != SWITCH_STATUS_SUCCESS) {
+		switch_core_file_open_job_destroy(&open_job);
 		switch_channel_hangup(channel, SWITCH_CAUSE_DESTINATION_OUT_OF_ORDER);
 		switch_core_session_reset(session, SWITCH_TRUE, SWITCH_TRUE);
 		arg_recursion_check_stop(args);
@@ -564,6 +666,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_record_file(switch_core_session_t *se
 			write_frame.samples = write_frame.datalen / 2;
 			write_frame.codec = &write_codec;
 		} else {
+			switch_core_file_open_job_destroy(&open_job);
 			arg_recursion_check_stop(args);
 			return SWITCH_STATUS_FALSE;
 		}
@@ -688,6 +791,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_record_file(switch_core_session_t *se
 			}
 			switch_channel_clear_flag(channel, CF_VIDEO_BLANK);
 			switch_core_file_close(fh);
+			switch_core_file_open_job_destroy(&open_job);
 
 			switch_core_session_reset(session, SWITCH_TRUE, SWITCH_TRUE);
 			arg_recursion_check_stop(args);
@@ -956,6 +1060,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_record_file(switch_core_session_t *se
 		switch_event_fire(&event);
 	}
 
+	switch_core_file_open_job_destroy(&open_job);
 	switch_core_session_reset(session, SWITCH_TRUE, SWITCH_TRUE);
 
 	arg_recursion_check_stop(args);
@@ -1151,6 +1256,92 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_release_file_handle(switch_core_sessi
 #define FILE_BLOCKSIZE 1024 * 8
 #define FILE_BUFSIZE 1024 * 64
 
+/* Put the sound prefix in front of relative paths and the codec name after ones without an extension */
+static char *play_file_path(switch_core_session_t *session, const char *file, const char *prefix, const char *iananame, char **backup_file)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	const char *backup_ext;
+
+	if (strstr(file, SWITCH_URL_SEPARATOR)) {
+		return (char *) file;
+	}
+
+	if (!switch_is_file_path(file)) {
+		char *tfile = NULL;
+		char *e;
+
+		if (*file == '{') {
+			tfile = switch_core_session_strdup(session, file);
+
+			while (*file == '{') {
+				if ((e = switch_find_end_paren(tfile, '{', '}'))) {
+					*e = '\0';
+					file = e + 1;
+					while(*file == ' ') file++;
+				} else {
+					tfile = NULL;
+					break;
+				}
+			}
+		}
+
+		file = switch_core_session_sprintf(session, "%s%s%s%s%s", switch_str_nil(tfile), tfile ? "}" : "", prefix, SWITCH_PATH_SEPARATOR, file);
+	}
+
+	if (!strrchr(file, '.')) {
+		if (!(backup_ext = switch_channel_get_variable(channel, "native_backup_extension"))) {
+			backup_ext = "wav";
+		}
+
+		if (backup_file) {
+			*backup_file = switch_core_session_sprintf(session, "%s.%s", file, backup_ext);
+		}
+		file = switch_core_session_sprintf(session, "%s.%s", file, iananame);
+	}
+
+	return (char *) file;
+}
+
+SWITCH_DECLARE(uint32_t) switch_ivr_prefetch_depth(switch_core_session_t *session)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	const char *var;
+
+	if ((var = switch_channel_get_variable(channel, "prompt_prefetch_depth"))) {
+		int tmp = atoi(var);
+
+		if (tmp >= 0) {
+			return (uint32_t) tmp;
+		}
+	}
+
+	return switch_core_file_prefetch_depth();
+}
+
+SWITCH_DECLARE(switch_status_t) switch_ivr_prefetch_file(switch_core_session_t *session, const char *file)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	switch_codec_implementation_t read_impl = { 0 };
+	const char *prefix;
+
+	if (zstr(file) || !strncasecmp(file, "phrase:", 7) || !strncasecmp(file, "say:", 4)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_core_session_get_read_impl(session, &read_impl);
+
+	if (!read_impl.actual_samples_per_second) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!(prefix = switch_channel_get_variable(channel, "sound_prefix"))) {
+		prefix = SWITCH_GLOBAL_dirs.base_dir;
+	}
+
+	return switch_core_file_prefetch(play_file_path(session, file, prefix, read_impl.iananame, NULL),
+									 read_impl.number_of_channels, read_impl.actual_samples_per_second);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *session, switch_file_handle_t *fh, const char *file, switch_input_args_t *args)
 {
 	switch_channel_t *channel = switch_core_session_get_channel(session);
@@ -1168,9 +1359,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 	switch_file_handle_t lfh;
 	const char *p;
 	//char *title = "", *copyright = "", *software = "", *artist = "", *comment = "", *date = "";
-	char *ext;
 	char *backup_file = NULL;
-	const char *backup_ext;
 	const char *prefix;
 	const char *timer_name;
 	const char *prebuf;
@@ -1187,6 +1376,10 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 	char *argv[128] = { 0 };
 	int argc;
 	int cur;
+	int prefetched = 1;
+	uint32_t depth = 0;
+	switch_file_open_job_t *open_job = NULL;
+	int own_fh = 0;
 	int done = 0;
 	int timeout_samples = 0;
 	switch_bool_t timeout_as_success = SWITCH_FALSE;
@@ -1197,6 +1390,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 	uint32_t buflen = 0;
 	int flags;
 	int cumulative = 0;
+	const void *mapped = NULL;
 
 	if (switch_channel_pre_answer(channel) != SWITCH_STATUS_SUCCESS) {
 		return SWITCH_STATUS_FALSE;
@@ -1250,6 +1444,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 	if (play_delimiter) {
 		file_dup = switch_core_session_strdup(session, file);
 		argc = switch_separate_string(file_dup, play_delimiter, argv, (sizeof(argv) / sizeof(argv[0])));
+		depth = switch_ivr_prefetch_depth(session);
 	} else {
 		argc = 1;
 		argv[0] = (char *) file;
@@ -1258,6 +1453,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 	if (!fh) {
 		fh = &lfh;
 		memset(fh, 0, sizeof(lfh));
+		own_fh = 1;
 	}
 
 	if (fh->samples > 0) {
@@ -1269,9 +1465,19 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 
 
 	for (cur = 0; switch_channel_ready(channel) && !done && cur < argc; cur++) {
+		if (open_job) {
+			switch_core_file_open_job_destroy(&open_job);
+			fh = &lfh;
+		}
+
 		file = argv[cur];
 		eof = 0;
 
+		/* open the next few in the list while this one plays */
+		while (depth && prefetched < argc && prefetched <= cur + (int) depth) {
+			switch_ivr_prefetch_file(session, argv[prefetched++]);
+		}
+
 		if (cur) {
 			fh->samples = sample_start = 0;
 			if (sleep_val_i) {
@@ -1348,41 +1554,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 			prefix = SWITCH_GLOBAL_dirs.base_dir;
 		}
 
-		if (!strstr(file, SWITCH_URL_SEPARATOR)) {
-			if (!switch_is_file_path(file)) {
-				char *tfile = NULL;
-				char *e;
-
-				if (*file == '{') {
-					tfile = switch_core_session_strdup(session, file);
-
-					while (*file == '{') {
-						if ((e = switch_find_end_paren(tfile, '{', '}'))) {
-							*e = '\0';
-							file = e + 1;
-							while(*file == ' ') file++;
-						} else {
-							tfile = NULL;
-							break;
-						}
-					}
-				}
-
-				file = switch_core_session_sprintf(session, "%s%s%s%s%s", switch_str_nil(tfile), tfile ? "}" : "", prefix, SWITCH_PATH_SEPARATOR, file);
-			}
-			if ((ext = strrchr(file, '.'))) {
-				ext++;
-			} else {
-
-				if (!(backup_ext = switch_channel_get_variable(channel, "native_backup_extension"))) {
-					backup_ext = "wav";
-				}
-
-				ext = read_impl.iananame;
-				backup_file = switch_core_session_sprintf(session, "%s.%s", file, backup_ext);
-				file = switch_core_session_sprintf(session, "%s.%s", file, ext);
-			}
-		}
+		file = play_file_path(session, file, prefix, read_impl.iananame, &backup_file);
 
 		if ((prebuf = switch_channel_get_variable(channel, "stream_prebuffer"))) {
 			int maybe = atoi(prebuf);
@@ -1404,11 +1576,32 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 		}
 
 
+		/* streams can hand out frames already encoded for our codec */
+		fh->native_impl = &read_impl;
+
+		/* handles we own can be opened by the I/O threads and left to them if the open hangs */
+		if (own_fh && switch_core_file_open_job_create(&open_job, fh) == SWITCH_STATUS_SUCCESS) {
+			fh = switch_core_file_open_job_handle(open_job);
+		}
+
 		for(;;) {
-			if (switch_core_file_open(fh,
-									  file,
-									  read_impl.number_of_channels,
-									  read_impl.actual_samples_per_second, flags, NULL) == SWITCH_STATUS_SUCCESS) {
+			if (open_job) {
+				status = ivr_file_open_job(session, open_job, file, read_impl.number_of_channels, read_impl.actual_samples_per_second, flags, args);
+
+				if (status != SWITCH_STATUS_SUCCESS && switch_core_file_open_job_wait(open_job, 0) == SWITCH_STATUS_TIMEOUT) {
+					/* timed out or interrupted, skip this file or stop playing */
+					switch_core_file_open_job_destroy(&open_job);
+					fh = &lfh;
+					if (status != SWITCH_STATUS_TIMEOUT) {
+						done = 1;
+					}
+					break;
+				}
+			} else {
+				status = switch_core_file_open(fh, file, read_impl.number_of_channels, read_impl.actual_samples_per_second, flags, NULL);
+			}
+
+			if (status == SWITCH_STATUS_SUCCESS) {
 				break;
 			}
 
@@ -1420,9 +1613,13 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 			}
 		}
 
+		fh->native_impl = NULL;
+
 		if (!switch_test_flag(fh, SWITCH_FILE_OPEN)) {
 			switch_core_session_reset(session, SWITCH_TRUE, SWITCH_FALSE);
-			status = SWITCH_STATUS_NOTFOUND;
+			if (!done) {
+				status = SWITCH_STATUS_NOTFOUND;
+			}
 			continue;
 		}
 
@@ -1695,6 +1892,12 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 
 				olen = switch_test_flag(fh, SWITCH_FILE_NATIVE) ? framelen : ilen;
 				do_speed = 0;
+			} else if (last_native && !eof && fh->map_data && !switch_buffer_inuse(fh->audio_buffer) &&
+					   switch_core_file_read_ref(fh, &mapped, framelen) == SWITCH_STATUS_SUCCESS) {
+				/* send the frame straight from the mapped file, it is never written to */
+				write_frame.data = (void *) mapped;
+				fh->offset_pos += framelen;
+				olen = framelen;
 			} else if (fh->audio_buffer && (eof || (switch_buffer_inuse(fh->audio_buffer) > (switch_size_t) (framelen)))) {
 				if (!(bread = switch_buffer_read(fh->audio_buffer, abuf, framelen))) {
 					if (eof) {
@@ -1720,6 +1923,9 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 				olen = FILE_STARTSAMPLES;
 				if (!switch_test_flag(fh, SWITCH_FILE_NATIVE)) {
 					olen /= 2;
+				} else if (fh->map_data && read_impl.encoded_bytes_per_packet) {
+					/* one frame so the buffer drains and the frames after it need no copy */
+					olen = read_impl.encoded_bytes_per_packet;
 				}
 				switch_set_flag_locked(fh, SWITCH_FILE_BREAK_ON_CHANGE);
 
@@ -1904,10 +2110,12 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 
 			/* write silence while dmachine is in reading state */
 			if (args && args->dmachine && switch_ivr_dmachine_is_parsing(args->dmachine)) {
+				write_frame.data = abuf;
 				memset(write_frame.data, 0, write_frame.datalen);
 			}
 
 			status = switch_core_session_write_frame(session, &write_frame, SWITCH_IO_FLAG_NONE, 0);
+			write_frame.data = abuf;
 
 			if (timeout_samples) {
 				timeout_samples -= write_frame.samples;
@@ -1984,6 +2192,8 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_play_file(switch_core_session_t *sess
 		}
 	}
 
+	switch_core_file_open_job_destroy(&open_job);
+
 	if (switch_core_codec_ready((&codec))) {
 		switch_core_codec_destroy(&codec);
 	}
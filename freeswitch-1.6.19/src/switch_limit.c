@@ -32,6 +32,34 @@
 #include <switch.h>
 #include <switch_module_interfaces.h> /* this is odd VS 2008 Express requires this- include order problem?? */
 
+/* Rate limiter clock resolution, 32 bits of it cover 19 hours */
+#define RATE_TICK_USEC 16
+/* Slots looked at for a key before sharing one */
+#define RATE_PROBES 4
+#define LIMIT_RATE_SLOTS 4096
+#define LIMIT_RATE_LOG_SLOTS 1024
+
+typedef struct {
+	volatile switch_atomic_t tag;	/* < Hash of the key, 0 when free */
+	volatile switch_atomic_t tat;	/* < Token bucket: tick the bucket is full again */
+	volatile switch_atomic_t head;	/* < Sliding log: hits so far */
+	volatile switch_atomic_t *log;	/* < Sliding log: ticks of the last log_size hits */
+} rate_slot_t;
+
+struct switch_rate_limiter {
+	switch_rate_algorithm_t algorithm;
+	uint32_t mask;
+	uint32_t log_mask;
+	switch_time_t start;
+	rate_slot_t *slots;
+};
+
+/* Limiters behind switch_limit_rate() */
+static struct {
+	switch_rate_limiter_t *bucket;
+	switch_rate_limiter_t *log;
+} limit_rate;
+
 static switch_limit_interface_t *get_backend(const char *backend) {
 	switch_limit_interface_t *limit = NULL;
 	
@@ -56,6 +84,9 @@ SWITCH_DECLARE(void) switch_limit_init(switch_memory_pool_t *pool) {
 	if (switch_event_reserve_subclass(LIMIT_EVENT_USAGE) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't register event subclass \"%s\"", LIMIT_EVENT_USAGE);
 	}
+
+	switch_rate_limiter_create(&limit_rate.bucket, SWITCH_RATE_TOKEN_BUCKET, LIMIT_RATE_SLOTS, 0, pool);
+	switch_rate_limiter_create(&limit_rate.log, SWITCH_RATE_SLIDING_LOG, LIMIT_RATE_LOG_SLOTS, SWITCH_RATE_LOG_MAX, pool);
 }
 
 
@@ -235,6 +266,225 @@ end:
 	return status;
 }
 
+static uint32_t rate_pow2(uint32_t n)
+{
+	uint32_t r = 1;
+
+	while (r < n && r < 0x80000000) {
+		r <<= 1;
+	}
+
+	return r;
+}
+
+static uint32_t rate_now(switch_rate_limiter_t *limiter)
+{
+	uint32_t now = (uint32_t) ((switch_mono_micro_time_now() - limiter->start) / RATE_TICK_USEC);
+
+	/* 0 marks an unused log entry */
+	return now ? now : 1;
+}
+
+static uint32_t rate_ticks(uint32_t interval_ms)
+{
+	uint64_t ticks = (uint64_t) interval_ms * 1000 / RATE_TICK_USEC;
+
+	return ticks > 0x7fffffff ? 0x7fffffff : (ticks ? (uint32_t) ticks : 1);
+}
+
+/* Nobody would be held back by the hits counted in this slot */
+static switch_bool_t rate_slot_idle(switch_rate_limiter_t *limiter, rate_slot_t *slot, uint32_t now, uint32_t interval)
+{
+	if (limiter->algorithm == SWITCH_RATE_TOKEN_BUCKET) {
+		return (int32_t) (switch_atomic_read(&slot->tat) - now) <= 0;
+	} else {
+		uint32_t last = switch_atomic_read(&slot->log[(switch_atomic_read(&slot->head) - 1) & limiter->log_mask]);
+		int32_t age = (int32_t) (now - last);
+
+		return !last || age < 0 || (uint32_t) age >= interval;
+	}
+}
+
+static rate_slot_t *rate_slot(switch_rate_limiter_t *limiter, const char *key, uint32_t now, uint32_t interval)
+{
+	switch_ssize_t hlen = -1;
+	uint32_t hash = switch_hashfunc_default(key, &hlen);
+	rate_slot_t *slot;
+	uint32_t i, tag;
+
+	if (!hash) {
+		hash = 1;
+	}
+
+	for (i = 0; i < RATE_PROBES; i++) {
+		slot = &limiter->slots[(hash + i) & limiter->mask];
+
+		if ((tag = switch_atomic_read(&slot->tag)) == hash) {
+			return slot;
+		}
+
+		if (!tag && (!(tag = switch_atomic_cas(&slot->tag, hash, 0)) || tag == hash)) {
+			return slot;
+		}
+	}
+
+	/* Table is full around here, take over a key that is not being held back */
+	for (i = 0; i < RATE_PROBES; i++) {
+		slot = &limiter->slots[(hash + i) & limiter->mask];
+		tag = switch_atomic_read(&slot->tag);
+
+		if (rate_slot_idle(limiter, slot, now, interval) && switch_atomic_cas(&slot->tag, hash, tag) == tag) {
+			return slot;
+		}
+	}
+
+	/* Share with whoever is there, both get limited a bit early */
+	return &limiter->slots[hash & limiter->mask];
+}
+
+SWITCH_DECLARE(switch_status_t) switch_rate_limiter_create(switch_rate_limiter_t **limiter, switch_rate_algorithm_t algorithm,
+														   uint32_t slots, uint32_t log_size, switch_memory_pool_t *pool)
+{
+	switch_rate_limiter_t *new_limiter;
+	uint32_t i;
+
+	switch_assert(pool);
+
+	slots = rate_pow2(slots);
+
+	new_limiter = switch_core_alloc(pool, sizeof(*new_limiter));
+	new_limiter->algorithm = algorithm;
+	new_limiter->mask = slots - 1;
+	new_limiter->start = switch_mono_micro_time_now();
+	new_limiter->slots = switch_core_alloc(pool, sizeof(rate_slot_t) * slots);
+
+	if (algorithm == SWITCH_RATE_SLIDING_LOG) {
+		volatile switch_atomic_t *log;
+
+		log_size = rate_pow2(log_size);
+		new_limiter->log_mask = log_size - 1;
+		log = switch_core_alloc(pool, sizeof(switch_atomic_t) * slots * log_size);
+
+		for (i = 0; i < slots; i++) {
+			new_limiter->slots[i].log = log + (i * log_size);
+		}
+	}
+
+	*limiter = new_limiter;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_rate_limiter_check(switch_rate_limiter_t *limiter, const char *key, uint32_t max, uint32_t interval_ms, uint32_t burst)
+{
+	uint32_t now, interval;
+	rate_slot_t *slot;
+
+	if (!limiter || !key) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!max) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	now = rate_now(limiter);
+	interval = rate_ticks(interval_ms);
+	slot = rate_slot(limiter, key, now, interval);
+
+	if (limiter->algorithm == SWITCH_RATE_TOKEN_BUCKET) {
+		/* GCRA: each hit pushes tat one refill period ahead, the bucket is empty once it is burst periods ahead */
+		uint32_t period = interval / max ? interval / max : 1;
+		uint64_t tolerance = (uint64_t) period * (burst ? burst : max);
+		uint32_t tau = tolerance > 0x7fffffff ? 0x7fffffff : (uint32_t) tolerance;
+
+		for (;;) {
+			uint32_t tat = switch_atomic_read(&slot->tat);
+			int32_t ahead = (int32_t) (tat - now);
+			uint32_t next = (ahead > 0 && (uint32_t) ahead <= tau) ? tat + period : now + period;
+
+			if (next - now > tau) {
+				return SWITCH_STATUS_GENERR;
+			}
+
+			if (switch_atomic_cas(&slot->tat, next, tat) == tat) {
+				return SWITCH_STATUS_SUCCESS;
+			}
+		}
+	} else {
+		/* The log only remembers log_size hits, a larger max can't be told apart from no limit */
+		if (max > limiter->log_mask + 1) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Rate limit of %u for %s is more than a sliding log can hold (%u)\n",
+							  max, key, limiter->log_mask + 1);
+			return SWITCH_STATUS_FALSE;
+		}
+
+		/* Over the limit while the max-th most recent hit is still inside the interval */
+
+		for (;;) {
+			uint32_t head = switch_atomic_read(&slot->head);
+			uint32_t oldest = switch_atomic_read(&slot->log[(head - max) & limiter->log_mask]);
+			int32_t age = (int32_t) (now - oldest);
+
+			if (oldest && age >= 0 && (uint32_t) age < interval) {
+				return SWITCH_STATUS_GENERR;
+			}
+
+			if (switch_atomic_cas(&slot->head, head + 1, head) == head) {
+				switch_atomic_set(&slot->log[head & limiter->log_mask], now);
+				return SWITCH_STATUS_SUCCESS;
+			}
+		}
+	}
+}
+
+SWITCH_DECLARE(void) switch_rate_limiter_reset(switch_rate_limiter_t *limiter, const char *key)
+{
+	uint32_t now, i;
+	rate_slot_t *slot;
+
+	if (!limiter || !key) {
+		return;
+	}
+
+	now = rate_now(limiter);
+	slot = rate_slot(limiter, key, now, 0x7fffffff);
+
+	if (limiter->algorithm == SWITCH_RATE_TOKEN_BUCKET) {
+		switch_atomic_set(&slot->tat, now);
+	} else {
+		for (i = 0; i <= limiter->log_mask; i++) {
+			switch_atomic_set(&slot->log[i], 0);
+		}
+	}
+}
+
+SWITCH_DECLARE(switch_status_t) switch_rate_str2algorithm(const char *name, switch_rate_algorithm_t *algorithm)
+{
+	if (zstr(name)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!strcasecmp(name, "token_bucket") || !strcasecmp(name, "bucket")) {
+		*algorithm = SWITCH_RATE_TOKEN_BUCKET;
+	} else if (!strcasecmp(name, "sliding_log") || !strcasecmp(name, "log")) {
+		*algorithm = SWITCH_RATE_SLIDING_LOG;
+	} else {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_limit_rate(const char *realm, const char *resource, switch_rate_algorithm_t algorithm, uint32_t max, uint32_t interval_ms)
+{
+	char key[256];
+
+	switch_snprintf(key, sizeof(key), "%s_%s", realm, resource);
+
+	return switch_rate_limiter_check(algorithm == SWITCH_RATE_SLIDING_LOG ? limit_rate.log : limit_rate.bucket, key, max, interval_ms, 0);
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
@@ -336,6 +336,7 @@ struct switch_rtp {
 	uint32_t cur_tmmbr;
 	uint32_t tmmbr;
 	uint32_t tmmbn;
+	uint32_t remote_bitrate;
 
 	ts_normalize_t ts_norm;
 	switch_sockaddr_t *remote_addr, *rtcp_remote_addr;
@@ -4656,6 +4657,15 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_ack_bitrate(switch_rtp_t *rtp_session
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(uint32_t) switch_rtp_get_remote_bitrate(switch_rtp_t *rtp_session)
+{
+	if (!switch_rtp_ready(rtp_session)) {
+		return 0;
+	}
+
+	return rtp_session->remote_bitrate;
+}
+
 SWITCH_DECLARE(void) switch_rtp_video_refresh(switch_rtp_t *rtp_session)
 {
 
@@ -6286,7 +6296,26 @@ static switch_status_t process_rtcp_report(switch_rtp_t *rtp_session, rtcp_msg_t
 
 			//switch_core_media_gen_key_frame(rtp_session->session);
 		}
-		
+
+		if (msg->header.type == _RTCP_PT_RTPFB && extp->header.fmt == _RTCP_RTPFB_TMMBR && ntohs(extp->header.length) >= 4) {
+			rtcp_tmmbx_t *tmmbx = (rtcp_tmmbx_t *) extp->body;
+			uint32_t mantissa = ((tmmbx->parts[0] & 0x03) << 15) | (tmmbx->parts[1] << 7) | (tmmbx->parts[2] >> 1);
+			uint32_t bps = mantissa << (tmmbx->parts[0] >> 2);
+
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG1, "%s Got TMMBR %u\n",
+							  switch_core_session_get_name(rtp_session->session), bps);
+			rtp_session->remote_bitrate = bps;
+			switch_rtp_ack_bitrate(rtp_session, bps);
+		}
+
+		if (msg->header.type == _RTCP_PT_PSFB && extp->header.fmt == _RTCP_PSFB_AFB && ntohs(extp->header.length) >= 4 &&
+			!memcmp(extp->body, "REMB", 4)) {
+			uint8_t *remb = (uint8_t *) extp->body + 4;
+			uint32_t mantissa = ((remb[1] & 0x03) << 16) | (remb[2] << 8) | remb[3];
+
+			rtp_session->remote_bitrate = mantissa << (remb[1] >> 2);
+		}
+
 	} else {
 		struct switch_rtcp_report_block *report;
 
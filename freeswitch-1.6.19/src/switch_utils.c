@@ -47,6 +47,7 @@ struct switch_network_node {
 	ip_t ip;
 	ip_t mask;
 	uint32_t bits;
+	uint32_t seq;
 	int family;
 	switch_bool_t ok;
 	char *token;
@@ -55,8 +56,21 @@ struct switch_network_node {
 };
 typedef struct switch_network_node switch_network_node_t;
 
+/* Path compressed binary trie node, key holds the first len bits of the prefix */
+struct switch_network_trie {
+	uint8_t key[16];
+	uint32_t len;
+	switch_network_node_t *node;
+	struct switch_network_trie *child[2];
+};
+typedef struct switch_network_trie switch_network_trie_t;
+
 struct switch_network_list {
+	/* only entries that are not a prefix, like a host_mask with holes in the mask */
 	struct switch_network_node *node_head;
+	switch_network_trie_t *trie4;
+	switch_network_trie_t *trie6;
+	uint32_t seq;
 	switch_bool_t default_type;
 	switch_memory_pool_t *pool;
 	char *name;
@@ -438,57 +452,204 @@ SWITCH_DECLARE(switch_bool_t) switch_testv6_subnet(ip_t _ip, ip_t _net, ip_t _ma
 			else return SWITCH_TRUE;
 		}
 }
-SWITCH_DECLARE(switch_bool_t) switch_network_list_validate_ip6_token(switch_network_list_t *list, ip_t ip, const char **token)
+/* The most specific entry wins, the first one added between equally specific ones */
+static inline switch_bool_t network_node_better(const switch_network_node_t *node, const switch_network_node_t *best)
 {
-	switch_network_node_t *node;
-	switch_bool_t ok = list->default_type;
-	uint32_t bits = 0;
+	return !best || node->bits > best->bits || (node->bits == best->bits && node->seq < best->seq);
+}
 
-	for (node = list->node_head; node; node = node->next) {
-		if (node->family == AF_INET) continue;
+static inline uint32_t network_key_bit(const uint8_t *key, uint32_t bit)
+{
+	return (key[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
 
-		if (node->bits >= bits && switch_testv6_subnet(ip, node->ip, node->mask)) {
-			if (node->ok) {
-				ok = SWITCH_TRUE;
-			} else {
-				ok = SWITCH_FALSE;
+/* Number of leading bits a and b share, up to max */
+static uint32_t network_key_common(const uint8_t *a, const uint8_t *b, uint32_t max)
+{
+	uint32_t i, bits = 0;
+
+	for (i = 0; bits < max; i++, bits += 8) {
+		uint8_t x = a[i] ^ b[i];
+
+		if (x) {
+			while (!(x & 0x80)) {
+				x <<= 1;
+				bits++;
 			}
+			break;
+		}
+	}
 
-			bits = node->bits;
+	return bits < max ? bits : max;
+}
+
+static inline switch_bool_t network_key_match(const uint8_t *prefix, const uint8_t *key, uint32_t len)
+{
+	uint32_t bytes = len >> 3, rest = len & 7;
+
+	if (memcmp(prefix, key, bytes)) {
+		return SWITCH_FALSE;
+	}
 
-			if (token) {
-				*token = node->token;
+	return !rest || !((prefix[bytes] ^ key[bytes]) & (0xFF << (8 - rest)));
+}
+
+static switch_network_trie_t *network_trie_new(switch_network_list_t *list, const uint8_t *key, uint32_t len, switch_network_node_t *node)
+{
+	switch_network_trie_t *trie = switch_core_alloc(list->pool, sizeof(*trie));
+	uint32_t bytes = len >> 3;
+
+	memcpy(trie->key, key, (len + 7) >> 3);
+	if (len & 7) {
+		trie->key[bytes] &= 0xFF << (8 - (len & 7));
+	}
+	trie->len = len;
+	trie->node = node;
+
+	return trie;
+}
+
+static void network_trie_insert(switch_network_list_t *list, switch_network_trie_t **link, const uint8_t *key, uint32_t len, switch_network_node_t *node)
+{
+	switch_network_trie_t *trie, *branch;
+	uint32_t common;
+
+	while ((trie = *link)) {
+		common = network_key_common(trie->key, key, trie->len < len ? trie->len : len);
+
+		if (common < trie->len) {
+			if (common == len) {
+				/* the new prefix covers this subtree */
+				branch = network_trie_new(list, key, len, node);
+			} else {
+				branch = network_trie_new(list, key, common, NULL);
+				branch->child[network_key_bit(key, common)] = network_trie_new(list, key, len, node);
+			}
+			branch->child[network_key_bit(trie->key, common)] = trie;
+			*link = branch;
+			return;
+		}
+
+		if (trie->len == len) {
+			if (!trie->node || network_node_better(node, trie->node)) {
+				trie->node = node;
 			}
+			return;
+		}
+
+		link = &trie->child[network_key_bit(key, trie->len)];
+	}
+
+	*link = network_trie_new(list, key, len, node);
+}
+
+static switch_network_node_t *network_trie_lookup(switch_network_trie_t *trie, const uint8_t *key, uint32_t max)
+{
+	switch_network_node_t *best = NULL;
+
+	while (trie && network_key_match(trie->key, key, trie->len)) {
+		if (trie->node && network_node_better(trie->node, best)) {
+			best = trie->node;
+		}
+
+		if (trie->len >= max) {
+			break;
 		}
+
+		trie = trie->child[network_key_bit(key, trie->len)];
 	}
 
-	return ok;
+	return best;
+}
+
+static inline void network_v4_key(uint32_t ip, uint8_t *key)
+{
+	key[0] = (uint8_t) (ip >> 24);
+	key[1] = (uint8_t) (ip >> 16);
+	key[2] = (uint8_t) (ip >> 8);
+	key[3] = (uint8_t) ip;
+}
+
+static switch_bool_t network_list_result(switch_network_list_t *list, switch_network_node_t *best, const char **token)
+{
+	if (!best) {
+		return list->default_type;
+	}
+
+	if (token) {
+		*token = best->token;
+	}
+
+	return best->ok ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_network_list_validate_ip6_token(switch_network_list_t *list, ip_t ip, const char **token)
+{
+	switch_network_node_t *node, *best;
+
+	best = network_trie_lookup(list->trie6, ip.v6.s6_addr, 128);
+
+	for (node = list->node_head; node; node = node->next) {
+		if (node->family == AF_INET) continue;
+
+		if (network_node_better(node, best) && switch_testv6_subnet(ip, node->ip, node->mask)) {
+			best = node;
+		}
+	}
+
+	return network_list_result(list, best, token);
 }
 
 SWITCH_DECLARE(switch_bool_t) switch_network_list_validate_ip_token(switch_network_list_t *list, uint32_t ip, const char **token)
 {
-	switch_network_node_t *node;
-	switch_bool_t ok = list->default_type;
-	uint32_t bits = 0;
+	switch_network_node_t *node, *best;
+	uint8_t key[4];
+
+	network_v4_key(ip, key);
+	best = network_trie_lookup(list->trie4, key, 32);
 
 	for (node = list->node_head; node; node = node->next) {
 		if (node->family == AF_INET6) continue; /* want AF_INET */
-		if (node->bits >= bits && switch_test_subnet(ip, node->ip.v4, node->mask.v4)) {
-			if (node->ok) {
-				ok = SWITCH_TRUE;
-			} else {
-				ok = SWITCH_FALSE;
-			}
-
-			bits = node->bits;
 
-			if (token) {
-				*token = node->token;
-			}
+		if (network_node_better(node, best) && switch_test_subnet(ip, node->ip.v4, node->mask.v4)) {
+			best = node;
 		}
 	}
 
-	return ok;
+	return network_list_result(list, best, token);
+}
+
+/* File an entry in the trie matching its family, anything that is not a plain prefix goes on the list */
+static void network_list_add_node(switch_network_list_t *list, switch_network_node_t *node)
+{
+	node->seq = list->seq++;
+
+	if (node->family == AF_INET6) {
+		const uint8_t *net = node->ip.v6.s6_addr;
+		uint8_t key[16] = { 0 };
+
+		if (node->bits) {
+			network_trie_insert(list, &list->trie6, net, node->bits, node);
+		} else if (memcmp(net, key, sizeof(key))) {
+			/* without a mask a non zero address only matches itself */
+			network_trie_insert(list, &list->trie6, net, 128, node);
+		} else {
+			network_trie_insert(list, &list->trie6, key, 0, node);
+		}
+	} else {
+		uint32_t prefix = node->bits ? 0xFFFFFFFF << (32 - node->bits) : 0;
+		uint8_t key[4];
+
+		if (node->mask.v4 != prefix) {
+			node->next = list->node_head;
+			list->node_head = node;
+			return;
+		}
+
+		network_v4_key(node->ip.v4, key);
+		/* same as above, 1.2.3.4/0 only matches 1.2.3.4 */
+		network_trie_insert(list, &list->trie4, key, (!node->bits && node->ip.v4) ? 32 : node->bits, node);
+	}
 }
 
 SWITCH_DECLARE(char *) switch_network_ipv4_mapped_ipv6_addr(const char* ip_str)
@@ -539,8 +700,7 @@ SWITCH_DECLARE(switch_status_t) switch_network_list_perform_add_cidr_token(switc
 		node->token = switch_core_strdup(list->pool, token);
 	}
 
-	node->next = list->node_head;
-	list->node_head = node;
+	network_list_add_node(list, node);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Adding %s (%s) [%s] to list %s\n",
 					  cidr_str, ok ? "allow" : "deny", switch_str_nil(token), list->name);
@@ -596,9 +756,9 @@ SWITCH_DECLARE(switch_status_t) switch_network_list_add_host_mask(switch_network
 	node->bits = (((mask.v4 + (mask.v4 >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24;
 
 	node->str = switch_core_sprintf(list->pool, "%s:%s", host, mask_str);
+	node->family = AF_INET;
 
-	node->next = list->node_head;
-	list->node_head = node;
+	network_list_add_node(list, node);
 
 	return SWITCH_STATUS_SUCCESS;
 }
@@ -650,7 +810,7 @@ SWITCH_DECLARE(int) switch_parse_cidr(const char *string, ip_t *ip, ip_t *mask,
 		switch_inet_pton(AF_INET, host, (unsigned char *)ip);
 		ipv->v4 = htonl(ipv->v4);
 
-		maskv->v4 = 0xFFFFFFFF & ~(0xFFFFFFFF >> bits);
+		maskv->v4 = bits ? 0xFFFFFFFF << (32 - bits) : 0;
 	}
 	*bitp = bits;
 
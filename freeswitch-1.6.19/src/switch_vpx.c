@@ -311,6 +311,13 @@ struct vpx_context {
 	switch_buffer_t *pbuffer;
 	switch_time_t start_time;
 	switch_image_t *patch_img;
+	unsigned long deadline;
+	int cpu_used;
+	switch_time_t encode_time;
+	switch_time_t encode_time_max;
+	switch_time_t encode_time_total;
+	uint64_t encode_count;
+	char encode_stats[128];
 };
 typedef struct vpx_context vpx_context_t;
 
@@ -417,9 +424,18 @@ static switch_status_t init_encoder(switch_codec_t *codec)
 	config->rc_target_bitrate = context->bandwidth;
 	config->g_lag_in_frames = 0;
 	config->kf_max_dist = 360;//2000;
-	threads = cpus / 2;
+
+	if (context->codec_settings.video.threads > 0) {
+		threads = context->codec_settings.video.threads;
+	} else {
+		/* about one thread per 640x360 worth of pixels so small per-member encoders stay single threaded */
+		threads = (config->g_w * config->g_h) / (640 * 360);
+		if (threads > cpus / 2) threads = cpus / 2;
+	}
+
 	if (threads < 1) threads = 1;
 	config->g_threads = threads;
+	context->deadline = context->codec_settings.video.deadline ? context->codec_settings.video.deadline : VPX_DL_REALTIME;
 	
 	if (context->is_vp9) {
 		//config->rc_dropframe_thresh = 2;
@@ -438,6 +454,7 @@ static switch_status_t init_encoder(switch_codec_t *codec)
 		config->ts_rate_decimator[0] = 1;
 		config->ts_periodicity = 1;
 		config->ts_layer_id[0] = 0;
+		context->cpu_used = context->lossless ? -6 : -8;
 	} else {
 
 		// settings
@@ -496,8 +513,22 @@ static switch_status_t init_encoder(switch_codec_t *codec)
 		//	Use the target bitrate (rc_target_bitrate) to convert to
 		//	bits/bytes, if necessary.
 		config->rc_buf_optimal_sz = 1000;
+		//Set cpu usage, a bit lower than normal (-6) but higher than android (-12)
+		context->cpu_used = -16;
+	}
+
+	if (context->codec_settings.video.cpu_used_set) {
+		context->cpu_used = context->codec_settings.video.cpu_used;
+	}
+
+	if (context->codec_settings.video.token_partitions > 0) {
+		for (token_parts = 0; token_parts < 3 && (2 << token_parts) <= context->codec_settings.video.token_partitions; token_parts++);
 	}
 
+	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), SWITCH_LOG_DEBUG,
+					  "VPX encoder profile threads %u cpu-used %d token-partitions %d deadline %lu\n",
+					  config->g_threads, context->cpu_used, 1 << token_parts, context->deadline);
+
 	if (context->encoder_init) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "VPX ENCODER RESET\n");
 		if (vpx_codec_enc_config_set(&context->encoder, config) != VPX_CODEC_OK) {
@@ -555,20 +586,29 @@ static switch_status_t init_encoder(switch_codec_t *codec)
 		if (context->is_vp9) {
 			if (context->lossless) {
 				vpx_codec_control(&context->encoder, VP9E_SET_LOSSLESS, 1);
-				vpx_codec_control(&context->encoder, VP8E_SET_CPUUSED, -6);
-			} else {
-				vpx_codec_control(&context->encoder, VP8E_SET_CPUUSED, -8);
 			}
 
+			vpx_codec_control(&context->encoder, VP8E_SET_CPUUSED, context->cpu_used);
 			vpx_codec_control(&context->encoder, VP8E_SET_STATIC_THRESHOLD, 1000);
 			vpx_codec_control(&context->encoder, VP8E_SET_TOKEN_PARTITIONS, token_parts);
 			vpx_codec_control(&context->encoder, VP9E_SET_TUNE_CONTENT, VP9E_CONTENT_SCREEN);
 
+			if (context->codec_settings.video.tile_columns > 0) {
+				vpx_codec_control(&context->encoder, VP9E_SET_TILE_COLUMNS, context->codec_settings.video.tile_columns);
+			}
+
+			if (context->codec_settings.video.row_mt) {
+#ifdef VPX_CTRL_VP9E_SET_ROW_MT
+				vpx_codec_control(&context->encoder, VP9E_SET_ROW_MT, context->codec_settings.video.row_mt > 0 ? 1 : 0);
+#else
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), SWITCH_LOG_WARNING, "row-mt is not supported by libvpx %s\n", vpx_codec_version_str());
+#endif
+			}
+
 		} else {
 			// The static threshold imposes a change threshold on blocks below which they will be skipped by the encoder.
 			vpx_codec_control(&context->encoder, VP8E_SET_STATIC_THRESHOLD, 100);
-			//Set cpu usage, a bit lower than normal (-6) but higher than android (-12)
-			vpx_codec_control(&context->encoder, VP8E_SET_CPUUSED, -16);
+			vpx_codec_control(&context->encoder, VP8E_SET_CPUUSED, context->cpu_used);
 			vpx_codec_control(&context->encoder, VP8E_SET_TOKEN_PARTITIONS, token_parts);
 			
 			// Enable noise reduction
@@ -799,7 +839,7 @@ static switch_status_t switch_vpx_encode(switch_codec_t *codec, switch_frame_t *
 	uint32_t dur;
 	int64_t pts;
 	vpx_enc_frame_flags_t vpx_flags = 0;
-	switch_time_t now;
+	switch_time_t now, encode_start;
 	int err;
 
 	if (frame->flags & SFF_SAME_IMAGE) {
@@ -864,18 +904,28 @@ static switch_status_t switch_vpx_encode(switch_codec_t *codec, switch_frame_t *
 
 	dur = context->last_ms ? (now - context->last_ms) / 1000 : pts;
 
+	encode_start = switch_micro_time_now();
+
 	if ((err = vpx_codec_encode(&context->encoder,
 						 (vpx_image_t *) frame->img,
 						 pts,
 						 dur,
 						 vpx_flags,
-						 VPX_DL_REALTIME)) != VPX_CODEC_OK) {
+						 context->deadline)) != VPX_CODEC_OK) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "VPX encode error %d:%s:%s\n",
 			err, vpx_codec_error(&context->encoder), vpx_codec_error_detail(&context->encoder));
 		frame->datalen = 0;
 		return SWITCH_STATUS_FALSE;
 	}
 
+	context->encode_time = switch_micro_time_now() - encode_start;
+	context->encode_time_total += context->encode_time;
+	context->encode_count++;
+
+	if (context->encode_time > context->encode_time_max) {
+		context->encode_time_max = context->encode_time;
+	}
+
 	context->enc_iter = NULL;
 	context->last_ts = frame->timestamp;
 	context->last_ms = now;
@@ -1326,6 +1376,36 @@ static switch_status_t switch_vpx_control(switch_codec_t *codec,
 	case SCC_VIDEO_GEN_KEYFRAME:
 		context->need_key_frame = 1;		
 		break;
+	case SCC_CODEC_SPECIFIC:
+		{
+			const char *command = (const char *)cmd_data;
+			const char *arg = (const char *)cmd_arg;
+			const char *reply = "ERROR INVALID COMMAND";
+
+			if (!zstr(command)) {
+				if (!strcasecmp(command, "encoder_params")) {
+					if (switch_core_codec_parse_video_encoder_params(arg, &context->codec_settings) == SWITCH_STATUS_SUCCESS) {
+						context->need_encoder_reset = 1;
+						reply = "OK";
+					} else {
+						reply = "ERROR INVALID PARAMS";
+					}
+				} else if (!strcasecmp(command, "encode_stats")) {
+					switch_snprintf(context->encode_stats, sizeof(context->encode_stats),
+									"frames %" SWITCH_UINT64_T_FMT " last %0.2fms avg %0.2fms max %0.2fms threads %u cpu-used %d",
+									context->encode_count, (double) context->encode_time / 1000,
+									context->encode_count ? (double) context->encode_time_total / context->encode_count / 1000 : 0,
+									(double) context->encode_time_max / 1000, context->config.g_threads, context->cpu_used);
+					reply = context->encode_stats;
+				}
+			}
+
+			if (rtype) {
+				*rtype = SCCT_STRING;
+				*ret_data = (void *)reply;
+			}
+		}
+		break;
 	case SCC_VIDEO_BANDWIDTH:
 		{
 			switch(ctype) {
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+#include "limit_store.h"
+
+// #define BENCHMARK 1
+
+#ifdef BENCHMARK
+typedef struct {
+  int id;
+  int loops;
+  int shared;
+} bench_thread_t;
+
+static void *SWITCH_THREAD_FUNC bench_thread(switch_thread_t *thread, void *obj)
+{
+  bench_thread_t *bt = (bench_thread_t *) obj;
+  char key[64];
+  int x;
+
+  for (x = 0; x < bt->loops; x++) {
+    /* distinct resources per thread unless they all fight over the same one */
+    switch_snprintf(key, sizeof(key), "bench_%d_%d", bt->shared ? 0 : bt->id, x % 16);
+    limit_store_incr(key, -1, 0, SWITCH_TRUE, 0, NULL);
+    limit_store_incr(key, 1000, 1, SWITCH_FALSE, 0, NULL);
+    limit_store_release(key);
+  }
+
+  return NULL;
+}
+
+static void run_bench(switch_memory_pool_t *pool, int threads, int loops, int shared)
+{
+  switch_thread_t *thread[32];
+  bench_thread_t bt[32];
+  switch_threadattr_t *thd_attr = NULL;
+  switch_time_t start_ts, end_ts;
+  unsigned long long micro_total = 0;
+  double micro_per = 0;
+  double rate_per_sec = 0;
+  int x;
+
+  switch_threadattr_create(&thd_attr, pool);
+  switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+  start_ts = switch_time_now();
+  for (x = 0; x < threads; x++) {
+    bt[x].id = x;
+    bt[x].loops = loops;
+    bt[x].shared = shared;
+    switch_thread_create(&thread[x], thd_attr, bench_thread, &bt[x], pool);
+  }
+  for (x = 0; x < threads; x++) {
+    switch_status_t retval;
+    switch_thread_join(&retval, thread[x]);
+  }
+  end_ts = switch_time_now();
+
+  /* each loop is two limit checks and a release */
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) (loops * threads * 3);
+  rate_per_sec = 1000000 / micro_per;
+  note("limit store %s keys, %2d threads: Total %ldus / %d ops, %.3f us per op, %.0f ops per second\n",
+       shared ? "shared" : "distinct", threads, micro_total, loops * threads * 3, micro_per, rate_per_sec);
+}
+#endif
+
+/* Take a delta since version, then move epoch and version to the ones it reported */
+static char *delta(char *epoch, switch_time_t *version)
+{
+  switch_stream_handle_t stream = { 0 };
+  char *data, *p;
+
+  SWITCH_STANDARD_STREAM(stream);
+  limit_store_dump_delta(&stream, epoch, *version);
+  data = (char *) stream.data;
+
+  /* V/epoch/version/full|delta */
+  if (data && (p = strchr(data + 2, '/'))) {
+    switch_copy_string(epoch, data + 2, p - (data + 2) + 1);
+    *version = (switch_time_t) strtoll(p + 1, NULL, 10);
+  }
+
+  return data;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+#ifdef BENCHMARK
+  int threads, loops = 100000;
+#endif
+
+#ifdef BENCHMARK
+  plan(1);
+#else
+  plan(1 + 19);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  limit_store_init(pool);
+
+#ifndef BENCHMARK
+  {
+    limit_hash_item_t usage = { 0 };
+    switch_stream_handle_t stream = { 0 };
+
+    limit_store_incr("test_total", 2, 0, SWITCH_TRUE, 0, NULL);
+    limit_store_incr("test_total", 2, 0, SWITCH_TRUE, 0, NULL);
+    ok( limit_store_incr("test_total", 2, 0, SWITCH_TRUE, 0, &usage) == SWITCH_STATUS_GENERR, "Total usage over max rejected");
+    ok( usage.total_usage == 2, "Rejected call not counted in total");
+    ok( limit_store_incr("test_total", 2, 0, SWITCH_TRUE, 1, NULL) == SWITCH_STATUS_GENERR, "Remote usage counted against max");
+    ok( limit_store_release("test_total") == 1, "Release returns remaining usage");
+    ok( limit_store_release("test_missing") == -1, "Release of unknown key");
+
+    limit_store_incr("test_rate", 3, 10, SWITCH_FALSE, 0, NULL);
+    limit_store_incr("test_rate", 3, 10, SWITCH_FALSE, 0, NULL);
+    limit_store_incr("test_rate", 3, 10, SWITCH_FALSE, 0, NULL);
+    ok( limit_store_incr("test_rate", 3, 10, SWITCH_FALSE, 0, NULL) == SWITCH_STATUS_GENERR, "Rate over max in window rejected");
+    limit_store_interval_reset("test_rate");
+    ok( limit_store_incr("test_rate", 3, 10, SWITCH_FALSE, 0, &usage) == SWITCH_STATUS_SUCCESS && usage.rate_usage == 1, "Interval reset clears the window");
+
+    SWITCH_STANDARD_STREAM(stream);
+    limit_store_dump_delta(&stream, NULL, 0);
+    ok( stream.data && strstr((char *) stream.data, "/full\n") && strstr((char *) stream.data, "L/test_rate/0/1/10/"), "Delta dump without epoch is a full snapshot");
+    switch_safe_free(stream.data);
+
+    limit_store_release("test_total");
+    limit_store_interval_reset("test_rate");
+  }
+
+  {
+    limit_hash_item_t a = { 0 }, b = { 0 };
+    char epoch[64] = "", *data;
+    switch_time_t version = 0, old_version;
+    char key[32];
+    int x;
+
+    data = delta(epoch, &version);
+    switch_safe_free(data);
+
+    limit_store_incr("test_delta_a", -1, 0, SWITCH_TRUE, 0, &a);
+    limit_store_incr("test_delta_b", -1, 0, SWITCH_TRUE, 0, &b);
+    ok( b.version >= a.version && b.version > 0, "Back to back changes never get older versions");
+
+    data = delta(epoch, &version);
+    ok( data && strstr(data, "/delta\n") && strstr(data, "L/test_delta_a/1/") && strstr(data, "L/test_delta_b/1/") && !strstr(data, "L/test_rate/"),
+        "Delta holds only the entries changed since the version");
+    switch_safe_free(data);
+
+    limit_store_incr("test_delta_a", -1, 0, SWITCH_TRUE, 0, NULL);
+    data = delta(epoch, &version);
+    ok( data && strstr(data, "L/test_delta_a/2/") && !strstr(data, "L/test_delta_b/"), "Changes right after a delta are in the next one");
+    switch_safe_free(data);
+
+    data = delta(epoch, &version);
+    ok( data && strstr(data, "/delta\n") && !strstr(data, "L/"), "Delta without changes is empty");
+    switch_safe_free(data);
+
+    limit_store_release("test_delta_b");
+    data = delta(epoch, &version);
+    ok( data && strstr(data, "L/test_delta_b/0/0/0/0\n"), "Freed entries are sent with 0 usage");
+    switch_safe_free(data);
+
+    old_version = version;
+    for (x = 0; x < LIMIT_STORE_JOURNAL_SIZE + 1; x++) {
+      switch_snprintf(key, sizeof(key), "test_journal_%d", x);
+      limit_store_incr(key, -1, 0, SWITCH_TRUE, 0, NULL);
+      limit_store_release(key);
+    }
+    version = old_version;
+    data = delta(epoch, &version);
+    ok( data && strstr(data, "/full\n") && strstr(data, "L/test_delta_a/2/"), "Full snapshot once the journal no longer covers the version");
+    switch_safe_free(data);
+
+    strcpy(epoch, "0");
+    data = delta(epoch, &version);
+    ok( data && strstr(data, "/full\n"), "Full snapshot for another epoch");
+    switch_safe_free(data);
+
+    limit_store_release("test_delta_a");
+    limit_store_release("test_delta_a");
+  }
+
+  {
+    limit_hash_item_t usage = { 0 };
+    char epoch[64] = "", *data;
+    switch_time_t version = 0;
+    int x;
+
+    for (x = 0; x < 10; x++) {
+      limit_store_incr("test_window", 10, 1, SWITCH_FALSE, 0, NULL);
+    }
+    ok( limit_store_incr("test_window", 10, 1, SWITCH_FALSE, 0, NULL) == SWITCH_STATUS_GENERR, "Rate over max within the window rejected");
+
+    /* halfway into the next window the previous one still counts for about half */
+    switch_yield(1500000);
+    limit_store_incr("test_window", 10, 1, SWITCH_FALSE, 0, &usage);
+    ok( usage.rate_usage >= 3 && usage.rate_usage <= 8, "Previous window counts for the part still inside the interval");
+
+    data = delta(epoch, &version);
+    switch_safe_free(data);
+    switch_yield(200000);
+    data = delta(epoch, &version);
+    ok( data && strstr(data, "/delta\n") && strstr(data, "L/test_window/"), "Deltas resend rates that are still dropping");
+    switch_safe_free(data);
+
+    switch_yield(2100000);
+    limit_store_incr("test_window", 10, 1, SWITCH_FALSE, 0, &usage);
+    ok( usage.rate_usage == 1, "Windows older than the interval are forgotten");
+  }
+#else
+  for (threads = 1; threads <= 32; threads *= 2) {
+    run_bench(pool, threads, loops / threads, 0);
+  }
+
+  for (threads = 1; threads <= 32; threads *= 2) {
+    run_bench(pool, threads, loops / threads, 1);
+  }
+#endif
+
+  limit_store_destroy();
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
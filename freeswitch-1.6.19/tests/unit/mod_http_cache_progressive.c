@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+/* the cache is static to the module, test it from the inside */
+#include "mod_http_cache.c"
+
+// #define BENCHMARK 1
+
+#define BODY_LEN 64000
+#define CHUNK_LEN 4000
+
+/* An HTTP stub that trickles the body out in chunks to act like a slow object store */
+static struct {
+  switch_memory_pool_t *pool;
+  switch_socket_t *sock;
+  switch_mutex_t *mutex;
+  uint16_t port;
+  volatile int running;
+  int chunk_ms;
+  uint32_t requests;
+  char body[BODY_LEN];
+} stub;
+
+static void *SWITCH_THREAD_FUNC stub_connection(switch_thread_t *thread, void *obj)
+{
+  switch_socket_t *sock = (switch_socket_t *) obj;
+  char buf[4096] = "", head[256];
+  switch_size_t used = 0, len, sent;
+
+  while (!strstr(buf, "\r\n\r\n")) {
+    len = sizeof(buf) - used - 1;
+    if (used == sizeof(buf) - 1 || switch_socket_recv(sock, buf + used, &len) != SWITCH_STATUS_SUCCESS || !len) {
+      goto done;
+    }
+    used += len;
+    buf[used] = '\0';
+  }
+
+  switch_mutex_lock(stub.mutex);
+  stub.requests++;
+  switch_mutex_unlock(stub.mutex);
+
+  /* error pages are trickled out like media so a reader could mistake them for it */
+  switch_snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: audio/x-raw\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",
+                  strstr(buf, "/missing") ? "404 Not Found" : "200 OK", BODY_LEN);
+  len = strlen(head);
+  switch_socket_send(sock, head, &len);
+
+  for (sent = 0; sent < BODY_LEN && stub.running; sent += CHUNK_LEN) {
+    len = CHUNK_LEN;
+    if (switch_socket_send(sock, stub.body + sent, &len) != SWITCH_STATUS_SUCCESS) {
+      break;
+    }
+    switch_yield(stub.chunk_ms * 1000);
+  }
+
+ done:
+  switch_socket_close(sock);
+  return NULL;
+}
+
+static void *SWITCH_THREAD_FUNC stub_server(switch_thread_t *thread, void *obj)
+{
+  switch_threadattr_t *thd_attr = NULL;
+
+  switch_threadattr_create(&thd_attr, stub.pool);
+  switch_threadattr_detach_set(thd_attr, 1);
+  switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+  while (stub.running) {
+    switch_socket_t *conn = NULL;
+    switch_thread_t *conn_thread;
+
+    if (switch_socket_accept(&conn, stub.sock, stub.pool) != SWITCH_STATUS_SUCCESS || !stub.running) {
+      break;
+    }
+
+    switch_thread_create(&conn_thread, thd_attr, stub_connection, conn, stub.pool);
+  }
+
+  return NULL;
+}
+
+static switch_status_t stub_start(switch_thread_t **thread)
+{
+  switch_sockaddr_t *sa = NULL;
+  switch_threadattr_t *thd_attr = NULL;
+  int x;
+
+  switch_core_new_memory_pool(&stub.pool);
+  switch_mutex_init(&stub.mutex, SWITCH_MUTEX_NESTED, stub.pool);
+
+  for (x = 0; x < BODY_LEN; x++) {
+    stub.body[x] = (char) (x * 7);
+  }
+
+  if (switch_sockaddr_info_get(&sa, "127.0.0.1", SWITCH_INET, 0, 0, stub.pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_create(&stub.sock, SWITCH_INET, SOCK_STREAM, SWITCH_PROTO_TCP, stub.pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_opt_set(stub.sock, SWITCH_SO_REUSEADDR, 1) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_bind(stub.sock, sa) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_listen(stub.sock, 64) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_addr_get(&sa, SWITCH_FALSE, stub.sock) != SWITCH_STATUS_SUCCESS) {
+    return SWITCH_STATUS_FALSE;
+  }
+
+  stub.port = switch_sockaddr_get_port(sa);
+  stub.running = 1;
+
+  switch_threadattr_create(&thd_attr, stub.pool);
+  switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+  return switch_thread_create(thread, thd_attr, stub_server, NULL, stub.pool);
+}
+
+static void cache_start(const char *location, size_t progressive_min_bytes, switch_memory_pool_t *pool)
+{
+  memset(&gcache, 0, sizeof(gcache));
+  gcache.pool = pool;
+  switch_core_hash_init(&gcache.map);
+  switch_core_hash_init(&gcache.profiles);
+  switch_core_hash_init_nocase(&gcache.fqdn_profiles);
+  switch_mutex_init(&gcache.mutex, SWITCH_MUTEX_UNNESTED, pool);
+  switch_thread_rwlock_create(&gcache.shutdown_lock, pool);
+  gcache.location = switch_core_strdup(pool, location);
+  gcache.max_url = 100;
+  gcache.default_max_age = 86400 * 1000 * 1000LL;
+  gcache.connect_timeout = 5;
+  gcache.download_timeout = 30;
+  gcache.progressive_min_bytes = progressive_min_bytes;
+  gcache.queue.max_size = gcache.max_url;
+  gcache.queue.data = switch_core_alloc(pool, sizeof(void *) * gcache.queue.max_size);
+  setup_dir(&gcache);
+}
+
+static void cache_stop(void)
+{
+  gcache.shutdown = 1;
+  switch_thread_rwlock_wrlock(gcache.shutdown_lock);
+  switch_thread_rwlock_unlock(gcache.shutdown_lock);
+  url_cache_clear(&gcache, NULL);
+  switch_core_hash_destroy(&gcache.map);
+  switch_core_hash_destroy(&gcache.profiles);
+  switch_core_hash_destroy(&gcache.fqdn_profiles);
+}
+
+static int wait_available(cached_url_t *u, int seconds)
+{
+  int x;
+
+  for (x = 0; x < seconds * 100 && u->status == CACHED_URL_RX_IN_PROGRESS; x++) {
+    switch_yield(10000);
+  }
+
+  return u->status == CACHED_URL_AVAILABLE;
+}
+
+static int file_matches(const char *filename)
+{
+  char buf[BODY_LEN];
+  FILE *f = fopen(filename, "rb");
+  size_t len;
+
+  if (!f) {
+    return 0;
+  }
+
+  len = fread(buf, 1, sizeof(buf), f);
+  fclose(f);
+
+  return len == BODY_LEN && !memcmp(buf, stub.body, BODY_LEN);
+}
+
+typedef struct {
+  const char *url;
+  char *filename;
+  cached_url_t *rx_url;
+  switch_memory_pool_t *pool;
+} getter_t;
+
+static void *SWITCH_THREAD_FUNC getter_thread(switch_thread_t *thread, void *obj)
+{
+  getter_t *g = (getter_t *) obj;
+
+  g->filename = url_cache_get(&gcache, NULL, NULL, g->url, DOWNLOAD, 0, &g->rx_url, g->pool);
+
+  return NULL;
+}
+
+#ifdef BENCHMARK
+static void run_bench(const char *base, switch_memory_pool_t *pool)
+{
+  switch_time_t start_ts, first_ts, end_ts;
+  cached_url_t *rx_url = NULL;
+  char *url = switch_core_sprintf(pool, "%s/bench_%d.raw", base, (int) switch_epoch_time_now(NULL));
+
+  start_ts = switch_time_now();
+  url_cache_get(&gcache, NULL, NULL, url, DOWNLOAD, 0, &rx_url, pool);
+  first_ts = switch_time_now();
+  if (rx_url) {
+    wait_available(rx_url, 30);
+    url_cache_release(&gcache, NULL, rx_url);
+  }
+  end_ts = switch_time_now();
+
+  note("%d bytes at %d bytes per %dms: playable after %ldus, downloaded after %ldus\n",
+       BODY_LEN, CHUNK_LEN, stub.chunk_ms, (long) (first_ts - start_ts), (long) (end_ts - start_ts));
+}
+#endif
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  switch_thread_t *server = NULL;
+  char *location, base[128];
+
+#ifdef BENCHMARK
+  plan(1);
+#else
+  plan(1 + 11);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+
+  if (stub_start(&server) != SWITCH_STATUS_SUCCESS) {
+    bail_out(0, "Bail due to failure to start the HTTP stub");
+  }
+
+  /* the whole body takes 16 chunks, about 800ms */
+  stub.chunk_ms = 50;
+  switch_snprintf(base, sizeof(base), "http://127.0.0.1:%u", stub.port);
+  location = switch_core_sprintf(pool, "%s%shttp_cache_test_%d", SWITCH_GLOBAL_dirs.temp_dir, SWITCH_PATH_SEPARATOR, (int) getpid());
+  cache_start(location, CHUNK_LEN * 2, pool);
+
+#ifndef BENCHMARK
+  {
+    switch_time_t start_ts;
+    cached_url_t *rx_url = NULL;
+    char *url = switch_core_sprintf(pool, "%s/first.raw", base), *filename;
+
+    start_ts = switch_time_now();
+    filename = url_cache_get(&gcache, NULL, NULL, url, DOWNLOAD, 0, &rx_url, pool);
+    ok( filename && rx_url && switch_time_now() - start_ts < 500000, "File handed out before the download is done");
+    ok( rx_url && rx_url->size >= CHUNK_LEN * 2 && rx_url->size < BODY_LEN, "File holds the first chunks");
+    ok( rx_url && wait_available(rx_url, 10) && file_matches(filename), "Download completes in the background");
+    if (rx_url) {
+      url_cache_release(&gcache, NULL, rx_url);
+    }
+
+    rx_url = NULL;
+    ok( url_cache_get(&gcache, NULL, NULL, url, DOWNLOAD, 0, &rx_url, pool) && !rx_url && stub.requests == 1, "Completed download is a cache hit");
+  }
+
+  {
+    switch_thread_t *threads[4];
+    getter_t getters[4];
+    switch_threadattr_t *thd_attr = NULL;
+    char *url = switch_core_sprintf(pool, "%s/shared.raw", base);
+    int x, same = 1, partial = 1;
+
+    stub.requests = 0;
+    switch_threadattr_create(&thd_attr, pool);
+    switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+    for (x = 0; x < 4; x++) {
+      getters[x].url = url;
+      getters[x].filename = NULL;
+      getters[x].rx_url = NULL;
+      getters[x].pool = pool;
+      switch_thread_create(&threads[x], thd_attr, getter_thread, &getters[x], pool);
+    }
+
+    for (x = 0; x < 4; x++) {
+      switch_status_t retval;
+      switch_thread_join(&retval, threads[x]);
+    }
+
+    for (x = 0; x < 4; x++) {
+      if (!getters[x].filename || !getters[x].rx_url || strcmp(getters[x].filename, getters[0].filename)) {
+        same = 0;
+      }
+      if (getters[x].rx_url && getters[x].rx_url->status != CACHED_URL_RX_IN_PROGRESS) {
+        partial = 0;
+      }
+    }
+
+    ok( same && partial, "Concurrent requests all get the partial file");
+    ok( stub.requests == 1, "Concurrent requests share one transfer");
+    ok( getters[0].rx_url && getters[0].rx_url->waiters == 4, "Each reader holds the entry");
+
+    for (x = 0; x < 4; x++) {
+      if (getters[x].rx_url) {
+        url_cache_release(&gcache, NULL, getters[x].rx_url);
+      }
+    }
+
+    ok( getters[0].rx_url && wait_available(getters[0].rx_url, 10) && file_matches(getters[0].filename), "Shared download completes");
+  }
+
+  {
+    switch_time_t start_ts;
+    char *url = switch_core_sprintf(pool, "%s/whole.raw", base), *filename;
+
+    /* callers that don't follow the download still get the whole file */
+    start_ts = switch_time_now();
+    filename = url_cache_get(&gcache, NULL, NULL, url, DOWNLOAD, 0, NULL, pool);
+    ok( filename && switch_time_now() - start_ts >= 700000 && file_matches(filename), "Whole file returned without progressive");
+  }
+
+  {
+    cached_url_t *rx_url = NULL;
+    char *url = switch_core_sprintf(pool, "%s/noext", base);
+
+    /* files named from the content type are renamed when done, so they can't be played early */
+    ok( url_cache_get(&gcache, NULL, NULL, url, DOWNLOAD, 0, &rx_url, pool) && !rx_url, "Files without an extension are downloaded first");
+  }
+
+  {
+    cached_url_t *rx_url = NULL;
+    char *url = switch_core_sprintf(pool, "%s/missing.raw", base);
+
+    ok( !url_cache_get(&gcache, NULL, NULL, url, DOWNLOAD, 0, &rx_url, pool) && !rx_url, "Error bodies are never handed out to play");
+  }
+#else
+  run_bench(base, pool);
+#endif
+
+  cache_stop();
+
+  stub.running = 0;
+  switch_socket_shutdown(stub.sock, SWITCH_SHUTDOWN_READWRITE);
+  switch_socket_close(stub.sock);
+  {
+    switch_status_t retval;
+    switch_thread_join(&retval, server);
+  }
+  switch_core_destroy_memory_pool(&stub.pool);
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
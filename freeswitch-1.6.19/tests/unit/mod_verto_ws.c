@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+#include <sys/socket.h>
+#include "ws.h"
+
+// #define BENCHMARK 1
+
+static const char *upgrade_req =
+  "GET /verto HTTP/1.1\r\n"
+  "Host: localhost\r\n"
+  "Upgrade: websocket\r\n"
+  "Connection: Upgrade\r\n"
+  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+  "Sec-WebSocket-Version: 13\r\n\r\n";
+
+static int read_exact(int fd, uint8_t *buf, size_t len)
+{
+  size_t got = 0;
+
+  while (got < len) {
+    ssize_t r = recv(fd, buf + got, len - got, 0);
+    if (r <= 0) {
+      return -1;
+    }
+    got += r;
+  }
+
+  return 0;
+}
+
+/* what a browser would send: a masked frame */
+static size_t client_frame(uint8_t *out, ws_opcode_t oc, const uint8_t *data, size_t len)
+{
+  const uint8_t mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+  size_t hlen, x;
+
+  hlen = ws_build_frame_header(out, oc, len);
+  out[1] |= 0x80;
+  memcpy(out + hlen, mask, 4);
+  hlen += 4;
+
+  for (x = 0; x < len; x++) {
+    out[hlen + x] = data[x] ^ mask[x % 4];
+  }
+
+  return hlen + len;
+}
+
+int main () {
+  wsh_t wsh;
+  int sv[2];
+  char resp[512] = "";
+  uint8_t *payload, *wire, *frame = NULL;
+  uint8_t *data = NULL;
+  ws_opcode_t oc;
+  ssize_t flen, r;
+  size_t sizes[] = { 5, 125, 126, 1000, 65535, 65536 };
+  int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+  int x = 0, loops = 10000;
+  size_t y, wlen;
+  switch_time_t start_ts, end_ts;
+  unsigned long long micro_total = 0;
+  double micro_per = 0;
+  double rate_per_sec = 0;
+
+#ifdef BENCHMARK
+  plan(2);
+#else
+  plan(2 + (4 * nsizes) + 2);
+#endif
+
+  if ( !ok(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0, "Create socket pair")) {
+    bail_out(0, "Bail due to failure to create socket pair");
+  }
+
+  payload = malloc(65536 + 1);
+  wire = malloc(65536 + WS_MAX_HEADER_LEN + 4);
+
+  for (y = 0; y < 65536; y++) {
+    payload[y] = 'a' + (y % 26);
+  }
+
+  send(sv[1], upgrade_req, strlen(upgrade_req), 0);
+
+  if ( !ok(ws_init(&wsh, sv[0], NULL, 0, 1, 0) == 0, "WebSocket handshake")) {
+    bail_out(0, "Bail due to failed handshake");
+  }
+
+  recv(sv[1], resp, sizeof(resp) - 1, 0);
+
+#ifndef BENCHMARK
+  for (x = 0; x < nsizes; x++) {
+    size_t len = sizes[x];
+
+    /* masked client frame unmasked in place */
+    wlen = client_frame(wire, WSOC_TEXT, payload, len);
+    send(sv[1], wire, wlen, 0);
+    r = ws_read_frame(&wsh, &oc, &data);
+    ok(r == (ssize_t)len && oc == WSOC_TEXT, "Read frame of %ld bytes", (long)len);
+    ok(data && !memcmp(data, payload, len), "Payload of %ld bytes unmasked", (long)len);
+
+    /* server frame written with header and payload gathered */
+    r = ws_write_frame(&wsh, WSOC_TEXT, payload, len);
+    flen = ws_build_frame(WSOC_TEXT, payload, len, &frame);
+    ok(r == (ssize_t)len && flen > (ssize_t)len, "Write frame of %ld bytes", (long)len);
+    read_exact(sv[1], wire, flen);
+    ok(!memcmp(wire, frame, flen), "Written frame matches prepared frame");
+    free(frame);
+  }
+
+  /* one prepared frame, written as is */
+  flen = ws_build_frame(WSOC_TEXT, payload, 1000, &frame);
+  ok(ws_write_prepared_frame(&wsh, frame, flen) == flen, "Write prepared frame");
+  read_exact(sv[1], wire, flen);
+  ok(!memcmp(wire, frame, flen), "Prepared frame arrives unchanged");
+  free(frame);
+#endif
+
+  /* frame throughput */
+  start_ts = switch_time_now();
+
+  wlen = client_frame(wire, WSOC_TEXT, payload, 4096);
+  for (x = 0; x < loops; x++) {
+    send(sv[1], wire, wlen, 0);
+    if (ws_read_frame(&wsh, &oc, &data) != 4096) {
+      fail("Failed to read frame");
+    }
+  }
+
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("ws_read_frame 4k: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  start_ts = switch_time_now();
+
+  for (x = 0; x < loops; x++) {
+    if (ws_write_frame(&wsh, WSOC_TEXT, payload, 4096) != 4096) {
+      fail("Failed to write frame");
+    }
+    read_exact(sv[1], wire, 4096 + 4);
+  }
+
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("ws_write_frame 4k: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  flen = ws_build_frame(WSOC_TEXT, payload, 4096, &frame);
+  start_ts = switch_time_now();
+
+  for (x = 0; x < loops; x++) {
+    if (ws_write_prepared_frame(&wsh, frame, flen) != flen) {
+      fail("Failed to write prepared frame");
+    }
+    read_exact(sv[1], wire, flen);
+  }
+
+  end_ts = switch_time_now();
+  free(frame);
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  diag("ws_write_prepared_frame 4k: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  ws_destroy(&wsh);
+  close(sv[0]);
+  close(sv[1]);
+  free(payload);
+  free(wire);
+
+  done_testing();
+}
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+#define SAMPLES 1600
+
+/* A file format for the test, .traw is 16 bit mono PCM and .tnat is handed back as is like mod_native_file does,
+   files with slow in their name take a while to open */
+static struct {
+  switch_mutex_t *mutex;
+  uint32_t opens;
+} tfile;
+
+static switch_status_t tfile_open(switch_file_handle_t *handle, const char *path)
+{
+  FILE *f;
+
+  if (!(f = fopen(path, switch_test_flag(handle, SWITCH_FILE_FLAG_WRITE) ? "wb" : "rb"))) {
+    return SWITCH_STATUS_GENERR;
+  }
+
+  switch_mutex_lock(tfile.mutex);
+  tfile.opens++;
+  switch_mutex_unlock(tfile.mutex);
+
+  /* a file on a stalled mount */
+  if (strstr(path, "slow")) {
+    switch_yield(300000);
+  }
+
+  if (strstr(path, ".tnat")) {
+    switch_set_flag(handle, SWITCH_FILE_NATIVE);
+  }
+
+  handle->private_info = f;
+  handle->samplerate = handle->native_rate = 8000;
+  handle->channels = handle->real_channels = 1;
+  handle->seekable = 0;
+
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t tfile_close(switch_file_handle_t *handle)
+{
+  fclose((FILE *) handle->private_info);
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t tfile_read(switch_file_handle_t *handle, void *data, size_t *len)
+{
+  size_t size = switch_test_flag(handle, SWITCH_FILE_NATIVE) ? 1 : 2;
+
+  *len = fread(data, size, *len, (FILE *) handle->private_info);
+  return *len ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t tfile_write(switch_file_handle_t *handle, void *data, size_t *len)
+{
+  *len = fwrite(data, 2, *len, (FILE *) handle->private_info);
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static char *tfile_exts[] = { "traw", "tnat", NULL };
+
+SWITCH_MODULE_LOAD_FUNCTION(tfile_load)
+{
+  switch_file_interface_t *file_interface;
+
+  *module_interface = switch_loadable_module_create_module_interface(pool, "tfile");
+  file_interface = switch_loadable_module_create_interface(*module_interface, SWITCH_FILE_INTERFACE);
+  file_interface->interface_name = "tfile";
+  file_interface->extens = tfile_exts;
+  file_interface->file_open = tfile_open;
+  file_interface->file_close = tfile_close;
+  file_interface->file_read = tfile_read;
+  file_interface->file_write = tfile_write;
+
+  return SWITCH_STATUS_SUCCESS;
+}
+
+static void write_file(const char *path, const void *data, size_t len)
+{
+  FILE *f = fopen(path, "wb");
+
+  fwrite(data, 1, len, f);
+  fclose(f);
+}
+
+static uint32_t opens(void)
+{
+  uint32_t n;
+
+  switch_mutex_lock(tfile.mutex);
+  n = tfile.opens;
+  switch_mutex_unlock(tfile.mutex);
+
+  return n;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  char dir[256], conf[512], raw[512], nat[512], slow[512], slow_rec[512];
+  int16_t pcm[SAMPLES];
+  uint8_t enc[SAMPLES];
+  int x;
+
+  plan(13);
+
+  /* the prompt cache is configured from switch.conf, give the core one of its own */
+  switch_snprintf(dir, sizeof(dir), "/tmp/switch_core_file_test_%d", (int) getpid());
+  mkdir(dir, 0755);
+  switch_snprintf(conf, sizeof(conf), "%s/freeswitch.xml", dir);
+  {
+    const char *xml =
+      "<document type=\"freeswitch/xml\">\n"
+      "  <section name=\"configuration\">\n"
+      "    <configuration name=\"switch.conf\">\n"
+      "      <settings>\n"
+      "        <param name=\"prompt-cache-size\" value=\"1m\"/>\n"
+      "        <param name=\"file-open-threads\" value=\"1\"/>\n"
+      "      </settings>\n"
+      "    </configuration>\n"
+      "  </section>\n"
+      "</document>\n";
+    write_file(conf, xml, strlen(xml));
+  }
+  SWITCH_GLOBAL_dirs.conf_dir = strdup(dir);
+  SWITCH_GLOBAL_dirs.log_dir = strdup(dir);
+  SWITCH_GLOBAL_dirs.db_dir = strdup(dir);
+  SWITCH_GLOBAL_dirs.run_dir = strdup(dir);
+  SWITCH_GLOBAL_dirs.temp_dir = strdup(dir);
+
+  status = switch_core_init(0, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_loadable_module_init(SWITCH_FALSE);
+  switch_core_new_memory_pool(&pool);
+  switch_mutex_init(&tfile.mutex, SWITCH_MUTEX_NESTED, pool);
+  switch_loadable_module_build_dynamic("tfile", tfile_load, NULL, NULL, SWITCH_FALSE);
+
+  for (x = 0; x < SAMPLES; x++) {
+    pcm[x] = (int16_t) (x * 37);
+    enc[x] = (uint8_t) (x * 13);
+  }
+
+  switch_snprintf(raw, sizeof(raw), "%s/prompt.traw", dir);
+  switch_snprintf(nat, sizeof(nat), "%s/prompt.tnat", dir);
+  write_file(raw, pcm, sizeof(pcm));
+  write_file(nat, enc, sizeof(enc));
+
+  switch_snprintf(slow, sizeof(slow), "%s/slow.traw", dir);
+  switch_snprintf(slow_rec, sizeof(slow_rec), "%s/slow_rec.traw", dir);
+  write_file(slow, pcm, sizeof(pcm));
+
+  {
+    switch_file_handle_t fh = { 0 };
+    int16_t buf[SAMPLES];
+    switch_size_t len = SAMPLES;
+
+    switch_core_file_open(&fh, raw, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+    switch_core_file_close(&fh);
+
+    memset(&fh, 0, sizeof(fh));
+    status = switch_core_file_open(&fh, raw, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+    ok( status == SWITCH_STATUS_SUCCESS && fh.prompt_cache, "PCM prompts are served from the prompt cache");
+    switch_core_file_read(&fh, buf, &len);
+    ok( len == SAMPLES && !memcmp(buf, pcm, sizeof(pcm)), "Cached prompts play back what was decoded");
+    switch_core_file_close(&fh);
+  }
+
+  {
+    switch_file_handle_t fh = { 0 };
+    uint8_t buf[SAMPLES];
+    switch_size_t len = SAMPLES;
+    uint32_t before;
+
+    status = switch_core_file_open(&fh, nat, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+    ok( status == SWITCH_STATUS_SUCCESS && switch_test_flag(&fh, SWITCH_FILE_NATIVE) && !fh.prompt_cache, "Native prompts are not cached as PCM");
+    switch_core_file_read(&fh, buf, &len);
+    ok( len == SAMPLES && !memcmp(buf, enc, sizeof(enc)), "Native prompts play back the encoded bytes");
+    switch_core_file_close(&fh);
+
+    before = opens();
+    memset(&fh, 0, sizeof(fh));
+    switch_core_file_open(&fh, nat, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+    switch_core_file_close(&fh);
+    ok( opens() == before + 1, "Native prompts are not tried for the cache again");
+  }
+
+  {
+    switch_file_open_job_t *job = NULL, *busy = NULL;
+    switch_file_handle_t *fh;
+    int16_t buf[SAMPLES];
+    switch_size_t len = SAMPLES;
+    switch_stream_handle_t stream = { 0 };
+
+    switch_core_file_open_job_create(&job, NULL);
+    status = switch_core_file_open_job_start(job, raw, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT);
+    if (status == SWITCH_STATUS_SUCCESS) {
+      status = switch_core_file_open_job_wait(job, 5000);
+    }
+    fh = switch_core_file_open_job_handle(job);
+    ok( status == SWITCH_STATUS_SUCCESS && switch_test_flag(fh, SWITCH_FILE_OPEN), "Jobs open files");
+    switch_core_file_read(fh, buf, &len);
+    ok( len == SAMPLES && !memcmp(buf, pcm, sizeof(pcm)), "Handles opened by a job play back the file");
+    switch_core_file_open_job_destroy(&job);
+
+    switch_core_file_open_job_create(&job, NULL);
+    switch_core_file_open_job_start(job, "/nonexistent/missing.traw", 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT);
+    status = switch_core_file_open_job_wait(job, 5000);
+    ok( status != SWITCH_STATUS_SUCCESS && status != SWITCH_STATUS_TIMEOUT, "Failed opens are reported by the job");
+    switch_core_file_open_job_destroy(&job);
+
+    /* the only thread is stuck on the slow file, other opens queue behind it */
+    switch_core_file_open_job_create(&busy, NULL);
+    switch_core_file_open_job_start(busy, slow, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT);
+    ok( switch_core_file_open_job_wait(busy, 10) == SWITCH_STATUS_TIMEOUT, "Slow opens time out while waiting");
+    switch_core_file_open_job_destroy(&busy);
+
+    switch_core_file_open_job_create(&job, NULL);
+    switch_core_file_open_job_start(job, raw, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT);
+    ok( switch_core_file_open_job_wait(job, 0) == SWITCH_STATUS_TIMEOUT, "Opens are queued while every thread is busy");
+    ok( switch_core_file_open_job_wait(job, 5000) == SWITCH_STATUS_SUCCESS, "Queued opens finish once a thread is free");
+    switch_core_file_open_job_destroy(&job);
+
+    SWITCH_STANDARD_STREAM(stream);
+    switch_core_file_io_status(&stream);
+    ok( strstr((char *) stream.data, "Abandoned   \t1\n") != NULL, "Slow opens can be abandoned");
+    switch_safe_free(stream.data);
+
+    /* abandon a recording while it is being opened */
+    switch_yield(500000);
+    switch_core_file_open_job_create(&job, NULL);
+    switch_core_file_open_job_start(job, slow_rec, 1, 8000, SWITCH_FILE_FLAG_WRITE | SWITCH_FILE_DATA_SHORT);
+    switch_core_file_open_job_wait(job, 10);
+    switch_core_file_open_job_destroy(&job);
+
+    for (x = 0; x < 100; x++) {
+      switch_yield(20000);
+      SWITCH_STANDARD_STREAM(stream);
+      switch_core_file_io_status(&stream);
+      if (strstr((char *) stream.data, "Pending     \t0\n")) {
+        break;
+      }
+      switch_safe_free(stream.data);
+    }
+    ok( stream.data && strstr((char *) stream.data, "Abandoned   \t2\n") && switch_file_exists(slow_rec, pool) != SWITCH_STATUS_SUCCESS,
+        "Abandoned recordings do not leave a file behind");
+    switch_safe_free(stream.data);
+  }
+
+  unlink(raw);
+  unlink(nat);
+  unlink(slow);
+  unlink(slow_rec);
+  unlink(conf);
+
+  switch_core_destroy_memory_pool(&pool);
+
+  done_testing();
+}
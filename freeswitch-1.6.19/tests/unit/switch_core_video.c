@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+typedef void (*video_bench_func_t)(switch_image_t *IMG, switch_image_t *img);
+
+static switch_rgb_color_t red = { 0 };
+static switch_rgb_color_t clear = { 0 };
+
+static void bench_patch_argb(switch_image_t *IMG, switch_image_t *img)
+{
+  switch_img_patch(IMG, img, 16, IMG->d_h - img->d_h - 16);
+}
+
+static void bench_patch_noalpha(switch_image_t *IMG, switch_image_t *img)
+{
+  switch_img_fill(IMG, 0, 0, IMG->d_w, IMG->d_h, &clear);
+  switch_img_patch_rgb(IMG, img, 0, 0, SWITCH_TRUE);
+}
+
+static void bench_fill(switch_image_t *IMG, switch_image_t *img)
+{
+  switch_img_fill(IMG, 0, 0, IMG->d_w, IMG->d_h, &red);
+}
+
+static void bench_overlay(switch_image_t *IMG, switch_image_t *img)
+{
+  switch_img_overlay(IMG, img, IMG->d_w / 4, IMG->d_h / 4, 50);
+}
+
+static void run_bench(const char *name, video_bench_func_t func, switch_image_t *IMG, switch_image_t *img, int loops)
+{
+  switch_time_t start_ts, end_ts;
+  unsigned long long micro_total = 0;
+  double micro_per = 0;
+  double rate_per_sec = 0;
+  int x;
+
+  start_ts = switch_time_now();
+  for (x = 0; x < loops; x++) {
+    func(IMG, img);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("%s %dx%d: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       name, IMG->d_w, IMG->d_h, micro_total, loops, micro_per, rate_per_sec);
+}
+
+/* a banner the width of the frame with an alpha ramp, like rendered text */
+static switch_image_t *make_banner(int w, int h)
+{
+  switch_image_t *img = switch_img_alloc(NULL, SWITCH_IMG_FMT_ARGB, w, h, 1);
+  int x, y;
+
+  for (y = 0; y < h; y++) {
+    switch_rgb_color_t *row = (switch_rgb_color_t *)(img->planes[SWITCH_PLANE_PACKED] + y * img->stride[SWITCH_PLANE_PACKED]);
+
+    for (x = 0; x < w; x++) {
+      row[x].r = 255;
+      row[x].g = x & 0xff;
+      row[x].b = y & 0xff;
+      row[x].a = (x + y) & 0xff;
+    }
+  }
+
+  return img;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  int sizes[][2] = { { 1280, 720 }, { 1920, 1080 } };
+  int s, loops = 200;
+
+#ifdef BENCHMARK
+  plan(1);
+#else
+  plan(1 + 8);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_color_set_rgb(&red, "#ff0000");
+
+#ifndef BENCHMARK
+  {
+    switch_image_t *IMG = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, 64, 64, 1);
+    switch_image_t *ARGB = switch_img_alloc(NULL, SWITCH_IMG_FMT_ARGB, 64, 64, 1);
+    switch_image_t *img = switch_img_alloc(NULL, SWITCH_IMG_FMT_ARGB, 8, 8, 1);
+    switch_rgb_color_t black = { 0 }, *px;
+    uint32_t *p32;
+
+    switch_color_set_rgb(&black, "#000000");
+    switch_img_fill(IMG, 0, 0, IMG->d_w, IMG->d_h, &black);
+
+    /* opaque red on the left half, transparent on the right */
+    switch_img_fill(img, 0, 0, img->d_w, img->d_h, &red);
+    switch_img_fill(img, 4, 0, 4, img->d_h, &black);
+    px = (switch_rgb_color_t *) img->planes[SWITCH_PLANE_PACKED];
+    ok( px[0].r == 255 && px[4].r == 0 && px[4].a == 255, "ARGB fill honors the rectangle");
+
+    for (s = 0; s < 64; s++) {
+      if (s % 8 >= 4) px[s].a = 0;
+    }
+
+    switch_img_patch(IMG, img, 10, 10);
+    ok( abs(IMG->planes[SWITCH_PLANE_Y][10 * IMG->stride[SWITCH_PLANE_Y] + 10] - 82) <= 1, "Opaque ARGB pixel converted to red luma");
+    ok( abs(IMG->planes[SWITCH_PLANE_V][5 * IMG->stride[SWITCH_PLANE_V] + 5] - 240) <= 1, "Opaque ARGB pixel converted to red chroma");
+    ok( IMG->planes[SWITCH_PLANE_Y][10 * IMG->stride[SWITCH_PLANE_Y] + 15] == 16, "Transparent ARGB pixel leaves luma alone");
+    ok( IMG->planes[SWITCH_PLANE_Y][9 * IMG->stride[SWITCH_PLANE_Y] + 10] == 16, "Pixels outside the patch untouched");
+
+    /* under-patch only lands on transparent pixels */
+    switch_img_fill(ARGB, 0, 0, ARGB->d_w, ARGB->d_h, &black);
+    p32 = (uint32_t *) ARGB->planes[SWITCH_PLANE_PACKED];
+    for (s = 0; s < 8; s++) {
+      ((switch_rgb_color_t *) &p32[s])->a = 0;
+    }
+    switch_img_patch_rgb(ARGB, img, 0, 0, SWITCH_TRUE);
+    px = (switch_rgb_color_t *) ARGB->planes[SWITCH_PLANE_PACKED];
+    ok( px[0].r == 255 && px[0].a == 255, "Under-patch fills a transparent pixel");
+    ok( px[5].a == 0, "Under-patch skips a transparent source pixel");
+    ok( px[ARGB->d_w].r == 0 && px[ARGB->d_w].a == 255, "Under-patch keeps an opaque pixel");
+
+    switch_img_free(&img);
+    switch_img_free(&ARGB);
+    switch_img_free(&IMG);
+  }
+#endif
+
+  for (s = 0; s < 2; s++) {
+    int w = sizes[s][0], h = sizes[s][1];
+    switch_image_t *canvas = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, w, h, 1);
+    switch_image_t *argb_canvas = switch_img_alloc(NULL, SWITCH_IMG_FMT_ARGB, w, h, 1);
+    switch_image_t *banner = make_banner(w - 32, h / 6);
+    switch_image_t *layer = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, w / 2, h / 2, 1);
+    switch_image_t *argb_layer = make_banner(w, h);
+
+    switch_img_fill(layer, 0, 0, layer->d_w, layer->d_h, &red);
+
+    run_bench("switch_img_patch argb banner", bench_patch_argb, canvas, banner, loops);
+    run_bench("switch_img_patch_rgb noalpha", bench_patch_noalpha, argb_canvas, argb_layer, loops);
+    run_bench("switch_img_fill i420", bench_fill, canvas, NULL, loops);
+    run_bench("switch_img_fill argb", bench_fill, argb_canvas, NULL, loops);
+    run_bench("switch_img_overlay i420", bench_overlay, canvas, layer, loops);
+
+    switch_img_free(&canvas);
+    switch_img_free(&argb_canvas);
+    switch_img_free(&banner);
+    switch_img_free(&layer);
+    switch_img_free(&argb_layer);
+  }
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <switch.h>
+#include <switch_curl.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+/* A keep-alive HTTP stub the spool posts to, it can be told to be slow or to fail */
+static struct {
+  switch_memory_pool_t *pool;
+  switch_socket_t *sock;
+  switch_mutex_t *mutex;
+  uint16_t port;
+  volatile int running;
+  int delay_ms;
+  int fail;
+  uint32_t requests;
+  uint32_t records;
+  uint32_t connections;
+  uint32_t failed;
+} stub;
+
+static uint32_t failed_records = 0;
+
+static void *SWITCH_THREAD_FUNC stub_connection(switch_thread_t *thread, void *obj)
+{
+  switch_socket_t *sock = (switch_socket_t *) obj;
+  char buf[65536];
+  switch_size_t used = 0;
+
+  while (stub.running) {
+    char *end, *p;
+    switch_size_t len = sizeof(buf) - used - 1, need;
+    uint32_t records = 1;
+    int fail = 0;
+
+    if (!(end = strstr(buf, "\r\n\r\n"))) {
+      if (switch_socket_recv(sock, buf + used, &len) != SWITCH_STATUS_SUCCESS || !len) {
+        break;
+      }
+      used += len;
+      buf[used] = '\0';
+      continue;
+    }
+
+    need = (end + 4 - buf) + ((p = strstr(buf, "Content-Length: ")) ? atoi(p + 16) : 0);
+
+    while (used < need) {
+      len = sizeof(buf) - used - 1;
+      if (switch_socket_recv(sock, buf + used, &len) != SWITCH_STATUS_SUCCESS || !len) {
+        goto done;
+      }
+      used += len;
+      buf[used] = '\0';
+    }
+
+    if ((p = strstr(buf, "count=")) && p < end) {
+      records = atoi(p + 6);
+    }
+
+    if (stub.delay_ms) {
+      switch_yield(stub.delay_ms * 1000);
+    }
+
+    switch_mutex_lock(stub.mutex);
+    stub.requests++;
+    if (stub.fail > 0) {
+      stub.fail--;
+      stub.failed++;
+      fail = 1;
+    } else {
+      stub.records += records;
+    }
+    switch_mutex_unlock(stub.mutex);
+
+    if (fail) {
+      const char *res = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+      len = strlen(res);
+      switch_socket_send(sock, res, &len);
+    } else {
+      const char *res = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK";
+      len = strlen(res);
+      switch_socket_send(sock, res, &len);
+    }
+
+    memmove(buf, buf + need, used - need);
+    used -= need;
+    buf[used] = '\0';
+  }
+
+ done:
+  switch_socket_close(sock);
+  return NULL;
+}
+
+static void *SWITCH_THREAD_FUNC stub_server(switch_thread_t *thread, void *obj)
+{
+  switch_threadattr_t *thd_attr = NULL;
+
+  switch_threadattr_create(&thd_attr, stub.pool);
+  switch_threadattr_detach_set(thd_attr, 1);
+  switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+  while (stub.running) {
+    switch_socket_t *conn = NULL;
+    switch_thread_t *conn_thread;
+
+    if (switch_socket_accept(&conn, stub.sock, stub.pool) != SWITCH_STATUS_SUCCESS || !stub.running) {
+      break;
+    }
+
+    switch_mutex_lock(stub.mutex);
+    stub.connections++;
+    switch_mutex_unlock(stub.mutex);
+
+    switch_thread_create(&conn_thread, thd_attr, stub_connection, conn, stub.pool);
+  }
+
+  return NULL;
+}
+
+static switch_status_t stub_start(switch_thread_t **thread)
+{
+  switch_sockaddr_t *sa = NULL;
+  switch_threadattr_t *thd_attr = NULL;
+
+  switch_core_new_memory_pool(&stub.pool);
+  switch_mutex_init(&stub.mutex, SWITCH_MUTEX_NESTED, stub.pool);
+
+  if (switch_sockaddr_info_get(&sa, "127.0.0.1", SWITCH_INET, 0, 0, stub.pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_create(&stub.sock, SWITCH_INET, SOCK_STREAM, SWITCH_PROTO_TCP, stub.pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_opt_set(stub.sock, SWITCH_SO_REUSEADDR, 1) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_bind(stub.sock, sa) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_listen(stub.sock, 64) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_addr_get(&sa, SWITCH_FALSE, stub.sock) != SWITCH_STATUS_SUCCESS) {
+    return SWITCH_STATUS_FALSE;
+  }
+
+  stub.port = switch_sockaddr_get_port(sa);
+  stub.running = 1;
+
+  switch_threadattr_create(&thd_attr, stub.pool);
+  switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+  return switch_thread_create(thread, thd_attr, stub_server, NULL, stub.pool);
+}
+
+static void stub_reset(int delay_ms, int fail)
+{
+  switch_mutex_lock(stub.mutex);
+  stub.delay_ms = delay_ms;
+  stub.fail = fail;
+  stub.requests = stub.records = stub.connections = stub.failed = 0;
+  switch_mutex_unlock(stub.mutex);
+  failed_records = 0;
+}
+
+static void count_failed(const char *id, const char *body, switch_size_t len, void *user_data)
+{
+  failed_records++;
+}
+
+static switch_curl_spool_t *make_spool(const char *url, const char *spool_dir, uint32_t batch_size, uint32_t queue_size, uint32_t retries, switch_memory_pool_t *pool)
+{
+  switch_curl_spool_settings_t settings = { 0 };
+  switch_curl_spool_t *spool = NULL;
+  const char *urls[1];
+
+  urls[0] = url;
+  settings.name = "test";
+  settings.urls = urls;
+  settings.url_count = 1;
+  settings.spool_dir = spool_dir;
+  settings.queue_size = queue_size;
+  settings.connections = 4;
+  settings.batch_size = batch_size;
+  settings.retries = retries;
+  settings.timeout = 10;
+  settings.record_prefix = "cdr=";
+  settings.batch_separator = "&";
+  settings.fail = count_failed;
+
+  switch_curl_spool_create(&spool, &settings, pool);
+
+  return spool;
+}
+
+static void submit(switch_curl_spool_t *spool, int count, const char *prefix)
+{
+  char id[64];
+  int x;
+
+  for (x = 0; x < count; x++) {
+    switch_snprintf(id, sizeof(id), "%s-%d", prefix, x);
+    switch_curl_spool_submit(spool, id, "%3Ccdr%3E%3C%2Fcdr%3E");
+  }
+}
+
+/* wait for the spool to drain, the stub can be slow on purpose */
+static int drain(switch_curl_spool_t *spool, int seconds)
+{
+  int x;
+
+  for (x = 0; x < seconds * 100; x++) {
+    if (!switch_curl_spool_backlog(spool)) {
+      return 1;
+    }
+    switch_yield(10000);
+  }
+
+  return 0;
+}
+
+#ifdef BENCHMARK
+static void run_bench(const char *url, uint32_t batch_size, int records, switch_memory_pool_t *pool)
+{
+  switch_curl_spool_t *spool = make_spool(url, NULL, batch_size, records, 1, pool);
+  switch_time_t start_ts, submit_ts, end_ts;
+
+  stub_reset(0, 0);
+
+  start_ts = switch_time_now();
+  submit(spool, records, "bench");
+  submit_ts = switch_time_now();
+  drain(spool, 60);
+  end_ts = switch_time_now();
+
+  note("batch %3u: submit %.3f us per record, delivered %d records in %ldus over %u posts and %u connections, %.0f records per second\n",
+       batch_size, (submit_ts - start_ts) / (double) records, records, (long) (end_ts - start_ts), stub.requests, stub.connections,
+       records * 1000000.0 / (end_ts - start_ts));
+
+  switch_curl_spool_destroy(&spool);
+}
+#endif
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  switch_thread_t *server = NULL;
+  char url[128];
+
+#ifdef BENCHMARK
+  plan(1);
+#else
+  plan(1 + 13);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+
+  if (stub_start(&server) != SWITCH_STATUS_SUCCESS) {
+    bail_out(0, "Bail due to failure to start the HTTP stub");
+  }
+
+  switch_snprintf(url, sizeof(url), "http://127.0.0.1:%u/cdr", stub.port);
+
+#ifndef BENCHMARK
+  {
+    switch_curl_spool_t *spool;
+    char *spool_dir = switch_core_sprintf(pool, "%s%scurl_spool_test_%d", SWITCH_GLOBAL_dirs.temp_dir, SWITCH_PATH_SEPARATOR, (int) getpid());
+
+    stub_reset(0, 0);
+    spool = make_spool(url, NULL, 1, 100, 1, pool);
+    submit(spool, 20, "single");
+    ok( drain(spool, 10) && stub.records == 20 && stub.requests == 20, "Single records all delivered");
+    ok( stub.connections <= 4, "Connections are kept alive between posts");
+    switch_curl_spool_destroy(&spool);
+
+    stub_reset(200, 0);
+    spool = make_spool(url, NULL, 1, 100, 1, pool);
+    submit(spool, 8, "backlog");
+    {
+      int x, counted = 1;
+
+      /* the workers take records off the queue meanwhile, none of them may go uncounted */
+      for (x = 0; x < 50; x++) {
+        if (switch_curl_spool_backlog(spool) != 8) {
+          counted = 0;
+        }
+        switch_yield(1000);
+      }
+      ok( counted, "Records being taken off the queue stay in the backlog");
+    }
+    drain(spool, 10);
+    switch_curl_spool_destroy(&spool);
+
+    stub_reset(0, 2);
+    spool = make_spool(url, NULL, 1, 100, 3, pool);
+    submit(spool, 1, "retry");
+    ok( drain(spool, 10) && stub.records == 1 && stub.requests == 3, "Errors are retried");
+    switch_curl_spool_destroy(&spool);
+
+    stub_reset(0, 100);
+    spool = make_spool(url, NULL, 1, 100, 2, pool);
+    submit(spool, 3, "fail");
+    ok( drain(spool, 10) && failed_records == 3 && stub.requests == 6, "Records are handed back once retries run out");
+    switch_curl_spool_destroy(&spool);
+
+    stub_reset(100, 0);
+    spool = make_spool(url, NULL, 10, 100, 1, pool);
+    submit(spool, 60, "batch");
+    ok( drain(spool, 10) && stub.records == 60, "Batched records all delivered");
+    ok( stub.requests < 60, "Records queued behind a slow server are batched");
+    switch_curl_spool_destroy(&spool);
+
+    stub_reset(100, 0);
+    spool = make_spool(url, spool_dir, 1, 4, 1, pool);
+    submit(spool, 40, "overflow");
+    ok( switch_curl_spool_backlog(spool) == 40 && !failed_records, "Records that do not fit the queue are spooled");
+    ok( drain(spool, 20) && stub.records == 40, "Spooled records delivered once the queue drains");
+    switch_curl_spool_destroy(&spool);
+
+    stub_reset(300, 0);
+    spool = make_spool(url, spool_dir, 1, 100, 1, pool);
+    submit(spool, 20, "restart");
+    switch_curl_spool_destroy(&spool);
+    ok( !failed_records && stub.records < 20, "Pending records are spooled at shutdown");
+    {
+      uint32_t before = stub.records;
+
+      stub_reset(0, 0);
+      spool = make_spool(url, spool_dir, 1, 100, 1, pool);
+      ok( drain(spool, 20) && before + stub.records >= 20, "Records spooled by a previous run are delivered");
+      switch_curl_spool_destroy(&spool);
+    }
+
+    stub_reset(10, 0);
+    spool = make_spool("http://127.0.0.1:1/cdr", NULL, 1, 100, 2, pool);
+    submit(spool, 2, "refused");
+    ok( drain(spool, 10) && failed_records == 2, "Connection errors are handed back");
+    switch_curl_spool_destroy(&spool);
+
+    {
+      switch_stream_handle_t stream = { 0 };
+
+      stub_reset(0, 0);
+      spool = make_spool(url, NULL, 1, 100, 1, pool);
+      submit(spool, 5, "status");
+      drain(spool, 10);
+      SWITCH_STANDARD_STREAM(stream);
+      switch_curl_spool_status(spool, &stream);
+      ok( stream.data && strstr((char *) stream.data, "Delivered        \t5\n") && strstr((char *) stream.data, "Backlog          \t0\n"), "Status reports backlog and counters");
+      switch_safe_free(stream.data);
+      switch_curl_spool_destroy(&spool);
+    }
+
+    rmdir(spool_dir);
+  }
+#else
+  run_bench(url, 1, 10000, pool);
+  run_bench(url, 10, 10000, pool);
+  run_bench(url, 100, 10000, pool);
+#endif
+
+  stub.running = 0;
+  switch_socket_shutdown(stub.sock, SWITCH_SHUTDOWN_READWRITE);
+  switch_socket_close(stub.sock);
+  switch_thread_join(&status, server);
+
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
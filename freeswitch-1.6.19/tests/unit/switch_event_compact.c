@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+static const char *channel_headers[] = {
+  "Event-Name", "CHANNEL_ANSWER",
+  "Core-UUID", "e6e3ff1e-4a53-4d2b-9b1c-7f4e4a61a7a2",
+  "FreeSWITCH-Hostname", "pbx01.example.com",
+  "FreeSWITCH-Switchname", "pbx01.example.com",
+  "FreeSWITCH-IPv4", "10.0.0.10",
+  "Event-Date-Local", "2016-05-04 13:22:05",
+  "Event-Date-GMT", "Wed, 04 May 2016 17:22:05 GMT",
+  "Event-Date-Timestamp", "1462382525663920",
+  "Event-Calling-File", "switch_channel.c",
+  "Event-Calling-Function", "switch_channel_perform_mark_answered",
+  "Event-Calling-Line-Number", "3637",
+  "Event-Sequence", "2190",
+  "Channel-State", "CS_EXECUTE",
+  "Channel-Call-State", "ACTIVE",
+  "Channel-State-Number", "4",
+  "Channel-Name", "sofia/internal/1000@10.0.0.10",
+  "Unique-ID", "5c1b5ec8-1d0e-4bd5-a1c6-7a9d7a5f3b0e",
+  "Call-Direction", "inbound",
+  "Presence-Call-Direction", "inbound",
+  "Channel-HIT-Dialplan", "true",
+  "Channel-Presence-ID", "1000@10.0.0.10",
+  "Channel-Call-UUID", "5c1b5ec8-1d0e-4bd5-a1c6-7a9d7a5f3b0e",
+  "Answer-State", "answered",
+  "Channel-Read-Codec-Name", "PCMU",
+  "Channel-Read-Codec-Rate", "8000",
+  "Channel-Read-Codec-Bit-Rate", "64000",
+  "Channel-Write-Codec-Name", "PCMU",
+  "Channel-Write-Codec-Rate", "8000",
+  "Channel-Write-Codec-Bit-Rate", "64000",
+  "Caller-Direction", "inbound",
+  "Caller-Logical-Direction", "inbound",
+  "Caller-Username", "1000",
+  "Caller-Dialplan", "XML",
+  "Caller-Caller-ID-Name", "Extension 1000",
+  "Caller-Caller-ID-Number", "1000",
+  "Caller-Orig-Caller-ID-Name", "Extension 1000",
+  "Caller-Orig-Caller-ID-Number", "1000",
+  "Caller-Network-Addr", "10.0.0.21",
+  "Caller-ANI", "1000",
+  "Caller-Destination-Number", "9196",
+  "Caller-Unique-ID", "5c1b5ec8-1d0e-4bd5-a1c6-7a9d7a5f3b0e",
+  "Caller-Source", "mod_sofia",
+  "Caller-Context", "default",
+  "Caller-Channel-Name", "sofia/internal/1000@10.0.0.10",
+  "Caller-Profile-Index", "1",
+  "Caller-Profile-Created-Time", "1462382525643920",
+  "Caller-Channel-Created-Time", "1462382525643920",
+  "Caller-Channel-Answered-Time", "1462382525663920",
+  "variable_direction", "inbound",
+  "variable_uuid", "5c1b5ec8-1d0e-4bd5-a1c6-7a9d7a5f3b0e",
+  "variable_session_id", "12",
+  "variable_sip_from_user", "1000",
+  "variable_sip_from_uri", "1000@10.0.0.10",
+  "variable_sip_req_uri", "9196@10.0.0.10",
+  "variable_sip_contact_uri", "sip:1000@10.0.0.21:5060;transport=udp",
+  "variable_sip_user_agent", "Yealink SIP-T46G 28.80.0.95",
+  "variable_sip_via_host", "10.0.0.21",
+  "variable_switch_r_sdp", "v=0\r\no=- 20007 20007 IN IP4 10.0.0.21\r\ns=SDP data\r\nc=IN IP4 10.0.0.21\r\nt=0 0\r\nm=audio 11796 RTP/AVP 0 8 18 101\r\n",
+  "variable_rtp_use_codec_string", "OPUS,G722,PCMU,PCMA,VP8",
+  "variable_current_application", "answer",
+  NULL
+};
+
+static switch_status_t create_plain(switch_event_t **event, const char *data)
+{
+  char *body = strdup(data), *beg = body, *c;
+
+  switch_event_create(event, SWITCH_EVENT_CLONE);
+
+  while ((c = strchr(beg, '\n'))) {
+    char *hname = beg, *hval;
+
+    *c = '\0';
+
+    if ((hval = strchr(hname, ':'))) {
+      *hval++ = '\0';
+      while (*hval == ' ') hval++;
+      switch_url_decode(hval);
+      switch_event_add_header_string(*event, SWITCH_STACK_BOTTOM, hname, hval);
+    }
+
+    beg = c + 1;
+
+    if (*beg == '\n') {
+      break;
+    }
+  }
+
+  free(body);
+
+  return SWITCH_STATUS_SUCCESS;
+}
+
+int main () {
+  switch_event_t *event = NULL, *decoded = NULL;
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_time_t start_ts, end_ts;
+  int loops = 10000, x = 0;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  char *plain = NULL, *json = NULL, *compact = NULL;
+  switch_size_t compact_len = 0;
+  unsigned long long micro_total = 0;
+  double micro_per = 0;
+  double rate_per_sec = 0;
+
+#ifdef BENCHMARK
+  plan(2);
+#else
+  plan(2 + 7);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  status = switch_event_create(&event, SWITCH_EVENT_CHANNEL_ANSWER);
+  ok( status == SWITCH_STATUS_SUCCESS,"Create Event");
+
+  for ( x = 0; channel_headers[x]; x += 2) {
+    switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, channel_headers[x], channel_headers[x + 1]);
+  }
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "variable_codecs", "ARRAY::PCMU|:PCMA|:G722");
+
+  switch_event_serialize(event, &plain, SWITCH_TRUE);
+  switch_event_serialize_json(event, &json);
+  switch_event_serialize_compact(event, &compact, &compact_len);
+
+  note("event size: plain %ld bytes, json %ld bytes, compact %ld bytes\n",
+       (long) strlen(plain), (long) strlen(json), (long) compact_len);
+
+#ifndef BENCHMARK
+  status = switch_event_create_compact(&decoded, compact, compact_len);
+  ok( status == SWITCH_STATUS_SUCCESS, "Decode compact event");
+  ok( decoded && decoded->event_id == SWITCH_EVENT_CHANNEL_ANSWER, "Event id restored from Event-Name");
+  is( switch_event_get_header(decoded, "Caller-Username"), "1000", "Interned header value returned");
+  is( switch_event_get_header(decoded, "variable_switch_r_sdp"), switch_event_get_header(event, "variable_switch_r_sdp"),
+      "Inline header value with newlines returned");
+  is( switch_event_get_header_idx(decoded, "variable_codecs", 2), "G722", "Array header restored");
+  switch_event_destroy(&decoded);
+
+  ok( switch_event_create_compact(&decoded, compact, compact_len - 4) != SWITCH_STATUS_SUCCESS, "Truncated compact event rejected");
+  compact[0] = 0x7f;
+  ok( switch_event_create_compact(&decoded, compact, compact_len) != SWITCH_STATUS_SUCCESS, "Unknown compact version rejected");
+  switch_safe_free(compact);
+  switch_event_serialize_compact(event, &compact, &compact_len);
+#endif
+
+  /* encode */
+  start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    char *str = NULL;
+    switch_event_serialize(event, &str, SWITCH_TRUE);
+    free(str);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("encode plain: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    char *str = NULL;
+    switch_event_serialize_json(event, &str);
+    free(str);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("encode json: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    char *str = NULL;
+    switch_size_t len = 0;
+    switch_event_serialize_compact(event, &str, &len);
+    free(str);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("encode compact: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  /* decode */
+  start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    create_plain(&decoded, plain);
+    switch_event_destroy(&decoded);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("decode plain: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    if (switch_event_create_json(&decoded, json) != SWITCH_STATUS_SUCCESS) {
+      fail("Failed to decode json event");
+      break;
+    }
+    switch_event_destroy(&decoded);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("decode json: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    if (switch_event_create_compact(&decoded, compact, compact_len) != SWITCH_STATUS_SUCCESS) {
+      fail("Failed to decode compact event");
+      break;
+    }
+    switch_event_destroy(&decoded);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  diag("decode compact: Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n",
+       micro_total, loops, micro_per, rate_per_sec);
+
+  switch_safe_free(plain);
+  switch_safe_free(json);
+  switch_safe_free(compact);
+  switch_event_destroy(&event);
+
+  switch_core_destroy();
+
+  done_testing();
+}
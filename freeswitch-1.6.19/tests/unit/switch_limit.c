@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+/* Hits allowed in a row before the first one is turned away */
+static int allowed(switch_rate_limiter_t *limiter, const char *key, uint32_t max, uint32_t interval_ms, uint32_t burst)
+{
+  int x;
+
+  for (x = 0; x < 1000; x++) {
+    if (switch_rate_limiter_check(limiter, key, max, interval_ms, burst) != SWITCH_STATUS_SUCCESS) {
+      break;
+    }
+  }
+
+  return x;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  switch_rate_limiter_t *bucket = NULL, *log = NULL;
+  switch_rate_algorithm_t algorithm;
+  int n;
+
+  plan(1 + 12);
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  switch_rate_limiter_create(&bucket, SWITCH_RATE_TOKEN_BUCKET, 64, 0, pool);
+  switch_rate_limiter_create(&log, SWITCH_RATE_SLIDING_LOG, 64, SWITCH_RATE_LOG_MAX, pool);
+
+  ok( allowed(bucket, "a", 10, 60000, 0) == 10, "Token bucket allows max hits");
+  ok( allowed(bucket, "a", 10, 60000, 0) == 0, "Token bucket turns hits away once empty");
+  ok( allowed(bucket, "b", 10, 60000, 0) == 10, "Keys are limited separately");
+  ok( allowed(bucket, "burst", 10, 60000, 3) == 3, "Token bucket holds up to burst");
+
+  switch_rate_limiter_reset(bucket, "a");
+  ok( allowed(bucket, "a", 10, 60000, 0) == 10, "Reset refills the bucket");
+
+  /* a token every 20ms */
+  ok( allowed(bucket, "refill", 10, 200, 0) == 10, "Token bucket allows max hits per short interval");
+  switch_yield(50000);
+  n = allowed(bucket, "refill", 10, 200, 0);
+  ok( n >= 2 && n < 10, "Token bucket refills max per interval");
+
+  ok( allowed(log, "a", SWITCH_RATE_LOG_MAX, 60000, 0) == SWITCH_RATE_LOG_MAX, "Sliding log allows up to its log size");
+  ok( allowed(log, "b", 5, 200, 0) == 5 && allowed(log, "b", 5, 200, 0) == 0, "Sliding log turns hits away once max is reached");
+  switch_yield(250000);
+  ok( allowed(log, "b", 5, 200, 0) == 5, "Sliding log allows hits again once the interval has passed");
+
+  ok( switch_rate_limiter_check(log, "c", SWITCH_RATE_LOG_MAX + 1, 60000, 0) == SWITCH_STATUS_FALSE &&
+      switch_limit_rate("test", "c", SWITCH_RATE_SLIDING_LOG, SWITCH_RATE_LOG_MAX + 1, 60000) == SWITCH_STATUS_FALSE,
+      "Sliding log rejects a max larger than its log");
+
+  ok( switch_rate_str2algorithm("sliding_log", &algorithm) == SWITCH_STATUS_SUCCESS && algorithm == SWITCH_RATE_SLIDING_LOG &&
+      switch_rate_str2algorithm("bucket", &algorithm) == SWITCH_STATUS_SUCCESS && algorithm == SWITCH_RATE_TOKEN_BUCKET &&
+      switch_rate_str2algorithm("leaky", &algorithm) != SWITCH_STATUS_SUCCESS, "Rate algorithms are parsed by name");
+
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#ifdef BENCHMARK
+static uint32_t rand_state = 1;
+
+/* deterministic so every run benchmarks the same lists */
+static uint32_t next_rand(void)
+{
+  rand_state = rand_state * 1103515245 + 12345;
+  return (rand_state >> 8) ^ (rand_state << 16);
+}
+
+static switch_network_list_t *make_list(int entries, switch_memory_pool_t *pool)
+{
+  switch_network_list_t *list = NULL;
+  char cidr[64];
+  int x;
+
+  switch_network_list_create(&list, "bench", SWITCH_FALSE, pool);
+
+  for (x = 0; x < entries; x++) {
+    uint32_t ip = next_rand();
+    int bits = 16 + next_rand() % 17;
+
+    switch_snprintf(cidr, sizeof(cidr), "%u.%u.%u.%u/%d", ip >> 24, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff, bits);
+    switch_network_list_add_cidr_token(list, cidr, (next_rand() & 7) ? SWITCH_TRUE : SWITCH_FALSE, "customer");
+  }
+
+  return list;
+}
+
+static void run_bench(int entries, int loops, switch_memory_pool_t *pool)
+{
+  switch_network_list_t *list = make_list(entries, pool);
+  switch_time_t start_ts, end_ts;
+  unsigned long long micro_total = 0;
+  double micro_per = 0;
+  double rate_per_sec = 0;
+  int x, hits = 0;
+
+  start_ts = switch_time_now();
+  for (x = 0; x < loops; x++) {
+    const char *token = NULL;
+    hits += switch_network_list_validate_ip_token(list, next_rand(), &token);
+  }
+  end_ts = switch_time_now();
+
+  micro_total = end_ts - start_ts;
+  micro_per = micro_total / (double) loops;
+  rate_per_sec = 1000000 / micro_per;
+  note("validate %d entries: Total %ldus / %d loops, %.3f us per loop, %.0f loops per second (%d allowed)\n",
+       entries, micro_total, loops, micro_per, rate_per_sec, hits);
+}
+#endif
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_memory_pool_t *pool = NULL;
+  int level = SWITCH_LOG_WARNING;
+
+#ifdef BENCHMARK
+  plan(1);
+#else
+  plan(1 + 10);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  /* every added cidr is logged at NOTICE */
+  switch_core_session_ctl(SCSC_LOGLEVEL, &level);
+  switch_core_new_memory_pool(&pool);
+
+#ifndef BENCHMARK
+  {
+    switch_network_list_t *list = NULL;
+    const char *token = NULL;
+    ip_t ip6;
+
+    switch_network_list_create(&list, "test", SWITCH_FALSE, pool);
+    switch_network_list_add_cidr_token(list, "10.0.0.0/8", SWITCH_TRUE, "wide");
+    switch_network_list_add_cidr_token(list, "10.1.0.0/16", SWITCH_FALSE, "narrow");
+    switch_network_list_add_cidr_token(list, "10.1.2.3/32", SWITCH_TRUE, "host");
+    switch_network_list_add_cidr_token(list, "10.2.0.0/16", SWITCH_TRUE, "first");
+    switch_network_list_add_cidr_token(list, "10.2.0.0/16", SWITCH_FALSE, "second");
+    switch_network_list_add_cidr_token(list, "2001:db8::/32", SWITCH_TRUE, "v6");
+    switch_network_list_add_cidr_token(list, "2001:db8:1::/48", SWITCH_FALSE, "v6narrow");
+
+    ok( switch_network_list_validate_ip_token(list, 0x0a050505, &token) && !strcmp(token, "wide"), "Covering prefix allows");
+    ok( !switch_network_list_validate_ip_token(list, 0x0a010505, &token) && !strcmp(token, "narrow"), "More specific deny wins");
+    ok( switch_network_list_validate_ip_token(list, 0x0a010203, &token) && !strcmp(token, "host"), "Host entry wins");
+    ok( !switch_network_list_validate_ip_token(list, 0x0a010204, NULL), "Host entry only matches itself");
+    ok( switch_network_list_validate_ip_token(list, 0x0a020001, &token) && !strcmp(token, "first"), "First of equal prefixes wins");
+    ok( !switch_network_list_validate_ip_token(list, 0x0b000001, NULL), "Default used without a match");
+
+    switch_inet_pton(AF_INET6, "2001:db8::5", &ip6);
+    ok( switch_network_list_validate_ip6_token(list, ip6, &token) && !strcmp(token, "v6"), "IPv6 prefix allows");
+    switch_inet_pton(AF_INET6, "2001:db8:1::5", &ip6);
+    ok( !switch_network_list_validate_ip6_token(list, ip6, &token) && !strcmp(token, "v6narrow"), "More specific IPv6 deny wins");
+    switch_inet_pton(AF_INET6, "2001:db9::5", &ip6);
+    ok( !switch_network_list_validate_ip6_token(list, ip6, NULL), "IPv6 default used without a match");
+
+    switch_network_list_add_host_mask(list, "192.168.0.0", "255.255.0.0", SWITCH_TRUE);
+    ok( switch_network_list_validate_ip_token(list, 0xc0a80101, NULL), "Host mask entry allows");
+  }
+#else
+  run_bench(10, 1000000, pool);
+  run_bench(1000, 1000000, pool);
+  run_bench(100000, 1000000, pool);
+#endif
+
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -15,3 +15,66 @@ tests_unit_switch_hash_CFLAGS = $(SWITCH_AM_CFLAGS)
 tests_unit_switch_hash_LDADD = $(FSLD)
 tests_unit_switch_hash_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
 
+
+check_PROGRAMS += tests/unit/mod_verto_ws
+
+tests_unit_mod_verto_ws_SOURCES = tests/unit/mod_verto_ws.c src/mod/endpoints/mod_verto/ws.c
+tests_unit_mod_verto_ws_CFLAGS = $(SWITCH_AM_CFLAGS) -I$(switch_srcdir)/src/mod/endpoints/mod_verto
+tests_unit_mod_verto_ws_LDADD = $(FSLD)
+tests_unit_mod_verto_ws_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap $(openssl_LIBS)
+
+check_PROGRAMS += tests/unit/switch_event_compact
+
+tests_unit_switch_event_compact_SOURCES = tests/unit/switch_event_compact.c
+tests_unit_switch_event_compact_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_event_compact_LDADD = $(FSLD)
+tests_unit_switch_event_compact_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_core_video
+
+tests_unit_switch_core_video_SOURCES = tests/unit/switch_core_video.c
+tests_unit_switch_core_video_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_core_video_LDADD = $(FSLD)
+tests_unit_switch_core_video_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/mod_hash_limit
+
+tests_unit_mod_hash_limit_SOURCES = tests/unit/mod_hash_limit.c src/mod/applications/mod_hash/limit_store.c
+tests_unit_mod_hash_limit_CFLAGS = $(SWITCH_AM_CFLAGS) -I$(switch_srcdir)/src/mod/applications/mod_hash
+tests_unit_mod_hash_limit_LDADD = $(FSLD)
+tests_unit_mod_hash_limit_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_network_list
+
+tests_unit_switch_network_list_SOURCES = tests/unit/switch_network_list.c
+tests_unit_switch_network_list_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_network_list_LDADD = $(FSLD)
+tests_unit_switch_network_list_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_curl_spool
+
+tests_unit_switch_curl_spool_SOURCES = tests/unit/switch_curl_spool.c
+tests_unit_switch_curl_spool_CFLAGS = $(SWITCH_AM_CFLAGS) $(CURL_CFLAGS)
+tests_unit_switch_curl_spool_LDADD = $(FSLD)
+tests_unit_switch_curl_spool_LDFLAGS = $(SWITCH_AM_LDFLAGS) $(CURL_LIBS) -ltap
+
+check_PROGRAMS += tests/unit/mod_http_cache_progressive
+
+tests_unit_mod_http_cache_progressive_SOURCES = tests/unit/mod_http_cache_progressive.c src/mod/applications/mod_http_cache/common.c src/mod/applications/mod_http_cache/aws.c src/mod/applications/mod_http_cache/azure.c
+tests_unit_mod_http_cache_progressive_CFLAGS = $(SWITCH_AM_CFLAGS) $(CURL_CFLAGS) -I$(switch_srcdir)/src/mod/applications/mod_http_cache
+tests_unit_mod_http_cache_progressive_LDADD = $(FSLD)
+tests_unit_mod_http_cache_progressive_LDFLAGS = $(SWITCH_AM_LDFLAGS) $(CURL_LIBS) -ltap $(openssl_LIBS)
+
+check_PROGRAMS += tests/unit/switch_core_file
+
+tests_unit_switch_core_file_SOURCES = tests/unit/switch_core_file.c
+tests_unit_switch_core_file_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_core_file_LDADD = $(FSLD)
+tests_unit_switch_core_file_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_limit
+
+tests_unit_switch_limit_SOURCES = tests/unit/switch_limit.c
+tests_unit_switch_limit_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_limit_LDADD = $(FSLD)
+tests_unit_switch_limit_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap